@@ -19,45 +19,182 @@
 /**
  * @file Bank.hpp
  *
- * @brief Single element of the photon packet storage bank for MC photoionisation.
+ * @brief Photon packet storage bank for MC photoionisation.
  *
  * @author Daniel Tootill (dt34@st-andrews.ac.uk)
  */
 #ifndef BANK_HPP
 #define BANK_HPP
 
+#include "Checkpoint.hpp"      // checkpoint writer and reader
+#include "ThreadPlacement.hpp" // first touch allocator
+
+#include <algorithm>
 #include <cstdint>
+#include <vector>
 
 /**
- * @brief Single element of the photon packet storage bank.
+ * @brief Photon packet storage bank.
+ *
+ * The bank stores the packets that did not finish their path during a time
+ * step, so that they can continue during the next time step. The packet
+ * variables are stored as separate arrays (structure of arrays), in two
+ * buffers: the current buffer contains the packets stored during the previous
+ * time step, the future buffer receives the packets that are stored during the
+ * current time step. At the end of the time step, the buffers are swapped.
+ *
+ * Packets are stored in the future buffer in the slot with the same index as
+ * the packet itself, so that different threads can safely store packets at the
+ * same time. Slots that do not contain a packet have cell index 0.
  */
 class Bank {
+private:
+  /*! @brief Grid cell for each packet, for both buffers. */
+  std::vector<int, FirstTouchAllocator<int>> _cell[2];
+
+  /*! @brief Remaining optical depth for each packet to travel (or the weight
+   *  of the packet, for MC_ESTIMATOR_PATH_LENGTH), for both buffers. */
+  std::vector<double, FirstTouchAllocator<double>> _taurem[2];
+
+  /*! @brief Current physical position of each packet in its grid cell, in
+   *  relation to the lower boundary (in SI units of m), for both buffers. */
+  std::vector<double, FirstTouchAllocator<double>> _distance[2];
+
+  /*! @brief Index of the current buffer. */
+  unsigned char _current;
+
+  /*! @brief Number of packets in the current buffer. */
+  uint_fast32_t _size;
+
 public:
-  // variables for stored packets to be used in current timestep
+  /**
+   * @brief Constructor.
+   *
+   * Creates an empty bank. No memory is allocated until Bank::reserve is
+   * called.
+   */
+  inline Bank() : _current(0), _size(0) {}
 
-  /*! @brief Current grid cell. */
-  int _currentCell;
-  /*! @brief Remaining optical depth for packet to travel. */
-  double _currentTaurem;
-  /*! @brief Current physical position of packet in grid cell, in relation to 
-   *  lower boundary (in internal units of L). */
-  double _currentDistance;
-  /*! @brief Number of packets stored bank */
-  int _currentnbank;
+  /**
+   * @brief Get the number of packets in the current buffer.
+   *
+   * @return Number of packets stored during the previous time step.
+   */
+  inline uint_fast32_t size() const { return _size; }
 
+  /**
+   * @brief Make sure the future buffer has room for the given number of
+   * packets.
+   *
+   * The bank grows by at least a factor 2, and the contents of the current
+   * buffer are preserved. The packets are propagated with a dynamic schedule,
+   * so the new memory is first touched by all threads, which spreads it evenly
+   * over the sockets.
+   *
+   * @param npacket Number of packets.
+   */
+  inline void reserve(const uint_fast32_t npacket) {
+    if (npacket > _cell[0].size()) {
+      const size_t new_size = std::max<size_t>(npacket, 2 * _cell[0].size());
+      for (unsigned char ibuffer = 0; ibuffer < 2; ++ibuffer) {
+        first_touch_resize(_cell[ibuffer], new_size);
+        first_touch_resize(_taurem[ibuffer], new_size);
+        first_touch_resize(_distance[ibuffer], new_size);
+      }
+    }
+  }
 
+  /**
+   * @brief Get the number of packets the bank can hold without growing.
+   *
+   * @return Capacity of the bank.
+   */
+  inline size_t capacity() const { return _cell[0].size(); }
 
-  // variables for stored packets to be used in future timestep
+  /**
+   * @brief Get the packet with the given index from the current buffer.
+   *
+   * @param index Index of the packet.
+   * @param cell Grid cell of the packet.
+   * @param taurem Remaining optical depth for the packet to travel.
+   * @param distance Position of the packet in its grid cell (in SI units of
+   * m).
+   */
+  inline void get_packet(const uint_fast32_t index, int &cell, double &taurem,
+                         double &distance) const {
+    cell = _cell[_current][index];
+    taurem = _taurem[_current][index];
+    distance = _distance[_current][index];
+  }
 
-  /*! @brief Current grid cell. */
-  int _futureCell;
-  /*! @brief Remaining optical depth for packet to travel. */
-  double _futureTaurem;
-  /*! @brief Current physical position of packet in grid cell, in relation to 
-   *  lower boundary (in internal units of L). */
-  double _futureDistance;
+  /**
+   * @brief Store a packet in the given slot of the future buffer.
+   *
+   * @param slot Slot in the future buffer.
+   * @param cell Grid cell of the packet (0 means no packet is stored in this
+   * slot).
+   * @param taurem Remaining optical depth for the packet to travel.
+   * @param distance Position of the packet in its grid cell (in SI units of
+   * m).
+   */
+  inline void store_packet(const uint_fast32_t slot, const int cell,
+                           const double taurem, const double distance) {
+    const unsigned char future = _current ^ 1;
+    _cell[future][slot] = cell;
+    _taurem[future][slot] = taurem;
+    _distance[future][slot] = distance;
+  }
 
-};
+  /**
+   * @brief Move the packets stored in the first slots of the future buffer to
+   * the front of that buffer (in the same order) and make it the current
+   * buffer.
+   *
+   * @param nslot Number of slots of the future buffer that were used.
+   */
+  inline void swap(const uint_fast32_t nslot) {
+    const unsigned char future = _current ^ 1;
+    int *cell = _cell[future].data();
+    double *taurem = _taurem[future].data();
+    double *distance = _distance[future].data();
+    uint_fast32_t size = 0;
+    for (uint_fast32_t i = 0; i < nslot; ++i) {
+      if (cell[i] > 0) {
+        cell[size] = cell[i];
+        taurem[size] = taurem[i];
+        distance[size] = distance[i];
+        ++size;
+      }
+    }
+    _size = size;
+    _current = future;
+  }
 
+  /**
+   * @brief Add the packets in the current buffer to the given checkpoint.
+   *
+   * @param checkpoint CheckpointWriter.
+   */
+  inline void write_checkpoint(CheckpointWriter &checkpoint) const {
+    checkpoint.write<uint64_t>(_size);
+    checkpoint.write(_cell[_current].data(), _size);
+    checkpoint.write(_taurem[_current].data(), _size);
+    checkpoint.write(_distance[_current].data(), _size);
+  }
+
+  /**
+   * @brief Restore the packets in the current buffer from the given
+   * checkpoint.
+   *
+   * @param checkpoint CheckpointReader.
+   */
+  inline void read_checkpoint(CheckpointReader &checkpoint) {
+    _size = checkpoint.read<uint64_t>();
+    reserve(_size);
+    checkpoint.read(_cell[_current].data(), _size);
+    checkpoint.read(_taurem[_current].data(), _size);
+    checkpoint.read(_distance[_current].data(), _size);
+  }
+};
 
 #endif // BANK_HPP
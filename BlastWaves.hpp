@@ -34,7 +34,8 @@
  * @param ncell Number of cells.
  */
 #define initialize(cells, ncell)                                               \
-  _Pragma("omp parallel for") for (unsigned int i = 1; i < ncell + 1; ++i) {   \
+  _Pragma("omp parallel for schedule(static)")                                 \
+  for (unsigned int i = 1; i < ncell + 1; ++i) {                               \
     cells[i]._rho = 1.;                                                        \
     if (cells[i]._midpoint < 0.1) {                                            \
       cells[i]._P = 1000.;                                                     \
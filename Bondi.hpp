@@ -28,10 +28,24 @@
 
 #include "Cell.hpp"           // Cell class
 #include "Bank.hpp"           // Bank class
-#include "LambertW.hpp"       // Lambert W function implementation
+#include "BondiProfile.hpp"   // neutral Bondi profile
+#include "IonisationBalance.hpp" // ionisation balance solver
+#include "MonteCarloControl.hpp" // adaptive Monte Carlo photon count
+#include "PhotonPropagation.hpp" // photon packet propagation
+#include "PrefixScan.hpp"     // parallel prefix sum
+#include "RandomGenerator.hpp" // Counter-based random number generator
 #include "SafeParameters.hpp" // Safe way to include Parameters.hpp
+#include "ThreadPlacement.hpp" // first touch allocator
 
+#if OFFLOAD == OFFLOAD_OPENMP_TARGET
+#include "OffloadTransport.hpp" // photon transport on an offload device
+#endif
+
+#include <algorithm>
 #include <cmath>
+#include <omp.h>
+#include <unistd.h>
+#include <vector>
 
 /*! @brief Bondi density: density at 
 UNIT_TIME_IN_SI: 1.02197e+09
@@ -49,35 +63,269 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
 #if EOS == EOS_BONDI
 
 /**
- * @brief Initialize the log file used to log the ionisation radius as a
- * function of time.
+ * @brief Declare the log file used to log the ionisation radius as a function
+ * of time (this opens the file), and write a single record to it.
+ *
+ * If SNAPSHOT_TYPE_CONTAINER and SNAPSHOT_CONTAINER_IONISATION_RADIUS are
+ * selected, the records are stored in the snapshot container instead. If
+ * snapshot compression is selected, the records are handed to the snapshot
+ * writer, which compresses them (see SnapshotWriter.hpp).
+ */
+#if (SNAPSHOT_TYPE == SNAPSHOT_TYPE_CONTAINER &&                               \
+     SNAPSHOT_CONTAINER_IONISATION_RADIUS == 1) ||                             \
+    SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_NONE
+#define bondi_rfile_variables
+#define write_bondi_rfile(curtime, ionrad, Cion)                               \
+  snapshot_writer.add_ionisation_radius(curtime, ionrad, Cion);
+#define write_bondi_rfile_checkpoint(checkpoint)
+#define read_bondi_rfile_checkpoint(checkpoint)
+#else
+#define bondi_rfile_variables                                                  \
+  std::ofstream bondi_rfile{output_prefix + "ionisation_radius.dat",           \
+                            restart ? (std::ios::in | std::ios::out)           \
+                                    : std::ios::out};
+#define write_bondi_rfile(curtime, ionrad, Cion)                               \
+  bondi_rfile.write(reinterpret_cast<const char *>(&curtime), sizeof(double)); \
+  bondi_rfile.write(reinterpret_cast<const char *>(&ionrad), sizeof(double));  \
+  bondi_rfile.write(reinterpret_cast<const char *>(&Cion), sizeof(double));    \
+  bondi_rfile.flush();
+/* on restart, we discard the records that were written after the checkpoint */
+#define write_bondi_rfile_checkpoint(checkpoint)                               \
+  checkpoint.write<uint64_t>(bondi_rfile.tellp());
+#define read_bondi_rfile_checkpoint(checkpoint)                                \
+  {                                                                            \
+    const uint64_t rfile_position = checkpoint.read<uint64_t>();               \
+    bondi_rfile.flush();                                                       \
+    if (truncate((output_prefix + "ionisation_radius.dat").c_str(),            \
+                 rfile_position) != 0) {                                       \
+      std::cerr << "Unable to truncate ionisation radius file!" << std::endl;  \
+      abort();                                                                 \
+    }                                                                          \
+    bondi_rfile.seekp(rfile_position);                                         \
+  }
+#endif
+
+/**
+ * @brief Monte Carlo photon transport backend.
+ *
+ * photon_transport_variables declares the photon packet bank and the path
+ * length accumulators, photon_transport_initialize() allocates the latter,
+ * propagate_photon_packets() propagates the npacket
+ * packets: the nbanki packets in the bank and the nemit photons emitted by the
+ * source during this step, and stores the packets that run out of time in the
+ * bank, and get_photon_path_length() declares variables that contain the total
+ * path length and the total squared path length of all packets in a cell
+ * during the step.
  *
- * Only done if the ionisation mode is IONISATION_MODE_SELF_CONSISTENT.
+ * For MC_ESTIMATOR_PATH_LENGTH, the packets are weighted (see
+ * PhotonPropagation.hpp): new packets get the weight mc_weight, and the bank
+ * stores the weight of a packet instead of its remaining optical depth (a
+ * packet is alive as long as either is positive).
+ *
+ * With OFFLOAD_OPENMP_TARGET, the packets are propagated on the offload device
+ * (see OffloadTransport.hpp). Otherwise, they are propagated on the host, and
+ * every thread accumulates path lengths in its own arrays.
+ */
+#if OFFLOAD == OFFLOAD_OPENMP_TARGET
+#define photon_transport_variables OffloadTransport photon_bank{ncell};
+#define photon_transport_initialize()
+#define propagate_photon_packets()                                             \
+  {                                                                            \
+    Timer thread_time;                                                         \
+    photon_bank.propagate(cells, nemit,                                        \
+                          MC_ESTIMATOR == MC_ESTIMATOR_PATH_LENGTH, mc_weight, \
+                          mc_minimum_weight, mc_survival_weight,               \
+                          MC_RANDOM_SEED, mc_step, lstep, UNIT_LENGTH_IN_SI,   \
+                          UNIT_DENSITY_IN_SI / HYDROGEN_MASS_IN_SI);           \
+    phase_timers.add_thread_time(PHASE_IONISATION, 0, thread_time.stop());     \
+  }
+#define get_photon_path_length(k, length, length2)                             \
+  const double length = photon_bank.get_length(k);                             \
+  const double length2 = photon_bank.get_squared_length(k);
+#else
+#define photon_transport_variables                                             \
+  Bank photon_bank;                                                            \
+  const int mc_nthread = max_number_of_threads;                                \
+  double *mc_length = nullptr;                                                 \
+  double *mc_length2 = nullptr;
+#define photon_transport_initialize()                                          \
+  /* the per-thread arrays are part of the memory arena (see                   \
+     get_arena_size() in Simulation.cpp), and are first touched by their own   \
+     thread (see propagate_photon_packets()) */                                \
+  mc_length = arena.allocate<double>(mc_nthread * (ncell + 2));                \
+  mc_length2 = arena.allocate<double>(mc_nthread * (ncell + 2));               \
+  /* size the bank for the packets emitted during two steps, so that it        \
+     normally does not need to grow during the run */                          \
+  photon_bank.reserve(2 * ((MC_TARGET_RELATIVE_ERROR > 0.)                     \
+                               ? MC_MAXIMUM_NUMBER_OF_PHOTONS                  \
+                               : MC_NUMBER_OF_PHOTONS));
+#define propagate_photon_packets()                                             \
+  /* every packet is either stored in the bank slot with its own index or not  \
+     stored at all, so the bank needs room for all of them */                  \
+  photon_bank.reserve(npacket);                                                \
+                                                                               \
+  /* propagate the packets stored in the previous time step and the photons    \
+     emitted by the source in this time step. Every packet has its own random  \
+     number stream, so the result does not depend on the thread that           \
+     propagates it. Every thread records the time it spent on its own packets  \
+     for the phase timers. */                                                  \
+  _Pragma("omp parallel") {                                                    \
+    Timer thread_time;                                                         \
+    /* every thread resets its own path length arrays (and the arrays of       \
+       the threads that are not part of the team, for ensemble members         \
+       that run on fewer threads than mc_nthread), so that they are placed     \
+       on the memory of its socket */                                          \
+    for (int ithread = omp_get_thread_num(); ithread < mc_nthread;             \
+         ithread += omp_get_num_threads()) {                                   \
+      std::fill(&mc_length[ithread * (ncell + 2)],                             \
+                &mc_length[(ithread + 1) * (ncell + 2)], 0.);                  \
+      std::fill(&mc_length2[ithread * (ncell + 2)],                            \
+                &mc_length2[(ithread + 1) * (ncell + 2)], 0.);                 \
+    }                                                                          \
+    double *length = &mc_length[omp_get_thread_num() * (ncell + 2)];           \
+    double *length2 = &mc_length2[omp_get_thread_num() * (ncell + 2)];         \
+    _Pragma("omp for schedule(dynamic, 64) nowait")                            \
+    for (uint_fast32_t j = 0; j < npacket; ++j) {                              \
+      int cell;                                                                \
+      /* remaining optical depth, or weight for MC_ESTIMATOR_PATH_LENGTH */    \
+      double taurem;                                                           \
+      double rcurrent;                                                         \
+      if (j < nbanki) {                                                        \
+        photon_bank.get_packet(j, cell, taurem, rcurrent);                     \
+      } else {                                                                 \
+        cell = 1;                                                              \
+        if (MC_ESTIMATOR == MC_ESTIMATOR_PATH_LENGTH) {                        \
+          taurem = mc_weight;                                                  \
+        } else {                                                               \
+          RandomGenerator random_generator(MC_RANDOM_SEED, mc_step,            \
+                                           j - nbanki);                        \
+          taurem = -std::log(random_generator.get_uniform_random_double());    \
+        }                                                                      \
+        rcurrent = 0.;                                                         \
+      }                                                                        \
+      double lrem = lstep;                                                     \
+      if (MC_ESTIMATOR == MC_ESTIMATOR_PATH_LENGTH) {                          \
+        RandomGenerator random_generator(MC_RANDOM_SEED, mc_step, j);          \
+        while (taurem > 0. && lrem > 0. && cell <= static_cast<int>(ncell)) {  \
+          PROPAGATE_WEIGHTED(cells, length, length2, mc_minimum_weight,        \
+                             mc_survival_weight, random_generator, cell,       \
+                             taurem, rcurrent, lrem);                          \
+        }                                                                      \
+      } else {                                                                 \
+        while (taurem > 0. && lrem > 0. && cell <= static_cast<int>(ncell)) {  \
+          PROPAGATE(cells, length, length2, cell, taurem, rcurrent, lrem);     \
+        }                                                                      \
+      }                                                                        \
+      /* packets that ran out of time are stored for the next time step */     \
+      if (taurem > 0. && lrem == 0. && cell <= static_cast<int>(ncell)) {      \
+        photon_bank.store_packet(j, cell, taurem, rcurrent);                   \
+      } else {                                                                 \
+        photon_bank.store_packet(j, 0, 0., 0.);                                \
+      }                                                                        \
+    }                                                                          \
+    phase_timers.add_thread_time(PHASE_IONISATION, omp_get_thread_num(),       \
+                                 thread_time.stop());                          \
+  }                                                                            \
+  /* make the packets stored this step the packets to be read from next step   \
+     (this preserves the packet order) */                                      \
+  photon_bank.swap(npacket);
+#define get_photon_path_length(k, length, length2)                             \
+  /* reduce the per-thread path lengths (always in the same order) */          \
+  double length = 0.;                                                          \
+  double length2 = 0.;                                                         \
+  for (int ithread = 0; ithread < mc_nthread; ++ithread) {                     \
+    length += mc_length[ithread * (ncell + 2) + k];                            \
+    length2 += mc_length2[ithread * (ncell + 2) + k];                          \
+  }
+#endif
+
+/**
+ * @brief Declare the variables used to compute the ionisation radius, and
+ * initialize them.
+ *
+ * The variables are declared by ionisation_radius_variables, which is used in
+ * class scope (see Simulation.cpp), and are initialized by
+ * ionisation_radius_initialize(). For IONISATION_MODE_SELF_CONSISTENT and
+ * IONISATION_MODE_MONTE_CARLO_TRANSFER, this includes the log file used to log
+ * the ionisation radius as a function of time.
  */
 #if IONISATION_MODE == IONISATION_MODE_SELF_CONSISTENT
-#define initialize_bondi_rfile()                                               \
+#define ionisation_radius_variables                                            \
   double rion_old = 0.;                                                        \
                                                                                \
-  std::ofstream bondi_rfile("ionisation_radius.dat");
+  bondi_rfile_variables                                                        \
+                                                                               \
+  /* prefix sum of the shell recombination budgets */                          \
+  PrefixScan ionisation_scan{ncell};
+#define ionisation_radius_initialize()
 #elif IONISATION_MODE == IONISATION_MODE_MONTE_CARLO_TRANSFER
-#define initialize_bondi_rfile()                                               \
+#define ionisation_radius_variables                                            \
   double rion_old = 0.;                                                        \
                                                                                \
-  std::ofstream bondi_rfile("ionisation_radius.dat");
+  bondi_rfile_variables                                                        \
+                                                                               \
+  /* Monte Carlo transport state: the photon packet bank (see                  \
+     photon_transport_variables), the index of the transport step (this        \
+     selects the random number streams) and the convergence statistics and     \
+     photon count (see MonteCarloControl.hpp) */                               \
+  photon_transport_variables                                                   \
+  uint_fast64_t mc_step = 0;                                                   \
+  MonteCarloControl mc_control{ncell, output_prefix, restart};                 \
+                                                                               \
+  /* ionisation balance solver (see IonisationBalance.hpp) */                  \
+  IonisationBalance ionisation_balance{ncell};
+#define ionisation_radius_initialize() photon_transport_initialize();
 #elif IONISATION_MODE == IONISATION_MODE_CONSTANT
-#define initialize_bondi_rfile()
+#define ionisation_radius_variables
+#define ionisation_radius_initialize()
 #endif
 
 /**
- * @brief Initialize ionisation variables.
+ * @brief Add the state of the ionisation radius computation to the given
+ * checkpoint, or read it back from the given checkpoint during a restart.
  *
- * We need to initialize the smooth transition (if LINEAR_TRANSITION was
- * selected when configuring the code), and the ionising luminosity.
- * We also open the log file in which we will write the ionisation radius as a
- * function of time.
+ * For Monte Carlo transfer, this includes the photon packet bank, the index
+ * of the transport step, so that the random number streams continue where they
+ * left off, and the current number of photons.
  */
-#define ionisation_initialize()                                                \
-  initialize_bondi_rfile();                                                    \
+#if IONISATION_MODE == IONISATION_MODE_SELF_CONSISTENT
+#define bondi_rfile_write_checkpoint(checkpoint)                               \
+  checkpoint.write(rion_old);                                                  \
+  write_bondi_rfile_checkpoint(checkpoint);
+#define bondi_rfile_read_checkpoint(checkpoint)                                \
+  checkpoint.read(rion_old);                                                   \
+  read_bondi_rfile_checkpoint(checkpoint);
+#elif IONISATION_MODE == IONISATION_MODE_MONTE_CARLO_TRANSFER
+#define bondi_rfile_write_checkpoint(checkpoint)                               \
+  checkpoint.write(rion_old);                                                  \
+  write_bondi_rfile_checkpoint(checkpoint);                                    \
+  checkpoint.write(mc_step);                                                   \
+  photon_bank.write_checkpoint(checkpoint);                                    \
+  mc_control.write_checkpoint(checkpoint);
+#define bondi_rfile_read_checkpoint(checkpoint)                                \
+  checkpoint.read(rion_old);                                                   \
+  read_bondi_rfile_checkpoint(checkpoint);                                     \
+  checkpoint.read(mc_step);                                                    \
+  photon_bank.read_checkpoint(checkpoint);                                     \
+  mc_control.read_checkpoint(checkpoint);
+#elif IONISATION_MODE == IONISATION_MODE_CONSTANT
+#define bondi_rfile_write_checkpoint(checkpoint)
+#define bondi_rfile_read_checkpoint(checkpoint)
+#endif
+
+/**
+ * @brief Declare the ionisation variables.
+ *
+ * These are the parameters of the smooth transition (if LINEAR_TRANSITION was
+ * selected when configuring the code), the ionising luminosity, and the
+ * variables used to compute the ionisation radius (including the log file in
+ * which we will write the ionisation radius as a function of time).
+ *
+ * This declares class members (see Simulation.cpp), so it can only contain
+ * declarations. The variables are initialized by ionisation_initialize().
+ */
+#define ionisation_variables                                                   \
+  ionisation_radius_variables                                                  \
                                                                                \
   const double bondi_S =                                                       \
       (transition_width > 0.) ? 3. / (2. * transition_width) : 0.;             \
@@ -89,19 +337,35 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
   const double bondi_volume_correction_factor = 4. * M_PI / 3. / CELLSIZE *    \
     (RMIN * RMIN * RMIN - bondi_rmin * bondi_rmin * bondi_rmin);*/             \
   const double bondi_volume_correction_factor = 0.;                            \
-  std::cout << "Bondi volume correction factor: "                              \
-            << bondi_volume_correction_factor << std::endl;                    \
+                                                                               \
+  /* luminosity needed to ionise out until the requested ionisation radius */  \
+  double const_bondi_Q = 0.;                                                   \
+  /* current value of the central mass (only used to increase the luminosity   \
+     over time). Currently not really used. */                                 \
+  double central_mass = MASS_POINT_MASS;
+
+/**
+ * @brief Initialize ionisation variables.
+ *
+ * We need to compute the ionising luminosity, and to initialize the variables
+ * used to compute the ionisation radius.
+ */
+#define ionisation_initialize()                                                \
+  ionisation_radius_initialize();                                              \
+                                                                               \
+  output << "Bondi volume correction factor: "                                 \
+         << bondi_volume_correction_factor << std::endl;                       \
                                                                                \
   /* set the Q value to the value that is needed to ionise out until the       \
      requested ionisation radius */                                            \
-  _Pragma("omp parallel for") for (uint_fast32_t i = 1; i < ncell + 1; ++i) {  \
+  _Pragma("omp parallel for schedule(static)")                                 \
+  for (uint_fast32_t i = 1; i < ncell + 1; ++i) {                              \
     const double rmin = cells[i]._lowlim;                                      \
     const double rmax = cells[i]._uplim;                                       \
     const double Vshell = (rmax * rmax * rmax - rmin * rmin * rmin) / 3.;      \
     const double Cshell = Vshell * cells[i]._rho * cells[i]._rho;              \
     cells[i]._nfac = Cshell;                                                   \
   }                                                                            \
-  double const_bondi_Q = 0.;                                                   \
   for (uint_fast32_t i = 1; i < ncell + 1; ++i) {                              \
     const double rmin = cells[i]._lowlim;                                      \
     const double rmax = cells[i]._uplim;                                       \
@@ -117,10 +381,7 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
       const_bondi_Q += Cshell;                                                 \
     }                                                                          \
   }                                                                            \
-  std::cout << "Bondi Q: " << const_bondi_Q << std::endl;                      \
-  /* current value of the central mass (only used to increase the luminosity   \
-     over time). Currently not really used. */                                 \
-  double central_mass = MASS_POINT_MASS;
+  output << "Bondi Q: " << const_bondi_Q << std::endl;
 
 /**
  * @brief Set the initial value for the pressure of the given cell.
@@ -152,42 +413,52 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
  * @brief Compute the ionisation radius by numerically integrating the density
  * squared until the desired target luminosity is reached.
  *
+ * The shell budgets and their prefix sum are computed in parallel (see
+ * PrefixScan.hpp), and the front is located in the first shell for which the
+ * remaining budget is smaller than the shell budget. The result does not
+ * depend on the number of threads.
+ *
  * This is only done if IONISATION_MODE_SELF_CONSISTENT is chosen during
  * configuration.
  */
 #if IONISATION_MODE == IONISATION_MODE_SELF_CONSISTENT
 #define get_ionisation_radius()                                                \
-  /* first loop */                                                             \
-  _Pragma("omp parallel for") for (uint_fast32_t i = 1; i < ncell + 1; ++i) {  \
-    const double rmin = cells[i]._lowlim;                                      \
-    const double rmax = cells[i]._uplim;                                       \
+  /* compute the recombination budget of every shell and its prefix sum in     \
+     parallel */                                                               \
+  ionisation_scan.compute([&](const uint_fast32_t ishell) {                    \
+    const Cell &shell = cells[ishell + 1];                                     \
+    const double rmin = shell._lowlim;                                         \
+    const double rmax = shell._uplim;                                          \
     const double Vshell = (rmax * rmax * rmax - rmin * rmin * rmin) / 3.;      \
-    const double Cshell = Vshell * cells[i]._rho * cells[i]._rho;              \
-    cells[i]._nfac = Cshell;                                                   \
-  }                                                                            \
+    return Vshell * shell._rho * shell._rho;                                   \
+  });                                                                          \
                                                                                \
-  /* second loop */                                                            \
+  /* find the first shell that is not completely ionised: the shell for which  \
+     the remaining budget is smaller than the shell budget */                  \
   /* note that the get_bondi_Q_factor part defaults to 1 for now */            \
   double Cion =                                                                \
       const_bondi_Q * get_bondi_Q_factor(central_mass / MASS_POINT_MASS);      \
+  double Cbefore;                                                              \
+  const uint_fast32_t ifront = ionisation_scan.find_first(                     \
+      [Cion](const double Cprefix, const double Cshell) {                      \
+        const double Crem = Cion - Cprefix;                                    \
+        return !(Crem > 0. && Crem >= Cshell);                                 \
+      },                                                                       \
+      Cbefore);                                                                \
   double rion = 0.;                                                            \
-  for (uint_fast32_t i = 1; i < ncell + 1; ++i) {                              \
-    if (Cion > 0.) {                                                           \
-      const double rmin = cells[i]._lowlim;                                    \
-      const double rmax = cells[i]._uplim;                                     \
-      const double ifac = std::min(1., Cion / cells[i]._nfac);                 \
-      if (ifac < 1.) {                                                         \
-        if (ifac > 0.) {                                                       \
-          const double nfac = 1. - ifac;                                       \
-          rion = std::cbrt(ifac * rmax * rmax * rmax +                         \
-                           nfac * rmin * rmin * rmin);                         \
-        }                                                                      \
-      } else {                                                                 \
-        rion = rmax;                                                           \
-      }                                                                        \
-      /* subtract this shell's ionisation budget from the total */             \
-      Cion -= ifac * cells[i]._nfac;                                           \
+  if (ifront < ncell && Cion - Cbefore > 0.) {                                 \
+    /* the front lies inside this shell */                                     \
+    const double rmin = cells[ifront + 1]._lowlim;                             \
+    const double rmax = cells[ifront + 1]._uplim;                              \
+    const double ifac =                                                        \
+        (Cion - Cbefore) / ionisation_scan.get_value(ifront);                  \
+    if (ifac > 0.) {                                                           \
+      const double nfac = 1. - ifac;                                           \
+      rion = std::cbrt(ifac * rmax * rmax * rmax + nfac * rmin * rmin * rmin); \
     }                                                                          \
+  } else if (ifront > 0) {                                                     \
+    /* all shells up to the front are completely ionised */                    \
+    rion = cells[ifront]._uplim;                                               \
   }                                                                            \
   /* check if we need to write to the file */                                  \
   if (std::abs(rion - rion_old) > 1.e-4 * std::abs(rion + rion_old)) {         \
@@ -195,63 +466,43 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
         current_integer_time * time_conversion_factor * UNIT_TIME_IN_SI;       \
     const double ionrad = rion * UNIT_LENGTH_IN_SI;                            \
     Cion = const_bondi_Q * get_bondi_Q_factor(central_mass / MASS_POINT_MASS); \
-    bondi_rfile.write(reinterpret_cast<const char *>(&curtime),                \
-                      sizeof(double));                                         \
-    bondi_rfile.write(reinterpret_cast<const char *>(&ionrad),                 \
-                      sizeof(double));                                         \
-    bondi_rfile.write(reinterpret_cast<const char *>(&Cion), sizeof(double));  \
-    bondi_rfile.flush();                                                       \
+    write_bondi_rfile(curtime, ionrad, Cion);                                  \
     rion_old = rion;                                                           \
   }
 #elif IONISATION_MODE == IONISATION_MODE_CONSTANT
 #define get_ionisation_radius() const double rion = INITIAL_IONISATION_RADIUS;
 #elif IONISATION_MODE == IONISATION_MODE_MONTE_CARLO_TRANSFER
 #define get_ionisation_radius()                                                \
-  /*const double rmin=cells[0]._lowlim*UNIT_LENGTH_IN_SI;*/                    \
-  const double rmax=cells[ncell+1]._uplim;                                     \
-  double Qion = 1.E47;                                                         \
-  /*double timepassed=current_integer_time*time_conversion_factor;*/           \
-  double taurem;                                                               \
-  double rcurrent;                                                             \
-  double lrem=SPEED_OF_LIGHT_IN_SI*cells[1]._dt*UNIT_TIME_IN_SI;               \
-  double rion=0.0;							               \
-  int nphoton=1000;                                                            \
-  int cell;                                                                    \
-  int sizebank=10000000;                                                       \
-  int nbanki=P_Store[0]._currentnbank;                                         \
-  int nbank=0;                                                                 \
-  _Pragma("omp parallel for")                                                  \
-  for (uint_fast32_t k = 1; k < ncell+1; ++k){                                 \
-    cells[k]._jmean=0.0; cells[k]._length=0.0;}                                \
+  const double rmax = cells[ncell + 1]._uplim;                                 \
+  const double Qion = MC_IONISING_LUMINOSITY_IN_SI;                            \
+  /* the mean intensity is normalised to MC_NUMBER_OF_PHOTONS photons; the     \
+     source emits nemit photons with weight mc_weight during this step (see    \
+     MonteCarloControl.hpp) */                                                 \
+  const uint_fast32_t nphoton = MC_NUMBER_OF_PHOTONS;                          \
+  const uint_fast32_t nemit = mc_control.get_number_of_photons();              \
+  const double mc_weight = mc_control.get_initial_weight();                    \
+  const double mc_minimum_weight =                                             \
+      MONTECARLOCONTROL_ROULETTE_MINIMUM_WEIGHT * mc_weight;                   \
+  const double mc_survival_weight =                                            \
+      MONTECARLOCONTROL_ROULETTE_SURVIVAL_WEIGHT * mc_weight;                  \
+  const uint_fast32_t nbanki = photon_bank.size();                             \
+  const uint_fast32_t npacket = nbanki + nemit;                                \
+  /* system time step (in internal units of T) */                              \
+  const double mc_dt = current_integer_dt * time_conversion_factor;            \
+  /* distance light travels during this time step (in SI units of m) */        \
+  const double lstep = SPEED_OF_LIGHT_IN_SI * mc_dt * UNIT_TIME_IN_SI;         \
+  double rion = 0.0;                                                           \
                                                                                \
-  /* loop over packets stored in previous timestep */                          \
-  for(uint_fast32_t j=0;j<nbanki;j++){                                         \
-    taurem=P_Store[j]._currentTaurem;                                          \
-    cell=P_Store[j]._currentCell;                                              \
-    rcurrent=P_Store[j]._currentDistance;                                      \
-    lrem=SPEED_OF_LIGHT_IN_SI*cells[0]._dt*UNIT_TIME_IN_SI;                    \
-    if(cell>ncell){continue;}                                                  \
-    if(rcurrent==0.0 && taurem==0.0){continue;}                                \
-    if(rcurrent!=0.0){                                                         \
-      ICT(cells,P_Store,cell,taurem,rcurrent,lrem,nbank);}                     \
-    while(taurem > 0.0 && lrem>0.0){                                           \
-      PROPAGATE(cells,P_Store,cell,taurem,lrem,nbank);}                        \
-      }                                                                        \
-                                                                               \
-  /*loop over photons emitted from source in this timestep*/                   \
-  for(uint_fast32_t j=0;j<nphoton;j++){                                        \
-    taurem=-log(((double) rand()/RAND_MAX));                                   \
-    cell=1;                                                                    \
-    lrem=SPEED_OF_LIGHT_IN_SI*cells[1]._dt*UNIT_TIME_IN_SI;                    \
-    while(taurem>0.0 && lrem >0.0){                                            \
-      if (cell>ncell) {break;}                                                 \
-        PROPAGATE(cells,P_Store,cell,taurem,lrem,nbank);}                      \
-      }                                                                        \
+  /* propagate the photon packets (see propagate_photon_packets()) */          \
+  propagate_photon_packets();                                                  \
                                                                                \
-  /* calculate mean intensity in each cell based on total path length          \    
+  /* calculate mean intensity in each cell based on total path length          \
    * travelled through cell*/                                                  \
-  _Pragma("omp parallel for")                                                  \
+  _Pragma("omp parallel for schedule(static)")                                 \
   for (uint_fast32_t k = 1; k < ncell+1; ++k){                                 \
+    get_photon_path_length(k, length, length2);                                \
+    cells[k]._length = length;                                                 \
+    mc_control.set_squared_length(k, length2);                                 \
     double vcell;                                                              \
     if ((cells[k]._lowlim*UNIT_LENGTH_IN_SI)==0.0){                            \
       vcell=4./3.*M_PI*std::pow(cells[k]._V*UNIT_LENGTH_IN_SI,3);}             \
@@ -261,29 +512,17 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
     cells[k]._jmean=                                                           \
        (Qion*cells[k]._sigma*cells[k]._length)/(nphoton*vcell);}               \
                                                                                \
-  /*update neutral fraction in each cell*/	                               \
-  _Pragma("omp parallel for")                                                  \
-    for (int k = 1; k < ncell+1; ++k){                                         \
-      UPDATE_ION(cells,k,/*timepassed,*/cells[1]._dt*UNIT_TIME_IN_SI);         \
-      cells[k]._last_jmean=cells[k]._jmean;}                                   \
+  /* convergence statistics and number of photons for the next step */         \
+  mc_control.update(cells, ncell, npacket,                                     \
+                    current_integer_time * time_conversion_factor *            \
+                        UNIT_TIME_IN_SI);                                      \
                                                                                \
-  /* finish simulation if number of photons that are being stored              \
-   * exceeds size of bankelse set number of photons stored this step           \
-   * as nbanki and reset nbank to 0 */                                         \
-  if (nbank>sizebank){                                                         \
-    break;}                                                                    \
+  /* update the neutral fraction in each cell (see IonisationBalance.hpp) */   \
+  ionisation_balance.update(cells, ncell, mc_dt * UNIT_TIME_IN_SI,             \
+                            UNIT_DENSITY_IN_SI / HYDROGEN_MASS_IN_SI,          \
+                            MC_IONISATION_SOLVER);                             \
                                                                                \
-  /* shift packets stored this step to first three columns of bank to          \
-   * be read from next step */                                                 \
-  _Pragma("omp parallel for")                                                  \
-  for(uint_fast32_t j=0;j<nbank;j++){                                          \
-    P_Store[j]._currentTaurem=P_Store[j]._futureTaurem;                        \
-    P_Store[j]._currentCell=P_Store[j]._futureCell;                            \
-    P_Store[j]._currentDistance=P_Store[j]._futureDistance;                    \
-    P_Store[j]._futureTaurem=0.0;                                              \
-    P_Store[j]._futureDistance=0.0;                                            \
-    P_Store[j]._futureCell=0;}			                               \
-  P_Store[0]._currentnbank=nbank;                                              \
+  ++mc_step;                                                                   \
                                                                                \
   /* calculate rion */                                                         \
   for (uint_fast32_t k=1;k<ncell+2;k++){                                       \
@@ -300,12 +539,7 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
         current_integer_time * time_conversion_factor * UNIT_TIME_IN_SI;       \
     const double ionrad = rion * UNIT_LENGTH_IN_SI;                            \
     double Cion = Qion;                                                        \
-    bondi_rfile.write(reinterpret_cast<const char *>(&curtime),                \
-                      sizeof(double));                                         \
-    bondi_rfile.write(reinterpret_cast<const char *>(&ionrad),                 \
-                      sizeof(double));                                         \
-    bondi_rfile.write(reinterpret_cast<const char *>(&Cion), sizeof(double));  \
-    bondi_rfile.flush();                                                       \
+    write_bondi_rfile(curtime, ionrad, Cion);                                  \
     rion_old = rion;                                                           \
   }
 #endif
@@ -330,7 +564,8 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
   /* third loop */                                                             \
   const double rion_min = rion - 0.5 * transition_width;                       \
   const double rion_max = rion + 0.5 * transition_width;                       \
-  _Pragma("omp parallel for") for (uint_fast32_t i = 1; i < ncell + 1; ++i) {  \
+  _Pragma("omp parallel for schedule(static)")                                 \
+  for (uint_fast32_t i = 1; i < ncell + 1; ++i) {                              \
     cells[i]._nfac =                                                           \
         get_neutral_fraction(cells[i]._lowlim, cells[i]._uplim, rion,          \
                              rion_min, rion_max, bondi_S, bondi_A);            \
@@ -347,27 +582,73 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
 #define flux_into_inner_mask(mflux)                                            \
   central_mass -= mflux * bondi_volume_correction_factor;
 
+/**
+ * @brief Add the ionisation state to the given checkpoint.
+ *
+ * @param checkpoint CheckpointWriter.
+ */
+#define ionisation_write_checkpoint(checkpoint)                                \
+  bondi_rfile_write_checkpoint(checkpoint);                                    \
+  checkpoint.write(const_bondi_Q);                                             \
+  checkpoint.write(central_mass);
+
+/**
+ * @brief Read the ionisation state from the given checkpoint.
+ *
+ * @param checkpoint CheckpointReader.
+ */
+#define ionisation_read_checkpoint(checkpoint)                                 \
+  bondi_rfile_read_checkpoint(checkpoint);                                     \
+  checkpoint.read(const_bondi_Q);                                              \
+  checkpoint.read(central_mass);
+
+/**
+ * @brief Radius of the ionisation front, used for the grid refinement.
+ *
+ * This is the ionisation radius rion computed by do_ionisation() during the
+ * current step.
+ */
+#define ionisation_front_radius() rion
+
+/**
+ * @brief Mass of the central point mass, used for the in-situ analysis.
+ *
+ * This includes the mass accreted through the inner boundary (see
+ * flux_into_inner_mask()).
+ */
+#define ionisation_central_mass() central_mass
+
 #endif // EOS == EOS_BONDI
 
 // boundary condition functionality
 #if BOUNDARIES == BOUNDARIES_BONDI
 
+/**
+ * @brief Declare the variables used for the boundary conditions.
+ *
+ * This declares class members (see Simulation.cpp), so it can only contain
+ * declarations. The variables are initialized by
+ * boundary_conditions_initialize().
+ */
+#define boundary_conditions_variables                                          \
+  const BondiProfile bondi_boundary_profile{BONDI_DENSITY,                     \
+                                            ISOTHERMAL_C_SQUARED};             \
+  double bondi_density_high, bondi_velocity_high, bondi_pressure_high;         \
+  double bondi_density_max, bondi_velocity_max, bondi_pressure_max;
+
 /**
  * @brief Initialize variables used for the boundary conditions.
  *
  * We need to initialize the outer boundary variables.
  */
 #define boundary_conditions_initialize()                                       \
-  const double bondi_r_inv_high = RBONDI / cells[ncell + 1]._midpoint;         \
-  const double bondi_density_high = bondi_density(bondi_r_inv_high);           \
-  const double bondi_velocity_high = bondi_velocity(bondi_r_inv_high);         \
-  const double bondi_pressure_high = bondi_pressure(bondi_r_inv_high);         \
+  bondi_boundary_profile.get_primitive_variables(                              \
+      RBONDI / cells[ncell + 1]._midpoint, bondi_density_high,                 \
+      bondi_velocity_high, bondi_pressure_high);                               \
                                                                                \
-  const double bondi_rmax_inv =                                                \
-      RBONDI / (cells[ncell + 1]._midpoint + CELLSIZE);                        \
-  const double bondi_density_max = bondi_density(bondi_rmax_inv);              \
-  const double bondi_velocity_max = bondi_velocity(bondi_rmax_inv);            \
-  const double bondi_pressure_max = bondi_pressure(bondi_rmax_inv);
+  bondi_boundary_profile.get_primitive_variables(                              \
+      RBONDI / (cells[ncell + 1]._midpoint + cells[ncell + 1]._V),             \
+      bondi_density_max, bondi_velocity_max, bondi_pressure_max);
 
 /**
  * @brief Apply boundary conditions after the primitive variable conversion.
@@ -398,8 +679,8 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
   /* upper boundary: compute gradient using the known expression outside rmax  \
    */                                                                          \
   {                                                                            \
-    const double dx_inv = 1. / CELLSIZE;                                       \
-    const double half_dx = HALF_CELLSIZE;                                      \
+    const double dx_inv = 1. / cells[ncell + 1]._V;                            \
+    const double half_dx = 0.5 * cells[ncell + 1]._V;                          \
                                                                                \
     const double gradrho = (bondi_density_max - cells[ncell]._rho) * dx_inv;   \
     const double rhomax = std::max(cells[ncell]._rho, bondi_density_max);      \
@@ -457,12 +738,7 @@ Newton G: 6.67408e-11 m^3 kg^-1 s^-2the neutral Bondi radius (in internal units
  * @return Bondi velocity squared divided by the sound speed squared.
  */
 double u2_over_cs2(double rinv) {
-  const double lambertarg = -std::exp(3. + 4. * (std::log(rinv) - rinv));
-  if (rinv < 1.) {
-    return -LambertW::lambert_w(lambertarg, 0);
-  } else {
-    return -LambertW::lambert_w(lambertarg, -1);
-  }
+  return BondiProfile::get_exact_u2_over_cs2(rinv);
 }
 
 /**
@@ -475,7 +751,7 @@ double u2_over_cs2(double rinv) {
 double bondi_density(double rinv) {
   // we need to manually disable the density very close to r = 0 to prevent
   // errors in the Lambert W function
-  if (rinv < 150.) {
+  if (rinv < BONDIPROFILE_MAXIMUM_INVERSE_RADIUS) {
     return BONDI_DENSITY * std::exp(-0.5 * u2_over_cs2(rinv) + 2. * rinv - 1.5);
   } else {
     return 0.;
@@ -666,164 +942,86 @@ inline static double get_neutral_fraction(const double rmin, const double rmax,
  * @param ncell Number of cells.
  */
 #define initialize(cells, ncell)                                               \
-  _Pragma("omp parallel for") for (unsigned int i = 1; i < ncell + 1; ++i) {   \
-    const double r_inv = RBONDI / RMAX;                                        \
-    cells[i]._rho = bondi_density(r_inv);                                      \
-    cells[i]._u = bondi_velocity(r_inv);                                       \
-    cells[i]._P = ISOTHERMAL_C_SQUARED * cells[i]._rho;                        \
-    const double r2 = cells[i]._midpoint * cells[i]._midpoint;                 \
-    cells[i]._a = -G_INTERNAL * MASS_POINT_MASS / r2;                          \
-    cells[i]._nfac = 0.;                                                       \
+  {                                                                            \
+    /* the inflow values are the same for all cells, so that we only need to  \
+       evaluate the Bondi profile once */                                      \
+    const BondiProfile bondi_initial_profile(BONDI_DENSITY,                    \
+                                             ISOTHERMAL_C_SQUARED);            \
+    double rho_inflow, u_inflow, P_inflow;                                     \
+    bondi_initial_profile.get_primitive_variables(RBONDI / RMAX, rho_inflow,   \
+                                                  u_inflow, P_inflow);         \
+    _Pragma("omp parallel for schedule(static)")                               \
+    for (unsigned int i = 1; i < ncell + 1; ++i) {                             \
+      cells[i]._rho = rho_inflow;                                              \
+      cells[i]._u = u_inflow;                                                  \
+      cells[i]._P = P_inflow;                                                  \
+      const double r2 = cells[i]._midpoint * cells[i]._midpoint;               \
+      cells[i]._a = -G_INTERNAL * MASS_POINT_MASS / r2;                        \
+      cells[i]._nfac = 0.;                                                     \
+    }                                                                          \
   }
 
 #endif // IC == IC_BONDI
 
 /**
- * @brief Store photon packets for which distance travelled exceeds that 
- * allowed in one timestep.
- *
- * @param cell Cell location of packet to be stored.
- * @param taurem Remaining optical depth packet has to travel.
- * @param radius Distance from current cell lower boundary that packet has 
- * travelled (in internal units of L).
- * @param stored Number of packets added to bank so far this timestep
- */
-
-void BANK(Bank* P_Store,int& cell,double& taurem,double& radius,int& stored){
-  P_Store[stored]._futureCell=cell;                                           
-  P_Store[stored]._futureDistance=radius;                                     
-  P_Store[stored]._futureTaurem=taurem;                                       
-  stored++;}                                                                   
-  
-/**
- * @brief Propagates stored packets through to end of cell in which they were
- * stored (if they can reach end of cell in timestep without being absorbed).
+ * @brief Propagates packet through current cell. If packet is unable to
+ * reach end of cell either absorbed (remaining optical depth to travel
+ * less than cell optical depth) and terminated, or halted (if cannot
+ * travel physical distance of cell in remaining timestep) so that the caller
+ * can bank it.
  *
- * @param cell Cell location of packet.
- * @param taurem Remaining optical depth packet has to travel.
- * @param rcurrent Distance from current cell lower boundary that packet has 
- * travelled (in internal units of L).
- * @param lrem Distance packet can travel in this timestep (in internal units 
- * of L).
- * @param stored Number of packets added to bank so far this timestep
- */
-
-void ICT(Cell* cells,Bank* P_Store,int& cell, double& taurem,double& rcurrent,
-         double& lrem,int& stored){                                 
-  double taucell=                                                             
-              cells[cell]._sigma*(cells[cell]._V*UNIT_LENGTH_IN_SI-rcurrent)* 
-              cells[cell]._rho*(UNIT_DENSITY_IN_SI/HYDROGEN_MASS_IN_SI)*      
-              cells[cell]._nfac_MC;                                              
-  if (taurem>taucell && lrem>(cells[cell]._V*UNIT_LENGTH_IN_SI-rcurrent)){    
-    cells[cell]._length+=(cells[cell]._V*UNIT_LENGTH_IN_SI-rcurrent);         
-    taurem-=taucell;                                                          
-    lrem-=(cells[cell]._V*UNIT_LENGTH_IN_SI-rcurrent);                        
-    cell++;                                                                   
-    rcurrent=0.0;}                                                            
-  else {                                                                      
-    double taulength=                                                         
-              taurem/(cells[cell]._rho*                                       
-              (UNIT_DENSITY_IN_SI/HYDROGEN_MASS_IN_SI)*cells[cell]._nfac_MC*     
-              cells[cell]._sigma);                                            
-    if (taulength<=lrem){                                                     
-    cells[cell]._length+=taulength;                                           
-    taurem=0.0;}                                                              
-    else{                                                                     
-      cells[cell]._length+=lrem;                                              
-      taurem-=(cells[cell]._rho*(UNIT_DENSITY_IN_SI/HYDROGEN_MASS_IN_SI)*     
-               cells[cell]._nfac_MC*cells[cell]._sigma*lrem);                    
-      rcurrent+=lrem;                                                       
-      if (stored<=10000000){BANK(P_Store,cell,taurem,rcurrent,stored);}               
-      else{stored++;}                                                         
-      lrem=0.0;}                                                              
-     }}                                                                       
-  
-
-/**
- * @brief Propagates packet through current cell. If packet is unable to  
- * reach end of  cell either absorbed (remaining optical depth to travel 
- * less than cell optical depth) and terminated, or banked (if cannot  
- * travel physical distance of cell in remaining timestep). 
+ * Path lengths are added to the given accumulator instead of the cells, so
+ * that different threads can propagate packets at the same time.
  *
+ * @param cells Cells.
+ * @param length Path length accumulator for each cell (in SI units of m).
+ * @param length2 Squared path length accumulator for each cell (in SI units of
+ * m^2).
  * @param cell Cell location of packet.
  * @param taurem Remaining optical depth packet has to travel.
- * @param lrem Distance packet can travel in this timestep (in internal  
- * units of L).
- * @param stored Number of packets added to bank so far this timestep
+ * @param rcurrent Distance from current cell lower boundary that packet has
+ * travelled (in SI units of m).
+ * @param lrem Distance packet can travel in this timestep (in SI units of m).
+ * Is set to exactly zero if the packet runs out of time.
  */
-
-void PROPAGATE(Cell* cells,Bank* P_Store, int& cell,double& taurem,
-               double& lrem,int& stored){
-  double taucell=                                                              
-              cells[cell]._sigma*cells[cell]._V*UNIT_LENGTH_IN_SI*             
-              cells[cell]._rho*(UNIT_DENSITY_IN_SI/HYDROGEN_MASS_IN_SI)*       
-              cells[cell]._nfac_MC;                                              
-  if (taurem>taucell && lrem>cells[cell]._V*UNIT_LENGTH_IN_SI){                
-    cells[cell]._length+=cells[cell]._V*UNIT_LENGTH_IN_SI;                     
-    taurem-=taucell;                                                           
-    lrem-=cells[cell]._V*UNIT_LENGTH_IN_SI;                                    
-    cell++;}                                                                   
-  else {                                                                       
-    double taulength=                                                          
-              taurem/(cells[cell]._rho*                                        
-              (UNIT_DENSITY_IN_SI/HYDROGEN_MASS_IN_SI)*cells[cell]._nfac_MC*      
-              cells[cell]._sigma);                                             
-    if (taulength<=lrem){                                                      
-    cells[cell]._length+=taulength;                                            
-    taurem=0.0;}                                                              
-    else{                                                                      
-      cells[cell]._length+=lrem;                                               
-      taurem-=(cells[cell]._rho*(UNIT_DENSITY_IN_SI/HYDROGEN_MASS_IN_SI)*      
-               cells[cell]._nfac_MC*cells[cell]._sigma*lrem);                   
-      if (stored<=10000000){BANK(P_Store,cell,taurem,lrem,stored);}                    
-      else{stored++;}                                                          
-      lrem=0.0;}                                                               
-    }}                                                                         
+inline static void PROPAGATE(const Cell *cells, double *length,
+                             double *length2, int &cell, double &taurem,
+                             double &rcurrent, double &lrem) {
+  propagate_packet<false>(cells[cell]._V * UNIT_LENGTH_IN_SI, cells[cell]._rho,
+                          UNIT_DENSITY_IN_SI / HYDROGEN_MASS_IN_SI,
+                          cells[cell]._nfac_MC, cells[cell]._sigma,
+                          length[cell], length2[cell], cell, taurem, rcurrent,
+                          lrem);
+}
 
 /**
- * @brief updates neutral fraction in cell according to solution to 
- * differential equation df/dt=(1-f)*jmean-f^2*(ntot*alphaB) where f is the
- * ionised fraction of the cell.
+ * @brief Propagate a weighted packet through its current cell (for
+ * MC_ESTIMATOR_PATH_LENGTH).
  *
+ * @param cells Cells.
+ * @param length Path length accumulator for each cell (in SI units of m).
+ * @param length2 Squared path length accumulator for each cell (in SI units of
+ * m^2).
+ * @param minimum_weight Weight below which Russian roulette is played.
+ * @param survival_weight Weight of packets that survive Russian roulette.
+ * @param random_generator Random number stream of the packet.
  * @param cell Cell location of packet.
- * @param timep t_0 : simulation time of previous step
- * @param delta Simulation time since t_0
+ * @param weight Weight of the packet (set to 0 if it is terminated).
+ * @param rcurrent Distance from current cell lower boundary that packet has
+ * travelled (in SI units of m).
+ * @param lrem Distance packet can travel in this timestep (in SI units of m).
+ * Is set to exactly zero if the packet runs out of time.
  */
-
-void UPDATE_ION(Cell* cells,int& cell,/*timep,*/double delta){ 
-  double ConB=                                                                
-              (cells[cell]._alphaB*(cells[cell]._rho*                         
-              (UNIT_DENSITY_IN_SI/HYDROGEN_MASS_IN_SI)));                     
-  /*double last_ConB=                                                         
-              (cells[cell]._alphaB*(cells[cell]._last_rho*                    
-              (UNIT_DENSITY_IN_SI/HYDROGEN_MASS_IN_SI)));*/                   
-  if(cells[cell]._nfac_MC==1.0){                                                
-    cells[cell]._ifrac=                                                       
-              cells[cell]._ft0+cells[cell]._jmean*delta;/*+                   
-              (cells[cell]._jmean-cells[cell]._last_jmean)*timep;*/           
-    if(cells[cell]._ifrac>1.0){                                               
-      cells[cell]._nfac_MC=1.0E-8;                                               
-      cells[cell]._ifrac=1.0-cells[cell]._nfac_MC;}                              
-    else{cells[cell]._nfac_MC=1.0-cells[cell]._ifrac;}                           
-    cells[cell]._ft0=cells[cell]._ifrac;                                      
-  }                                                                           
-  else{                                                                       
-    if(cells[cell]._jmean==0.0 or cells[cell]._nfac_MC==0.0){ 
-      cells[cell]._ifrac=1./((1./cells[cell]._ft0)+ConB*delta);               
-      cells[cell]._nfac_MC=1.0-cells[cell]._ifrac;                               
-      cells[cell]._ft0=cells[cell]._ifrac;}                                   
-    else{   
-      double IoR=(cells[cell]._jmean)/ConB;                                   
-      double root=std::sqrt(IoR*(IoR+4.));                                         
-      /*double last_IoR=(cells[cell]._last_jmean)/last_ConB;                  
-      double last_root=sqrt(last_IoR*(last_IoR+4.));*/                        
-      double arg=(2*cells[cell]._ft0+IoR)/root;                               
-      double arg2=0.5*ConB*root*delta;
-      cells[cell]._ifrac=                                                     
-              0.5*root*((arg+std::tanh(arg2))/(1.+arg*std::tanh(arg2)))-
-              0.5*IoR;        
-      cells[cell]._nfac_MC=1.0-cells[cell]._ifrac;                          
-      cells[cell]._ft0=cells[cell]._ifrac;}                                   
-  }}
+inline static void
+PROPAGATE_WEIGHTED(const Cell *cells, double *length, double *length2,
+                   const double minimum_weight, const double survival_weight,
+                   RandomGenerator &random_generator, int &cell,
+                   double &weight, double &rcurrent, double &lrem) {
+  propagate_weighted_packet<false>(
+      cells[cell]._V * UNIT_LENGTH_IN_SI, cells[cell]._rho,
+      UNIT_DENSITY_IN_SI / HYDROGEN_MASS_IN_SI, cells[cell]._nfac_MC,
+      cells[cell]._sigma, minimum_weight, survival_weight, random_generator,
+      length[cell], length2[cell], cell, weight, rcurrent, lrem);
+}
 
 #endif // BONDI_HPP
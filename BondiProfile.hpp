@@ -0,0 +1,308 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file BondiProfile.hpp
+ *
+ * @brief Neutral isothermal Bondi profile: density, velocity and pressure as a
+ * function of the inverse radius.
+ *
+ * The profile is completely determined by the squared Mach number
+ * @f$M^2 = u^2/c_s^2@f$, which is given by a Lambert W function of the inverse
+ * radius @f$x = R_B/r@f$:
+ * @f[
+ *   M^2 = -W\left(-{\rm{}e}^{3 + 4(\ln(x) - x)}\right),
+ * @f]
+ * with the @f$W_0@f$ branch for @f$x < 1@f$ and the @f$W_{-1}@f$ branch for
+ * @f$x \geq{} 1@f$. The density, velocity and pressure are then
+ * @f[
+ *   \rho = \rho_B {\rm{}e}^{-M^2/2 + 2x - 3/2}, \quad
+ *   u = -c_s M, \quad
+ *   P = c_s^2 \rho.
+ * @f]
+ *
+ * A BondiProfile computes @f$M^2@f$ only once for every requested radius, and
+ * returns all three quantities at once. It has two modes:
+ *  - exact mode: every request evaluates the Lambert W function (with its
+ *    default relative accuracy of 1.e-10), or, close to the sonic point, an
+ *    equivalent equation that does not suffer from round off error (see
+ *    get_sonic_point_u2_over_cs2()).
+ *  - tabulated mode: @f$\ln(M^2)@f$ is tabulated on a uniform grid in
+ *    @f$\ln(x)@f$ over a given range, and interpolated using cubic Lagrange
+ *    interpolation. @f$\ln(M^2)@f$ is a smooth, almost linear function of
+ *    @f$\ln(x)@f$, so that the interpolation error scales as @f$h^4@f$, with
+ *    @f$h@f$ the table spacing. The constructor measures the error in between
+ *    all table points, where it is largest (see get_maximum_relative_error()).
+ *    With BONDIPROFILE_DEFAULT_POINTS_PER_DECADE table points per decade, the
+ *    relative error @f$\epsilon{}@f$ on @f$M^2@f$ is below 1.e-12 (and the
+ *    error is 16 times smaller for every doubling of the number of points),
+ *    while a table lookup is about 10 times faster than an exact evaluation.
+ *    The relative error on the velocity is then @f$\epsilon{}/2@f$, and the
+ *    relative error on the density and pressure @f$M^2 \epsilon{}/2@f$.
+ *    Requests outside the table range use the exact evaluation.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef BONDIPROFILE_HPP
+#define BONDIPROFILE_HPP
+
+#include "LambertW.hpp" // Lambert W function implementation
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*! @brief Default number of table points per decade in inverse radius for a
+ *  tabulated BondiProfile. */
+#define BONDIPROFILE_DEFAULT_POINTS_PER_DECADE 1000
+
+/*! @brief Distance from the sonic point (in inverse radius) within which the
+ *  squared Mach number is computed without the Lambert W function. */
+#define BONDIPROFILE_SONIC_POINT_WIDTH 0.01
+
+/*! @brief Inverse radius above which the density is set to zero, to prevent
+ *  errors in the Lambert W function very close to r = 0. */
+#define BONDIPROFILE_MAXIMUM_INVERSE_RADIUS 150.
+
+/**
+ * @brief Neutral isothermal Bondi profile.
+ */
+class BondiProfile {
+private:
+  /*! @brief Density at the Bondi radius (in internal units of M L^-3). */
+  const double _bondi_density;
+
+  /*! @brief Isothermal sound speed squared (in internal units of L^2 T^-2). */
+  const double _cs2;
+
+  /*! @brief Natural logarithm of the lower limit of the table range. */
+  double _log_xmin;
+
+  /*! @brief Inverse of the table spacing in natural logarithm of inverse
+   *  radius. */
+  double _inverse_spacing;
+
+  /*! @brief Tabulated natural logarithm of the squared Mach number (empty in
+   *  exact mode). */
+  std::vector<double> _log_M2;
+
+  /*! @brief Maximum relative error on the squared Mach number in the table
+   *  range (0 in exact mode). */
+  double _maximum_relative_error;
+
+  /**
+   * @brief Interpolate the natural logarithm of the squared Mach number in the
+   * table.
+   *
+   * @param log_x Natural logarithm of the inverse radius, within the table
+   * range.
+   * @return Interpolated natural logarithm of the squared Mach number.
+   */
+  inline double interpolate_log_M2(const double log_x) const {
+    const double t = (log_x - _log_xmin) * _inverse_spacing;
+    // the 4 point stencil i-1, i, i+1, i+2 needs to fit inside the table
+    const int_fast32_t ilast = _log_M2.size() - 3;
+    const int_fast32_t i = std::min(std::max<int_fast32_t>(t, 1),
+                                    std::max<int_fast32_t>(ilast, 1));
+    const double s = t - i;
+    const double sm1 = s + 1.;
+    const double sp1 = s - 1.;
+    const double sp2 = s - 2.;
+    return -_log_M2[i - 1] * s * sp1 * sp2 / 6. +
+           _log_M2[i] * sm1 * sp1 * sp2 / 2. -
+           _log_M2[i + 1] * sm1 * s * sp2 / 2. +
+           _log_M2[i + 2] * sm1 * s * sp1 / 6.;
+  }
+
+  /**
+   * @brief Get @f$\ln(1+t) - t@f$ for a small value @f$t@f$, without round off
+   * error.
+   *
+   * @param t Value @f$t@f$ (@f$|t| < 0.1@f$).
+   * @return @f$\ln(1+t) - t@f$, computed from its Taylor series.
+   */
+  inline static double log1p_minus_identity(const double t) {
+    double tk = t * t;
+    double sum = 0.;
+    for (uint_fast32_t k = 2; k < 18; ++k) {
+      sum += ((k % 2 == 0) ? -tk : tk) / k;
+      tk *= t;
+    }
+    return sum;
+  }
+
+  /**
+   * @brief Get the squared Mach number close to the sonic point.
+   *
+   * Close to the sonic point, the Lambert W argument is very close to the
+   * branch point @f$-1/{\rm{}e}@f$, where the Lambert W function is very
+   * sensitive to the round off error on its argument (an argument error of
+   * @f$\delta{}@f$ yields a result error of order @f$\sqrt{\delta{}}@f$).
+   * We therefore directly solve the Bondi equation
+   * @f$\ln(M^2) - M^2 = 3 + 4(\ln(x) - x)@f$ written in terms of
+   * @f$y = M^2 - 1@f$ and @f$d = x - 1@f$:
+   * @f[
+   *   \ln(1+y) - y = 4 \left(\ln(1+d) - d\right),
+   * @f]
+   * using Newton-Raphson iterations that start from the leading order
+   * solution @f$y = 2d@f$ (the transonic solution has @f$y@f$ and @f$d@f$ of
+   * the same sign).
+   *
+   * @param d Inverse radius minus 1 (@f$|d| <@f$
+   * BONDIPROFILE_SONIC_POINT_WIDTH).
+   * @return Bondi velocity squared divided by the sound speed squared.
+   */
+  inline static double get_sonic_point_u2_over_cs2(const double d) {
+    if (d == 0.) {
+      return 1.;
+    }
+    const double rhs = 4. * log1p_minus_identity(d);
+    double y = 2. * d;
+    for (uint_fast32_t i = 0; i < 20; ++i) {
+      const double dy = (log1p_minus_identity(y) - rhs) * (1. + y) / y;
+      y += dy;
+      if (std::abs(dy) <= 1.e-15 * std::abs(y)) {
+        break;
+      }
+    }
+    return 1. + y;
+  }
+
+public:
+  /**
+   * @brief Get the exact squared Mach number at the given inverse radius.
+   *
+   * @param rinv Inverse radius (in units of RBONDI^-1).
+   * @return Bondi velocity squared divided by the sound speed squared.
+   */
+  inline static double get_exact_u2_over_cs2(const double rinv) {
+    const double d = rinv - 1.;
+    if (std::abs(d) < BONDIPROFILE_SONIC_POINT_WIDTH) {
+      return get_sonic_point_u2_over_cs2(d);
+    }
+    const double lambertarg = -std::exp(3. + 4. * (std::log(rinv) - rinv));
+    if (rinv < 1.) {
+      return -LambertW::lambert_w(lambertarg, 0);
+    } else {
+      return -LambertW::lambert_w(lambertarg, -1);
+    }
+  }
+
+  /**
+   * @brief Constructor for an exact profile.
+   *
+   * @param bondi_density Density at the Bondi radius (in internal units of
+   * M L^-3).
+   * @param cs2 Isothermal sound speed squared (in internal units of L^2 T^-2).
+   */
+  inline BondiProfile(const double bondi_density, const double cs2)
+      : _bondi_density(bondi_density), _cs2(cs2), _log_xmin(0.),
+        _inverse_spacing(0.), _maximum_relative_error(0.) {}
+
+  /**
+   * @brief Constructor for a tabulated profile.
+   *
+   * @param bondi_density Density at the Bondi radius (in internal units of
+   * M L^-3).
+   * @param cs2 Isothermal sound speed squared (in internal units of L^2 T^-2).
+   * @param rinv_min Lower limit of the table range in inverse radius (in units
+   * of RBONDI^-1).
+   * @param rinv_max Upper limit of the table range in inverse radius (in units
+   * of RBONDI^-1).
+   * @param points_per_decade Number of table points per decade in inverse
+   * radius.
+   */
+  inline BondiProfile(const double bondi_density, const double cs2,
+                      const double rinv_min, const double rinv_max,
+                      const uint_fast32_t points_per_decade =
+                          BONDIPROFILE_DEFAULT_POINTS_PER_DECADE)
+      : _bondi_density(bondi_density), _cs2(cs2) {
+
+    _log_xmin = std::log(rinv_min);
+    const double log_range = std::log(rinv_max) - _log_xmin;
+    // we need at least 4 points for the interpolation stencil
+    const uint_fast32_t npoint = std::max<uint_fast32_t>(
+        4, std::ceil(points_per_decade * log_range / std::log(10.)) + 1);
+    _inverse_spacing = (npoint - 1) / log_range;
+    _log_M2.resize(npoint);
+    for (uint_fast32_t i = 0; i < npoint; ++i) {
+      const double rinv = std::exp(_log_xmin + i / _inverse_spacing);
+      _log_M2[i] = std::log(get_exact_u2_over_cs2(rinv));
+    }
+
+    // the interpolation error is largest in between table points
+    _maximum_relative_error = 0.;
+    for (uint_fast32_t i = 0; i < npoint - 1; ++i) {
+      const double log_x = _log_xmin + (i + 0.5) / _inverse_spacing;
+      const double M2 = get_exact_u2_over_cs2(std::exp(log_x));
+      const double error = std::abs(std::exp(interpolate_log_M2(log_x)) - M2);
+      _maximum_relative_error = std::max(_maximum_relative_error, error / M2);
+    }
+  }
+
+  /**
+   * @brief Get the maximum relative error on the squared Mach number (and on
+   * quantities derived from it) within the table range.
+   *
+   * @return Maximum relative error, measured in between all table points (0 in
+   * exact mode).
+   */
+  inline double get_maximum_relative_error() const {
+    return _maximum_relative_error;
+  }
+
+  /**
+   * @brief Get the squared Mach number at the given inverse radius.
+   *
+   * @param rinv Inverse radius (in units of RBONDI^-1).
+   * @return Bondi velocity squared divided by the sound speed squared.
+   */
+  inline double get_u2_over_cs2(const double rinv) const {
+    if (!_log_M2.empty()) {
+      const double log_x = std::log(rinv);
+      const double t = (log_x - _log_xmin) * _inverse_spacing;
+      if (t >= 0. && t <= _log_M2.size() - 1.) {
+        return std::exp(interpolate_log_M2(log_x));
+      }
+    }
+    return get_exact_u2_over_cs2(rinv);
+  }
+
+  /**
+   * @brief Get the density, velocity and pressure at the given inverse radius.
+   *
+   * @param rinv Inverse radius (in units of RBONDI^-1).
+   * @param rho Density (in internal units of M L^-3).
+   * @param u Velocity (in internal units of L T^-1).
+   * @param P Pressure (in internal units of M L^-1 T^-2).
+   */
+  inline void get_primitive_variables(const double rinv, double &rho,
+                                      double &u, double &P) const {
+    const double M2 = get_u2_over_cs2(rinv);
+    if (rinv < BONDIPROFILE_MAXIMUM_INVERSE_RADIUS) {
+      rho = _bondi_density * std::exp(-0.5 * M2 + 2. * rinv - 1.5);
+    } else {
+      rho = 0.;
+    }
+    u = -std::sqrt(_cs2 * M2);
+    P = _cs2 * rho;
+  }
+};
+
+#endif // BONDIPROFILE_HPP
@@ -33,6 +33,14 @@
 
 #else // BOUNDARIES == BOUNDARIES_BONDI
 
+/**
+ * @brief Declare variables used for the boundary conditions.
+ *
+ * Open or reflective boundaries don't have associated variables, so this method
+ * does nothing.
+ */
+#define boundary_conditions_variables
+
 /**
  * @brief Initialize variables used for the boundary conditions.
  *
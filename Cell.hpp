@@ -116,10 +116,7 @@ public:
   // ADAPTIVE OUTPUT
 
   /*! @brief Index of the cell (for identification in the log file). */
-  uint_least16_t _index;
-
-  /*! @brief Last log file entry offset. */
-  uint_least64_t _last_entry;
+  uint_least32_t _index;
 
   /*! @brief Last density value that was written to the log file (in internal
    *  units of M L^-3). */
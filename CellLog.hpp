@@ -0,0 +1,348 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file CellLog.hpp
+ *
+ * @brief Event log of significant changes in the cell variables, written to a
+ * memory-mapped LogFile.
+ *
+ * The log file consists of a sequence of fixed size LogRecord entries, followed
+ * by a footer:
+ *  - block index: for every call to CellLog::write(), a double containing the
+ *    time (in s), a uint64 containing the offset of the first record written
+ *    during that call and a uint64 containing the number of records
+ *  - cell index: for every cell and every log entry type (in cell major
+ *    order), a uint64 containing the number of records and a uint64 containing
+ *    the offset of the last record
+ *  - trailer: a CellLogTrailer
+ * The records are written in parallel: every thread first counts the records it
+ * needs to write for its own contiguous range of cells, after which every
+ * thread fills its own part of a single reserved region. The records are hence
+ * stored in cell order within a block, independent of the number of threads.
+ *
+ * snapshotgenerator.cpp contains a reader for the log file.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef CELLLOG_HPP
+#define CELLLOG_HPP
+
+#include "Cell.hpp"           // Cell class
+#include "Checkpoint.hpp"     // checkpoint writer and reader
+#include "LogFile.hpp"        // memory-mapped log file
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+#include "Units.hpp"          // unit information
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <omp.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Practical names for log entry numbers.
+ */
+enum LogEntry {
+  LOGENTRY_DENSITY = 0,
+  LOGENTRY_VELOCITY,
+  LOGENTRY_PRESSURE,
+  LOGENTRY_NFRAC,
+  NUMBER_OF_LOGENTRIES
+};
+
+/**
+ * @brief Single record in the log file.
+ */
+class LogRecord {
+public:
+  /*! @brief Index of the cell. */
+  uint32_t _index;
+
+  /*! @brief Log entry type (a LogEntry value). */
+  uint32_t _entry;
+
+  /*! @brief Simulation time (in s). */
+  double _time;
+
+  /*! @brief Value of the variable (in SI units). */
+  double _value;
+};
+
+/**
+ * @brief Trailer at the end of the log file.
+ */
+class CellLogTrailer {
+public:
+  /*! @brief Number of cells. */
+  uint64_t _number_of_cells;
+
+  /*! @brief Number of log entry types. */
+  uint64_t _number_of_entries;
+
+  /*! @brief Number of blocks. */
+  uint64_t _number_of_blocks;
+
+  /*! @brief Offset of the block index in the file. */
+  uint64_t _block_index_offset;
+
+  /*! @brief Offset of the cell index in the file. */
+  uint64_t _cell_index_offset;
+
+  /*! @brief Signature: "HCS1DLOG". */
+  char _signature[8];
+};
+
+/**
+ * @brief Event log of significant changes in the cell variables.
+ */
+class CellLog {
+private:
+  /*! @brief Memory-mapped log file. */
+  LogFile _file;
+
+  /*! @brief Number of cells. */
+  const uint_fast32_t _ncell;
+
+  /*! @brief Number of records for every cell and log entry type. */
+  std::vector<uint64_t> _number_of_records;
+
+  /*! @brief Offset of the last record for every cell and log entry type. */
+  std::vector<uint64_t> _last_record;
+
+  /*! @brief Time of every block (in s). */
+  std::vector<double> _block_time;
+
+  /*! @brief Offset of the first record in every block. */
+  std::vector<uint64_t> _block_offset;
+
+  /*! @brief Number of records in every block. */
+  std::vector<uint64_t> _block_size;
+
+  /*! @brief Per thread record counts, converted into per thread record offsets
+   *  within the block. */
+  std::vector<uint_fast64_t> _thread_offset;
+
+  /**
+   * @brief Check if the value for the given log entry variable has changed
+   * significantly since the last output.
+   *
+   * @param logentry Log entry identifier.
+   * @param cell Cell to check.
+   * @return True if the value needs to be written to the log file.
+   */
+  inline static bool changed(const int logentry, const Cell &cell) {
+    // tolerance: If the relative difference of the value and the last outputted
+    // value is less than this value, no output is written
+    const double tol = LOGFILE_TOLERANCE;
+    switch (logentry) {
+    case LOGENTRY_DENSITY:
+      return std::abs(cell._rho - cell._last_rho) >
+             tol * std::abs(cell._rho + cell._last_rho);
+    case LOGENTRY_VELOCITY:
+      return std::abs(cell._u - cell._last_u) >
+             tol * std::abs(cell._u + cell._last_u);
+    case LOGENTRY_PRESSURE:
+      return std::abs(cell._P - cell._last_P) >
+             tol * std::abs(cell._P + cell._last_P);
+    case LOGENTRY_NFRAC:
+      return std::abs(cell._nfac - cell._last_nfac) >
+             tol * std::abs(cell._nfac + cell._last_nfac);
+    default:
+      return false;
+    }
+  }
+
+  /**
+   * @brief Get the value for the given log entry variable.
+   *
+   * @param logentry Log entry identifier.
+   * @param cell Cell for which we want the variable.
+   * @return Value of the variable.
+   */
+  inline static double get_value(const int logentry, Cell &cell) {
+    switch (logentry) {
+    case LOGENTRY_DENSITY:
+      cell._last_rho = cell._rho;
+      return cell._rho * UNIT_DENSITY_IN_SI;
+    case LOGENTRY_VELOCITY:
+      cell._last_u = cell._u;
+      return cell._u * UNIT_VELOCITY_IN_SI;
+    case LOGENTRY_PRESSURE:
+      cell._last_P = cell._P;
+      return cell._P * UNIT_PRESSURE_IN_SI;
+    case LOGENTRY_NFRAC:
+      cell._last_nfac = cell._nfac;
+      return cell._nfac;
+    default:
+      return 0.;
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param filename Name of the log file.
+   * @param size Size of the memory-mapped buffer, in MB.
+   * @param ncell Number of cells.
+   * @param number_of_threads Maximum number of threads that will be used during
+   * the run.
+   */
+  inline CellLog(const std::string filename, const size_t size,
+                 const uint_fast32_t ncell,
+                 const int number_of_threads = omp_get_max_threads())
+      : _file(filename, size), _ncell(ncell),
+        _number_of_records(ncell * NUMBER_OF_LOGENTRIES, 0),
+        _last_record(ncell * NUMBER_OF_LOGENTRIES, 0),
+        _thread_offset(number_of_threads + 1, 0) {}
+
+  /**
+   * @brief Write significantly changed variables to the log file.
+   *
+   * @param cells Cells to write.
+   * @param time Current simulation time (in internal units of T).
+   * @param full_dump If set to True, dumps all cells irrespective of variable
+   * changes.
+   */
+  inline void write(Cell *cells, const double time,
+                    const bool full_dump = false) {
+    const uint_fast32_t ncell = _ncell;
+    const double time_SI = time * UNIT_TIME_IN_SI;
+    const uint64_t block_offset = _file.get_current_position();
+    char *region = nullptr;
+#pragma omp parallel
+    {
+      const uint_fast32_t ithread = omp_get_thread_num();
+      const uint_fast32_t nthread = omp_get_num_threads();
+      // every thread handles a contiguous range of cells
+      const uint_fast32_t ibegin = 1 + (ithread * ncell) / nthread;
+      const uint_fast32_t iend = 1 + ((ithread + 1) * ncell) / nthread;
+
+      // count the records this thread needs to write
+      uint_fast64_t count = 0;
+      for (uint_fast32_t i = ibegin; i < iend; ++i) {
+        for (int logentry = 0; logentry < NUMBER_OF_LOGENTRIES; ++logentry) {
+          if (full_dump || changed(logentry, cells[i])) {
+            ++count;
+          }
+        }
+      }
+      _thread_offset[ithread + 1] = count;
+
+#pragma omp barrier
+#pragma omp single
+      {
+        // convert the counts into offsets and reserve a single region for all
+        // records
+        _thread_offset[0] = 0;
+        for (uint_fast32_t jthread = 0; jthread < nthread; ++jthread) {
+          _thread_offset[jthread + 1] += _thread_offset[jthread];
+        }
+        region = _file.reserve(_thread_offset[nthread] * sizeof(LogRecord));
+      }
+      // implicit barrier at the end of the single region
+
+      // now fill this thread's part of the region
+      uint_fast64_t irecord = _thread_offset[ithread];
+      for (uint_fast32_t i = ibegin; i < iend; ++i) {
+        for (int logentry = 0; logentry < NUMBER_OF_LOGENTRIES; ++logentry) {
+          if (full_dump || changed(logentry, cells[i])) {
+            LogRecord record;
+            record._index = cells[i]._index;
+            record._entry = logentry;
+            record._time = time_SI;
+            record._value = get_value(logentry, cells[i]);
+            std::memcpy(region + irecord * sizeof(LogRecord), &record,
+                        sizeof(LogRecord));
+            const uint_fast64_t icell =
+                (i - 1) * NUMBER_OF_LOGENTRIES + logentry;
+            ++_number_of_records[icell];
+            _last_record[icell] = block_offset + irecord * sizeof(LogRecord);
+            ++irecord;
+          }
+        }
+      }
+    }
+
+    _block_time.push_back(time_SI);
+    _block_offset.push_back(block_offset);
+    _block_size.push_back((_file.get_current_position() - block_offset) /
+                          sizeof(LogRecord));
+  }
+
+  /**
+   * @brief Add the state of the log to the given checkpoint.
+   *
+   * @param checkpoint CheckpointWriter.
+   */
+  inline void write_checkpoint(CheckpointWriter &checkpoint) const {
+    checkpoint.write<uint64_t>(_file.get_current_position());
+    checkpoint.write(_number_of_records);
+    checkpoint.write(_last_record);
+    checkpoint.write(_block_time);
+    checkpoint.write(_block_offset);
+    checkpoint.write(_block_size);
+  }
+
+  /**
+   * @brief Restore the state of the log from the given checkpoint.
+   *
+   * The existing log file is continued at the position where the checkpoint
+   * was written.
+   *
+   * @param checkpoint CheckpointReader.
+   */
+  inline void read_checkpoint(CheckpointReader &checkpoint) {
+    _file.set_current_position(checkpoint.read<uint64_t>());
+    checkpoint.read(_number_of_records);
+    checkpoint.read(_last_record);
+    checkpoint.read(_block_time);
+    checkpoint.read(_block_offset);
+    checkpoint.read(_block_size);
+  }
+
+  /**
+   * @brief Write the footer and close the log file.
+   */
+  inline void close_file() {
+    const uint64_t block_index_offset = _file.get_current_position();
+    for (size_t i = 0; i < _block_time.size(); ++i) {
+      _file.write(_block_time[i]);
+      _file.write(_block_offset[i]);
+      _file.write(_block_size[i]);
+    }
+    const uint64_t cell_index_offset = _file.get_current_position();
+    for (size_t i = 0; i < _number_of_records.size(); ++i) {
+      _file.write(_number_of_records[i]);
+      _file.write(_last_record[i]);
+    }
+    CellLogTrailer trailer;
+    trailer._number_of_cells = _ncell;
+    trailer._number_of_entries = NUMBER_OF_LOGENTRIES;
+    trailer._number_of_blocks = _block_time.size();
+    trailer._block_index_offset = block_index_offset;
+    trailer._cell_index_offset = cell_index_offset;
+    std::memcpy(trailer._signature, "HCS1DLOG", 8);
+    _file.write(trailer);
+    _file.close_file();
+  }
+};
+
+#endif // CELLLOG_HPP
@@ -0,0 +1,395 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file Checkpoint.hpp
+ *
+ * @brief Asynchronous checkpoint writer and checkpoint reader.
+ *
+ * A checkpoint contains the complete state of a simulation, so that a restart
+ * from the checkpoint continues bit-for-bit. The different parts of the
+ * program add their state to the checkpoint in a fixed order, and read it back
+ * in the same order during a restart. Values are stored as raw bytes, so that
+ * a checkpoint can only be read by the same executable that wrote it.
+ *
+ * The checkpoint file has the following layout:
+ *  - 8 characters: "HCS1DCHK"
+ *  - uint32: format version (currently 1)
+ *  - uint32: size of a Cell (as a basic check on the executable)
+ *  - the state of the simulation
+ *
+ * The state is copied into a buffer by the main thread, and is written to disk
+ * by a background thread. The checkpoint is first written to a temporary file,
+ * which then replaces the old checkpoint file, so that there always is a
+ * complete checkpoint on disk, even if the program is killed during a write.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "Cell.hpp"            // Cell class
+#include "ThreadPlacement.hpp" // thread pinning
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*! @brief Name of the checkpoint file. */
+#define CHECKPOINT_FILE_NAME "checkpoint.dat"
+
+/*! @brief Version of the checkpoint format. */
+#define CHECKPOINT_VERSION 1
+
+/**
+ * @brief Asynchronous checkpoint writer.
+ */
+class CheckpointWriter {
+private:
+  /*! @brief Name of the checkpoint file. */
+  const std::string _filename;
+
+  /*! @brief Buffer that is being filled by the main thread. */
+  std::vector<char> _fill_buffer;
+
+  /*! @brief Buffer that is being written by the background thread. */
+  std::vector<char> _write_buffer;
+
+  /*! @brief Flag signalling whether the write buffer still needs to be
+   *  written. */
+  bool _pending;
+
+  /*! @brief Flag signalling the background thread to stop. */
+  bool _stop;
+
+  /*! @brief Lock protecting the flags. */
+  std::mutex _mutex;
+
+  /*! @brief Condition used to signal changes in the flags. */
+  std::condition_variable _condition;
+
+  /*! @brief Background I/O thread. */
+  std::thread _thread;
+
+  /**
+   * @brief Main loop of the background I/O thread.
+   */
+  inline void run() {
+    // do not stay on the CPU of the compute thread that created this thread
+    release_thread_pinning();
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+      while (!_pending && !_stop) {
+        _condition.wait(lock);
+      }
+      if (!_pending) {
+        // stopped and nothing left to write
+        return;
+      }
+      lock.unlock();
+
+      const std::string tmpname = _filename + ".tmp";
+      {
+        std::ofstream ofile(tmpname, std::ios::binary);
+        ofile.write(&_write_buffer[0], _write_buffer.size());
+        ofile.close();
+        if (!ofile) {
+          std::cerr << "Error writing checkpoint file " << tmpname << "!"
+                    << std::endl;
+          abort();
+        }
+      }
+      if (std::rename(tmpname.c_str(), _filename.c_str()) != 0) {
+        std::cerr << "Error replacing checkpoint file " << _filename << "!"
+                  << std::endl;
+        abort();
+      }
+
+      lock.lock();
+      _pending = false;
+      _condition.notify_all();
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * Starts the background I/O thread.
+   *
+   * @param filename Name of the checkpoint file.
+   */
+  inline CheckpointWriter(const std::string filename)
+      : _filename(filename), _pending(false), _stop(false) {
+    _thread = std::thread(&CheckpointWriter::run, this);
+  }
+
+  /**
+   * @brief Destructor.
+   *
+   * Waits for the pending checkpoint to be written and stops the background
+   * I/O thread.
+   */
+  inline ~CheckpointWriter() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _condition.notify_all();
+    _thread.join();
+  }
+
+  /**
+   * @brief Start a new checkpoint.
+   */
+  inline void start() {
+    _fill_buffer.clear();
+    _fill_buffer.insert(_fill_buffer.end(), "HCS1DCHK", "HCS1DCHK" + 8);
+    write<uint32_t>(CHECKPOINT_VERSION);
+    write<uint32_t>(sizeof(Cell));
+  }
+
+  /**
+   * @brief Add an array of values to the checkpoint.
+   *
+   * @param values Values (need to be trivially copyable).
+   * @param size Number of values.
+   */
+  template <typename _datatype_>
+  inline void write(const _datatype_ *values, const size_t size) {
+    const char *bytes = reinterpret_cast<const char *>(values);
+    _fill_buffer.insert(_fill_buffer.end(), bytes,
+                        bytes + size * sizeof(_datatype_));
+  }
+
+  /**
+   * @brief Add a single value to the checkpoint.
+   *
+   * @param value Value (needs to be trivially copyable).
+   */
+  template <typename _datatype_> inline void write(const _datatype_ value) {
+    write(&value, 1);
+  }
+
+  /**
+   * @brief Add a std::vector to the checkpoint.
+   *
+   * @param values std::vector (the elements need to be trivially copyable).
+   */
+  template <typename _datatype_>
+  inline void write(const std::vector<_datatype_> &values) {
+    write<uint64_t>(values.size());
+    write(values.data(), values.size());
+  }
+
+  /**
+   * @brief Add a std::string to the checkpoint.
+   *
+   * @param value std::string.
+   */
+  inline void write(const std::string &value) {
+    write<uint64_t>(value.size());
+    write(value.c_str(), value.size());
+  }
+
+  /**
+   * @brief Hand the checkpoint over to the background thread.
+   *
+   * If the previous checkpoint is still being written, we wait until it is
+   * done.
+   */
+  inline void submit() {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (_pending) {
+        _condition.wait(lock);
+      }
+      _write_buffer.swap(_fill_buffer);
+      _pending = true;
+    }
+    _condition.notify_all();
+  }
+
+  /**
+   * @brief Wait until the pending checkpoint has been written to disk.
+   */
+  inline void flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_pending) {
+      _condition.wait(lock);
+    }
+  }
+
+  // the writer owns a running thread, so it cannot be copied
+  CheckpointWriter(const CheckpointWriter &) = delete;
+  CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+};
+
+/**
+ * @brief Checkpoint reader.
+ */
+class CheckpointReader {
+private:
+  /*! @brief Name of the checkpoint file. */
+  const std::string _filename;
+
+  /*! @brief Contents of the checkpoint file. */
+  std::vector<char> _buffer;
+
+  /*! @brief Current read position in the buffer. */
+  size_t _position;
+
+  /**
+   * @brief Abort with an error message about the checkpoint file.
+   *
+   * @param message Error message.
+   */
+  inline void error(const std::string message) const {
+    std::cerr << "Error reading checkpoint file " << _filename << ": "
+              << message << "!" << std::endl;
+    abort();
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * Reads the complete checkpoint file and checks its header.
+   *
+   * @param filename Name of the checkpoint file.
+   */
+  inline CheckpointReader(const std::string filename)
+      : _filename(filename), _position(0) {
+    std::ifstream ifile(filename, std::ios::binary | std::ios::ate);
+    if (!ifile) {
+      error("unable to open file");
+    }
+    _buffer.resize(ifile.tellg());
+    ifile.seekg(0);
+    ifile.read(&_buffer[0], _buffer.size());
+    if (_buffer.size() < 8 || std::memcmp(&_buffer[0], "HCS1DCHK", 8) != 0) {
+      error("not a checkpoint file");
+    }
+    _position = 8;
+    if (read<uint32_t>() != CHECKPOINT_VERSION) {
+      error("unsupported checkpoint version");
+    }
+    if (read<uint32_t>() != sizeof(Cell)) {
+      error("checkpoint was written by a different executable");
+    }
+  }
+
+  /**
+   * @brief Check if a checkpoint file with the given name exists.
+   *
+   * @param filename Name of the checkpoint file.
+   * @return True if the file exists.
+   */
+  inline static bool exists(const std::string filename) {
+    std::ifstream ifile(filename);
+    return ifile.good();
+  }
+
+  /**
+   * @brief Read an array of values from the checkpoint.
+   *
+   * @param values Array to store the values in (need to be trivially
+   * copyable).
+   * @param size Number of values.
+   */
+  template <typename _datatype_>
+  inline void read(_datatype_ *values, const size_t size) {
+    const size_t bytes = size * sizeof(_datatype_);
+    if (_position + bytes > _buffer.size()) {
+      error("unexpected end of file");
+    }
+    std::memcpy(reinterpret_cast<char *>(values), &_buffer[_position], bytes);
+    _position += bytes;
+  }
+
+  /**
+   * @brief Read a single value from the checkpoint.
+   *
+   * @return Value (needs to be trivially copyable).
+   */
+  template <typename _datatype_> inline _datatype_ read() {
+    _datatype_ value;
+    read(&value, 1);
+    return value;
+  }
+
+  /**
+   * @brief Read a single value from the checkpoint.
+   *
+   * @param value Variable to store the value in (needs to be trivially
+   * copyable).
+   */
+  template <typename _datatype_> inline void read(_datatype_ &value) {
+    read(&value, 1);
+  }
+
+  /**
+   * @brief Read a std::vector from the checkpoint.
+   *
+   * @param values std::vector to store the values in (the elements need to be
+   * trivially copyable).
+   */
+  template <typename _datatype_>
+  inline void read(std::vector<_datatype_> &values) {
+    values.resize(read<uint64_t>());
+    read(values.data(), values.size());
+  }
+
+  /**
+   * @brief Read a std::string from the checkpoint.
+   *
+   * @param value std::string to store the value in.
+   */
+  inline void read(std::string &value) {
+    std::vector<char> characters;
+    read(characters);
+    value.assign(characters.begin(), characters.end());
+  }
+
+  /**
+   * @brief Check that a value from the checkpoint matches the value that is
+   * used for the restart.
+   *
+   * @param name Name of the value (used for the error message).
+   * @param value Value used for the restart.
+   */
+  template <typename _datatype_>
+  inline void check(const std::string name, const _datatype_ &value) {
+    _datatype_ checkpoint_value;
+    read(checkpoint_value);
+    if (!(checkpoint_value == value)) {
+      error("the value of " + name +
+            " does not match the value used for the restart");
+    }
+  }
+};
+
+#endif // CHECKPOINT_HPP
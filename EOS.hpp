@@ -47,6 +47,13 @@
 #define initial_pressure(cell) cell._P = ISOTHERMAL_C_SQUARED * cell._rho
 #endif
 
+/**
+ * @brief Declare ionisation variables.
+ *
+ * Not used for an ideal or isothermal equation of state.
+ */
+#define ionisation_variables
+
 /**
  * @brief Initialize ionisation variables.
  *
@@ -76,6 +83,39 @@
  */
 #define flux_into_inner_mask(mflux)
 
+/**
+ * @brief Add the ionisation state to the given checkpoint.
+ *
+ * Not used for an ideal or isothermal equation of state.
+ *
+ * @param checkpoint CheckpointWriter.
+ */
+#define ionisation_write_checkpoint(checkpoint)
+
+/**
+ * @brief Read the ionisation state from the given checkpoint.
+ *
+ * Not used for an ideal or isothermal equation of state.
+ *
+ * @param checkpoint CheckpointReader.
+ */
+#define ionisation_read_checkpoint(checkpoint)
+
+/**
+ * @brief Radius of the ionisation front, used for the grid refinement.
+ *
+ * There is no ionisation front for an ideal or isothermal equation of state.
+ */
+#define ionisation_front_radius() -1.
+
+/**
+ * @brief Mass of the central point mass, used for the in-situ analysis.
+ *
+ * The central mass does not change for an ideal or isothermal equation of
+ * state.
+ */
+#define ionisation_central_mass() MASS_POINT_MASS
+
 /**
  * @brief Conversion function called during the primitive variable conversion
  * for the given cell.
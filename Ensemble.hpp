@@ -0,0 +1,385 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file Ensemble.hpp
+ *
+ * @brief Ensemble of independent simulations that are run within a single
+ * process.
+ *
+ * The ensemble is read from an ensemble file, that contains one member per
+ * line. Every line has the same positional arguments as the command line of
+ * the program:
+ *   ncell [ic_file_name [transition_width [bondi_pressure_contrast]]]
+ * A value of "-" (or a missing value) means that the default value is used.
+ * Everything after a '#' is a comment, and empty lines are ignored.
+ *
+ * Every member runs in its own thread, with an OpenMP team of its own. Members
+ * request one thread per ENSEMBLE_CELLS_PER_THREAD cells (with a minimum of 1),
+ * and are started largest first, as soon as enough threads are free. Smaller
+ * members are used to fill up threads that are not enough to start a larger
+ * member. Once all members have been started, threads that become free are
+ * handed to the running member with the most cells per thread, which picks
+ * them up at the start of its next step. All output of member i is written to
+ * the folder member_XXXX (with XXXX the 4 digit index i).
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include "Timer.hpp" // Timer class
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+/*! @brief Number of cells per thread requested by an ensemble member. */
+#define ENSEMBLE_CELLS_PER_THREAD 1000
+
+/*! @brief Minimum number of cells per thread for a running member that is
+ *  handed an extra thread. */
+#define ENSEMBLE_MIN_CELLS_PER_THREAD 100
+
+/**
+ * @brief Parameters of a single ensemble member.
+ */
+class EnsembleMember {
+public:
+  /*! @brief Number of cells. */
+  unsigned int _ncell;
+
+  /*! @brief Name of the initial condition file. */
+  std::string _ic_file_name;
+
+  /*! @brief Width of the ionisation transition region (in internal units of
+   *  L). */
+  double _transition_width;
+
+  /*! @brief Pressure contrast between ionised and neutral region. */
+  double _bondi_pressure_contrast;
+};
+
+/**
+ * @brief Ensemble of independent simulations.
+ */
+class Ensemble {
+private:
+  /*! @brief Members of the ensemble. */
+  std::vector<EnsembleMember> _members;
+
+  /**
+   * @brief Abort with an error message about the given line of the ensemble
+   * file.
+   *
+   * @param filename Name of the ensemble file.
+   * @param line_number Line number.
+   * @param line Line.
+   */
+  inline static void invalid_line(const std::string filename,
+                                  const unsigned int line_number,
+                                  const std::string line) {
+    std::cerr << "Invalid line in ensemble file " << filename << " (line "
+              << line_number << "): \"" << line << "\"" << std::endl;
+    abort();
+  }
+
+  /**
+   * @brief Get the number of threads requested by the given member.
+   *
+   * @param member EnsembleMember.
+   * @param number_of_threads Total number of threads.
+   * @return Requested number of threads.
+   */
+  inline static int get_requested_threads(const EnsembleMember &member,
+                                          const int number_of_threads) {
+    const int requested =
+        (member._ncell + ENSEMBLE_CELLS_PER_THREAD - 1) /
+        ENSEMBLE_CELLS_PER_THREAD;
+    return std::max(1, std::min(requested, number_of_threads));
+  }
+
+public:
+  /**
+   * @brief Read the ensemble file with the given name.
+   *
+   * @param filename Name of the ensemble file.
+   * @param default_member Member parameters that are used for values that are
+   * not specified in the file.
+   */
+  inline Ensemble(const std::string filename,
+                  const EnsembleMember &default_member) {
+    std::ifstream ifile(filename);
+    if (!ifile) {
+      std::cerr << "Unable to open ensemble file " << filename << "!"
+                << std::endl;
+      abort();
+    }
+    std::string line;
+    unsigned int line_number = 0;
+    while (std::getline(ifile, line)) {
+      ++line_number;
+      std::istringstream linestream(line.substr(0, line.find('#')));
+      std::vector<std::string> values;
+      std::string value;
+      while (linestream >> value) {
+        values.push_back(value);
+      }
+      if (values.size() == 0) {
+        continue;
+      }
+      if (values.size() > 4) {
+        invalid_line(filename, line_number, line);
+      }
+      EnsembleMember member(default_member);
+      for (unsigned int i = 0; i < values.size(); ++i) {
+        if (values[i] == "-") {
+          continue;
+        }
+        if (i == 1) {
+          member._ic_file_name = values[i];
+          continue;
+        }
+        char *end;
+        if (i == 0) {
+          member._ncell = strtoul(values[i].c_str(), &end, 10);
+        } else if (i == 2) {
+          member._transition_width = strtod(values[i].c_str(), &end);
+        } else {
+          member._bondi_pressure_contrast = strtod(values[i].c_str(), &end);
+        }
+        if (*end != '\0') {
+          invalid_line(filename, line_number, line);
+        }
+      }
+      if (member._ncell == 0) {
+        invalid_line(filename, line_number, line);
+      }
+      _members.push_back(member);
+    }
+  }
+
+  /**
+   * @brief Get the number of members.
+   *
+   * @return Number of members.
+   */
+  inline size_t size() const { return _members.size(); }
+
+  /**
+   * @brief Access the given member.
+   *
+   * @param imember Index of the member.
+   * @return Reference to the member.
+   */
+  inline const EnsembleMember &operator[](const size_t imember) const {
+    return _members[imember];
+  }
+
+  /**
+   * @brief Get the prefix for all output files of the given member.
+   *
+   * @param imember Index of the member.
+   * @return Name of the output folder of the member, including the trailing
+   * '/'.
+   */
+  inline static std::string get_output_prefix(const size_t imember) {
+    std::stringstream prefix;
+    prefix << "member_";
+    prefix.fill('0');
+    prefix.width(4);
+    prefix << imember << "/";
+    return prefix.str();
+  }
+
+  /**
+   * @brief Get the tag that is used for messages about the given member.
+   *
+   * @param imember Index of the member.
+   * @return Tag.
+   */
+  inline static std::string get_tag(const size_t imember) {
+    std::stringstream tag;
+    tag << "[member ";
+    tag.fill('0');
+    tag.width(4);
+    tag << imember << "]";
+    return tag.str();
+  }
+
+  /**
+   * @brief Run all members of the ensemble.
+   *
+   * The given function is called once for every member, from a separate
+   * thread, with the index of the member, the output prefix of the member and
+   * an atomic variable that contains the number of threads the member should
+   * use. The latter can grow while the member is running. The function should
+   * return an exit code (0 on success).
+   *
+   * @param number_of_threads Total number of threads to use.
+   * @param run_member Function that runs a single member.
+   * @return 0 if all members ran successfully, 1 otherwise.
+   */
+  template <typename _function_>
+  inline int run(const int number_of_threads, _function_ run_member) const {
+
+    const size_t number_of_members = _members.size();
+
+    // create the output folders
+    for (size_t imember = 0; imember < number_of_members; ++imember) {
+      const std::string folder = get_output_prefix(imember);
+      if (mkdir(folder.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Unable to create output folder " << folder << "!"
+                  << std::endl;
+        return 1;
+      }
+    }
+
+    // largest members first
+    std::vector<size_t> queue(number_of_members);
+    for (size_t imember = 0; imember < number_of_members; ++imember) {
+      queue[imember] = imember;
+    }
+    std::stable_sort(queue.begin(), queue.end(),
+                     [this](const size_t a, const size_t b) {
+                       return _members[a]._ncell > _members[b]._ncell;
+                     });
+
+    std::unique_ptr<std::atomic_int[]> member_threads(
+        new std::atomic_int[number_of_members]);
+    std::vector<bool> started(number_of_members, false);
+    std::vector<bool> finished(number_of_members, false);
+    std::vector<int> exit_codes(number_of_members, 0);
+    std::vector<std::thread> threads;
+    int free_threads = number_of_threads;
+    size_t number_of_started = 0;
+    size_t number_of_running = 0;
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (number_of_started < number_of_members || number_of_running > 0) {
+
+      // start as many queued members as the free threads allow: the first
+      // (largest) waiting member that fits in the free threads is started
+      // (if nothing is running, all threads are free and every member fits)
+      bool changed = true;
+      while (changed && number_of_started < number_of_members) {
+        changed = false;
+        size_t next = number_of_members;
+        int nthread = 0;
+        for (size_t iqueue = 0; iqueue < number_of_members; ++iqueue) {
+          const size_t imember = queue[iqueue];
+          if (started[imember]) {
+            continue;
+          }
+          const int requested =
+              get_requested_threads(_members[imember], number_of_threads);
+          if (requested <= free_threads) {
+            next = imember;
+            nthread = requested;
+            break;
+          }
+        }
+        if (next < number_of_members) {
+          started[next] = true;
+          member_threads[next] = nthread;
+          free_threads -= nthread;
+          ++number_of_started;
+          ++number_of_running;
+          changed = true;
+          std::cout << get_tag(next) << " started on " << nthread
+                    << " thread(s): " << _members[next]._ncell << " cells"
+                    << std::endl;
+          threads.push_back(std::thread([&, next]() {
+            Timer run_time;
+            run_time.start();
+            const int exit_code = run_member(next, get_output_prefix(next),
+                                             &member_threads[next]);
+            run_time.stop();
+            std::lock_guard<std::mutex> guard(mutex);
+            exit_codes[next] = exit_code;
+            finished[next] = true;
+            free_threads += member_threads[next];
+            --number_of_running;
+            std::cout << get_tag(next) << " finished in " << run_time.value()
+                      << " s (exit code " << exit_code << ")" << std::endl;
+            condition.notify_all();
+          }));
+        }
+      }
+
+      // all members started: hand free threads to running members
+      while (number_of_started == number_of_members && free_threads > 0) {
+        size_t next = number_of_members;
+        unsigned int max_cells_per_thread = 0;
+        for (size_t imember = 0; imember < number_of_members; ++imember) {
+          if (!started[imember] || finished[imember]) {
+            continue;
+          }
+          const unsigned int cells_per_thread =
+              _members[imember]._ncell / (member_threads[imember] + 1);
+          if (cells_per_thread >= ENSEMBLE_MIN_CELLS_PER_THREAD &&
+              cells_per_thread > max_cells_per_thread) {
+            next = imember;
+            max_cells_per_thread = cells_per_thread;
+          }
+        }
+        if (next == number_of_members) {
+          break;
+        }
+        ++member_threads[next];
+        --free_threads;
+        std::cout << get_tag(next) << " now running on " << member_threads[next]
+                  << " thread(s)" << std::endl;
+      }
+
+      if (number_of_running > 0) {
+        condition.wait(lock);
+      }
+    }
+    lock.unlock();
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+      threads[i].join();
+    }
+
+    int exit_code = 0;
+    for (size_t imember = 0; imember < number_of_members; ++imember) {
+      if (exit_codes[imember] != 0) {
+        std::cerr << get_tag(imember) << " failed with exit code "
+                  << exit_codes[imember] << "!" << std::endl;
+        exit_code = 1;
+      }
+    }
+    return exit_code;
+  }
+};
+
+#endif // ENSEMBLE_HPP
@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file Grid.hpp
+ *
+ * @brief Radial grid: positions and widths of the cells.
+ *
+ * The type of grid is a run time parameter (GRID_TYPE):
+ *  - GRID_TYPE_UNIFORM: all cells have the same width CELLSIZE.
+ *  - GRID_TYPE_LOGARITHMIC: the cell faces are logarithmically spaced in
+ *    between RMIN and RMAX (RMIN needs to be larger than zero), so that the
+ *    cell width is proportional to the radius and the inner region is
+ *    resolved with far fewer cells than a uniform grid would need.
+ *  - GRID_TYPE_FILE: the cell faces are read from the text file GRID_FILE_NAME,
+ *    which contains ncell + 1 increasing face positions (in AU), one per line.
+ *    The first and last face should be at RMIN and RMAX.
+ * The ghost cells have the same width as their neighbouring cell. All other
+ * code uses the cell limits, midpoint and width stored in the cells, so that it
+ * works for any grid.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef GRID_HPP
+#define GRID_HPP
+
+#include "Cell.hpp"           // Cell class
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Abort with an error message about the grid.
+ *
+ * @param message Error message.
+ */
+inline static void grid_error(const std::string message) {
+  std::cerr << "Invalid grid: " << message << "!" << std::endl;
+  abort();
+}
+
+/**
+ * @brief Get the positions of the ncell + 1 cell faces of the grid.
+ *
+ * @param ncell Number of cells.
+ * @param faces std::vector to store the face positions in (in internal units
+ * of L).
+ */
+inline static void get_grid_faces(const unsigned int ncell,
+                                  std::vector<double> &faces) {
+  faces.resize(ncell + 1);
+  if (GRID_TYPE == GRID_TYPE_UNIFORM) {
+    for (unsigned int i = 0; i < ncell + 1; ++i) {
+      faces[i] = RMIN + i * CELLSIZE;
+    }
+  } else if (GRID_TYPE == GRID_TYPE_LOGARITHMIC) {
+    if (!(RMIN > 0.)) {
+      grid_error("a logarithmic grid needs rmin_in_au > 0");
+    }
+    const double log_ratio = std::log(RMAX / RMIN);
+    for (unsigned int i = 0; i < ncell; ++i) {
+      faces[i] = RMIN * std::exp(log_ratio * i / ncell);
+    }
+    faces[ncell] = RMAX;
+  } else {
+    std::ifstream ifile(GRID_FILE_NAME);
+    if (!ifile) {
+      grid_error("unable to open grid file \"" + GRID_FILE_NAME + "\"");
+    }
+    unsigned int nface = 0;
+    double face_in_au;
+    while (ifile >> face_in_au) {
+      if (nface == ncell + 1) {
+        grid_error("grid file contains more than ncell + 1 faces");
+      }
+      faces[nface] = face_in_au * AU_IN_SI / UNIT_LENGTH_IN_SI;
+      if (nface > 0 && !(faces[nface] > faces[nface - 1])) {
+        grid_error("grid file faces are not increasing");
+      }
+      ++nface;
+    }
+    if (!ifile.eof()) {
+      grid_error("grid file contains an invalid value");
+    }
+    if (nface != ncell + 1) {
+      grid_error("grid file contains fewer than ncell + 1 faces");
+    }
+    const double tolerance = 1.e-10 * (RMAX - RMIN);
+    if (std::abs(faces[0] - RMIN) > tolerance ||
+        std::abs(faces[ncell] - RMAX) > tolerance) {
+      grid_error("grid file faces do not span rmin_in_au to rmax_in_au");
+    }
+  }
+}
+
+/**
+ * @brief Set the limits, midpoint and width of all cells, including the two
+ * ghost cells.
+ *
+ * @param cells Cells.
+ * @param ncell Number of cells (excluding the ghost cells).
+ */
+inline static void initialize_grid(Cell *cells, const unsigned int ncell) {
+  if (GRID_TYPE == GRID_TYPE_UNIFORM) {
+    // cell positions (lower limit, center and upper limit) are precomputed for
+    // maximal efficiency
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 0; i < ncell + 2; ++i) {
+      cells[i]._lowlim = RMIN + (i - 1.) * CELLSIZE;
+      cells[i]._midpoint = RMIN + (i - 0.5) * CELLSIZE;
+      cells[i]._uplim = RMIN + i * CELLSIZE;
+      cells[i]._V = CELLSIZE;
+    }
+    return;
+  }
+
+  std::vector<double> faces;
+  get_grid_faces(ncell, faces);
+  for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+    cells[i]._lowlim = faces[i - 1];
+    cells[i]._uplim = faces[i];
+  }
+  // the ghost cells mirror their neighbouring cell
+  cells[0]._lowlim = 2. * faces[0] - faces[1];
+  cells[0]._uplim = faces[0];
+  cells[ncell + 1]._lowlim = faces[ncell];
+  cells[ncell + 1]._uplim = 2. * faces[ncell] - faces[ncell - 1];
+  for (uint_fast32_t i = 0; i < ncell + 2; ++i) {
+    cells[i]._midpoint = 0.5 * (cells[i]._lowlim + cells[i]._uplim);
+    cells[i]._V = cells[i]._uplim - cells[i]._lowlim;
+  }
+}
+
+#endif // GRID_HPP
@@ -29,6 +29,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
 
 /**
  * @brief HLLC Riemann solver.
@@ -173,6 +176,124 @@ public:
       return 1;
     }
   }
+
+  /**
+   * @brief Solve the Riemann problems for a batch of interfaces directly for
+   * the fluxes.
+   *
+   * The loop over the interfaces is vectorised. Both the left and the right
+   * flux are computed for every interface, and the sampled flux is selected
+   * using masked blends instead of branches. For non vacuum interfaces, the
+   * result is the same as for solve_for_flux().
+   *
+   * If the batch contains a vacuum interface, the entire batch is redone
+   * using the scalar solve_for_flux(), which handles (or rejects) vacuum.
+   *
+   * @param n Number of interfaces in the batch.
+   * @param rhoL Left state densities.
+   * @param uL Left state velocities.
+   * @param PL Left state pressures.
+   * @param rhoR Right state densities.
+   * @param uR Right state velocities.
+   * @param PR Right state pressures.
+   * @param mflux Mass flux solutions.
+   * @param pflux Momentum flux solutions.
+   * @param Eflux Energy flux solutions.
+   */
+  inline void solve_for_flux_batch(const uint_fast32_t n, const double *rhoL,
+                                   const double *uL, const double *PL,
+                                   const double *rhoR, const double *uR,
+                                   const double *PR, double *mflux,
+                                   double *pflux, double *Eflux) {
+
+    int vacuum = 0;
+#pragma omp simd reduction(| : vacuum)
+    for (uint_fast32_t i = 0; i < n; ++i) {
+      // vacuum interfaces are redone below, we replace their densities with a
+      // dummy value to avoid divisions by zero
+      const bool vacuumi = (rhoL[i] == 0. || rhoR[i] == 0.);
+      const double rhoLi = vacuumi ? 1. : rhoL[i];
+      const double rhoRi = vacuumi ? 1. : rhoR[i];
+      const double uLi = uL[i];
+      const double PLi = PL[i];
+      const double uRi = uR[i];
+      const double PRi = PR[i];
+
+      const double rhoLinv = 1. / rhoLi;
+      const double rhoRinv = 1. / rhoRi;
+      const double aL = std::sqrt(_gamma * PLi * rhoLinv);
+      const double aR = std::sqrt(_gamma * PRi * rhoRinv);
+
+      const double uRmuL = uRi - uLi;
+
+      vacuum |= (vacuumi || 2. * _odgm1 * (aL + aR) <= uRmuL);
+
+      // STEP 1: pressure estimate
+      const double Ppvrs =
+          0.5 * (PLi + PRi) - 0.125 * uRmuL * (rhoLi + rhoRi) * (aL + aR);
+      const double Pstar = std::max(0., Ppvrs);
+
+      // STEP 2: wave speed estimates
+      const double qL =
+          (Pstar > PLi) ? std::sqrt(1. + _hgp1dg * (Pstar / PLi - 1.)) : 1.;
+      const double qR =
+          (Pstar > PRi) ? std::sqrt(1. + _hgp1dg * (Pstar / PRi - 1.)) : 1.;
+      const double SL = uLi - aL * qL;
+      const double SR = uRi + aR * qR;
+      const double SLmuL = SL - uLi;
+      const double SRmuR = SR - uRi;
+      const double Sstar =
+          (PRi - PLi + rhoLi * uLi * SLmuL - rhoRi * uRi * SRmuR) /
+          (rhoLi * SLmuL - rhoRi * SRmuR);
+
+      // flux FL (or FL*)
+      const double uL2 = uLi * uLi;
+      const double rhoLuL = rhoLi * uLi;
+      const double eL = _odgm1 * PLi * rhoLinv + 0.5 * uL2;
+      const double rhoLeL = rhoLi * eL;
+      const double mfluxL = rhoLuL;
+      const double pfluxL = rhoLi * uL2 + PLi;
+      const double EfluxL = (rhoLeL + PLi) * uLi;
+      const double rhostarL = rhoLi * SLmuL / (SL - Sstar);
+      const double ustarL = rhostarL * Sstar;
+      const double PstarL =
+          rhostarL * (eL + (Sstar - uLi) * (Sstar + PLi / (rhoLi * SLmuL)));
+      const bool starL = (SL < 0.);
+      const double mfluxLs = starL ? mfluxL + SL * (rhostarL - rhoLi) : mfluxL;
+      const double pfluxLs = starL ? pfluxL + SL * (ustarL - rhoLuL) : pfluxL;
+      const double EfluxLs = starL ? EfluxL + SL * (PstarL - rhoLeL) : EfluxL;
+
+      // flux FR (or FR*)
+      const double uR2 = uRi * uRi;
+      const double rhoRuR = rhoRi * uRi;
+      const double eR = _odgm1 * PRi * rhoRinv + 0.5 * uR2;
+      const double rhoReR = rhoRi * eR;
+      const double mfluxR = rhoRuR;
+      const double pfluxR = rhoRi * uR2 + PRi;
+      const double EfluxR = (rhoReR + PRi) * uRi;
+      const double rhostarR = rhoRi * SRmuR / (SR - Sstar);
+      const double ustarR = rhostarR * Sstar;
+      const double PstarR =
+          rhostarR * (eR + (Sstar - uRi) * (Sstar + PRi / (rhoRi * SRmuR)));
+      const bool starR = (SR > 0.);
+      const double mfluxRs = starR ? mfluxR + SR * (rhostarR - rhoRi) : mfluxR;
+      const double pfluxRs = starR ? pfluxR + SR * (ustarR - rhoRuR) : pfluxR;
+      const double EfluxRs = starR ? EfluxR + SR * (PstarR - rhoReR) : EfluxR;
+
+      // select the sampled flux
+      const bool left = (Sstar >= 0.);
+      mflux[i] = left ? mfluxLs : mfluxRs;
+      pflux[i] = left ? pfluxLs : pfluxRs;
+      Eflux[i] = left ? EfluxLs : EfluxRs;
+    }
+
+    if (vacuum) {
+      for (uint_fast32_t i = 0; i < n; ++i) {
+        solve_for_flux(rhoL[i], uL[i], PL[i], rhoR[i], uR[i], PR[i], mflux[i],
+                       pflux[i], Eflux[i]);
+      }
+    }
+  }
 };
 
 #endif // HLLCRIEMANNSOLVER_HPP
@@ -0,0 +1,194 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file HardwareCounters.hpp
+ *
+ * @brief Hardware performance counters for all OpenMP threads, using the Linux
+ * perf_event interface.
+ *
+ * Every OpenMP thread gets its own group of counters, with the cycle counter as
+ * group leader, so that all counters of a thread are always scheduled
+ * together. The counters are read from the master thread, the values of all
+ * threads are summed.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef HARDWARECOUNTERS_HPP
+#define HARDWARECOUNTERS_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <omp.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Practical names for the hardware counters.
+ */
+enum HardwareCounter {
+  HARDWARECOUNTER_CYCLES = 0,
+  HARDWARECOUNTER_INSTRUCTIONS,
+  HARDWARECOUNTER_CACHE_MISSES,
+  NUMBER_OF_HARDWARECOUNTERS
+};
+
+/*! @brief Names of the hardware counters, used for output. */
+static const char *hardware_counter_names[NUMBER_OF_HARDWARECOUNTERS] = {
+    "cycles", "instructions", "llc_misses"};
+
+/**
+ * @brief Hardware counters for all OpenMP threads.
+ */
+class HardwareCounters {
+private:
+  /*! @brief Number of threads. */
+  const int _number_of_threads;
+
+  /*! @brief File descriptors of the counters (thread major order). */
+  std::vector<int> _file_descriptors;
+
+  /*! @brief Flag signaling whether the counters could be opened. */
+  bool _active;
+
+  /**
+   * @brief Open a single counter for the calling thread.
+   *
+   * @param config Type of hardware event (PERF_COUNT_HW_XXX).
+   * @param group_leader File descriptor of the group leader, or -1 if this
+   * counter is the group leader.
+   * @return File descriptor of the counter, or -1 on failure.
+   */
+  inline static int open_counter(const uint64_t config,
+                                 const int group_leader) {
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(perf_event_attr));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(perf_event_attr);
+    attributes.config = config;
+    attributes.disabled = (group_leader == -1);
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP;
+    const pid_t thread_id = syscall(SYS_gettid);
+    return syscall(__NR_perf_event_open, &attributes, thread_id, -1,
+                   group_leader, 0);
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * Opens and enables the counters for all OpenMP threads. If this fails for
+   * any thread (e.g. because the kernel does not allow access to the
+   * counters), a warning is printed and all counters read as zero.
+   *
+   * @param number_of_threads Maximum number of threads that will be used during
+   * the run.
+   */
+  inline HardwareCounters(const int number_of_threads = omp_get_max_threads())
+      : _number_of_threads(number_of_threads),
+        _file_descriptors(_number_of_threads * NUMBER_OF_HARDWARECOUNTERS, -1),
+        _active(true) {
+
+    const uint64_t configs[NUMBER_OF_HARDWARECOUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES};
+    bool success = true;
+#pragma omp parallel num_threads(_number_of_threads) reduction(&& : success)
+    {
+      int *fds =
+          &_file_descriptors[omp_get_thread_num() * NUMBER_OF_HARDWARECOUNTERS];
+      fds[0] = open_counter(configs[0], -1);
+      success = (fds[0] != -1);
+      for (int i = 1; i < NUMBER_OF_HARDWARECOUNTERS && success; ++i) {
+        fds[i] = open_counter(configs[i], fds[0]);
+        success = (fds[i] != -1);
+      }
+      if (success) {
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+      }
+    }
+
+    if (!success) {
+      std::cerr << "Warning: could not open hardware counters (check "
+                   "/proc/sys/kernel/perf_event_paranoid), hardware counter "
+                   "values will be zero!"
+                << std::endl;
+      close_counters();
+    }
+  }
+
+  /**
+   * @brief Destructor.
+   */
+  inline ~HardwareCounters() { close_counters(); }
+
+  /**
+   * @brief Close all counters.
+   */
+  inline void close_counters() {
+    for (size_t i = 0; i < _file_descriptors.size(); ++i) {
+      if (_file_descriptors[i] != -1) {
+        close(_file_descriptors[i]);
+        _file_descriptors[i] = -1;
+      }
+    }
+    _active = false;
+  }
+
+  /**
+   * @brief Check if the counters are active.
+   *
+   * @return True if the counters could be opened.
+   */
+  inline bool is_active() const { return _active; }
+
+  /**
+   * @brief Read the current values of the counters, summed over all threads.
+   *
+   * @param values Array to store the NUMBER_OF_HARDWARECOUNTERS values in.
+   */
+  inline void read_counters(uint64_t *values) const {
+    for (int i = 0; i < NUMBER_OF_HARDWARECOUNTERS; ++i) {
+      values[i] = 0;
+    }
+    if (!_active) {
+      return;
+    }
+    // layout of the group read: number of counters, followed by the values
+    uint64_t buffer[1 + NUMBER_OF_HARDWARECOUNTERS];
+    for (int ithread = 0; ithread < _number_of_threads; ++ithread) {
+      const int leader =
+          _file_descriptors[ithread * NUMBER_OF_HARDWARECOUNTERS];
+      if (read(leader, buffer, sizeof(buffer)) ==
+          static_cast<ssize_t>(sizeof(buffer))) {
+        for (int i = 0; i < NUMBER_OF_HARDWARECOUNTERS; ++i) {
+          values[i] += buffer[1 + i];
+        }
+      }
+    }
+  }
+};
+
+#endif // HARDWARECOUNTERS_HPP
@@ -0,0 +1,235 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file Hydro.hpp
+ *
+ * @brief Per cell and per interface hydro kernels: slope limited gradients,
+ * half time step prediction and interface state reconstruction.
+ *
+ * The kernels are templated on the type of the cell argument, so that they can
+ * be applied both to actual grid cells and to the temporary HydroState copies
+ * used by the fused hydro sweep. Both hydro sweep modes use the same kernels,
+ * so that they produce identical results.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef HYDRO_HPP
+#define HYDRO_HPP
+
+#include "Cell.hpp"           // Cell class
+#include "Potential.hpp"      // for add_gravitational_prediction
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Primitive variables, gradients and gravitational acceleration of a
+ * single cell.
+ *
+ * Used as temporary storage for the predicted primitive variables in the fused
+ * hydro sweep and for individual time stepping. The member names match those
+ * in Cell, so that the same kernels can be applied to both.
+ */
+class HydroState {
+public:
+  /*! @brief Density (in internal units of M L^-3). */
+  double _rho;
+  /*! @brief Fluid velocity (in internal units of L T^-1). */
+  double _u;
+  /*! @brief Pressure (in internal units of M L^-1 T^-2). */
+  double _P;
+
+  /*! @brief Density gradient (in internal units of M L^-4). */
+  double _grad_rho;
+  /*! @brief Velocity gradient (in internal units of T^-1). */
+  double _grad_u;
+  /*! @brief Pressure gradient (in internal units of M L^-2 T^-2). */
+  double _grad_P;
+
+  /*! @brief Gravitational acceleration (in internal units of L T^-2). */
+  double _a;
+};
+
+/**
+ * @brief Copy the primitive variables, gradients and gravitational
+ * acceleration of the given cell into the given HydroState.
+ *
+ * @param cell Cell.
+ * @param state HydroState.
+ */
+inline static void copy_hydro_state(const Cell &cell, HydroState &state) {
+  state._rho = cell._rho;
+  state._u = cell._u;
+  state._P = cell._P;
+  state._grad_rho = cell._grad_rho;
+  state._grad_u = cell._grad_u;
+  state._grad_P = cell._grad_P;
+  state._a = cell._a;
+}
+
+/**
+ * @brief Compute the slope limited gradients for the primitive variables of
+ * the given cell.
+ *
+ * @param left Left neighbour of the cell.
+ * @param cell Cell.
+ * @param right Right neighbour of the cell.
+ * @param gradients Object in which the gradients are stored.
+ */
+template <typename _gradient_type_>
+inline static void compute_gradients(const Cell &left, const Cell &cell,
+                                     const Cell &right,
+                                     _gradient_type_ &gradients) {
+  const double dx = right._midpoint - left._midpoint;
+  const double dx_inv = 1. / dx;
+  const double half_dx = 0.5 * dx;
+
+  const double gradrho = (right._rho - left._rho) * dx_inv;
+  const double rhomax = std::max(left._rho, right._rho);
+  const double rhomin = std::min(left._rho, right._rho);
+  const double rho_ext_plu = half_dx * gradrho;
+  const double rho_ext_min = -half_dx * gradrho;
+  const double rhoextmax = std::max(rho_ext_min, rho_ext_plu);
+  const double rhoextmin = std::min(rho_ext_min, rho_ext_plu);
+  const double alpha_rho =
+      (gradrho != 0.)
+          ? std::min(1., 0.5 * std::min((rhomax - cell._rho) / rhoextmax,
+                                        (rhomin - cell._rho) / rhoextmin))
+          : 1.;
+  gradients._grad_rho = alpha_rho * gradrho;
+
+  const double gradu = (right._u - left._u) * dx_inv;
+  const double umax = std::max(left._u, right._u);
+  const double umin = std::min(left._u, right._u);
+  const double u_ext_plu = half_dx * gradu;
+  const double u_ext_min = -half_dx * gradu;
+  const double uextmax = std::max(u_ext_min, u_ext_plu);
+  const double uextmin = std::min(u_ext_min, u_ext_plu);
+  const double alpha_u =
+      (gradu != 0.) ? std::min(1., 0.5 * std::min((umax - cell._u) / uextmax,
+                                                   (umin - cell._u) / uextmin))
+                    : 1.;
+  gradients._grad_u = alpha_u * gradu;
+
+  const double gradP = (right._P - left._P) * dx_inv;
+  const double Pmax = std::max(left._P, right._P);
+  const double Pmin = std::min(left._P, right._P);
+  const double P_ext_plu = half_dx * gradP;
+  const double P_ext_min = -half_dx * gradP;
+  const double Pextmax = std::max(P_ext_min, P_ext_plu);
+  const double Pextmin = std::min(P_ext_min, P_ext_plu);
+  const double alpha_P =
+      (gradP != 0.) ? std::min(1., 0.5 * std::min((Pmax - cell._P) / Pextmax,
+                                                   (Pmin - cell._P) / Pextmin))
+                    : 1.;
+  gradients._grad_P = alpha_P * gradP;
+}
+
+/**
+ * @brief Evolve the primitive variables of the given cell forward in time for
+ * half a time step, using the Euler equations and the spatial gradients within
+ * the cell.
+ *
+ * @param cell Cell (or HydroState).
+ * @param half_dt Half the cell time step (in internal units of T).
+ */
+template <typename _cell_type_>
+inline static void predict_primitive_variables(_cell_type_ &cell,
+                                               const double half_dt) {
+  const double rho = cell._rho;
+  const double u = cell._u;
+  const double P = cell._P;
+  cell._rho -= half_dt * (rho * cell._grad_u + u * cell._grad_rho);
+  if (rho > 0.) {
+    cell._u -= half_dt * (u * cell._grad_u + cell._grad_P / rho);
+  }
+  cell._P -= half_dt * (GAMMA * P * cell._grad_u + u * cell._grad_P);
+
+  if (cell._rho < 0.) {
+    cell._rho = rho;
+  }
+  if (cell._P < 0.) {
+    cell._P = P;
+  }
+
+  // add gravity prediction. Handled by Potential.hpp.
+  add_gravitational_prediction(cell, half_dt);
+}
+
+/**
+ * @brief Reconstruct the left and right state at the interface between the
+ * given left and right cell.
+ *
+ * @param left Left cell (or HydroState), containing the predicted primitive
+ * variables.
+ * @param right Right cell (or HydroState), containing the predicted primitive
+ * variables.
+ * @param dL Distance between the left cell midpoint and the interface (in
+ * internal units of L).
+ * @param dR Distance between the interface and the right cell midpoint (in
+ * internal units of L).
+ * @param rhoL_dash Left state density (in internal units of M L^-3).
+ * @param uL_dash Left state velocity (in internal units of L T^-1).
+ * @param PL_dash Left state pressure (in internal units of M L^-1 T^-2).
+ * @param rhoR_dash Right state density (in internal units of M L^-3).
+ * @param uR_dash Right state velocity (in internal units of L T^-1).
+ * @param PR_dash Right state pressure (in internal units of M L^-1 T^-2).
+ */
+template <typename _left_type_, typename _right_type_>
+inline static void
+reconstruct_interface_states(const _left_type_ &left, const _right_type_ &right,
+                             const double dL, const double dR,
+                             double &rhoL_dash, double &uL_dash,
+                             double &PL_dash, double &rhoR_dash,
+                             double &uR_dash, double &PR_dash) {
+  // get the variables in the left and right state
+  const double rhoL = left._rho;
+  const double uL = left._u;
+  const double PL = left._P;
+  const double rhoR = right._rho;
+  const double uR = right._u;
+  const double PR = right._P;
+
+  // do the second order spatial reconstruction
+  // on a non-uniform grid, the interface is not halfway in between the cell
+  // midpoints, so we use a different distance on both sides
+  const double dplu = -dR;
+  rhoL_dash = rhoL + dL * left._grad_rho;
+  uL_dash = uL + dL * left._grad_u;
+  PL_dash = PL + dL * left._grad_P;
+  rhoR_dash = rhoR + dplu * right._grad_rho;
+  uR_dash = uR + dplu * right._grad_u;
+  PR_dash = PR + dplu * right._grad_P;
+
+  if (rhoL_dash < 0.) {
+    rhoL_dash = rhoL;
+  }
+  if (rhoR_dash < 0.) {
+    rhoR_dash = rhoR;
+  }
+  if (PL_dash < 0.) {
+    PL_dash = PL;
+  }
+  if (PR_dash < 0.) {
+    PR_dash = PR;
+  }
+}
+
+#endif // HYDRO_HPP
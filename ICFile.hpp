@@ -21,12 +21,196 @@
  *
  * @brief Set up initial conditions from a binary initial condition file.
  *
+ * The initial condition file is a binary snapshot file (e.g. the lastsnap.dat
+ * written at the end of every run, see SnapshotWriter.hpp), or an old format
+ * file without header (see SnapshotReader.hpp). The file is memory-mapped and
+ * copied into the cells in parallel.
+ *
+ * If the file contains the same number of cells as the grid and the cell
+ * midpoints match, the values are copied as they are. Otherwise, the density,
+ * velocity and pressure are linearly interpolated in radius onto the grid
+ * (values outside the radial range of the file are set to the value of the
+ * first or last cell in the file). Old format files do not contain the cell
+ * positions, and can only be used for a grid with the same number of cells.
+ *
+ * The gravitational acceleration is taken from old format files, and is
+ * recomputed from the external potential for binary snapshot files.
+ *
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #ifndef ICFILE_HPP
 #define ICFILE_HPP
 
-#include <fstream>
+#include "Cell.hpp"           // Cell class
+#include "Potential.hpp"      // external gravity
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+#include "SnapshotReader.hpp" // binary snapshot file reader
+#include "Units.hpp"          // unit information
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/**
+ * @brief Get the index of the given field in the initial condition file, and
+ * the factor that converts its values to internal units.
+ *
+ * Aborts if the file does not contain the field, or if the field does not have
+ * the expected unit.
+ *
+ * @param snapshot SnapshotReader.
+ * @param name Name of the field.
+ * @param unit Expected SI unit of the field.
+ * @param unit_in_si Internal unit of the field (in SI units).
+ * @param factor Variable to store the conversion factor in.
+ * @return Index of the field.
+ */
+inline static int get_ic_field(const SnapshotReader &snapshot,
+                               const std::string name, const std::string unit,
+                               const double unit_in_si, double &factor) {
+  const int ifield = snapshot.get_field_index(name);
+  if (ifield < 0) {
+    std::cerr << "Initial condition file \"" << snapshot.get_filename()
+              << "\" does not contain the field " << name << "!" << std::endl;
+    abort();
+  }
+  if (snapshot.is_legacy()) {
+    factor = 1.;
+  } else {
+    if (snapshot.get_unit(ifield) != unit) {
+      std::cerr << "Field " << name << " in initial condition file \""
+                << snapshot.get_filename() << "\" has unit \""
+                << snapshot.get_unit(ifield) << "\" (expected \"" << unit
+                << "\")!" << std::endl;
+      abort();
+    }
+    factor = 1. / unit_in_si;
+  }
+  return ifield;
+}
+
+/**
+ * @brief Set the primitive variables of the given cells from the given
+ * initial condition file.
+ *
+ * @param snapshot SnapshotReader for the initial condition file.
+ * @param cells Cells to initialize (the grid needs to be set up).
+ * @param ncell Number of cells.
+ * @param output std::ostream to write information to.
+ */
+inline static void initialize_from_snapshot(const SnapshotReader &snapshot,
+                                            Cell *cells,
+                                            const uint_fast32_t ncell,
+                                            std::ostream &output) {
+  double rho_factor, u_factor, P_factor;
+  const int irho = get_ic_field(snapshot, "density", "kg m^-3",
+                                UNIT_DENSITY_IN_SI, rho_factor);
+  const int iu = get_ic_field(snapshot, "velocity", "m s^-1",
+                              UNIT_VELOCITY_IN_SI, u_factor);
+  const int iP = get_ic_field(snapshot, "pressure", "kg m^-1 s^-2",
+                              UNIT_PRESSURE_IN_SI, P_factor);
+  const int ia = snapshot.get_field_index("acceleration");
+  const int ir = snapshot.get_field_index("radius");
+  double r_factor = 1.;
+  if (ir >= 0) {
+    get_ic_field(snapshot, "radius", "m", UNIT_LENGTH_IN_SI, r_factor);
+  }
+  const uint_fast64_t nfile = snapshot.get_ncell();
+
+  // check if the file uses the same grid
+  bool same_grid = (nfile == ncell);
+  if (same_grid && ir >= 0) {
+    for (uint_fast32_t i = 0; i < ncell && same_grid; ++i) {
+      const double rfile = snapshot.get_value(ir, i) * r_factor;
+      const double rgrid = cells[i + 1]._midpoint;
+      same_grid = (std::abs(rfile - rgrid) <=
+                   1.e-10 * (std::abs(rfile) + std::abs(rgrid)));
+    }
+  }
+
+  if (same_grid) {
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 0; i < ncell; ++i) {
+      cells[i + 1]._rho = snapshot.get_value(irho, i) * rho_factor;
+      cells[i + 1]._u = snapshot.get_value(iu, i) * u_factor;
+      cells[i + 1]._P = snapshot.get_value(iP, i) * P_factor;
+    }
+  } else {
+    if (ir < 0) {
+      std::cerr << "Initial condition file \"" << snapshot.get_filename()
+                << "\" contains " << nfile << " cells, but the grid has "
+                << ncell
+                << " cells (old format files without header cannot be "
+                   "resampled)!"
+                << std::endl;
+      abort();
+    }
+    for (uint_fast64_t j = 1; j < nfile; ++j) {
+      if (!(snapshot.get_value(ir, j) > snapshot.get_value(ir, j - 1))) {
+        std::cerr << "Radii in initial condition file \""
+                  << snapshot.get_filename() << "\" are not increasing!"
+                  << std::endl;
+        abort();
+      }
+    }
+    output << "Resampling initial condition from " << nfile << " to "
+           << ncell << " cells." << std::endl;
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 0; i < ncell; ++i) {
+      const double r = cells[i + 1]._midpoint / r_factor;
+      // binary search for the first file cell with a larger radius
+      uint_fast64_t high = 0;
+      uint_fast64_t count = nfile;
+      while (count > 0) {
+        const uint_fast64_t step = count / 2;
+        if (snapshot.get_value(ir, high + step) <= r) {
+          high += step + 1;
+          count -= step + 1;
+        } else {
+          count = step;
+        }
+      }
+      uint_fast64_t low;
+      double weight;
+      if (high == 0) {
+        low = 0;
+        weight = 0.;
+      } else if (high == nfile) {
+        low = nfile - 1;
+        high = nfile - 1;
+        weight = 0.;
+      } else {
+        low = high - 1;
+        const double rlow = snapshot.get_value(ir, low);
+        weight = (r - rlow) / (snapshot.get_value(ir, high) - rlow);
+      }
+      const double rho_low = snapshot.get_value(irho, low);
+      const double u_low = snapshot.get_value(iu, low);
+      const double P_low = snapshot.get_value(iP, low);
+      cells[i + 1]._rho =
+          (rho_low + weight * (snapshot.get_value(irho, high) - rho_low)) *
+          rho_factor;
+      cells[i + 1]._u =
+          (u_low + weight * (snapshot.get_value(iu, high) - u_low)) * u_factor;
+      cells[i + 1]._P =
+          (P_low + weight * (snapshot.get_value(iP, high) - P_low)) * P_factor;
+    }
+  }
+
+  // old format files contain the gravitational acceleration; for other files
+  // it is set by the external potential
+#pragma omp parallel for schedule(static)
+  for (uint_fast32_t i = 0; i < ncell; ++i) {
+    if (ia >= 0) {
+      cells[i + 1]._a = snapshot.get_value(ia, i);
+    } else {
+      cells[i + 1]._a = 0.;
+      update_gravitational_acceleration(cells[i + 1]);
+    }
+  }
+}
 
 /**
  * @brief Initialize the given cells.
@@ -35,24 +219,17 @@
  * @param ncell Number of cells.
  */
 #define initialize(cells, ncell)                                               \
-  /* open the initial condition file */                                        \
-  std::ifstream icfile(ic_file_name.c_str());                                  \
-  if (!icfile.good()) {                                                        \
-    std::cerr << "Looking for" << '\t' << ic_file_name << std::endl;           \
-    std::cerr << "Initial condition file not found!" << std::endl;             \
-    return 1;                                                                  \
-  }                                                                            \
-                                                                               \
-  /* initialize the cells (we don't initialize the ghost cells) */             \
-  for (unsigned int i = 1; i < ncell + 1; ++i) {                               \
-    /* read the primitive variables from the initial condition file */         \
-    icfile.read(reinterpret_cast<char *>(&cells[i]._rho), sizeof(double));     \
-    icfile.read(reinterpret_cast<char *>(&cells[i]._u), sizeof(double));       \
-    icfile.read(reinterpret_cast<char *>(&cells[i]._P), sizeof(double));       \
-    icfile.read(reinterpret_cast<char *>(&cells[i]._a), sizeof(double));       \
-  }                                                                            \
+  {                                                                            \
+    /* open (memory-map) the initial condition file */                         \
+    const SnapshotReader icfile(ic_file_name);                                 \
+    if (!icfile.is_open()) {                                                   \
+      std::cerr << "Looking for" << '\t' << ic_file_name << std::endl;         \
+      std::cerr << "Initial condition file not found!" << std::endl;           \
+      return 1;                                                                \
+    }                                                                          \
                                                                                \
-  /* close the initial condition file */                                       \
-  icfile.close();
+    /* initialize the cells (we don't initialize the ghost cells) */           \
+    initialize_from_snapshot(icfile, cells, ncell, output);                    \
+  }
 
 #endif // ICFILE_HPP
@@ -0,0 +1,416 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file InSituAnalysis.hpp
+ *
+ * @brief In-situ analysis: time series of global quantities and probe values.
+ *
+ * Every ANALYSIS_INTERVAL steps, the quantities in ANALYSIS_QUANTITIES (a comma
+ * separated list of quantity names, see insituanalysis_quantity_names) and the
+ * density at the radii in ANALYSIS_PROBE_RADII_IN_AU (a comma separated list)
+ * are computed (the density of the cell that contains the radius, or of the
+ * first or last cell if the radius is outside the grid). A record is only
+ * written if at least one value changed by more than a relative amount
+ * ANALYSIS_TOLERANCE since the last record (using the same criterion as the
+ * ionisation radius log), and at the end of the run.
+ *
+ * The time series file (analysis.dat) has the following layout (all values in
+ * native byte order):
+ *  - 8 characters: "HCS1DTSR"
+ *  - uint32: format version (currently 1)
+ *  - uint32: number of columns, ncolumn
+ *  - ncolumn times: 32 character column name and 32 character SI unit, both
+ *    padded with zeros
+ *  - records of ncolumn doubles (in SI units); the first column is always the
+ *    simulation time
+ * read_snapshot.py contains a reader for this file.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef INSITUANALYSIS_HPP
+#define INSITUANALYSIS_HPP
+
+#include "Cell.hpp"           // Cell class
+#include "Checkpoint.hpp"     // checkpoint writer and reader
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+#include "Units.hpp"          // unit information
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Practical names for the global quantities.
+ */
+enum InSituAnalysisQuantity {
+  INSITUANALYSIS_IONISATION_RADIUS = 0,
+  INSITUANALYSIS_CENTRAL_MASS,
+  INSITUANALYSIS_TOTAL_MASS,
+  INSITUANALYSIS_INNER_MASS_FLUX,
+  INSITUANALYSIS_NUMBER_OF_QUANTITIES
+};
+
+/*! @brief Names of the global quantities, used for input and output. */
+static const char
+    *insituanalysis_quantity_names[INSITUANALYSIS_NUMBER_OF_QUANTITIES] = {
+        "ionisation_radius", "central_mass", "total_mass", "inner_mass_flux"};
+
+/*! @brief SI units of the global quantities (for DIMENSIONALITY_3D). */
+static const char
+    *insituanalysis_quantity_units[INSITUANALYSIS_NUMBER_OF_QUANTITIES] = {
+        "m", "kg", "kg", "kg s^-1"};
+
+/*! @brief SI units of the global quantities for DIMENSIONALITY_1D (the total
+ *  mass and the mass flux are per unit area). */
+static const char
+    *insituanalysis_quantity_units_1D[INSITUANALYSIS_NUMBER_OF_QUANTITIES] = {
+        "m", "kg", "kg m^-2", "kg m^-2 s^-1"};
+
+/**
+ * @brief In-situ analysis.
+ */
+class InSituAnalysis {
+private:
+  /*! @brief Name of the time series file. */
+  const std::string _filename;
+
+  /*! @brief Time series file. */
+  std::ofstream _file;
+
+  /*! @brief Global quantities to compute. */
+  std::vector<int> _quantities;
+
+  /*! @brief Probe radii (in internal units of L). */
+  std::vector<double> _probe_radii;
+
+  /*! @brief Values of the current record (in SI units). */
+  std::vector<double> _values;
+
+  /*! @brief Values of the last record that was written (in SI units). */
+  std::vector<double> _last_values;
+
+  /*! @brief Has a record been written? */
+  bool _has_record;
+
+  /*! @brief Mass that flowed inwards through the inner boundary since the last
+   *  computation (in internal units of M L^-2). */
+  double _inner_mass;
+
+  /*! @brief Simulation time of the last computation (in internal units of
+   *  T). */
+  double _last_time;
+
+  /*! @brief Ionisation radius passed on to the last computation (in internal
+   *  units of L). */
+  double _last_ionisation_radius;
+
+  /**
+   * @brief Split the given comma separated list.
+   *
+   * @param list Comma separated list.
+   * @return Non-empty list elements, without leading and trailing whitespace.
+   */
+  inline static std::vector<std::string> split(const std::string list) {
+    std::vector<std::string> elements;
+    std::stringstream stream(list);
+    std::string element;
+    while (std::getline(stream, element, ',')) {
+      const size_t first = element.find_first_not_of(" \t");
+      if (first != std::string::npos) {
+        const size_t last = element.find_last_not_of(" \t");
+        elements.push_back(element.substr(first, last - first + 1));
+      }
+    }
+    return elements;
+  }
+
+  /**
+   * @brief Write a name or unit to the header, padded with zeros to 32
+   * characters.
+   *
+   * @param value Name or unit.
+   */
+  inline void write_header_string(const std::string value) {
+    char buffer[32];
+    std::memset(buffer, 0, 32);
+    std::strncpy(buffer, value.c_str(), 31);
+    _file.write(buffer, 32);
+  }
+
+  /**
+   * @brief Write the current values to the time series file.
+   */
+  inline void write_record() {
+    _file.write(reinterpret_cast<const char *>(_values.data()),
+                _values.size() * sizeof(double));
+    _last_values = _values;
+    _has_record = true;
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param output_prefix Prefix for the name of the time series file.
+   * @param restart Is this a restarted run? If so, the time series file is not
+   * overwritten.
+   */
+  inline InSituAnalysis(const std::string output_prefix, const bool restart)
+      : _filename(output_prefix + "analysis.dat"), _has_record(false),
+        _inner_mass(0.), _last_time(0.), _last_ionisation_radius(-1.) {
+
+    const std::vector<std::string> quantities = split(ANALYSIS_QUANTITIES);
+    for (uint_fast32_t i = 0; i < quantities.size(); ++i) {
+      int quantity = 0;
+      while (quantity < INSITUANALYSIS_NUMBER_OF_QUANTITIES &&
+             quantities[i] != insituanalysis_quantity_names[quantity]) {
+        ++quantity;
+      }
+      if (quantity == INSITUANALYSIS_NUMBER_OF_QUANTITIES) {
+        std::cerr << "Unknown analysis quantity: " << quantities[i] << "!"
+                  << std::endl;
+        abort();
+      }
+      _quantities.push_back(quantity);
+    }
+    const std::vector<std::string> radii = split(ANALYSIS_PROBE_RADII_IN_AU);
+    for (uint_fast32_t i = 0; i < radii.size(); ++i) {
+      char *end;
+      const double radius = std::strtod(radii[i].c_str(), &end);
+      if (*end != '\0') {
+        std::cerr << "Invalid analysis probe radius: " << radii[i] << "!"
+                  << std::endl;
+        abort();
+      }
+      _probe_radii.push_back(radius / UNIT_LENGTH_IN_AU);
+    }
+    _values.resize(1 + _quantities.size() + _probe_radii.size(), 0.);
+
+    if (ANALYSIS_INTERVAL == 0) {
+      return;
+    }
+
+    _file.open(_filename.c_str(), restart
+                                      ? (std::ios::in | std::ios::out |
+                                         std::ios::binary)
+                                      : (std::ios::out | std::ios::binary));
+    if (!restart) {
+      _file.write("HCS1DTSR", 8);
+      const uint32_t version = 1;
+      const uint32_t ncolumn = _values.size();
+      _file.write(reinterpret_cast<const char *>(&version), sizeof(uint32_t));
+      _file.write(reinterpret_cast<const char *>(&ncolumn), sizeof(uint32_t));
+      write_header_string("time");
+      write_header_string("s");
+      for (uint_fast32_t i = 0; i < _quantities.size(); ++i) {
+        write_header_string(insituanalysis_quantity_names[_quantities[i]]);
+        write_header_string(
+            (DIMENSIONALITY == DIMENSIONALITY_3D)
+                ? insituanalysis_quantity_units[_quantities[i]]
+                : insituanalysis_quantity_units_1D[_quantities[i]]);
+      }
+      for (uint_fast32_t i = 0; i < _probe_radii.size(); ++i) {
+        std::stringstream name;
+        name << "density_" << radii[i] << "_au";
+        write_header_string(name.str());
+        write_header_string("kg m^-3");
+      }
+    }
+  }
+
+  /**
+   * @brief Add the given mass flux through the inner boundary.
+   *
+   * @param mflux Mass that flowed through the inner boundary during a step
+   * (positive if it flowed outwards; in internal units of M L^-2).
+   */
+  inline void add_inner_mass_flux(const double mflux) { _inner_mass -= mflux; }
+
+  /**
+   * @brief Compute the values and write a record if necessary.
+   *
+   * @param cells Cells (including the ghost cells).
+   * @param ncell Number of cells (excluding the ghost cells).
+   * @param time Current simulation time (in internal units of T).
+   * @param ionisation_radius Current ionisation radius (in internal units of
+   * L, negative if there is no ionisation front).
+   * @param central_mass Current central mass (in internal units of M).
+   * @param force Always write a record (used at the end of the run)?
+   */
+  inline void compute(const Cell *cells, const uint_fast32_t ncell,
+                      const double time, const double ionisation_radius,
+                      const double central_mass, const bool force = false) {
+    if (ANALYSIS_INTERVAL == 0) {
+      return;
+    }
+
+    _values[0] = time * UNIT_TIME_IN_SI;
+    for (uint_fast32_t i = 0; i < _quantities.size(); ++i) {
+      double value = 0.;
+      switch (_quantities[i]) {
+      case INSITUANALYSIS_IONISATION_RADIUS:
+        value = (ionisation_radius >= 0.)
+                    ? ionisation_radius * UNIT_LENGTH_IN_SI
+                    : -1.;
+        break;
+      case INSITUANALYSIS_CENTRAL_MASS:
+        value = central_mass * UNIT_MASS_IN_SI;
+        break;
+      case INSITUANALYSIS_TOTAL_MASS: {
+        const bool spherical = (DIMENSIONALITY == DIMENSIONALITY_3D);
+        double mass = 0.;
+#pragma omp parallel for reduction(+ : mass)
+        for (uint_fast32_t k = 1; k < ncell + 1; ++k) {
+          if (spherical) {
+            const double rmin = cells[k]._lowlim;
+            const double rmax = cells[k]._uplim;
+            mass += 4. * M_PI / 3. *
+                    (rmax * rmax * rmax - rmin * rmin * rmin) * cells[k]._rho;
+          } else {
+            mass += cells[k]._rho * cells[k]._V;
+          }
+        }
+        value = spherical ? mass * UNIT_MASS_IN_SI
+                          : mass * UNIT_DENSITY_IN_SI * UNIT_LENGTH_IN_SI;
+        break;
+      }
+      case INSITUANALYSIS_INNER_MASS_FLUX: {
+        // average mass flux since the last computation
+        const double dt = time - _last_time;
+        double flux = (dt > 0.) ? _inner_mass / dt : 0.;
+        if (DIMENSIONALITY == DIMENSIONALITY_3D) {
+          const double rinner = cells[1]._lowlim;
+          flux *= 4. * M_PI * rinner * rinner;
+          value = flux * UNIT_MASS_IN_SI / UNIT_TIME_IN_SI;
+        } else {
+          value = flux * UNIT_DENSITY_IN_SI * UNIT_VELOCITY_IN_SI;
+        }
+        break;
+      }
+      }
+      _values[1 + i] = value;
+    }
+    const uint_fast32_t offset = 1 + _quantities.size();
+    for (uint_fast32_t i = 0; i < _probe_radii.size(); ++i) {
+      // binary search for the cell that contains the probe radius (the grid
+      // can change during the run)
+      uint_fast32_t low = 1;
+      uint_fast32_t high = ncell;
+      while (low < high) {
+        const uint_fast32_t mid = (low + high) / 2;
+        if (cells[mid]._uplim < _probe_radii[i]) {
+          low = mid + 1;
+        } else {
+          high = mid;
+        }
+      }
+      _values[offset + i] = cells[low]._rho * UNIT_DENSITY_IN_SI;
+    }
+    _inner_mass = 0.;
+    _last_time = time;
+    _last_ionisation_radius = ionisation_radius;
+
+    bool changed = force || !_has_record;
+    for (uint_fast32_t i = 1; i < _values.size() && !changed; ++i) {
+      changed = (std::abs(_values[i] - _last_values[i]) >
+                 ANALYSIS_TOLERANCE * std::abs(_values[i] + _last_values[i]));
+    }
+    if (changed) {
+      write_record();
+    }
+  }
+
+  /**
+   * @brief Write a final record at the end of the run.
+   *
+   * The ionisation radius is only known during a step, so we reuse the value
+   * of the last computation.
+   *
+   * @param cells Cells (including the ghost cells).
+   * @param ncell Number of cells (excluding the ghost cells).
+   * @param time Final simulation time (in internal units of T).
+   * @param central_mass Final central mass (in internal units of M).
+   */
+  inline void write_final_record(const Cell *cells, const uint_fast32_t ncell,
+                                 const double time, const double central_mass) {
+    compute(cells, ncell, time, _last_ionisation_radius, central_mass, true);
+    flush();
+  }
+
+  /**
+   * @brief Add the state to the given checkpoint.
+   *
+   * @param checkpoint CheckpointWriter.
+   */
+  inline void write_checkpoint(CheckpointWriter &checkpoint) {
+    uint64_t position = 0;
+    if (ANALYSIS_INTERVAL > 0) {
+      _file.flush();
+      position = _file.tellp();
+    }
+    checkpoint.write(position);
+    checkpoint.write(_last_values);
+    checkpoint.write(_has_record);
+    checkpoint.write(_inner_mass);
+    checkpoint.write(_last_time);
+    checkpoint.write(_last_ionisation_radius);
+  }
+
+  /**
+   * @brief Restore the state from the given checkpoint.
+   *
+   * The records that were written after the checkpoint are discarded.
+   *
+   * @param checkpoint CheckpointReader.
+   */
+  inline void read_checkpoint(CheckpointReader &checkpoint) {
+    const uint64_t position = checkpoint.read<uint64_t>();
+    checkpoint.read(_last_values);
+    checkpoint.read(_has_record);
+    checkpoint.read(_inner_mass);
+    checkpoint.read(_last_time);
+    checkpoint.read(_last_ionisation_radius);
+    if (ANALYSIS_INTERVAL > 0) {
+      _file.flush();
+      if (truncate(_filename.c_str(), position) != 0) {
+        std::cerr << "Unable to truncate analysis file!" << std::endl;
+        abort();
+      }
+      _file.seekp(position);
+    }
+  }
+
+  /**
+   * @brief Make sure all records are on disk.
+   */
+  inline void flush() {
+    if (ANALYSIS_INTERVAL > 0) {
+      _file.flush();
+    }
+  }
+};
+
+#endif // INSITUANALYSIS_HPP
@@ -0,0 +1,117 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file InterfaceStates.hpp
+ *
+ * @brief Structure-of-arrays storage for the reconstructed left and right
+ * states and the fluxes at the cell interfaces.
+ *
+ * Every variable is stored in its own contiguous, cache line aligned array, so
+ * that the batched Riemann solvers can process multiple interfaces at once
+ * using SIMD instructions. The arrays are part of the memory arena of the
+ * simulation (see MemoryArena.hpp).
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef INTERFACESTATES_HPP
+#define INTERFACESTATES_HPP
+
+#include "MemoryArena.hpp" // memory arena of the simulation
+
+#include <cstdint>
+
+/*! @brief Number of arrays in the interface storage. */
+#define INTERFACESTATES_NUMBER_OF_ARRAYS 9
+
+/**
+ * @brief Structure-of-arrays storage for the interface states and fluxes.
+ */
+class InterfaceStates {
+private:
+  /*! @brief Number of interfaces. */
+  uint_fast32_t _size;
+
+public:
+  /*! @brief Left state densities (in internal units of M L^-3). */
+  double *_rhoL;
+  /*! @brief Left state velocities (in internal units of L T^-1). */
+  double *_uL;
+  /*! @brief Left state pressures (in internal units of M L^-1 T^-2). */
+  double *_PL;
+
+  /*! @brief Right state densities (in internal units of M L^-3). */
+  double *_rhoR;
+  /*! @brief Right state velocities (in internal units of L T^-1). */
+  double *_uR;
+  /*! @brief Right state pressures (in internal units of M L^-1 T^-2). */
+  double *_PR;
+
+  /*! @brief Mass fluxes (in internal units of M T^-1). */
+  double *_mflux;
+  /*! @brief Momentum fluxes (in internal units of M L T^-2). */
+  double *_pflux;
+  /*! @brief Energy fluxes (in internal units of M L^2 T^-3). */
+  double *_Eflux;
+
+  /**
+   * @brief Get the size of the memory in the arena used by the arrays.
+   *
+   * @param size Number of interfaces.
+   * @return Size of the memory (in bytes).
+   */
+  inline static size_t get_memory_size(const uint_fast32_t size) {
+    return INTERFACESTATES_NUMBER_OF_ARRAYS *
+           MemoryArena::get_block_size<double>(size);
+  }
+
+  /**
+   * @brief Constructor.
+   *
+   * Every array starts on an aligned address in the given arena, and is freed
+   * together with the arena.
+   *
+   * @param size Number of interfaces.
+   * @param arena Memory arena of the simulation.
+   */
+  inline InterfaceStates(const uint_fast32_t size, MemoryArena &arena)
+      : _size(size) {
+    _rhoL = arena.allocate<double>(size);
+    _uL = arena.allocate<double>(size);
+    _PL = arena.allocate<double>(size);
+    _rhoR = arena.allocate<double>(size);
+    _uR = arena.allocate<double>(size);
+    _PR = arena.allocate<double>(size);
+    _mflux = arena.allocate<double>(size);
+    _pflux = arena.allocate<double>(size);
+    _Eflux = arena.allocate<double>(size);
+  }
+
+  /**
+   * @brief Get the number of interfaces.
+   *
+   * @return Number of interfaces.
+   */
+  inline uint_fast32_t size() const { return _size; }
+
+  // the arrays are shared with the arena, so the object cannot be copied
+  InterfaceStates(const InterfaceStates &) = delete;
+  InterfaceStates &operator=(const InterfaceStates &) = delete;
+};
+
+#endif // INTERFACESTATES_HPP
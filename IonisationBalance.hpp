@@ -0,0 +1,192 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file IonisationBalance.hpp
+ *
+ * @brief Integration of the photoionisation/recombination balance of the cells
+ * over a time step.
+ *
+ * The neutral fraction \f$x\f$ of a cell evolves as
+ * \f[
+ *   \frac{{\rm{}d}x}{{\rm{}d}t} = C (1 - x)^2 - J x,
+ * \f]
+ * with \f$J\f$ the photoionisation rate (Cell::_jmean) and \f$C = \alpha{}_B
+ * n_H\f$ the recombination rate. Both rates are constant during a time step.
+ *
+ * MC_IONISATION_SOLVER_EXACT uses the exact solution of this Riccati equation.
+ * If \f$x_1 = 2C / (2C + J + s)\f$, with \f$s = \sqrt{J (J + 4C)}\f$, is the
+ * equilibrium neutral fraction, the deviation \f$u = x - x_1\f$ satisfies
+ * \f[
+ *   u(t) = \frac{u_0 e^{-st}}{1 - u_0 C (1 - e^{-st}) / s}.
+ * \f]
+ * This expression has no cancellation for highly ionised cells (small
+ * \f$x_1\f$) and reduces to pure recombination if \f$J = 0\f$ (using the
+ * limit \f$C (1 - e^{-st}) / s \rightarrow{} C t\f$). The result is exact for
+ * any time step, so that the ionisation balance never needs to be sub-cycled.
+ *
+ * MC_IONISATION_SOLVER_IMPLICIT takes a single backward Euler step, which is a
+ * quadratic equation in the new neutral fraction that is solved in closed
+ * form. It is only first order accurate, but does not need any transcendental
+ * functions, and still always returns a neutral fraction in between the old
+ * value and the equilibrium value.
+ *
+ * The cell variables are gathered into contiguous arrays, so that the solvers
+ * can be vectorised across cells.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef IONISATIONBALANCE_HPP
+#define IONISATIONBALANCE_HPP
+
+#include "Cell.hpp"            // Cell class
+#include "SafeParameters.hpp"  // safe way to include Parameters.hpp
+#include "ThreadPlacement.hpp" // first touch allocator
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Get the neutral fraction at the end of a time step, using the exact
+ * solution for constant rates.
+ *
+ * @param x0 Neutral fraction at the start of the time step.
+ * @param J Photoionisation rate (in SI units of s^-1).
+ * @param C Recombination rate (in SI units of s^-1).
+ * @param dt Time step (in SI units of s).
+ * @return Neutral fraction at the end of the time step.
+ */
+inline static double get_neutral_fraction_exact(const double x0,
+                                                const double J,
+                                                const double C,
+                                                const double dt) {
+  const double s = std::sqrt(J * (J + 4. * C));
+  const double xsum = 2. * C + J + s;
+  const double x1 = (xsum > 0.) ? 2. * C / xsum : 0.;
+  const double u0 = x0 - x1;
+  const double E = std::exp(-s * dt);
+  const double h = (s > 0.) ? -C * std::expm1(-s * dt) / s : C * dt;
+  return x1 + u0 * E / (1. - u0 * h);
+}
+
+/**
+ * @brief Get the neutral fraction at the end of a time step, using a single
+ * backward Euler step.
+ *
+ * The new neutral fraction is the smallest root of
+ * \f$a x^2 - (2a + b + 1) x + a + x_0 = 0\f$, with \f$a = C \Delta{}t\f$ and
+ * \f$b = J \Delta{}t\f$.
+ *
+ * @param x0 Neutral fraction at the start of the time step.
+ * @param J Photoionisation rate (in SI units of s^-1).
+ * @param C Recombination rate (in SI units of s^-1).
+ * @param dt Time step (in SI units of s).
+ * @return Neutral fraction at the end of the time step.
+ */
+inline static double get_neutral_fraction_implicit(const double x0,
+                                                   const double J,
+                                                   const double C,
+                                                   const double dt) {
+  const double a = C * dt;
+  const double b1 = J * dt + 1.;
+  const double discriminant = b1 * (b1 + 4. * a) - 4. * a * x0;
+  return 2. * (a + x0) / (2. * a + b1 + std::sqrt(discriminant));
+}
+
+/**
+ * @brief Ionisation balance solver for all cells.
+ */
+class IonisationBalance {
+private:
+  /*! @brief Neutral fraction of every cell. */
+  std::vector<double, FirstTouchAllocator<double>> _nfac;
+
+  /*! @brief Photoionisation rate of every cell (in SI units of s^-1). */
+  std::vector<double, FirstTouchAllocator<double>> _ionisation_rate;
+
+  /*! @brief Recombination rate of every cell (in SI units of s^-1). */
+  std::vector<double, FirstTouchAllocator<double>> _recombination_rate;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * The arrays are first touched with the same static schedule as the loops
+   * in update().
+   *
+   * @param ncell Number of cells (excluding the ghost cells).
+   */
+  inline IonisationBalance(const uint_fast32_t ncell) {
+    first_touch_resize(_nfac, ncell);
+    first_touch_resize(_ionisation_rate, ncell);
+    first_touch_resize(_recombination_rate, ncell);
+  }
+
+  /**
+   * @brief Update the neutral fraction of all cells.
+   *
+   * Sets Cell::_nfac_MC, Cell::_ifrac and Cell::_ft0 to the values at the end
+   * of the time step, and stores the mean intensity in Cell::_last_jmean.
+   *
+   * @param cells Cells (including the ghost cells).
+   * @param ncell Number of cells (excluding the ghost cells).
+   * @param dt Time step (in SI units of s).
+   * @param number_density_factor Conversion factor from internal density to
+   * hydrogen number density (in SI units of m^-3 / (M L^-3)).
+   * @param solver Solver to use (MC_IONISATION_SOLVER_EXACT or
+   * MC_IONISATION_SOLVER_IMPLICIT).
+   */
+  inline void update(Cell *cells, const uint_fast32_t ncell, const double dt,
+                     const double number_density_factor, const int solver) {
+    double *nfac = _nfac.data();
+    double *J = _ionisation_rate.data();
+    double *C = _recombination_rate.data();
+#pragma omp parallel
+    {
+#pragma omp for schedule(static)
+      for (uint_fast32_t i = 0; i < ncell; ++i) {
+        const Cell &cell = cells[i + 1];
+        nfac[i] = cell._nfac_MC;
+        J[i] = cell._jmean;
+        C[i] = cell._alphaB * cell._rho * number_density_factor;
+      }
+      if (solver == MC_IONISATION_SOLVER_IMPLICIT) {
+#pragma omp for simd schedule(static)
+        for (uint_fast32_t i = 0; i < ncell; ++i) {
+          nfac[i] = get_neutral_fraction_implicit(nfac[i], J[i], C[i], dt);
+        }
+      } else {
+#pragma omp for simd schedule(static)
+        for (uint_fast32_t i = 0; i < ncell; ++i) {
+          nfac[i] = get_neutral_fraction_exact(nfac[i], J[i], C[i], dt);
+        }
+      }
+#pragma omp for schedule(static)
+      for (uint_fast32_t i = 0; i < ncell; ++i) {
+        Cell &cell = cells[i + 1];
+        cell._nfac_MC = nfac[i];
+        cell._ifrac = 1. - nfac[i];
+        cell._ft0 = cell._ifrac;
+        cell._last_jmean = cell._jmean;
+      }
+    }
+  }
+};
+
+#endif // IONISATIONBALANCE_HPP
@@ -30,6 +30,8 @@
  *
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
+#ifndef LAMBERTW_HPP
+#define LAMBERTW_HPP
 
 #include <cmath>
 #include <cstdlib>
@@ -130,3 +132,5 @@ public:
     return w1;
   }
 };
+
+#endif // LAMBERTW_HPP
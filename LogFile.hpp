@@ -21,11 +21,16 @@
  *
  * @brief Memory-mapped log file output, as in SWIFT.
  *
+ * Besides writing single values, the log file can reserve a contiguous region
+ * of the memory-mapped buffer, which allows multiple threads to fill different
+ * parts of the same region in parallel.
+ *
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #ifndef LOGFILE_HPP
 #define LOGFILE_HPP
 
+#include <algorithm>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
@@ -56,8 +61,12 @@ private:
    *  system page size. */
   const size_t _page_mask;
 
-  /*! @brief The size of the memory-mapped data, in bytes. */
-  const size_t _memory_buffer_size;
+  /*! @brief The default size of the memory-mapped data, in bytes. */
+  const size_t _default_buffer_size;
+
+  /*! @brief The size of the memory-mapped data, in bytes. This is larger than
+   *  the default size if a single reserved region did not fit. */
+  size_t _memory_buffer_size;
 
   /**
    * @brief Get the page size mask that can be used to round sizes and offsets
@@ -118,19 +127,21 @@ private:
    * @brief Increase the log file size by shifting the part of the file that was
    * written to disk.
    *
-   * We unmap the part of the file that was already written and grow the file to
-   * that size plus the default buffer size. We then memory-map the new part of
-   * the file.
+   * We unmap the memory-mapped region and grow the file to the size that was
+   * already written plus the default buffer size (or more, if the requested
+   * size does not fit in the default buffer size). We then memory-map the new
+   * part of the file.
+   *
+   * @param size Minimum requested available size after the shift, in bytes.
    */
-  inline void increase_file_size() {
+  inline void increase_file_size(const size_t size) {
     // truncate the number of bytes already written to the file to a multiple of
     // the page size
     // we will shift the memory-mapped region to this point
     const size_t buffer_offset = round_page_down(_memory_buffer_count);
-    // unmap the part of the memory-mapped region before the new offset
-    // if nothing was written to the file, we provide 1, which is rounded up to
-    // a single page size
-    if (munmap(_memory_buffer, buffer_offset > 0 ? buffer_offset : 1) != 0) {
+    // unmap the memory-mapped region; the part after the new offset is mapped
+    // again below
+    if (munmap(_memory_buffer, _memory_buffer_size) != 0) {
       std::cerr << "Error unmapping part of log file!" << std::endl;
       abort();
     }
@@ -140,6 +151,9 @@ private:
     // subtract the unmapped region from the counter that counts the bytes
     // already written to the mapped region
     _memory_buffer_count -= buffer_offset;
+    // make sure the requested size fits in the new region
+    _memory_buffer_size = std::max(
+        _default_buffer_size, round_page_up(_memory_buffer_count + size));
     // make sure we have enough disk space for the next bit of log file
     if (posix_fallocate(_file, _file_offset, _memory_buffer_size) != 0) {
       std::cerr << "Error reserving extra log file size on disk!" << std::endl;
@@ -171,7 +185,8 @@ public:
   inline LogFile(const std::string filename, const size_t size)
       : _memory_buffer(nullptr), _memory_buffer_count(0), _file_offset(0),
         _file(0), _page_mask(get_page_mask()),
-        _memory_buffer_size(round_page_up(size << 20)) {
+        _default_buffer_size(round_page_up(size << 20)),
+        _memory_buffer_size(_default_buffer_size) {
     // create the file
     // O_CREAT: create the file if it does not exist
     // O_RDWR: read/write access
@@ -211,6 +226,35 @@ public:
     }
   }
 
+  /**
+   * @brief Continue writing at the given position in the file.
+   *
+   * Used to continue an existing log file after a restart: everything after
+   * the given position is overwritten.
+   *
+   * @param position Position in the file, in bytes.
+   */
+  inline void set_current_position(const size_t position) {
+    if (munmap(_memory_buffer, _memory_buffer_size) != 0) {
+      std::cerr << "Error unmapping log file memory!" << std::endl;
+      abort();
+    }
+    _file_offset = round_page_down(position);
+    _memory_buffer_count = position - _file_offset;
+    _memory_buffer_size = _default_buffer_size;
+    if (posix_fallocate(_file, _file_offset, _memory_buffer_size) != 0) {
+      std::cerr << "Error reserving extra log file size on disk!" << std::endl;
+      abort();
+    }
+    _memory_buffer =
+        reinterpret_cast<char *>(mmap(nullptr, _memory_buffer_size, PROT_WRITE,
+                                      MAP_SHARED, _file, _file_offset));
+    if (_memory_buffer == MAP_FAILED) {
+      std::cerr << "Error memory mapping new part of log file!" << std::endl;
+      abort();
+    }
+  }
+
   /**
    * @brief Close the log file.
    *
@@ -219,8 +263,7 @@ public:
    */
   inline void close_file() {
     // unmap the actively memory-mapped region of the file
-    if (munmap(_memory_buffer,
-               _memory_buffer_count > 0 ? _memory_buffer_count : 1) != 0) {
+    if (munmap(_memory_buffer, _memory_buffer_size) != 0) {
       std::cerr << "Error unmapping log file memory!" << std::endl;
       abort();
     }
@@ -255,7 +298,7 @@ public:
    */
   inline void ensure_space(const size_t size) {
     if (_memory_buffer_size < _memory_buffer_count + size) {
-      increase_file_size();
+      increase_file_size(size);
     }
   }
 
@@ -292,6 +335,23 @@ public:
     _memory_buffer_count += vsize;
     memcpy(_memory_buffer + offset, &value, vsize);
   }
+
+  /**
+   * @brief Reserve a contiguous region of the given size in the log file.
+   *
+   * The region can be filled by multiple threads at the same time, but the
+   * returned pointer is only valid until the next call to write() or
+   * reserve(), since these can shift the memory-mapped region.
+   *
+   * @param size Size of the region, in bytes.
+   * @return Pointer to the start of the region in the memory-mapped buffer.
+   */
+  inline char *reserve(const size_t size) {
+    ensure_space(size);
+    char *region = _memory_buffer + _memory_buffer_count;
+    _memory_buffer_count += size;
+    return region;
+  }
 };
 
 #endif // LOGFILE_HPP
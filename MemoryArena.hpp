@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file MemoryArena.hpp
+ *
+ * @brief Single memory block for all arrays of a simulation whose size only
+ * depends on the number of cells and the configuration.
+ *
+ * The size of the arena is computed once, before the simulation is set up (see
+ * get_arena_size() in Simulation.cpp), and the arrays are handed out by simply
+ * moving a pointer. All arrays are freed at once when the arena is destroyed.
+ *
+ * The arena is mapped as anonymous memory, which is not touched until the
+ * arrays are first written, so that the memory pages are still placed on the
+ * socket of the thread that first writes to them (see ThreadPlacement.hpp).
+ * With HUGE_PAGES_TRANSPARENT, the kernel is asked to back the arena with
+ * transparent huge pages (2 MB on x86-64), which reduces the number of TLB
+ * misses in the loops over the cells.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef MEMORYARENA_HPP
+#define MEMORYARENA_HPP
+
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+
+/*! @brief Alignment of every array in the arena (in bytes): the size of a
+ *  cache line, which is also sufficient for AVX-512 loads and stores. */
+#define MEMORYARENA_ALIGNMENT 64
+
+/*! @brief Size of a transparent huge page (in bytes). */
+#define MEMORYARENA_HUGE_PAGE_SIZE (2 << 20)
+
+/**
+ * @brief Single memory block for all fixed size arrays of a simulation.
+ */
+class MemoryArena {
+private:
+  /*! @brief Start of the memory mapping. */
+  void *_mapping;
+
+  /*! @brief Size of the memory mapping (in bytes). */
+  size_t _mapping_size;
+
+  /*! @brief Start of the arena (aligned to MEMORYARENA_ALIGNMENT, or to
+   *  MEMORYARENA_HUGE_PAGE_SIZE if huge pages are used). */
+  char *_memory;
+
+  /*! @brief Size of the arena (in bytes). */
+  size_t _size;
+
+  /*! @brief Number of bytes that were handed out. */
+  size_t _used;
+
+  /*! @brief Description of the page type, used for output. */
+  std::string _page_description;
+
+public:
+  /**
+   * @brief Get the number of bytes in the arena used by an array with the
+   * given number of elements.
+   *
+   * @param size Number of elements.
+   * @return Size of the array, padded to a multiple of MEMORYARENA_ALIGNMENT
+   * (in bytes).
+   */
+  template <typename _datatype_>
+  inline static size_t get_block_size(const size_t size) {
+    const size_t bytes = size * sizeof(_datatype_);
+    return ((bytes + MEMORYARENA_ALIGNMENT - 1) / MEMORYARENA_ALIGNMENT) *
+           MEMORYARENA_ALIGNMENT;
+  }
+
+  /**
+   * @brief Constructor.
+   *
+   * @param size Size of the arena (in bytes; the sum of the block sizes of all
+   * arrays that will be allocated).
+   * @param huge_pages Type of pages to use (HUGE_PAGES_NONE or
+   * HUGE_PAGES_TRANSPARENT).
+   */
+  inline MemoryArena(const size_t size, const int huge_pages)
+      : _mapping(nullptr), _mapping_size(0), _memory(nullptr), _size(size),
+        _used(0), _page_description("normal pages") {
+    if (size == 0) {
+      return;
+    }
+    // huge pages need a huge page aligned address, so we map one extra huge
+    // page and start the arena at the first aligned address
+    const size_t alignment = (huge_pages == HUGE_PAGES_TRANSPARENT)
+                                 ? MEMORYARENA_HUGE_PAGE_SIZE
+                                 : MEMORYARENA_ALIGNMENT;
+    _mapping_size = size + alignment;
+    _mapping = mmap(nullptr, _mapping_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (_mapping == MAP_FAILED) {
+      std::cerr << "Unable to allocate memory arena of " << size << " bytes!"
+                << std::endl;
+      abort();
+    }
+    const uintptr_t address = reinterpret_cast<uintptr_t>(_mapping);
+    _memory = reinterpret_cast<char *>(
+        ((address + alignment - 1) / alignment) * alignment);
+
+    if (huge_pages == HUGE_PAGES_TRANSPARENT) {
+      // only whole huge pages can be backed by a huge page
+      const size_t huge_size = ((size + MEMORYARENA_HUGE_PAGE_SIZE - 1) /
+                                MEMORYARENA_HUGE_PAGE_SIZE) *
+                               MEMORYARENA_HUGE_PAGE_SIZE;
+#ifdef MADV_HUGEPAGE
+      if (madvise(_memory, huge_size, MADV_HUGEPAGE) == 0) {
+        _page_description = "transparent huge pages";
+      } else {
+        _page_description = "normal pages: transparent huge pages are not "
+                            "available";
+      }
+#else
+      (void)huge_size;
+      _page_description = "normal pages: transparent huge pages are not "
+                          "supported";
+#endif
+    }
+  }
+
+  /**
+   * @brief Destructor.
+   *
+   * Frees all arrays at once.
+   */
+  inline ~MemoryArena() {
+    if (_mapping != nullptr) {
+      munmap(_mapping, _mapping_size);
+    }
+  }
+
+  /**
+   * @brief Get an array with the given number of elements.
+   *
+   * The memory is not initialized or touched: the elements are zero when they
+   * are first read, unless they were written before.
+   *
+   * @param size Number of elements.
+   * @return Pointer to the first element (aligned to MEMORYARENA_ALIGNMENT).
+   */
+  template <typename _datatype_>
+  inline _datatype_ *allocate(const size_t size) {
+    const size_t block_size = get_block_size<_datatype_>(size);
+    if (_used + block_size > _size) {
+      std::cerr << "Memory arena is too small (" << _size
+                << " bytes, but at least " << _used + block_size
+                << " bytes are needed)!" << std::endl;
+      abort();
+    }
+    _datatype_ *block = reinterpret_cast<_datatype_ *>(_memory + _used);
+    _used += block_size;
+    return block;
+  }
+
+  /**
+   * @brief Get the size of the arena.
+   *
+   * @return Size of the arena (in bytes).
+   */
+  inline size_t get_size() const { return _size; }
+
+  /**
+   * @brief Get a description of the page type of the arena.
+   *
+   * @return Description of the page type, used for output.
+   */
+  inline const std::string &get_page_description() const {
+    return _page_description;
+  }
+
+  // the arena owns its memory, so it cannot be copied
+  MemoryArena(const MemoryArena &) = delete;
+  MemoryArena &operator=(const MemoryArena &) = delete;
+};
+
+#endif // MEMORYARENA_HPP
@@ -0,0 +1,291 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file MonteCarloControl.hpp
+ *
+ * @brief Convergence statistics and adaptive photon count for the Monte Carlo
+ * photoionisation.
+ *
+ * After every transport step, we estimate the relative error in the total path
+ * length (and hence in the mean intensity) of every cell from the path lengths
+ * of the individual packets:
+ * \f[
+ *   R = \frac{\sqrt{\sum_p l_p^2 - \frac{1}{N} \left(\sum_p l_p\right)^2}}
+ *            {\sum_p l_p},
+ * \f]
+ * with \f$N\f$ the number of packets that were propagated. The error of the
+ * step is the maximum error in the cells at the ionisation front: the cells
+ * with a neutral fraction in between MONTECARLOCONTROL_FRONT_MINIMUM_NFAC and
+ * MONTECARLOCONTROL_FRONT_MAXIMUM_NFAC, or the first cell with a neutral
+ * fraction of at least 0.5 if there are no such cells. Cells further away from
+ * the front are either fully ionised, so that their mean intensity has no
+ * effect, or are not reached by any photons.
+ *
+ * Front cells that were not reached by any packet are left out: for a sharp
+ * front (e.g. the Starbench test), the first neutral cell often lies behind
+ * an optically thick cell, and does not receive any path length, however many
+ * photons are emitted. If none of the front cells was reached, the error of
+ * the step is unknown.
+ *
+ * If a target relative error is set (MC_TARGET_RELATIVE_ERROR), the number of
+ * photons for the next step is scaled by (R / target)^2, limited to a change
+ * of a factor MONTECARLOCONTROL_MAXIMUM_CHANGE per step and to the range
+ * [MC_NUMBER_OF_PHOTONS, MC_MAXIMUM_NUMBER_OF_PHOTONS]. The number of photons
+ * does not change during steps with an unknown error.
+ *
+ * The number of photons, number of packets, the number of sampled front cells
+ * and the error of every step are written to the text file mc_statistics.txt
+ * (the error is nan for steps without sampled front cells).
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef MONTECARLOCONTROL_HPP
+#define MONTECARLOCONTROL_HPP
+
+#include "Cell.hpp"           // Cell class
+#include "Checkpoint.hpp"     // checkpoint writer and reader
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/*! @brief Minimum neutral fraction of a cell at the ionisation front. */
+#define MONTECARLOCONTROL_FRONT_MINIMUM_NFAC 0.1
+
+/*! @brief Maximum neutral fraction of a cell at the ionisation front. */
+#define MONTECARLOCONTROL_FRONT_MAXIMUM_NFAC 0.9
+
+/*! @brief Maximum factor by which the number of photons changes in between two
+ *  steps. */
+#define MONTECARLOCONTROL_MAXIMUM_CHANGE 2.
+
+/*! @brief Weight (relative to the initial weight of a packet) below which
+ *  Russian roulette is played (for MC_ESTIMATOR_PATH_LENGTH). */
+#define MONTECARLOCONTROL_ROULETTE_MINIMUM_WEIGHT 0.05
+
+/*! @brief Weight (relative to the initial weight of a packet) of packets that
+ *  survive Russian roulette (for MC_ESTIMATOR_PATH_LENGTH). */
+#define MONTECARLOCONTROL_ROULETTE_SURVIVAL_WEIGHT 0.5
+
+/**
+ * @brief Convergence statistics and adaptive photon count.
+ */
+class MonteCarloControl {
+private:
+  /*! @brief Total squared path length of the packets in every cell during the
+   *  last step (in SI units of m^2). */
+  std::vector<double> _length2;
+
+  /*! @brief Number of photons emitted by the source during the next step. */
+  uint_fast32_t _number_of_photons;
+
+  /*! @brief Name of the statistics file. */
+  const std::string _filename;
+
+  /*! @brief Statistics file. */
+  std::ofstream _file;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param ncell Number of cells (excluding the ghost cells).
+   * @param output_prefix Prefix for the name of the statistics file.
+   * @param restart Is this a restarted run? If so, the statistics file is not
+   * overwritten.
+   */
+  inline MonteCarloControl(const uint_fast32_t ncell,
+                           const std::string output_prefix,
+                           const bool restart)
+      : _length2(ncell + 2, 0.), _number_of_photons(MC_NUMBER_OF_PHOTONS),
+        _filename(output_prefix + "mc_statistics.txt"),
+        _file(_filename, restart ? (std::ios::in | std::ios::out)
+                                 : std::ios::out) {
+    if (MC_TARGET_RELATIVE_ERROR > 0. &&
+        MC_ESTIMATOR != MC_ESTIMATOR_PATH_LENGTH) {
+      std::cerr << "An adaptive number of photons (mc_target_relative_error > "
+                   "0) requires MC_ESTIMATOR_PATH_LENGTH!"
+                << std::endl;
+      abort();
+    }
+    if (MC_MAXIMUM_NUMBER_OF_PHOTONS < MC_NUMBER_OF_PHOTONS) {
+      std::cerr << "mc_maximum_number_of_photons should be at least "
+                   "mc_number_of_photons!"
+                << std::endl;
+      abort();
+    }
+    if (!restart) {
+      _file << "# time (s)\tnumber of photons\tnumber of packets\tnumber of "
+               "sampled front cells\tfront relative error (nan if no front "
+               "cell was sampled)\n";
+    }
+    _file.precision(8);
+  }
+
+  /**
+   * @brief Get the number of photons the source emits during this step.
+   *
+   * @return Number of photons.
+   */
+  inline uint_fast32_t get_number_of_photons() const {
+    return _number_of_photons;
+  }
+
+  /**
+   * @brief Get the weight of the photons the source emits during this step.
+   *
+   * The mean intensity is normalised using MC_NUMBER_OF_PHOTONS, so that a
+   * packet emitted during a step with a different number of photons has a
+   * different weight. Packets of the analog estimator always have weight 1.
+   *
+   * @return Initial weight of the photon packets.
+   */
+  inline double get_initial_weight() const {
+    return static_cast<double>(MC_NUMBER_OF_PHOTONS) / _number_of_photons;
+  }
+
+  /**
+   * @brief Set the total squared path length of the packets in the given
+   * cell.
+   *
+   * @param k Index of the cell.
+   * @param length2 Total squared path length (in SI units of m^2).
+   */
+  inline void set_squared_length(const uint_fast32_t k, const double length2) {
+    _length2[k] = length2;
+  }
+
+  /**
+   * @brief Compute the error of this step, write the statistics and set the
+   * number of photons for the next step.
+   *
+   * Should be called after the total path length (Cell::_length) and the
+   * squared path length (set_squared_length()) of all cells are set, and
+   * before the neutral fractions are updated.
+   *
+   * @param cells Cells.
+   * @param ncell Number of cells (excluding the ghost cells).
+   * @param npacket Number of packets that were propagated during this step.
+   * @param time Current simulation time (in SI units of s).
+   */
+  inline void update(const Cell *cells, const uint_fast32_t ncell,
+                     const uint_fast32_t npacket, const double time) {
+    uint_fast32_t nfront = 0;
+    double error = 0.;
+    for (uint_fast32_t k = 1; k < ncell + 1; ++k) {
+      const double nfac = cells[k]._nfac_MC;
+      // cells without path length cannot be sampled by more photons either
+      if (nfac >= MONTECARLOCONTROL_FRONT_MINIMUM_NFAC &&
+          nfac <= MONTECARLOCONTROL_FRONT_MAXIMUM_NFAC &&
+          cells[k]._length > 0.) {
+        ++nfront;
+        error = std::max(error, get_relative_error(cells, k, npacket));
+      }
+    }
+    if (nfront == 0) {
+      for (uint_fast32_t k = 1; k < ncell + 1; ++k) {
+        if (cells[k]._nfac_MC >= 0.5) {
+          if (cells[k]._length > 0.) {
+            nfront = 1;
+            error = get_relative_error(cells, k, npacket);
+          }
+          break;
+        }
+      }
+    }
+
+    _file << time << "\t" << _number_of_photons << "\t" << npacket << "\t"
+          << nfront << "\t";
+    if (nfront > 0) {
+      _file << error << "\n";
+    } else {
+      _file << "nan\n";
+    }
+
+    if (MC_TARGET_RELATIVE_ERROR > 0. && nfront > 0) {
+      const double ratio = error / MC_TARGET_RELATIVE_ERROR;
+      const double factor =
+          std::min(std::max(ratio * ratio, 1. / MONTECARLOCONTROL_MAXIMUM_CHANGE),
+                   MONTECARLOCONTROL_MAXIMUM_CHANGE);
+      const double number_of_photons =
+          std::min(std::max(std::round(factor * _number_of_photons),
+                            static_cast<double>(MC_NUMBER_OF_PHOTONS)),
+                   static_cast<double>(MC_MAXIMUM_NUMBER_OF_PHOTONS));
+      _number_of_photons = number_of_photons;
+    }
+  }
+
+  /**
+   * @brief Get the relative error in the total path length of the given cell.
+   *
+   * @param cells Cells.
+   * @param k Index of the cell.
+   * @param npacket Number of packets that were propagated during this step.
+   * @return Relative error (1 if no packet reached the cell).
+   */
+  inline double get_relative_error(const Cell *cells, const uint_fast32_t k,
+                                   const uint_fast32_t npacket) const {
+    const double length = cells[k]._length;
+    if (!(length > 0.)) {
+      return 1.;
+    }
+    const double variance =
+        std::max(_length2[k] - length * length / npacket, 0.);
+    return std::sqrt(variance) / length;
+  }
+
+  /**
+   * @brief Add the state to the given checkpoint.
+   *
+   * @param checkpoint CheckpointWriter.
+   */
+  inline void write_checkpoint(CheckpointWriter &checkpoint) {
+    _file.flush();
+    checkpoint.write<uint64_t>(_file.tellp());
+    checkpoint.write<uint64_t>(_number_of_photons);
+  }
+
+  /**
+   * @brief Restore the state from the given checkpoint.
+   *
+   * The statistics that were written after the checkpoint are discarded.
+   *
+   * @param checkpoint CheckpointReader.
+   */
+  inline void read_checkpoint(CheckpointReader &checkpoint) {
+    const uint64_t position = checkpoint.read<uint64_t>();
+    _number_of_photons = checkpoint.read<uint64_t>();
+    _file.flush();
+    if (truncate(_filename.c_str(), position) != 0) {
+      std::cerr << "Unable to truncate Monte Carlo statistics file!"
+                << std::endl;
+      abort();
+    }
+    _file.seekp(position);
+  }
+};
+
+#endif // MONTECARLOCONTROL_HPP
@@ -0,0 +1,473 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file OffloadTransport.hpp
+ *
+ * @brief Monte Carlo photon transport on an OpenMP offload device.
+ *
+ * Used instead of the host transport in get_ionisation_radius() if the code is
+ * configured with OFFLOAD_OPENMP_TARGET. The photon packet bank only lives on
+ * the device: packets are propagated with one device thread per packet,
+ * stored in the slot with their own index, and compacted on the device at the
+ * end of every step (in the same order as Bank::swap). The bank is only copied
+ * to the host when a checkpoint is written.
+ *
+ * Every step, only the cell variables that are needed for the transport are
+ * copied to the device, and only the (squared) path length in every cell is
+ * copied back.
+ * Path lengths are accumulated with atomic additions, so that the order of
+ * the additions (and hence the round off in the path lengths) depends on the
+ * order in which the packets are propagated. The photon histories themselves
+ * do not, as every packet has its own random number stream.
+ *
+ * If no device is available, the OpenMP runtime runs the target regions on the
+ * host.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef OFFLOADTRANSPORT_HPP
+#define OFFLOADTRANSPORT_HPP
+
+#include "Cell.hpp"              // Cell class
+#include "Checkpoint.hpp"        // checkpoint writer and reader
+#include "PhotonPropagation.hpp" // photon packet propagation
+#include "RandomGenerator.hpp"   // counter-based random number generator
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*! @brief Number of bank slots that are compacted by a single device thread.
+ */
+#define OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE 1024
+
+/**
+ * @brief Monte Carlo photon transport on an offload device.
+ */
+class OffloadTransport {
+private:
+  /*! @brief Number of cells (including the ghost cells). */
+  const uint_fast32_t _ncell;
+
+  /*! @brief Width of every cell (in SI units of m). */
+  std::vector<double> _width;
+
+  /*! @brief Density of every cell (in internal units of M L^-3). */
+  std::vector<double> _rho;
+
+  /*! @brief Neutral fraction of every cell. */
+  std::vector<double> _nfac;
+
+  /*! @brief Photoionisation cross section of every cell (in SI units of
+   *  m^2). */
+  std::vector<double> _sigma;
+
+  /*! @brief Path length of all packets in every cell during the last step (in
+   *  SI units of m). */
+  std::vector<double> _length;
+
+  /*! @brief Squared path length of the packets in every cell during the last
+   *  step (in SI units of m^2). */
+  std::vector<double> _length2;
+
+  /*! @brief Grid cell for each packet, for both bank buffers (only up to date
+   *  on the device). */
+  std::vector<int> _cell[2];
+
+  /*! @brief Remaining optical depth (or weight, for the path length
+   *  estimator) for each packet, for both bank buffers (only up to date on the
+   *  device). */
+  std::vector<double> _taurem[2];
+
+  /*! @brief Position of each packet in its grid cell, in relation to the lower
+   *  boundary (in SI units of m), for both bank buffers (only up to date on
+   *  the device). */
+  std::vector<double> _distance[2];
+
+  /*! @brief Number of stored packets in every compaction block, and their
+   *  offset in the compacted buffer (plus the total number of packets). */
+  std::vector<uint_fast32_t> _block_count;
+
+  /*! @brief Index of the bank buffer that contains the stored packets. */
+  unsigned char _current;
+
+  /*! @brief Number of packets in the current bank buffer. */
+  uint_fast32_t _size;
+
+  /**
+   * @brief Map the bank buffers onto the device.
+   */
+  inline void map_bank() {
+    const size_t capacity = _cell[0].size();
+    for (unsigned char ibuffer = 0; ibuffer < 2; ++ibuffer) {
+      int *cell = _cell[ibuffer].data();
+      double *taurem = _taurem[ibuffer].data();
+      double *distance = _distance[ibuffer].data();
+#pragma omp target enter data map(alloc : cell[0 : capacity],                 \
+                                  taurem[0 : capacity],                       \
+                                  distance[0 : capacity])
+    }
+    uint_fast32_t *block_count = _block_count.data();
+    const size_t nblock = _block_count.size();
+#pragma omp target enter data map(alloc : block_count[0 : nblock])
+  }
+
+  /**
+   * @brief Remove the bank buffers from the device.
+   */
+  inline void unmap_bank() {
+    const size_t capacity = _cell[0].size();
+    for (unsigned char ibuffer = 0; ibuffer < 2; ++ibuffer) {
+      int *cell = _cell[ibuffer].data();
+      double *taurem = _taurem[ibuffer].data();
+      double *distance = _distance[ibuffer].data();
+#pragma omp target exit data map(delete : cell[0 : capacity],                 \
+                                 taurem[0 : capacity],                        \
+                                 distance[0 : capacity])
+    }
+    uint_fast32_t *block_count = _block_count.data();
+    const size_t nblock = _block_count.size();
+#pragma omp target exit data map(delete : block_count[0 : nblock])
+  }
+
+  /**
+   * @brief Copy the packets in the current bank buffer between the host and
+   * the device.
+   *
+   * @param to_device Copy from the host to the device (true) or from the
+   * device to the host (false).
+   */
+  inline void update_current_buffer(const bool to_device) {
+    const size_t size = _size;
+    int *cell = _cell[_current].data();
+    double *taurem = _taurem[_current].data();
+    double *distance = _distance[_current].data();
+    if (to_device) {
+#pragma omp target update to(cell[0 : size], taurem[0 : size],                \
+                             distance[0 : size])
+    } else {
+#pragma omp target update from(cell[0 : size], taurem[0 : size],              \
+                               distance[0 : size])
+    }
+  }
+
+  /**
+   * @brief Make sure the bank has room for the given number of packets.
+   *
+   * The bank grows by at least a factor 2, and the packets in the current
+   * buffer are preserved.
+   *
+   * @param npacket Number of packets.
+   */
+  inline void reserve(const uint_fast32_t npacket) {
+    if (npacket > _cell[0].size()) {
+      update_current_buffer(false);
+      unmap_bank();
+      const size_t new_size = std::max<size_t>(npacket, 2 * _cell[0].size());
+      for (unsigned char ibuffer = 0; ibuffer < 2; ++ibuffer) {
+        _cell[ibuffer].resize(new_size, 0);
+        _taurem[ibuffer].resize(new_size, 0.);
+        _distance[ibuffer].resize(new_size, 0.);
+      }
+      const size_t nblock =
+          (new_size + OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE - 1) /
+          OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE;
+      _block_count.resize(nblock + 1, 0);
+      map_bank();
+      update_current_buffer(true);
+    }
+  }
+
+  // the device memory cannot be shared, so that we disallow copies
+  OffloadTransport(const OffloadTransport &);
+  OffloadTransport &operator=(const OffloadTransport &);
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param ncell Number of cells (excluding the ghost cells).
+   */
+  inline OffloadTransport(const uint_fast32_t ncell)
+      : _ncell(ncell + 2), _width(ncell + 2, 0.), _rho(ncell + 2, 0.),
+        _nfac(ncell + 2, 0.), _sigma(ncell + 2, 0.), _length(ncell + 2, 0.),
+        _length2(ncell + 2, 0.), _block_count(1, 0), _current(0), _size(0) {
+    const size_t n = _ncell;
+    double *width = _width.data();
+    double *rho = _rho.data();
+    double *nfac = _nfac.data();
+    double *sigma = _sigma.data();
+    double *length = _length.data();
+    double *length2 = _length2.data();
+#pragma omp target enter data map(alloc : width[0 : n], rho[0 : n],           \
+                                  nfac[0 : n], sigma[0 : n], length[0 : n],   \
+                                  length2[0 : n])
+    map_bank();
+  }
+
+  /**
+   * @brief Destructor.
+   *
+   * Frees the device memory.
+   */
+  inline ~OffloadTransport() {
+    const size_t n = _ncell;
+    double *width = _width.data();
+    double *rho = _rho.data();
+    double *nfac = _nfac.data();
+    double *sigma = _sigma.data();
+    double *length = _length.data();
+    double *length2 = _length2.data();
+#pragma omp target exit data map(delete : width[0 : n], rho[0 : n],           \
+                                 nfac[0 : n], sigma[0 : n], length[0 : n],    \
+                                 length2[0 : n])
+    unmap_bank();
+  }
+
+  /**
+   * @brief Get the number of packets in the bank.
+   *
+   * @return Number of packets stored during the previous step.
+   */
+  inline uint_fast32_t size() const { return _size; }
+
+  /**
+   * @brief Propagate the packets in the bank and the new photons emitted by
+   * the source during this step, and store the packets that run out of time.
+   *
+   * @param cells Cells (including the ghost cells).
+   * @param nphoton Number of photons emitted by the source.
+   * @param weighted Use weighted packets (MC_ESTIMATOR_PATH_LENGTH) instead of
+   * analog packets?
+   * @param initial_weight Weight of the photons emitted by the source (only
+   * used for weighted packets).
+   * @param minimum_weight Weight below which Russian roulette is played (only
+   * used for weighted packets).
+   * @param survival_weight Weight of packets that survive Russian roulette
+   * (only used for weighted packets).
+   * @param seed Seed for the random number streams.
+   * @param step Index of the transport step.
+   * @param lstep Distance light travels during this step (in SI units of m).
+   * @param length_unit Internal unit of length (in SI units of m).
+   * @param number_density_factor Conversion factor from internal density to
+   * hydrogen number density (in SI units of m^-3 / (M L^-3)).
+   */
+  inline void propagate(const Cell *cells, const uint_fast32_t nphoton,
+                        const bool weighted, const double initial_weight,
+                        const double minimum_weight,
+                        const double survival_weight, const uint_fast64_t seed,
+                        const uint_fast64_t step, const double lstep, const double length_unit,
+                        const double number_density_factor) {
+    const size_t n = _ncell;
+    const int last_cell = _ncell - 2;
+    const uint_fast32_t nbanki = _size;
+    const uint_fast32_t npacket = nbanki + nphoton;
+    reserve(npacket);
+
+    // copy the cell variables that are needed for the transport
+    double *width = _width.data();
+    double *rho = _rho.data();
+    double *nfac = _nfac.data();
+    double *sigma = _sigma.data();
+    double *length = _length.data();
+    double *length2 = _length2.data();
+#pragma omp parallel for
+    for (uint_fast32_t k = 0; k < n; ++k) {
+      width[k] = cells[k]._V * length_unit;
+      rho[k] = cells[k]._rho;
+      nfac[k] = cells[k]._nfac_MC;
+      sigma[k] = cells[k]._sigma;
+    }
+#pragma omp target update to(width[0 : n], rho[0 : n], nfac[0 : n],           \
+                             sigma[0 : n])
+
+    const unsigned char future = _current ^ 1;
+    const int *cell_current = _cell[_current].data();
+    const double *taurem_current = _taurem[_current].data();
+    const double *distance_current = _distance[_current].data();
+    int *cell_future = _cell[future].data();
+    double *taurem_future = _taurem[future].data();
+    double *distance_future = _distance[future].data();
+
+#pragma omp target teams distribute parallel for
+    for (uint_fast32_t k = 0; k < n; ++k) {
+      length[k] = 0.;
+      length2[k] = 0.;
+    }
+
+    // propagate all packets, one device thread per packet
+#pragma omp target teams distribute parallel for
+    for (uint_fast32_t j = 0; j < npacket; ++j) {
+      int cell;
+      double taurem;
+      double rcurrent;
+      if (j < nbanki) {
+        cell = cell_current[j];
+        taurem = taurem_current[j];
+        rcurrent = distance_current[j];
+      } else {
+        cell = 1;
+        if (weighted) {
+          taurem = initial_weight;
+        } else {
+          RandomGenerator random_generator(seed, step, j - nbanki);
+          taurem = -std::log(random_generator.get_uniform_random_double());
+        }
+        rcurrent = 0.;
+      }
+      double lrem = lstep;
+      if (weighted) {
+        RandomGenerator random_generator(seed, step, j);
+        while (taurem > 0. && lrem > 0. && cell <= last_cell) {
+          propagate_weighted_packet<true>(
+              width[cell], rho[cell], number_density_factor, nfac[cell],
+              sigma[cell], minimum_weight, survival_weight, random_generator,
+              length[cell], length2[cell], cell, taurem, rcurrent, lrem);
+        }
+      } else {
+        while (taurem > 0. && lrem > 0. && cell <= last_cell) {
+          propagate_packet<true>(width[cell], rho[cell], number_density_factor,
+                                 nfac[cell], sigma[cell], length[cell],
+                                 length2[cell], cell, taurem, rcurrent, lrem);
+        }
+      }
+      // packets that ran out of time are stored for the next step
+      if (taurem > 0. && lrem == 0. && cell <= last_cell) {
+        cell_future[j] = cell;
+        taurem_future[j] = taurem;
+        distance_future[j] = rcurrent;
+      } else {
+        cell_future[j] = 0;
+        taurem_future[j] = 0.;
+        distance_future[j] = 0.;
+      }
+    }
+
+    // compact the stored packets into the current buffer (which has been
+    // completely read by now), preserving their order
+    const uint_fast32_t nblock =
+        (npacket + OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE - 1) /
+        OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE;
+    uint_fast32_t *block_count = _block_count.data();
+#pragma omp target teams distribute parallel for
+    for (uint_fast32_t iblock = 0; iblock < nblock; ++iblock) {
+      const uint_fast32_t ibegin =
+          iblock * OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE;
+      const uint_fast32_t iend =
+          (ibegin + OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE < npacket)
+              ? ibegin + OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE
+              : npacket;
+      uint_fast32_t count = 0;
+      for (uint_fast32_t i = ibegin; i < iend; ++i) {
+        count += (cell_future[i] > 0);
+      }
+      block_count[iblock] = count;
+    }
+#pragma omp target
+    {
+      uint_fast32_t offset = 0;
+      for (uint_fast32_t iblock = 0; iblock < nblock; ++iblock) {
+        const uint_fast32_t count = block_count[iblock];
+        block_count[iblock] = offset;
+        offset += count;
+      }
+      block_count[nblock] = offset;
+    }
+    int *cell_compact = _cell[_current].data();
+    double *taurem_compact = _taurem[_current].data();
+    double *distance_compact = _distance[_current].data();
+#pragma omp target teams distribute parallel for
+    for (uint_fast32_t iblock = 0; iblock < nblock; ++iblock) {
+      const uint_fast32_t ibegin =
+          iblock * OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE;
+      const uint_fast32_t iend =
+          (ibegin + OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE < npacket)
+              ? ibegin + OFFLOADTRANSPORT_COMPACTION_BLOCK_SIZE
+              : npacket;
+      uint_fast32_t offset = block_count[iblock];
+      for (uint_fast32_t i = ibegin; i < iend; ++i) {
+        if (cell_future[i] > 0) {
+          cell_compact[offset] = cell_future[i];
+          taurem_compact[offset] = taurem_future[i];
+          distance_compact[offset] = distance_future[i];
+          ++offset;
+        }
+      }
+    }
+
+    // copy back the path lengths and the new number of packets
+#pragma omp target update from(length[0 : n], length2[0 : n],                 \
+                               block_count[nblock : 1])
+    _size = block_count[nblock];
+  }
+
+  /**
+   * @brief Get the path length of all packets in the given cell during the
+   * last step.
+   *
+   * @param k Index of the cell.
+   * @return Path length (in SI units of m).
+   */
+  inline double get_length(const uint_fast32_t k) const { return _length[k]; }
+
+  /**
+   * @brief Get the squared path length of the packets in the given cell
+   * during the last step.
+   *
+   * @param k Index of the cell.
+   * @return Squared path length (in SI units of m^2).
+   */
+  inline double get_squared_length(const uint_fast32_t k) const {
+    return _length2[k];
+  }
+
+  /**
+   * @brief Add the packets in the bank to the given checkpoint.
+   *
+   * Uses the same format as Bank::write_checkpoint.
+   *
+   * @param checkpoint CheckpointWriter.
+   */
+  inline void write_checkpoint(CheckpointWriter &checkpoint) {
+    update_current_buffer(false);
+    checkpoint.write<uint64_t>(_size);
+    checkpoint.write(_cell[_current].data(), _size);
+    checkpoint.write(_taurem[_current].data(), _size);
+    checkpoint.write(_distance[_current].data(), _size);
+  }
+
+  /**
+   * @brief Restore the packets in the bank from the given checkpoint.
+   *
+   * @param checkpoint CheckpointReader.
+   */
+  inline void read_checkpoint(CheckpointReader &checkpoint) {
+    const uint_fast32_t size = checkpoint.read<uint64_t>();
+    _size = 0;
+    reserve(size);
+    _size = size;
+    checkpoint.read(_cell[_current].data(), _size);
+    checkpoint.read(_taurem[_current].data(), _size);
+    checkpoint.read(_distance[_current].data(), _size);
+    update_current_buffer(true);
+  }
+};
+
+#endif // OFFLOADTRANSPORT_HPP
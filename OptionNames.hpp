@@ -75,6 +75,10 @@
 /*! @brief Fixed ionisation radius: use the initial ionisation radius as a
  *  constant ionisation radius. */
 #define IONISATION_MODE_CONSTANT 2
+/*! @brief Monte Carlo photoionisation: the neutral fraction is computed from
+ *  the mean intensity obtained by a time dependent Monte Carlo photon packet
+ *  transport. */
+#define IONISATION_MODE_MONTE_CARLO_TRANSFER 3
 
 // Possible types of ionisation transition.
 
@@ -97,4 +101,123 @@
 /*! @brief 3D spherically symmetric solver. */
 #define DIMENSIONALITY_3D 2
 
+// Possible types of radial grid
+
+/*! @brief Uniform grid: all cells have the same width. */
+#define GRID_TYPE_UNIFORM 1
+/*! @brief Logarithmic grid: the cell width is proportional to the radius. */
+#define GRID_TYPE_LOGARITHMIC 2
+/*! @brief Grid with cell face positions read from a text file. */
+#define GRID_TYPE_FILE 3
+
+// Possible Monte Carlo path length estimators
+
+/*! @brief Analog estimator: every packet is absorbed at a randomly sampled
+ *  optical depth. */
+#define MC_ESTIMATOR_ANALOG 1
+/*! @brief Expected path length estimator: packets carry a weight that is
+ *  reduced continuously by absorption, with Russian roulette for low weight
+ *  packets. */
+#define MC_ESTIMATOR_PATH_LENGTH 2
+
+// Possible Monte Carlo ionisation balance solvers
+
+/*! @brief Exact solution of the ionisation balance equation for constant rates
+ *  during the time step. */
+#define MC_IONISATION_SOLVER_EXACT 1
+/*! @brief Single backward Euler step of the ionisation balance equation. */
+#define MC_IONISATION_SOLVER_IMPLICIT 2
+
+// Possible types of thread pinning
+
+/*! @brief Threads are not pinned by the code (they can still be bound by the
+ *  OpenMP runtime, e.g. using OMP_PROC_BIND). */
+#define THREAD_PINNING_NONE 1
+/*! @brief Thread i is pinned to the i-th CPU the process is allowed to run on,
+ *  so that consecutive threads share a socket. */
+#define THREAD_PINNING_COMPACT 2
+/*! @brief Threads are pinned to CPUs that are evenly spread over the CPUs the
+ *  process is allowed to run on, so that they are spread over all sockets. */
+#define THREAD_PINNING_SPREAD 3
+
+// Possible types of memory pages for the memory arena
+
+/*! @brief The memory arena uses normal pages. */
+#define HUGE_PAGES_NONE 1
+/*! @brief The memory arena is backed by transparent huge pages (if the kernel
+ *  supports them). */
+#define HUGE_PAGES_TRANSPARENT 2
+
+// Possible types of hydro sweep
+
+/*! @brief Separate parallel passes over all cells for every step of the hydro
+ *  scheme. */
+#define HYDRO_SWEEP_PASSES 1
+/*! @brief Single cache blocked sweep that does the gradient, prediction and flux
+ *  steps for a block of cells at once. */
+#define HYDRO_SWEEP_FUSED 2
+
+// Possible types of time stepping
+
+/*! @brief All cells use the same, fixed physical time step. */
+#define TIME_STEPPING_FIXED 1
+/*! @brief Every cell uses its own power of 2 time step, based on its local
+ *  Courant condition. */
+#define TIME_STEPPING_INDIVIDUAL 2
+/*! @brief All cells use the same power of 2 time step, based on the minimal
+ *  Courant time step of all cells. */
+#define TIME_STEPPING_GLOBAL_CFL 3
+
+// Possible types of adaptive grid refinement
+
+/*! @brief No refinement: the grid does not change during the run. */
+#define REFINEMENT_NONE 1
+/*! @brief Refine the grid around the ionisation front and steep density
+ *  gradients, and coarsen it elsewhere (see Refinement.hpp). */
+#define REFINEMENT_IONISATION_FRONT 2
+
+// Possible snapshot types
+
+/*! @brief Text snapshots (snapshot_XXXX.txt). */
+#define SNAPSHOT_TYPE_TEXT 1
+/*! @brief Binary snapshots with a self-describing header (snapshot_XXXX.dat).
+ */
+#define SNAPSHOT_TYPE_BINARY 2
+/*! @brief All snapshots in a single, indexed container file (snapshots.dat). */
+#define SNAPSHOT_TYPE_CONTAINER 3
+
+// Possible snapshot compression types
+
+/*! @brief Uncompressed binary snapshots. */
+#define SNAPSHOT_COMPRESSION_NONE 1
+/*! @brief Lossless compression of all fields (byte shuffling and deflate). */
+#define SNAPSHOT_COMPRESSION_LOSSLESS 2
+/*! @brief Lossless compression, after the density and pressure are rounded to
+ *  a relative error below SNAPSHOT_COMPRESSION_TOLERANCE. */
+#define SNAPSHOT_COMPRESSION_LOSSY 3
+
+// Possible log file types
+
+/*! @brief No log file. */
+#define LOGFILE_NONE 1
+/*! @brief Event log with significant changes in the cell variables
+ *  (logfile.dat). */
+#define LOGFILE_EVENTS 2
+
+// Possible hardware counter types
+
+/*! @brief No hardware counters, only phase timers. */
+#define HARDWARE_COUNTERS_NONE 1
+/*! @brief Linux perf_event counters: cycles, instructions and last level cache
+ *  misses. */
+#define HARDWARE_COUNTERS_PERF 2
+
+// Possible offload types
+
+/*! @brief No offloading: everything runs on the host. */
+#define OFFLOAD_NONE 1
+/*! @brief Run the Monte Carlo photon transport on an OpenMP offload device
+ *  (see OffloadTransport.hpp). */
+#define OFFLOAD_OPENMP_TARGET 2
+
 #endif // OPTIONNAMES_HPP
@@ -0,0 +1,296 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file PhaseTimers.hpp
+ *
+ * @brief Named timers for the different phases of the main simulation loop.
+ *
+ * Phases are started and stopped from the master thread, outside parallel
+ * regions, and should not overlap. Within a parallel region, every thread can
+ * add the time it spent working on its own part of a phase, from which we
+ * derive a load imbalance for that phase. If the code is configured with
+ * HARDWARE_COUNTERS_PERF, we also record hardware counters for every phase.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef PHASETIMERS_HPP
+#define PHASETIMERS_HPP
+
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+#include "Timer.hpp"          // Timer class
+
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+#include "HardwareCounters.hpp" // perf_event hardware counters
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <omp.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Practical names for the phases of the main loop.
+ */
+enum Phase {
+  PHASE_SOURCE_TERMS = 0,
+  PHASE_IONISATION,
+  PHASE_PRIMITIVES,
+  PHASE_TIME_STEP,
+  PHASE_LOGFILE,
+  PHASE_SNAPSHOT,
+  PHASE_BOUNDARIES,
+  PHASE_GRADIENTS,
+  PHASE_PREDICTION,
+  PHASE_RIEMANN,
+  PHASE_FLUX_EXCHANGE,
+  PHASE_FUSED_SWEEP,
+  PHASE_REFINEMENT,
+  PHASE_CHECKPOINT,
+  PHASE_ANALYSIS,
+  NUMBER_OF_PHASES
+};
+
+/*! @brief Names of the phases, used for output. */
+static const char *phase_names[NUMBER_OF_PHASES] = {
+    "source_terms", "ionisation", "primitives", "time_step",
+    "logfile", "snapshot", "boundaries", "gradients",
+    "prediction", "riemann", "flux_exchange", "fused_sweep",
+    "refinement", "checkpoint", "analysis"};
+
+/**
+ * @brief Named timers for the phases of the main loop.
+ */
+class PhaseTimers {
+private:
+  /*! @brief Timers for every phase. */
+  Timer _timers[NUMBER_OF_PHASES];
+
+  /*! @brief Number of times every phase was started. */
+  uint_fast64_t _number_of_calls[NUMBER_OF_PHASES];
+
+  /*! @brief Number of threads. */
+  const int _number_of_threads;
+
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+  /*! @brief Hardware counters. */
+  HardwareCounters _counters;
+
+  /*! @brief Counter values at the start of the current phase. */
+  uint64_t _counter_start[NUMBER_OF_HARDWARECOUNTERS];
+
+  /*! @brief Total counter values for every phase. */
+  uint64_t _counter_totals[NUMBER_OF_PHASES][NUMBER_OF_HARDWARECOUNTERS];
+#endif
+
+  /*! @brief Time every thread spent working on every phase (in s, phase major
+   *  order). */
+  std::vector<double> _thread_times;
+
+  /**
+   * @brief Get the mean and maximum time the threads spent on the given phase.
+   *
+   * @param phase Phase.
+   * @param mean Variable to store the mean thread time in (in s).
+   * @param max Variable to store the maximum thread time in (in s).
+   * @return True if any thread time was recorded for the phase.
+   */
+  inline bool get_thread_times(const int phase, double &mean,
+                               double &max) const {
+    mean = 0.;
+    max = 0.;
+    for (int ithread = 0; ithread < _number_of_threads; ++ithread) {
+      const double time = _thread_times[phase * _number_of_threads + ithread];
+      mean += time;
+      max = std::max(max, time);
+    }
+    mean /= _number_of_threads;
+    return max > 0.;
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param number_of_threads Maximum number of threads that will be used during
+   * the run.
+   */
+  inline PhaseTimers(const int number_of_threads = omp_get_max_threads())
+      : _number_of_threads(number_of_threads),
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+        _counters(number_of_threads),
+#endif
+        _thread_times(NUMBER_OF_PHASES * _number_of_threads, 0.) {
+    for (int i = 0; i < NUMBER_OF_PHASES; ++i) {
+      _timers[i].reset();
+      _number_of_calls[i] = 0;
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+      for (int j = 0; j < NUMBER_OF_HARDWARECOUNTERS; ++j) {
+        _counter_totals[i][j] = 0;
+      }
+#endif
+    }
+  }
+
+  /**
+   * @brief Start the given phase.
+   *
+   * @param phase Phase.
+   */
+  inline void start(const Phase phase) {
+    ++_number_of_calls[phase];
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+    _counters.read_counters(_counter_start);
+#endif
+    _timers[phase].start();
+  }
+
+  /**
+   * @brief Stop the given phase.
+   *
+   * @param phase Phase.
+   */
+  inline void stop(const Phase phase) {
+    _timers[phase].stop();
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+    uint64_t values[NUMBER_OF_HARDWARECOUNTERS];
+    _counters.read_counters(values);
+    for (int i = 0; i < NUMBER_OF_HARDWARECOUNTERS; ++i) {
+      _counter_totals[phase][i] += values[i] - _counter_start[i];
+    }
+#endif
+  }
+
+  /**
+   * @brief Add the time a thread spent working on the given phase.
+   *
+   * This function can be called by all threads of a parallel region at the
+   * same time, as every thread only updates its own value.
+   *
+   * @param phase Phase.
+   * @param ithread Thread number.
+   * @param time Time spent by the thread (in s).
+   */
+  inline void add_thread_time(const Phase phase, const int ithread,
+                              const double time) {
+    _thread_times[phase * _number_of_threads + ithread] += time;
+  }
+
+  /**
+   * @brief Print a summary table of all phases that were used.
+   *
+   * The thread imbalance is the ratio of the maximum and mean time spent by
+   * the threads on the parts of the phase that record thread times.
+   *
+   * @param stream std::ostream to write to.
+   * @param total_time Total program time, used to compute time fractions (in
+   * s).
+   */
+  inline void print_summary(std::ostream &stream,
+                            const double total_time) const {
+    const std::ios_base::fmtflags flags = stream.flags();
+    const std::streamsize precision = stream.precision();
+    stream << std::fixed << std::setprecision(3);
+    stream << "Phase timers:\n";
+    stream << std::setw(15) << "phase" << std::setw(12) << "time (s)"
+           << std::setw(11) << "fraction" << std::setw(10) << "calls"
+           << std::setw(12) << "imbalance";
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+    for (int j = 0; j < NUMBER_OF_HARDWARECOUNTERS; ++j) {
+      stream << std::setw(15) << hardware_counter_names[j];
+    }
+    stream << std::setw(8) << "IPC";
+#endif
+    stream << "\n";
+    double accounted_time = 0.;
+    for (int i = 0; i < NUMBER_OF_PHASES; ++i) {
+      if (_number_of_calls[i] == 0) {
+        continue;
+      }
+      const double time = _timers[i].value();
+      accounted_time += time;
+      stream << std::setw(15) << phase_names[i] << std::setw(12) << time
+             << std::setw(10) << (100. * time / total_time) << "%"
+             << std::setw(10) << _number_of_calls[i];
+      double mean, max;
+      if (get_thread_times(i, mean, max)) {
+        stream << std::setw(12) << (max / mean);
+      } else {
+        stream << std::setw(12) << "-";
+      }
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+      for (int j = 0; j < NUMBER_OF_HARDWARECOUNTERS; ++j) {
+        stream << std::setw(15) << _counter_totals[i][j];
+      }
+      if (_counter_totals[i][HARDWARECOUNTER_CYCLES] > 0) {
+        stream << std::setw(8)
+               << (double(_counter_totals[i][HARDWARECOUNTER_INSTRUCTIONS]) /
+                   _counter_totals[i][HARDWARECOUNTER_CYCLES]);
+      } else {
+        stream << std::setw(8) << "-";
+      }
+#endif
+      stream << "\n";
+    }
+    stream << std::setw(15) << "other" << std::setw(12)
+           << (total_time - accounted_time) << std::setw(10)
+           << (100. * (total_time - accounted_time) / total_time) << "%"
+           << std::endl;
+    stream.flags(flags);
+    stream.precision(precision);
+  }
+
+  /**
+   * @brief Write the phase timers to a CSV file.
+   *
+   * The file contains one line per phase, with the total time, number of calls,
+   * mean and maximum thread time (all times in s) and the hardware counter
+   * values (if enabled).
+   *
+   * @param filename Name of the file.
+   */
+  inline void write_csv(const std::string filename) const {
+    std::ofstream ofile(filename);
+    ofile << "phase,time,calls,mean_thread_time,max_thread_time";
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+    for (int j = 0; j < NUMBER_OF_HARDWARECOUNTERS; ++j) {
+      ofile << "," << hardware_counter_names[j];
+    }
+#endif
+    ofile << "\n";
+    ofile.precision(10);
+    for (int i = 0; i < NUMBER_OF_PHASES; ++i) {
+      double mean, max;
+      get_thread_times(i, mean, max);
+      ofile << phase_names[i] << "," << _timers[i].value() << ","
+            << _number_of_calls[i] << "," << mean << "," << max;
+#if HARDWARE_COUNTERS == HARDWARE_COUNTERS_PERF
+      for (int j = 0; j < NUMBER_OF_HARDWARECOUNTERS; ++j) {
+        ofile << "," << _counter_totals[i][j];
+      }
+#endif
+      ofile << "\n";
+    }
+  }
+};
+
+#endif // PHASETIMERS_HPP
@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file PhotonPropagation.hpp
+ *
+ * @brief Propagation of a photon packet through a single cell.
+ *
+ * There are two estimators for the path length of the packets in a cell
+ * (MC_ESTIMATOR):
+ *  - MC_ESTIMATOR_ANALOG: every packet has a randomly sampled optical depth,
+ *    and is absorbed once it has travelled this optical depth. The path
+ *    length is the distance the packet actually travels in the cell.
+ *  - MC_ESTIMATOR_PATH_LENGTH: packets are never absorbed, but carry a weight
+ *    that is reduced by a factor exp(-tau) when they travel an optical depth
+ *    tau. The path length is the expected path length of an analog packet,
+ *    weight * (1 - exp(-tau)) / kappa, which has a much lower variance, as
+ *    every packet contributes to every cell it reaches. Packets with a low
+ *    weight are terminated using Russian roulette: they survive with a
+ *    probability weight / survival_weight and then get the weight
+ *    survival_weight, so that the estimator remains unbiased.
+ * Both estimators also add the square of the path length of every packet in
+ * every cell to a separate accumulator, so that the variance of the path
+ * length can be estimated.
+ *
+ * The functions only use their arguments, so that they can be used both on the
+ * host (see PROPAGATE in Bondi.hpp) and on an offload device (see
+ * OffloadTransport.hpp).
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef PHOTONPROPAGATION_HPP
+#define PHOTONPROPAGATION_HPP
+
+#include "RandomGenerator.hpp" // counter-based random number generator
+
+#include <cmath>
+
+#pragma omp declare target
+
+/**
+ * @brief Add the path length of a packet to the accumulators of a cell.
+ *
+ * @param dlength Path length (in SI units of m).
+ * @param length Path length accumulator (in SI units of m).
+ * @param length2 Squared path length accumulator (in SI units of m^2).
+ */
+template <bool _atomic_>
+inline static void add_path_length(const double dlength, double &length,
+                                   double &length2) {
+  if (_atomic_) {
+#pragma omp atomic
+    length += dlength;
+#pragma omp atomic
+    length2 += dlength * dlength;
+  } else {
+    length += dlength;
+    length2 += dlength * dlength;
+  }
+}
+
+/**
+ * @brief Propagate a packet through its current cell.
+ *
+ * If the packet is unable to reach the end of the cell, it is either absorbed
+ * (remaining optical depth to travel less than the cell optical depth) and
+ * terminated, or halted (if it cannot travel the physical distance of the cell
+ * in the remaining time step).
+ *
+ * @param width Width of the cell (in SI units of m).
+ * @param rho Density of the cell (in internal units of M L^-3).
+ * @param number_density_factor Conversion factor from internal density to
+ * hydrogen number density (in SI units of m^-3 / (M L^-3)).
+ * @param nfac Neutral fraction of the cell.
+ * @param sigma Photoionisation cross section of the cell (in SI units of m^2).
+ * @param length Path length of the packet in the cell is added to this
+ * variable (in SI units of m); if _atomic_ is true, the addition is atomic.
+ * @param length2 Square of the path length is added to this variable (in SI
+ * units of m^2).
+ * @param cell Cell location of packet.
+ * @param taurem Remaining optical depth packet has to travel.
+ * @param rcurrent Distance from current cell lower boundary that packet has
+ * travelled (in SI units of m).
+ * @param lrem Distance packet can travel in this timestep (in SI units of m).
+ * Is set to exactly zero if the packet runs out of time.
+ */
+template <bool _atomic_>
+inline static void propagate_packet(const double width, const double rho,
+                                    const double number_density_factor,
+                                    const double nfac, const double sigma,
+                                    double &length, double &length2, int &cell,
+                                    double &taurem, double &rcurrent,
+                                    double &lrem) {
+  const double lcell = width - rcurrent;
+  const double kappa = rho * number_density_factor * nfac * sigma;
+  const double taucell = sigma * lcell * rho * number_density_factor * nfac;
+  double dlength;
+  if (taurem > taucell && lrem > lcell) {
+    dlength = lcell;
+    taurem -= taucell;
+    lrem -= lcell;
+    ++cell;
+    rcurrent = 0.;
+  } else {
+    const double taulength = taurem / kappa;
+    if (taulength <= lrem) {
+      dlength = taulength;
+      taurem = 0.;
+    } else {
+      dlength = lrem;
+      taurem -= kappa * lrem;
+      rcurrent += lrem;
+      lrem = 0.;
+    }
+  }
+  add_path_length<_atomic_>(dlength, length, length2);
+}
+
+/**
+ * @brief Propagate a weighted packet through its current cell.
+ *
+ * The packet either reaches the end of the cell, or is halted (if it cannot
+ * travel the physical distance of the cell in the remaining time step). Its
+ * weight is reduced by the optical depth it travelled, and Russian roulette is
+ * played if the weight drops below the given minimum weight (a terminated
+ * packet gets weight 0).
+ *
+ * @param width Width of the cell (in SI units of m).
+ * @param rho Density of the cell (in internal units of M L^-3).
+ * @param number_density_factor Conversion factor from internal density to
+ * hydrogen number density (in SI units of m^-3 / (M L^-3)).
+ * @param nfac Neutral fraction of the cell.
+ * @param sigma Photoionisation cross section of the cell (in SI units of m^2).
+ * @param minimum_weight Weight below which Russian roulette is played.
+ * @param survival_weight Weight of packets that survive Russian roulette.
+ * @param random_generator Random number stream of the packet.
+ * @param length Expected path length of the packet in the cell is added to
+ * this variable (in SI units of m); if _atomic_ is true, the addition is
+ * atomic.
+ * @param length2 Square of the expected path length is added to this variable
+ * (in SI units of m^2).
+ * @param cell Cell location of packet.
+ * @param weight Weight of the packet.
+ * @param rcurrent Distance from current cell lower boundary that packet has
+ * travelled (in SI units of m).
+ * @param lrem Distance packet can travel in this timestep (in SI units of m).
+ * Is set to exactly zero if the packet runs out of time.
+ */
+template <bool _atomic_>
+inline static void propagate_weighted_packet(
+    const double width, const double rho, const double number_density_factor,
+    const double nfac, const double sigma, const double minimum_weight,
+    const double survival_weight, RandomGenerator &random_generator,
+    double &length, double &length2, int &cell, double &weight,
+    double &rcurrent, double &lrem) {
+  const double lcell = width - rcurrent;
+  const double kappa = rho * number_density_factor * nfac * sigma;
+  const bool crosses_cell = (lrem > lcell);
+  const double ltravel = crosses_cell ? lcell : lrem;
+  const double tau = kappa * ltravel;
+  // expected path length of an analog packet; we use expm1 to avoid round off
+  // for optically thin cells
+  const double dlength =
+      (kappa > 0.) ? -weight * std::expm1(-tau) / kappa : weight * ltravel;
+  add_path_length<_atomic_>(dlength, length, length2);
+  weight *= std::exp(-tau);
+  if (crosses_cell) {
+    lrem -= lcell;
+    ++cell;
+    rcurrent = 0.;
+  } else {
+    rcurrent += lrem;
+    lrem = 0.;
+  }
+  if (weight < minimum_weight) {
+    if (random_generator.get_uniform_random_double() * survival_weight <
+        weight) {
+      weight = survival_weight;
+    } else {
+      weight = 0.;
+    }
+  }
+}
+
+#pragma omp end declare target
+
+#endif // PHOTONPROPAGATION_HPP
@@ -28,25 +28,49 @@
 
 /**
  * @brief Add the gravitational acceleration.
+ *
+ * do_gravity_cell() kicks a single cell, do_gravity() kicks all cells.
  */
 #if POTENTIAL == POTENTIAL_POINT_MASS
-#define do_gravity() /* add gravitational acceleration */                      \
-  _Pragma("omp parallel for") for (uint_fast32_t i = 1; i < ncell + 1; ++i) {  \
-    const double m = cells[i]._V * cells[i]._rho;                              \
-    cells[i]._p += 0.5 * cells[i]._dt * cells[i]._a * m;                       \
+#define do_gravity_cell(cell) /* add gravitational acceleration */             \
+  {                                                                            \
+    const double m = cell._V * cell._rho;                                      \
+    cell._p += 0.5 * cell._dt * cell._a * m;                                   \
     /* we do not update the total energy, as we only run gravity simulations   \
        with an isothermal eos, in which case the total energy is ignored by    \
        the hydro scheme */                                                     \
-    /*const double r = cells[i]._midpoint;                                     \
+    /*const double r = cell._midpoint;                                         \
     const double a = -G_INTERNAL * MASS_POINT_MASS / (r * r);                  \
-    cells[i]._a = a;                                                           \
-    const double m = cells[i]._V * cells[i]._rho;                              \
-    cells[i]._p += 0.5 * DT * a * m; \*/                                       \
+    cell._a = a;                                                               \
+    const double m = cell._V * cell._rho;                                      \
+    cell._p += 0.5 * DT * a * m; \*/                                           \
+  }
+#define do_gravity()                                                           \
+  _Pragma("omp parallel for schedule(static)")                                 \
+  for (uint_fast32_t i = 1; i < ncell + 1; ++i) {                              \
+    do_gravity_cell(cells[i]);                                                 \
   }
 #elif POTENTIAL == POTENTIAL_NONE
+#define do_gravity_cell(cell)
 #define do_gravity()
 #endif
 
+/**
+ * @brief Recompute the gravitational acceleration of the given cell after its
+ * midpoint changed (due to grid refinement).
+ *
+ * @param cell Cell.
+ */
+#if POTENTIAL == POTENTIAL_POINT_MASS
+#define update_gravitational_acceleration(cell)                                \
+  {                                                                            \
+    const double r2 = cell._midpoint * cell._midpoint;                         \
+    cell._a = -G_INTERNAL * MASS_POINT_MASS / r2;                              \
+  }
+#elif POTENTIAL == POTENTIAL_NONE
+#define update_gravitational_acceleration(cell)
+#endif
+
 /**
  * @brief Do the gravitational half time step prediction for the given cell.
  *
@@ -0,0 +1,179 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file PrefixScan.hpp
+ *
+ * @brief Parallel prefix sum with a search for the first element that
+ * satisfies a condition.
+ *
+ * The values are split in blocks of PREFIXSCAN_BLOCK_SIZE elements. The first
+ * pass computes the values (using a function provided by the caller, so that
+ * the computation of the values is fused with the scan) and the sum of every
+ * block in parallel. The block offsets are then summed up serially, and the
+ * second pass walks through all blocks in parallel, starting from the offset
+ * of the block.
+ *
+ * The blocks do not depend on the number of threads, and the values within a
+ * block and the block sums are always added in the same order, so that the
+ * result is exactly the same for any number of threads, including a serial
+ * run.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef PREFIXSCAN_HPP
+#define PREFIXSCAN_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*! @brief Number of elements in a block of the scan. */
+#define PREFIXSCAN_BLOCK_SIZE 1024
+
+/**
+ * @brief Parallel prefix sum over a fixed number of values.
+ */
+class PrefixScan {
+private:
+  /*! @brief Number of values. */
+  const uint_fast32_t _size;
+
+  /*! @brief Number of blocks. */
+  const uint_fast32_t _number_of_blocks;
+
+  /*! @brief Values. */
+  std::vector<double> _values;
+
+  /*! @brief Exclusive prefix sum at the start of every block (the last element
+   *  contains the total sum). */
+  std::vector<double> _block_offsets;
+
+  /*! @brief First element that satisfies the search condition in every block
+   *  (or the number of values if no element in the block does). */
+  std::vector<uint_fast32_t> _block_first;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param size Number of values.
+   */
+  inline PrefixScan(const uint_fast32_t size)
+      : _size(size),
+        _number_of_blocks((size + PREFIXSCAN_BLOCK_SIZE - 1) /
+                          PREFIXSCAN_BLOCK_SIZE),
+        _values(size, 0.), _block_offsets(_number_of_blocks + 1, 0.),
+        _block_first(_number_of_blocks, size) {}
+
+  /**
+   * @brief Compute the values and their prefix sum.
+   *
+   * @param value_function Function that returns the value with the given index
+   * (in the range [0, size[). Is called exactly once for every index, from
+   * multiple threads at the same time.
+   */
+  template <typename _value_function_>
+  inline void compute(_value_function_ value_function) {
+    const uint_fast32_t nblock = _number_of_blocks;
+#pragma omp parallel for
+    for (uint_fast32_t iblock = 0; iblock < nblock; ++iblock) {
+      const uint_fast32_t ibegin = iblock * PREFIXSCAN_BLOCK_SIZE;
+      const uint_fast32_t iend =
+          std::min<uint_fast32_t>(ibegin + PREFIXSCAN_BLOCK_SIZE, _size);
+      double sum = 0.;
+      for (uint_fast32_t i = ibegin; i < iend; ++i) {
+        _values[i] = value_function(i);
+        sum += _values[i];
+      }
+      _block_offsets[iblock + 1] = sum;
+    }
+    _block_offsets[0] = 0.;
+    for (uint_fast32_t iblock = 0; iblock < nblock; ++iblock) {
+      _block_offsets[iblock + 1] += _block_offsets[iblock];
+    }
+  }
+
+  /**
+   * @brief Get the value with the given index.
+   *
+   * @param index Index (in the range [0, size[).
+   * @return Value, as computed during the last call to compute().
+   */
+  inline double get_value(const uint_fast32_t index) const {
+    return _values[index];
+  }
+
+  /**
+   * @brief Get the sum of all values.
+   *
+   * @return Sum of all values.
+   */
+  inline double get_total() const { return _block_offsets[_number_of_blocks]; }
+
+  /**
+   * @brief Find the first element that satisfies the given condition.
+   *
+   * @param condition Function that takes the exclusive prefix sum before an
+   * element (the sum of all values with a lower index) and the value of the
+   * element, and returns true if the element satisfies the condition.
+   * @param exclusive_sum Variable to store the exclusive prefix sum before the
+   * first element that satisfies the condition in (or the total sum if no
+   * element does).
+   * @return Index of the first element that satisfies the condition, or size if
+   * no element does.
+   */
+  template <typename _condition_>
+  inline uint_fast32_t find_first(_condition_ condition,
+                                  double &exclusive_sum) {
+    const uint_fast32_t nblock = _number_of_blocks;
+#pragma omp parallel for
+    for (uint_fast32_t iblock = 0; iblock < nblock; ++iblock) {
+      const uint_fast32_t ibegin = iblock * PREFIXSCAN_BLOCK_SIZE;
+      const uint_fast32_t iend =
+          std::min<uint_fast32_t>(ibegin + PREFIXSCAN_BLOCK_SIZE, _size);
+      double sum = _block_offsets[iblock];
+      uint_fast32_t ifirst = _size;
+      for (uint_fast32_t i = ibegin; i < iend; ++i) {
+        if (condition(sum, _values[i])) {
+          ifirst = i;
+          break;
+        }
+        sum += _values[i];
+      }
+      _block_first[iblock] = ifirst;
+    }
+    // the first block that contains an element that satisfies the condition
+    // contains the answer
+    for (uint_fast32_t iblock = 0; iblock < nblock; ++iblock) {
+      const uint_fast32_t ifirst = _block_first[iblock];
+      if (ifirst < _size) {
+        const uint_fast32_t ibegin = iblock * PREFIXSCAN_BLOCK_SIZE;
+        exclusive_sum = _block_offsets[iblock];
+        for (uint_fast32_t i = ibegin; i < ifirst; ++i) {
+          exclusive_sum += _values[i];
+        }
+        return ifirst;
+      }
+    }
+    exclusive_sum = get_total();
+    return _size;
+  }
+};
+
+#endif // PREFIXSCAN_HPP
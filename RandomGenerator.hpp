@@ -0,0 +1,107 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file RandomGenerator.hpp
+ *
+ * @brief Counter-based random number generator.
+ *
+ * The random numbers only depend on a seed, a stream index and the position
+ * within that stream, and not on the order in which the numbers are drawn. This
+ * means that every photon packet can get its own stream, so that the photon
+ * histories are the same irrespective of the number of threads used or the
+ * order in which the threads process the packets.
+ *
+ * The generator uses the SplitMix64 finaliser (Steele, Lea & Flood, 2014) as a
+ * bijective mixing function on a Weyl sequence.
+ *
+ * The generator can also be used on an OpenMP offload device.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef RANDOMGENERATOR_HPP
+#define RANDOMGENERATOR_HPP
+
+#include <cstdint>
+
+#pragma omp declare target
+
+/**
+ * @brief Counter-based random number generator.
+ */
+class RandomGenerator {
+private:
+  /*! @brief Key that identifies the random number stream. */
+  uint_fast64_t _key;
+
+  /*! @brief Position within the random number stream. */
+  uint_fast64_t _counter;
+
+  /**
+   * @brief Mix the bits of the given 64-bit integer.
+   *
+   * @param x Integer to mix.
+   * @return Mixed integer.
+   */
+  inline static uint_fast64_t mix(uint_fast64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param seed Global seed for the simulation.
+   * @param stream Index of the stream (e.g. the time step).
+   * @param substream Index of the substream (e.g. the photon packet index).
+   */
+  inline RandomGenerator(const uint_fast64_t seed, const uint_fast64_t stream,
+                         const uint_fast64_t substream = 0)
+      : _key(mix(mix(mix(seed) ^ stream) ^ substream)), _counter(0) {}
+
+  /**
+   * @brief Get the next random 64-bit integer in the stream.
+   *
+   * @return Random 64-bit integer.
+   */
+  inline uint_fast64_t get_random_integer() {
+    ++_counter;
+    return mix(_key + _counter * 0x9e3779b97f4a7c15ull);
+  }
+
+  /**
+   * @brief Get a uniform random double precision value in the open interval
+   * \f$]0,1[\f$.
+   *
+   * Zero is excluded so that the result can safely be used as argument of a
+   * logarithm.
+   *
+   * @return Uniform random double precision value.
+   */
+  inline double get_uniform_random_double() {
+    // use the 53 most significant bits to fill the mantissa and shift by half
+    // a unit to exclude both 0 and 1
+    return ((get_random_integer() >> 11) + 0.5) * (1. / 9007199254740992.);
+  }
+};
+
+#pragma omp end declare target
+
+#endif // RANDOMGENERATOR_HPP
@@ -0,0 +1,311 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file Refinement.hpp
+ *
+ * @brief Adaptive grid refinement around the ionisation front and steep
+ * density gradients.
+ *
+ * The initial grid (see Grid.hpp) is used as a base grid. Every base cell gets
+ * a refinement level, which is the maximum level (REFINEMENT_MAXIMUM_LEVEL) if
+ * the base cell (or one of its neighbours) overlaps
+ *  - the ionisation transition region: rion +- transition_width / 2, with rion
+ *    the ionisation radius computed by get_ionisation_radius(), or
+ *  - a cell with a steep density gradient: a cell for which the slope limited
+ *    density gradient still changes the density by more than a fraction
+ *    REFINEMENT_DENSITY_JUMP across the width of the base cell.
+ * The level then decreases by at most 1 from one base cell to the next, so that
+ * the refined region is surrounded by a gradual transition to the coarse grid.
+ *
+ * The grid always contains the same number of cells, so that all other parts of
+ * the program can keep using a flat array of cells: a base cell with level l
+ * gets a share of the cells proportional to 2^l, and the cell faces within a
+ * base cell are equally spaced. Refining the grid around the front hence
+ * coarsens the grid elsewhere, and the cells behind the front are coarsened
+ * again once the front has moved on.
+ *
+ * When the levels change, the conserved variables are remapped onto the new
+ * grid: every new cell receives the fraction of the mass, momentum and total
+ * energy of every old cell that corresponds to the overlap of both cells
+ * (piecewise constant prolongation, and summation as restriction), so that the
+ * remap is exactly conservative. All other cell variables are copied from the
+ * old cell that contains the midpoint of the new cell. The ghost cells keep
+ * their geometry, so that the boundary conditions do not change.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef REFINEMENT_HPP
+#define REFINEMENT_HPP
+
+#include "Cell.hpp"           // Cell class
+#include "Checkpoint.hpp"     // checkpoint writer and reader
+#include "Grid.hpp"           // base grid
+#include "Hydro.hpp"          // slope limited gradients
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Adaptive grid refinement.
+ */
+class GridRefinement {
+private:
+  /*! @brief Number of cells. */
+  const uint_fast32_t _ncell;
+
+  /*! @brief Cell faces of the base grid (in internal units of L). */
+  std::vector<double> _base_faces;
+
+  /*! @brief Refinement level of every base cell for the current grid. */
+  std::vector<unsigned int> _levels;
+
+  /*! @brief Refinement level of every base cell for the new grid. */
+  std::vector<unsigned int> _new_levels;
+
+  /*! @brief Flag for every cell, signalling a steep density gradient. */
+  std::vector<char> _steep;
+
+  /*! @brief Cumulative weight of the base cells (the weight of a base cell is
+   *  2^level). */
+  std::vector<double> _cumulative_weight;
+
+  /*! @brief Cell faces of the new grid (in internal units of L). */
+  std::vector<double> _faces;
+
+  /*! @brief Cell faces of the old grid (in internal units of L). */
+  std::vector<double> _old_faces;
+
+  /*! @brief Copy of the cells on the old grid. */
+  std::vector<Cell> _old_cells;
+
+  /*! @brief Number of times the grid changed. */
+  uint_fast64_t _number_of_updates;
+
+  /**
+   * @brief Get the base cell that contains the given radius.
+   *
+   * @param r Radius (in internal units of L).
+   * @return Index of the base cell (in the range [0, ncell[).
+   */
+  inline uint_fast32_t get_base_cell(const double r) const {
+    const uint_fast32_t k =
+        std::upper_bound(_base_faces.begin(), _base_faces.end(), r) -
+        _base_faces.begin();
+    return std::min(std::max<uint_fast32_t>(k, 1), _ncell) - 1;
+  }
+
+  /**
+   * @brief Set the new level of all base cells that overlap with the given
+   * radial range, and of their neighbours, to the maximum level.
+   *
+   * @param rmin Lower limit of the range (in internal units of L).
+   * @param rmax Upper limit of the range (in internal units of L).
+   */
+  inline void refine_range(const double rmin, const double rmax) {
+    const uint_fast32_t kmin = get_base_cell(rmin);
+    const uint_fast32_t kmax = get_base_cell(rmax);
+    const uint_fast32_t kbegin = (kmin > 0) ? kmin - 1 : 0;
+    const uint_fast32_t kend = std::min(kmax + 2, _ncell);
+    for (uint_fast32_t k = kbegin; k < kend; ++k) {
+      _new_levels[k] = REFINEMENT_MAXIMUM_LEVEL;
+    }
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param ncell Number of cells.
+   */
+  inline GridRefinement(const uint_fast32_t ncell)
+      : _ncell(ncell), _levels(ncell, 0), _new_levels(ncell, 0),
+        _steep(ncell + 2, 0), _cumulative_weight(ncell + 1, 0.),
+        _faces(ncell + 1, 0.), _old_faces(ncell + 1, 0.),
+        _old_cells(ncell + 2), _number_of_updates(0) {
+    get_grid_faces(ncell, _base_faces);
+  }
+
+  /**
+   * @brief Get the number of times the grid changed.
+   *
+   * @return Number of grid updates.
+   */
+  inline uint_fast64_t get_number_of_updates() const {
+    return _number_of_updates;
+  }
+
+  /**
+   * @brief Update the refinement levels and remap the cells onto the new grid
+   * if the levels changed.
+   *
+   * The primitive variables of the cells (including the ghost cells) are only
+   * used for the steep gradient criterion. If the grid changes, the caller
+   * needs to update the primitive variables of the cells using the new
+   * conserved variables.
+   *
+   * @param cells Cells.
+   * @param rion Ionisation radius (in internal units of L), a negative value
+   * means there is no ionisation front.
+   * @param transition_width Width of the ionisation transition region (in
+   * internal units of L).
+   * @return True if the grid changed.
+   */
+  inline bool refine(Cell *cells, const double rion,
+                     const double transition_width) {
+    const uint_fast32_t ncell = _ncell;
+
+    // flag the cells with a steep density gradient
+    // we use the width of the base cell instead of the actual cell width, so
+    // that a refined cell does not lose its flag because it became smaller
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+      HydroState gradients;
+      compute_gradients(cells[i - 1], cells[i], cells[i + 1], gradients);
+      const uint_fast32_t k = get_base_cell(cells[i]._midpoint);
+      const double base_width = _base_faces[k + 1] - _base_faces[k];
+      _steep[i] = std::abs(gradients._grad_rho) * base_width >
+                  REFINEMENT_DENSITY_JUMP * cells[i]._rho;
+    }
+
+    // get the new levels
+    std::fill(_new_levels.begin(), _new_levels.end(), 0);
+    if (rion >= 0.) {
+      refine_range(rion - 0.5 * transition_width,
+                   rion + 0.5 * transition_width);
+    }
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+      if (_steep[i]) {
+        refine_range(cells[i]._lowlim, cells[i]._uplim);
+      }
+    }
+    // limit the level jump in between neighbouring base cells to 1
+    for (uint_fast32_t k = 1; k < ncell; ++k) {
+      if (_new_levels[k - 1] > _new_levels[k] + 1) {
+        _new_levels[k] = _new_levels[k - 1] - 1;
+      }
+    }
+    for (uint_fast32_t k = ncell - 1; k > 0; --k) {
+      if (_new_levels[k] > _new_levels[k - 1] + 1) {
+        _new_levels[k - 1] = _new_levels[k] - 1;
+      }
+    }
+
+    if (_new_levels == _levels) {
+      return false;
+    }
+    _levels.swap(_new_levels);
+    ++_number_of_updates;
+
+    // compute the new cell faces: face j is placed at a fraction j / ncell of
+    // the total weight
+    _cumulative_weight[0] = 0.;
+    for (uint_fast32_t k = 0; k < ncell; ++k) {
+      _cumulative_weight[k + 1] =
+          _cumulative_weight[k] + static_cast<double>(1u << _levels[k]);
+    }
+    const double total_weight = _cumulative_weight[ncell];
+#pragma omp parallel for
+    for (uint_fast32_t j = 1; j < ncell; ++j) {
+      const double weight = total_weight * j / ncell;
+      const uint_fast32_t k =
+          std::upper_bound(_cumulative_weight.begin(),
+                           _cumulative_weight.end(), weight) -
+          _cumulative_weight.begin() - 1;
+      const double fraction = (weight - _cumulative_weight[k]) /
+                              static_cast<double>(1u << _levels[k]);
+      _faces[j] = _base_faces[k] +
+                  fraction * (_base_faces[k + 1] - _base_faces[k]);
+    }
+    _faces[0] = _base_faces[0];
+    _faces[ncell] = _base_faces[ncell];
+
+    // remap the cells
+    _old_cells.assign(cells, cells + ncell + 2);
+    for (uint_fast32_t i = 0; i < ncell; ++i) {
+      _old_faces[i] = _old_cells[i + 1]._lowlim;
+    }
+    _old_faces[ncell] = _old_cells[ncell]._uplim;
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t j = 1; j < ncell + 1; ++j) {
+      const double lowlim = _faces[j - 1];
+      const double uplim = _faces[j];
+      const double midpoint = 0.5 * (lowlim + uplim);
+
+      // copy the old cell that contains the midpoint
+      const uint_fast32_t imid =
+          std::upper_bound(_old_faces.begin(), _old_faces.end(), midpoint) -
+          _old_faces.begin();
+      cells[j] = _old_cells[std::min<uint_fast32_t>(imid, ncell)];
+
+      // add the overlapping fractions of the old cells
+      uint_fast32_t i =
+          std::upper_bound(_old_faces.begin(), _old_faces.end(), lowlim) -
+          _old_faces.begin();
+      double m = 0.;
+      double p = 0.;
+      double E = 0.;
+      while (i < ncell + 1 && _old_cells[i]._lowlim < uplim) {
+        const Cell &old_cell = _old_cells[i];
+        const double overlap = std::min(uplim, old_cell._uplim) -
+                               std::max(lowlim, old_cell._lowlim);
+        const double fraction = overlap / old_cell._V;
+        m += fraction * old_cell._m;
+        p += fraction * old_cell._p;
+        E += fraction * old_cell._E;
+        ++i;
+      }
+      cells[j]._m = m;
+      cells[j]._p = p;
+      cells[j]._E = E;
+
+      cells[j]._lowlim = lowlim;
+      cells[j]._uplim = uplim;
+      cells[j]._midpoint = midpoint;
+      cells[j]._V = uplim - lowlim;
+      cells[j]._index = j - 1;
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief Add the refinement state to the given checkpoint.
+   *
+   * @param checkpoint CheckpointWriter.
+   */
+  inline void write_checkpoint(CheckpointWriter &checkpoint) const {
+    checkpoint.write(_levels);
+    checkpoint.write(_number_of_updates);
+  }
+
+  /**
+   * @brief Restore the refinement state from the given checkpoint.
+   *
+   * @param checkpoint CheckpointReader.
+   */
+  inline void read_checkpoint(CheckpointReader &checkpoint) {
+    checkpoint.read(_levels);
+    checkpoint.read(_number_of_updates);
+  }
+};
+
+#endif // REFINEMENT_HPP
@@ -30,7 +30,9 @@
  * To use the Riemann solver, first create a RiemannSolver object with the
  * desired adiabatic index. Actual Riemann problem solutions are then obtained
  * by calling RiemannSolver::solve(), see the documentation for that function
- * for more information.
+ * for more information. Fluxes for many interfaces at once are most efficiently
+ * obtained by calling RiemannSolver::solve_for_flux_batch(), which iterates
+ * lanes of interfaces together in vectorised loops.
  *
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
@@ -39,6 +41,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 
 /**
@@ -114,6 +117,43 @@
     abort();                                                                   \
   }
 
+/*! @brief Number of interfaces that are iterated together by the batched
+ *  exact Riemann solver. */
+#define RIEMANNSOLVER_LANE_SIZE 8
+
+/*! @brief Maximum number of Newton-Raphson iterations in the batched exact
+ *  Riemann solver, interfaces that did not converge are redone with the
+ *  scalar solver. */
+#define RIEMANNSOLVER_MAXIMUM_NUMBER_OF_ITERATIONS 20
+
+/**
+ * @brief Integer power of a double precision value, computed using
+ * multiplications.
+ */
+template <unsigned int _exponent_> struct IntegerPower {
+  /**
+   * @brief Get the integer power of the given value.
+   *
+   * @param x Value.
+   * @return x to the power _exponent_.
+   */
+  static inline double power(const double x) {
+    return x * IntegerPower<_exponent_ - 1>::power(x);
+  }
+};
+
+/**
+ * @brief Zeroth power: end of the IntegerPower recursion.
+ */
+template <> struct IntegerPower<0> {
+  /**
+   * @brief Get the zeroth power of the given value.
+   *
+   * @return 1.
+   */
+  static inline double power(const double) { return 1.; }
+};
+
 /**
  * @brief Exact Riemann solver.
  */
@@ -146,6 +186,10 @@ private:
   /*! @brief @f$\frac{1}{\gamma}@f$ */
   double _ginv;
 
+  /*! @brief @f$\frac{2}{\gamma-1}@f$ if this is 3 or 5 (@f$\gamma{}=5/3@f$
+   *  or @f$\gamma{}=7/5@f$), 0 otherwise. */
+  unsigned int _tdgm1_integer;
+
   /**
    * @brief Get the soundspeed corresponding to the given density and pressure.
    *
@@ -831,6 +875,342 @@ private:
     }
   }
 
+  /**
+   * @brief Get the fluxes corresponding to the given sampled solution.
+   *
+   * @param rhosol Density solution.
+   * @param usol Velocity solution.
+   * @param Psol Pressure solution.
+   * @param mflux Mass flux.
+   * @param pflux Momentum flux.
+   * @param Eflux Energy flux.
+   */
+  inline void get_flux(const double rhosol, const double usol,
+                       const double Psol, double &mflux, double &pflux,
+                       double &Eflux) const {
+    mflux = rhosol * usol;
+    pflux = rhosol * usol * usol + Psol;
+    Eflux = (Psol / (_gamma - 1.) + 0.5 * rhosol * usol * usol) * usol +
+            Psol * usol;
+  }
+
+  /**
+   * @brief Get the rarefaction fan power @f$b^{\frac{2}{\gamma-1}}@f$.
+   *
+   * @param base Base @f$b@f$.
+   * @return Power, computed using multiplications if the given template
+   * exponent is not zero.
+   */
+  template <unsigned int _fan_exponent_>
+  inline double fan_power(const double base) const {
+    return (_fan_exponent_ > 0) ? IntegerPower<_fan_exponent_>::power(base)
+                                : std::pow(base, _tdgm1);
+  }
+
+  /**
+   * @brief Riemann fL or fR function and its derivative, evaluated without
+   * branches.
+   *
+   * Both the shock and the rarefaction expression are evaluated, so that this
+   * function can be used inside vectorised loops. The rarefaction expressions
+   * only need a single power: with
+   * @f$q = \left(\frac{P_*}{P}\right)^{\frac{\gamma-1}{2\gamma}}@f$, we have
+   * @f$\left(\frac{P_*}{P}\right)^{-\frac{\gamma+1}{2\gamma}} =
+   * q \frac{P}{P_*}@f$.
+   *
+   * @param rho Density of the left or right state.
+   * @param P Pressure of the left or right state.
+   * @param a Soundspeed of the left or right state.
+   * @param Pstar (Temporary) pressure of the middle state.
+   * @param fval Value of the fL or fR function.
+   * @param fprimeval Value of the derivative of the fL or fR function.
+   */
+  inline void fb_fprimeb(const double rho, const double P, const double a,
+                         const double Pstar, double &fval,
+                         double &fprimeval) const {
+    const double PdP = Pstar / P;
+    const double q = std::pow(PdP, _gm1d2g);
+    const double A = _tdgp1 / rho;
+    const double B = _gm1dgp1 * P;
+    const double g = std::sqrt(A / (Pstar + B));
+    if (Pstar > P) {
+      fval = (Pstar - P) * g;
+      fprimeval = (1. - 0.5 * (Pstar - P) / (B + Pstar)) * g;
+    } else {
+      fval = _tdgm1 * a * (q - 1.);
+      fprimeval = q / (PdP * rho * a);
+    }
+  }
+
+  /**
+   * @brief Solve the Riemann problems for a lane of at most
+   * RIEMANNSOLVER_LANE_SIZE interfaces directly for the fluxes.
+   *
+   * All interfaces in the lane are iterated together, using vectorised loops
+   * over the lane with masks instead of branches, until all of them have
+   * converged:
+   *  - The initial guess uses the same PVRS/TRRS/TSRS switch as guess_P()
+   *    (with the correct density factor in the PVRS guess). If the two
+   *    rarefaction (TRRS) closed form yields a pressure below both input
+   *    pressures, it is the exact solution and no iteration is needed. The
+   *    TRRS and TSRS guesses are only computed if at least one interface in
+   *    the lane needs them.
+   *  - The pressure function is monotonically increasing and concave, so that
+   *    Newton-Raphson iterations converge from both sides: an iteration that
+   *    starts above the root ends up below it, and from there on the iteration
+   *    converges monotonically. The pressure is limited to the same positivity
+   *    floor as in guess_P(), so that a root below this floor (a near vacuum
+   *    middle state) is approximated by the floor value. We use the same
+   *    convergence criterion as solve().
+   *  - The solution is sampled using the same expressions for the left and
+   *    right wave (with a sign that selects the wave), and the powers in the
+   *    sampling are rewritten as functions of a single power, e.g.
+   *    @f$\left(\frac{P_*}{P}\right)^{\frac{1}{\gamma}} = \frac{P_*}{P}
+   *    q^{-2}@f$ and
+   *    @f$b^{\frac{2\gamma}{\gamma-1}} = b^{\frac{2}{\gamma-1}} b^2@f$.
+   * Vacuum interfaces, interfaces that generate vacuum, and interfaces for
+   * which the Newton-Raphson iteration does not converge within
+   * RIEMANNSOLVER_MAXIMUM_NUMBER_OF_ITERATIONS iterations are redone with the
+   * scalar solve_for_flux(), which uses Brent's method and handles (or
+   * rejects) vacuum.
+   *
+   * Unused lane slots are padded with a trivial Riemann problem, so that the
+   * result for an interface does not depend on its position within the batch.
+   * The result agrees with solve_for_flux() to within the relative tolerance
+   * of the iteration (5.e-9).
+   *
+   * @param nlane Number of interfaces in the lane.
+   * @param rhoL Left state densities.
+   * @param uL Left state velocities.
+   * @param PL Left state pressures.
+   * @param rhoR Right state densities.
+   * @param uR Right state velocities.
+   * @param PR Right state pressures.
+   * @param mflux Mass flux solutions.
+   * @param pflux Momentum flux solutions.
+   * @param Eflux Energy flux solutions.
+   */
+  template <unsigned int _fan_exponent_>
+  inline void solve_for_flux_lane(const uint_fast32_t nlane, const double *rhoL,
+                                  const double *uL, const double *PL,
+                                  const double *rhoR, const double *uR,
+                                  const double *PR, double *mflux,
+                                  double *pflux, double *Eflux) {
+
+    double rhoLk[RIEMANNSOLVER_LANE_SIZE], uLk[RIEMANNSOLVER_LANE_SIZE],
+        PLk[RIEMANNSOLVER_LANE_SIZE], aLk[RIEMANNSOLVER_LANE_SIZE],
+        rhoRk[RIEMANNSOLVER_LANE_SIZE], uRk[RIEMANNSOLVER_LANE_SIZE],
+        PRk[RIEMANNSOLVER_LANE_SIZE], aRk[RIEMANNSOLVER_LANE_SIZE],
+        Pstar[RIEMANNSOLVER_LANE_SIZE], Pfloor[RIEMANNSOLVER_LANE_SIZE],
+        mfluxk[RIEMANNSOLVER_LANE_SIZE], pfluxk[RIEMANNSOLVER_LANE_SIZE],
+        Efluxk[RIEMANNSOLVER_LANE_SIZE], wave[RIEMANNSOLVER_LANE_SIZE];
+    // flags: interface needs to be redone with the scalar solver, interface
+    // is still iterating, interface needs a TRRS or TSRS guess, interface is
+    // sampled in a rarefaction fan
+    int scalar[RIEMANNSOLVER_LANE_SIZE], active[RIEMANNSOLVER_LANE_SIZE],
+        other[RIEMANNSOLVER_LANE_SIZE], fan[RIEMANNSOLVER_LANE_SIZE];
+
+    // load the lane, replacing unused slots and interfaces that are redone
+    // below with a trivial Riemann problem
+    for (uint_fast32_t k = 0; k < RIEMANNSOLVER_LANE_SIZE; ++k) {
+      if (k < nlane && rhoL[k] > 0. && rhoR[k] > 0. && PL[k] > 0. &&
+          PR[k] > 0.) {
+        scalar[k] = 0;
+        rhoLk[k] = rhoL[k];
+        uLk[k] = uL[k];
+        PLk[k] = PL[k];
+        rhoRk[k] = rhoR[k];
+        uRk[k] = uR[k];
+        PRk[k] = PR[k];
+      } else {
+        scalar[k] = (k < nlane);
+        rhoLk[k] = 1.;
+        uLk[k] = 0.;
+        PLk[k] = 1.;
+        rhoRk[k] = 1.;
+        uRk[k] = 0.;
+        PRk[k] = 1.;
+      }
+    }
+
+    // soundspeeds and PVRS initial guesses
+    int number_active = 0;
+    int number_other = 0;
+#pragma omp simd reduction(+ : number_active, number_other)
+    for (uint_fast32_t k = 0; k < RIEMANNSOLVER_LANE_SIZE; ++k) {
+      const double uRmuL = uRk[k] - uLk[k];
+      aLk[k] = get_soundspeed(rhoLk[k], PLk[k]);
+      aRk[k] = get_soundspeed(rhoRk[k], PRk[k]);
+      // vacuum generation
+      scalar[k] |= (_tdgm1 * (aLk[k] + aRk[k]) <= uRmuL);
+
+      const double Pmin = std::min(PLk[k], PRk[k]);
+      const double Pmax = std::max(PLk[k], PRk[k]);
+      Pfloor[k] = 5.e-9 * (PLk[k] + PRk[k]);
+      Pstar[k] =
+          std::max(Pfloor[k], 0.5 * (PLk[k] + PRk[k]) -
+                                  0.125 * uRmuL * (rhoLk[k] + rhoRk[k]) *
+                                      (aLk[k] + aRk[k]));
+      active[k] = !scalar[k];
+      other[k] = (active[k] && !(Pmax <= 2. * Pmin && Pmin <= Pstar[k] &&
+                                 Pstar[k] <= Pmax));
+      number_active += active[k];
+      number_other += other[k];
+    }
+
+    // TRRS and TSRS initial guesses for the interfaces that need them (this
+    // requires powers, so we skip this if no interface in the lane needs it)
+    if (number_other > 0) {
+      number_active = 0;
+#pragma omp simd reduction(+ : number_active)
+      for (uint_fast32_t k = 0; k < RIEMANNSOLVER_LANE_SIZE; ++k) {
+        const double uRmuL = uRk[k] - uLk[k];
+        const double Pmin = std::min(PLk[k], PRk[k]);
+        const double Ppv = Pstar[k];
+        const double base =
+            std::max(0., (aLk[k] + aRk[k] - _gm1d2 * uRmuL) /
+                             (aLk[k] * std::pow(PLk[k], -_gm1d2g) +
+                              aRk[k] * std::pow(PRk[k], -_gm1d2g)));
+        const double Ptr = std::pow(base, _tgdgm1);
+        const double gL = gb(rhoLk[k], PLk[k], Ppv);
+        const double gR = gb(rhoRk[k], PRk[k], Ppv);
+        const double Pts = (gL * PLk[k] + gR * PRk[k] - uRmuL) / (gL + gR);
+        if (other[k]) {
+          if (Ptr <= Pmin) {
+            // two rarefactions: the TRRS guess is the exact solution
+            Pstar[k] = Ptr;
+            active[k] = 0;
+          } else if (Ppv < Pmin) {
+            Pstar[k] = std::max(Pfloor[k], Ptr);
+          } else {
+            Pstar[k] = std::max(Pfloor[k], Pts);
+          }
+        }
+        number_active += active[k];
+      }
+    }
+
+    // Newton-Raphson iterations for all lanes that are still active
+    uint_fast32_t number_of_iterations = 0;
+    while (number_active > 0 &&
+           number_of_iterations < RIEMANNSOLVER_MAXIMUM_NUMBER_OF_ITERATIONS) {
+      number_active = 0;
+#pragma omp simd reduction(+ : number_active)
+      for (uint_fast32_t k = 0; k < RIEMANNSOLVER_LANE_SIZE; ++k) {
+        double fL, fprimeL, fR, fprimeR;
+        fb_fprimeb(rhoLk[k], PLk[k], aLk[k], Pstar[k], fL, fprimeL);
+        fb_fprimeb(rhoRk[k], PRk[k], aRk[k], Pstar[k], fR, fprimeR);
+        const double Pnew = std::max(
+            Pfloor[k],
+            Pstar[k] - (fL + fR + uRk[k] - uLk[k]) / (fprimeL + fprimeR));
+        const bool converged =
+            (std::abs(Pnew - Pstar[k]) <= 5.e-9 * (Pnew + Pstar[k]));
+        if (active[k]) {
+          Pstar[k] = Pnew;
+        }
+        active[k] = (active[k] && !converged);
+        number_active += active[k];
+      }
+      ++number_of_iterations;
+    }
+
+    // sample the solution and compute the fluxes
+    int number_fan = 0;
+#pragma omp simd reduction(+ : number_fan)
+    for (uint_fast32_t k = 0; k < RIEMANNSOLVER_LANE_SIZE; ++k) {
+      scalar[k] |= active[k];
+      const double P = Pstar[k];
+      const double qL = std::pow(P / PLk[k], _gm1d2g);
+      const double qR = std::pow(P / PRk[k], _gm1d2g);
+      const double fL = (P > PLk[k]) ? (P - PLk[k]) * gb(rhoLk[k], PLk[k], P)
+                                     : _tdgm1 * aLk[k] * (qL - 1.);
+      const double fR = (P > PRk[k]) ? (P - PRk[k]) * gb(rhoRk[k], PRk[k], P)
+                                     : _tdgm1 * aRk[k] * (qR - 1.);
+      const double ustar = 0.5 * (uLk[k] + uRk[k]) + 0.5 * (fR - fL);
+
+      // select the wave we sample: the right wave (s = 1) if ustar < 0, the
+      // left wave (s = -1) otherwise
+      const bool right = (ustar < 0.);
+      const double s = right ? 1. : -1.;
+      const double rhoK = right ? rhoRk[k] : rhoLk[k];
+      const double uK = right ? uRk[k] : uLk[k];
+      const double PK = right ? PRk[k] : PLk[k];
+      const double aK = right ? aRk[k] : aLk[k];
+      const double PdPK = P / PK;
+      const double q = right ? qR : qL;
+
+      // shock wave: speed and middle state density
+      const double S = uK + s * aK * std::sqrt(_gp1d2g * PdPK + _gm1d2g);
+      const double rhoshock =
+          rhoK * (PdPK + _gm1dgp1) / (_gm1dgp1 * PdPK + 1.);
+      // rarefaction wave: head and tail speed and middle state density
+      const double SH = uK + s * aK;
+      const double ST = ustar + s * aK * q;
+      const double rhorarefaction = (q > 0.) ? rhoK * PdPK / (q * q) : 0.;
+
+      // the rarefaction fan is sampled below, we provisionally sample the
+      // outer state
+      double rhosol = rhoK;
+      double usol = uK;
+      double Psol = PK;
+      wave[k] = s;
+      fan[k] = 0;
+      if (P > PK) {
+        if (s * S > 0.) {
+          rhosol = rhoshock;
+          usol = ustar;
+          Psol = P;
+        }
+      } else {
+        if (s * SH > 0.) {
+          if (s * ST > 0.) {
+            rhosol = rhorarefaction;
+            usol = ustar;
+            Psol = P;
+          } else {
+            fan[k] = 1;
+          }
+        }
+      }
+      number_fan += fan[k];
+
+      get_flux(rhosol, usol, Psol, mfluxk[k], pfluxk[k], Efluxk[k]);
+    }
+
+    // sample the rarefaction fans (this requires a power, so we skip this if
+    // no interface in the lane needs it)
+    if (number_fan > 0) {
+#pragma omp simd
+      for (uint_fast32_t k = 0; k < RIEMANNSOLVER_LANE_SIZE; ++k) {
+        const double s = wave[k];
+        const bool right = (s > 0.);
+        const double rhoK = right ? rhoRk[k] : rhoLk[k];
+        const double uK = right ? uRk[k] : uLk[k];
+        const double PK = right ? PRk[k] : PLk[k];
+        const double aK = right ? aRk[k] : aLk[k];
+        const double base = std::max(0., _tdgp1 - s * _gm1dgp1 * uK / aK);
+        const double basepow = fan_power<_fan_exponent_>(base);
+        double mfan, pfan, Efan;
+        get_flux(rhoK * basepow, _tdgp1 * (-s * aK + _gm1d2 * uK),
+                 PK * basepow * base * base, mfan, pfan, Efan);
+        mfluxk[k] = fan[k] ? mfan : mfluxk[k];
+        pfluxk[k] = fan[k] ? pfan : pfluxk[k];
+        Efluxk[k] = fan[k] ? Efan : Efluxk[k];
+      }
+    }
+
+    for (uint_fast32_t k = 0; k < nlane; ++k) {
+      if (scalar[k]) {
+        solve_for_flux(rhoL[k], uL[k], PL[k], rhoR[k], uR[k], PR[k], mflux[k],
+                       pflux[k], Eflux[k]);
+      } else {
+        mflux[k] = mfluxk[k];
+        pflux[k] = pfluxk[k];
+        Eflux[k] = Efluxk[k];
+      }
+    }
+  }
+
 public:
   /**
    * @brief Constructor.
@@ -853,6 +1233,14 @@ public:
     _tgdgm1 =
         2. * _gamma / (_gamma - 1.); // two times gamma divided by gamma minus 1
     _ginv = 1. / _gamma;             // gamma inverse
+
+    // integer rarefaction fan exponents are handled using multiplications
+    _tdgm1_integer = 0;
+    if (std::abs(_tdgm1 - 3.) < 1.e-10) {
+      _tdgm1_integer = 3;
+    } else if (std::abs(_tdgm1 - 5.) < 1.e-10) {
+      _tdgm1_integer = 5;
+    }
   }
 
   /**
@@ -990,6 +1378,53 @@ public:
 
     return solver_output;
   }
+
+  /**
+   * @brief Solve the Riemann problems for a batch of interfaces directly for
+   * the fluxes.
+   *
+   * The interfaces are solved in lanes of RIEMANNSOLVER_LANE_SIZE interfaces,
+   * see solve_for_flux_lane(). The lane solver is specialised for adiabatic
+   * indices for which the rarefaction fan exponent @f$\frac{2}{\gamma-1}@f$
+   * is a small integer (e.g. @f$\gamma{}=5/3@f$).
+   *
+   * @param n Number of interfaces in the batch.
+   * @param rhoL Left state densities.
+   * @param uL Left state velocities.
+   * @param PL Left state pressures.
+   * @param rhoR Right state densities.
+   * @param uR Right state velocities.
+   * @param PR Right state pressures.
+   * @param mflux Mass flux solutions.
+   * @param pflux Momentum flux solutions.
+   * @param Eflux Energy flux solutions.
+   */
+  inline void solve_for_flux_batch(const uint_fast32_t n, const double *rhoL,
+                                   const double *uL, const double *PL,
+                                   const double *rhoR, const double *uR,
+                                   const double *PR, double *mflux,
+                                   double *pflux, double *Eflux) {
+    for (uint_fast32_t i = 0; i < n; i += RIEMANNSOLVER_LANE_SIZE) {
+      const uint_fast32_t nlane =
+          std::min<uint_fast32_t>(RIEMANNSOLVER_LANE_SIZE, n - i);
+      switch (_tdgm1_integer) {
+      case 3:
+        solve_for_flux_lane<3>(nlane, rhoL + i, uL + i, PL + i, rhoR + i,
+                               uR + i, PR + i, mflux + i, pflux + i,
+                               Eflux + i);
+        break;
+      case 5:
+        solve_for_flux_lane<5>(nlane, rhoL + i, uL + i, PL + i, rhoR + i,
+                               uR + i, PR + i, mflux + i, pflux + i,
+                               Eflux + i);
+        break;
+      default:
+        solve_for_flux_lane<0>(nlane, rhoL + i, uL + i, PL + i, rhoR + i,
+                               uR + i, PR + i, mflux + i, pflux + i,
+                               Eflux + i);
+      }
+    }
+  }
 };
 
 #endif // RIEMANNSOLVER_HPP
@@ -0,0 +1,788 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file RuntimeParameters.hpp
+ *
+ * @brief Parameters that can be set at run time, using a parameter file.
+ *
+ * The default value of every run time parameter is set by the configuration
+ * (the DEFAULT_ macros in Parameters.hpp). A parameter file can overwrite these
+ * values when the program starts. The parameter file contains one parameter per
+ * line, in the format
+ *   name: value
+ * where the name is the (lower case) name of the corresponding CMake
+ * configuration option, and the value of a physics choice is the name of the
+ * option, e.g.
+ *   riemannsolver_type: RIEMANNSOLVER_TYPE_EXACT
+ * Everything after a '#' is a comment, empty lines are ignored. Parameters that
+ * are not in the file keep their default value.
+ *
+ * The parameters are accessed through the same macros that were used when they
+ * were still compile time constants (e.g. GAMMA), so that all other code can
+ * remain unchanged.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef RUNTIMEPARAMETERS_HPP
+#define RUNTIMEPARAMETERS_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/*! @brief Names of the Riemann solver types, used for input and output. */
+static const char *riemannsolver_type_names[2] = {"RIEMANNSOLVER_TYPE_EXACT",
+                                                  "RIEMANNSOLVER_TYPE_HLLC"};
+
+/*! @brief Values of the Riemann solver types. */
+static const int riemannsolver_type_values[2] = {RIEMANNSOLVER_TYPE_EXACT,
+                                                 RIEMANNSOLVER_TYPE_HLLC};
+
+/*! @brief Names of the dimensionality types, used for input and output. */
+static const char *dimensionality_names[2] = {"DIMENSIONALITY_1D",
+                                              "DIMENSIONALITY_3D"};
+
+/*! @brief Values of the dimensionality types. */
+static const int dimensionality_values[2] = {DIMENSIONALITY_1D,
+                                             DIMENSIONALITY_3D};
+
+/*! @brief Names of the grid types, used for input and output. */
+static const char *grid_type_names[3] = {
+    "GRID_TYPE_UNIFORM", "GRID_TYPE_LOGARITHMIC", "GRID_TYPE_FILE"};
+
+/*! @brief Values of the grid types. */
+static const int grid_type_values[3] = {
+    GRID_TYPE_UNIFORM, GRID_TYPE_LOGARITHMIC, GRID_TYPE_FILE};
+
+/*! @brief Names of the Monte Carlo estimators, used for input and output. */
+static const char *mc_estimator_names[2] = {"MC_ESTIMATOR_ANALOG",
+                                            "MC_ESTIMATOR_PATH_LENGTH"};
+
+/*! @brief Values of the Monte Carlo estimators. */
+static const int mc_estimator_values[2] = {MC_ESTIMATOR_ANALOG,
+                                           MC_ESTIMATOR_PATH_LENGTH};
+
+/*! @brief Names of the Monte Carlo ionisation balance solvers, used for input
+ *  and output. */
+static const char *mc_ionisation_solver_names[2] = {
+    "MC_IONISATION_SOLVER_EXACT", "MC_IONISATION_SOLVER_IMPLICIT"};
+
+/*! @brief Values of the Monte Carlo ionisation balance solvers. */
+static const int mc_ionisation_solver_values[2] = {
+    MC_IONISATION_SOLVER_EXACT, MC_IONISATION_SOLVER_IMPLICIT};
+
+/*! @brief Names of the thread pinning types, used for input and output. */
+static const char *thread_pinning_names[3] = {
+    "THREAD_PINNING_NONE", "THREAD_PINNING_COMPACT", "THREAD_PINNING_SPREAD"};
+
+/*! @brief Values of the thread pinning types. */
+static const int thread_pinning_values[3] = {
+    THREAD_PINNING_NONE, THREAD_PINNING_COMPACT, THREAD_PINNING_SPREAD};
+
+/*! @brief Names of the memory page types, used for input and output. */
+static const char *huge_pages_names[2] = {"HUGE_PAGES_NONE",
+                                          "HUGE_PAGES_TRANSPARENT"};
+
+/*! @brief Values of the memory page types. */
+static const int huge_pages_values[2] = {HUGE_PAGES_NONE,
+                                         HUGE_PAGES_TRANSPARENT};
+
+/**
+ * @brief Parameters that can be set at run time.
+ */
+class RuntimeParameters {
+private:
+  /**
+   * @brief Remove leading and trailing white space from the given string.
+   *
+   * @param value String.
+   * @return String without leading and trailing white space.
+   */
+  inline static std::string strip(const std::string value) {
+    const size_t first = value.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+      return "";
+    }
+    const size_t last = value.find_last_not_of(" \t\r");
+    return value.substr(first, last - first + 1);
+  }
+
+  /**
+   * @brief Abort with an error message about an invalid parameter value.
+   *
+   * @param name Name of the parameter.
+   * @param value Invalid value.
+   */
+  inline static void invalid_value(const std::string name,
+                                   const std::string value) {
+    std::cerr << "Invalid value for parameter \"" << name << "\": " << value
+              << "!" << std::endl;
+    abort();
+  }
+
+  /**
+   * @brief Convert the given string to a value of the given type.
+   *
+   * @param name Name of the parameter (used for error messages).
+   * @param value String representation of the value.
+   * @param result Variable to store the value in.
+   */
+  template <typename _type_>
+  inline static void read_value(const std::string name, const std::string value,
+                                _type_ &result) {
+    std::istringstream stream(value);
+    stream >> result;
+    if (stream.fail() || !(stream >> std::ws).eof()) {
+      invalid_value(name, value);
+    }
+  }
+
+  /**
+   * @brief Convert the given option name to its option value.
+   *
+   * @param name Name of the parameter (used for error messages).
+   * @param value Option name.
+   * @param option_names Valid option names.
+   * @param option_values Corresponding option values.
+   * @param number_of_options Number of valid options.
+   * @return Option value.
+   */
+  inline static int read_option(const std::string name, const std::string value,
+                                const char *const *option_names,
+                                const int *option_values,
+                                const int number_of_options) {
+    for (int i = 0; i < number_of_options; ++i) {
+      if (value == option_names[i]) {
+        return option_values[i];
+      }
+    }
+    invalid_value(name, value);
+    return 0;
+  }
+
+  /**
+   * @brief Get the name of the given option value.
+   *
+   * @param value Option value.
+   * @param option_names Valid option names.
+   * @param option_values Corresponding option values.
+   * @param number_of_options Number of valid options.
+   * @return Option name.
+   */
+  inline static const char *get_option_name(const int value,
+                                            const char *const *option_names,
+                                            const int *option_values,
+                                            const int number_of_options) {
+    for (int i = 0; i < number_of_options; ++i) {
+      if (value == option_values[i]) {
+        return option_names[i];
+      }
+    }
+    return "unknown";
+  }
+
+public:
+  /*! @brief Minimum radius (in AU). */
+  double _rmin_in_au;
+
+  /*! @brief Maximum radius (in AU). */
+  double _rmax_in_au;
+
+  /*! @brief Number of spherical shells (1D "cells") in between RMIN and
+   *  RMAX. */
+  unsigned int _ncell;
+
+  /*! @brief Polytropic index. */
+  double _gamma;
+
+  /*! @brief Maximum simulation time (in years). */
+  double _maxtime_in_yr;
+
+  /*! @brief Number of snapshots to write during the simulation. */
+  unsigned int _number_of_snaps;
+
+  /*! @brief Maximum number of time steps to perform, 0 means no limit. */
+  uint_fast64_t _max_number_of_steps;
+
+  /*! @brief Width of the ionisation transition region (in AU). */
+  double _ionisation_transition_width_in_au;
+
+  /*! @brief Constant temperature in the neutral region (in K). */
+  double _isothermal_temperature_in_k;
+
+  /*! @brief Value for Newton's gravity constant (in internal units of L^3 M^-1
+   *  T^-2). */
+  double _g_internal;
+
+  /*! @brief Mass of the point mass (in solar masses). */
+  double _mass_point_mass_in_msol;
+
+  /*! @brief Central density of the Bondi set up (in kg m^-3). */
+  double _bondi_density_in_si;
+
+  /*! @brief Pressure contrast between ionised and neutral region. */
+  double _bondi_pressure_contrast;
+
+  /*! @brief Name of the initial condition file. */
+  std::string _ic_file_name;
+
+  /*! @brief Initial ionisation radius (in AU). */
+  double _initial_ionisation_radius_in_au;
+
+  /*! @brief Mass unit (in kg). */
+  double _unit_mass_in_si;
+
+  /*! @brief Length unit (in m). */
+  double _unit_length_in_si;
+
+  /*! @brief Courant factor for the time step criterion. */
+  double _courant_factor;
+
+  /*! @brief Type of Riemann solver to use. */
+  int _riemannsolver_type;
+
+  /*! @brief Dimensionality. */
+  int _dimensionality;
+
+  /*! @brief Hydro scheme order. */
+  int _hydro_order;
+
+  /*! @brief Type of radial grid. */
+  int _grid_type;
+
+  /*! @brief Name of the file containing the cell face positions. */
+  std::string _grid_file_name;
+
+  /*! @brief Number of time steps in between two grid refinement updates. */
+  unsigned int _refinement_interval;
+
+  /*! @brief Maximum grid refinement level. */
+  unsigned int _refinement_maximum_level;
+
+  /*! @brief Relative density change across a cell above which the cell is
+   *  refined. */
+  double _refinement_density_jump;
+
+  /*! @brief Maximum relative error in the density and pressure in compressed
+   *  snapshots. */
+  double _snapshot_compression_tolerance;
+
+  /*! @brief Relative change in a cell variable that triggers a new log file
+   *  entry. */
+  double _logfile_tolerance;
+
+  /*! @brief Number of photon packets emitted by the source during every time
+   *  step. */
+  unsigned int _mc_number_of_photons;
+
+  /*! @brief Seed for the Monte Carlo random number streams. */
+  uint_fast64_t _mc_random_seed;
+
+  /*! @brief Number of ionising photons emitted by the source per unit time (in
+   *  s^-1). */
+  double _mc_ionising_luminosity_in_si;
+
+  /*! @brief Monte Carlo path length estimator. */
+  int _mc_estimator;
+
+  /*! @brief Target relative error in the mean intensity in the cells at the
+   *  ionisation front (0 means the number of photons is fixed). */
+  double _mc_target_relative_error;
+
+  /*! @brief Maximum number of photon packets emitted by the source during
+   *  every time step if the number of photons is adapted. */
+  unsigned int _mc_maximum_number_of_photons;
+
+  /*! @brief Solver for the ionisation balance of the cells. */
+  int _mc_ionisation_solver;
+
+  /*! @brief Wall clock time in between two checkpoints (in s, 0 means no
+   *  checkpoints are written). */
+  double _checkpoint_interval_in_s;
+
+  /*! @brief Number of steps in between two in-situ analysis computations (0
+   *  means no analysis is done). */
+  unsigned int _analysis_interval;
+
+  /*! @brief Comma separated list of global quantities computed by the in-situ
+   *  analysis. */
+  std::string _analysis_quantities;
+
+  /*! @brief Comma separated list of radii at which the in-situ analysis probes
+   *  the density (in AU). */
+  std::string _analysis_probe_radii_in_au;
+
+  /*! @brief Relative change in any of the analysis values that triggers a new
+   *  analysis record. */
+  double _analysis_tolerance;
+
+  /*! @brief Pinning of the threads of a single simulation to CPUs. */
+  int _thread_pinning;
+
+  /*! @brief Type of memory pages for the memory arena of a simulation. */
+  int _huge_pages;
+
+  /**
+   * @brief Constructor.
+   *
+   * Sets all parameters to their default values.
+   */
+  inline RuntimeParameters()
+      : _rmin_in_au(DEFAULT_RMIN_IN_AU), _rmax_in_au(DEFAULT_RMAX_IN_AU),
+        _ncell(DEFAULT_NCELL), _gamma(DEFAULT_GAMMA),
+        _maxtime_in_yr(DEFAULT_MAXTIME_IN_YR),
+        _number_of_snaps(DEFAULT_NUMBER_OF_SNAPS),
+        _max_number_of_steps(DEFAULT_MAX_NUMBER_OF_STEPS),
+        _ionisation_transition_width_in_au(
+            DEFAULT_IONISATION_TRANSITION_WIDTH_IN_AU),
+        _isothermal_temperature_in_k(DEFAULT_ISOTHERMAL_TEMPERATURE_IN_K),
+        _g_internal(DEFAULT_G_INTERNAL),
+        _mass_point_mass_in_msol(DEFAULT_MASS_POINT_MASS_IN_MSOL),
+        _bondi_density_in_si(DEFAULT_BONDI_DENSITY_IN_SI),
+        _bondi_pressure_contrast(DEFAULT_BONDI_PRESSURE_CONTRAST),
+        _ic_file_name(DEFAULT_IC_FILE_NAME),
+        _initial_ionisation_radius_in_au(
+            DEFAULT_INITIAL_IONISATION_RADIUS_IN_AU),
+        _unit_mass_in_si(DEFAULT_UNIT_MASS_IN_SI),
+        _unit_length_in_si(DEFAULT_UNIT_LENGTH_IN_SI),
+        _courant_factor(DEFAULT_COURANT_FACTOR),
+        _riemannsolver_type(DEFAULT_RIEMANNSOLVER_TYPE),
+        _dimensionality(DEFAULT_DIMENSIONALITY),
+        _hydro_order(DEFAULT_HYDRO_ORDER), _grid_type(DEFAULT_GRID_TYPE),
+        _grid_file_name(DEFAULT_GRID_FILE_NAME),
+        _refinement_interval(DEFAULT_REFINEMENT_INTERVAL),
+        _refinement_maximum_level(DEFAULT_REFINEMENT_MAXIMUM_LEVEL),
+        _refinement_density_jump(DEFAULT_REFINEMENT_DENSITY_JUMP),
+        _snapshot_compression_tolerance(
+            DEFAULT_SNAPSHOT_COMPRESSION_TOLERANCE),
+        _logfile_tolerance(DEFAULT_LOGFILE_TOLERANCE),
+        _mc_number_of_photons(DEFAULT_MC_NUMBER_OF_PHOTONS),
+        _mc_random_seed(DEFAULT_MC_RANDOM_SEED),
+        _mc_ionising_luminosity_in_si(DEFAULT_MC_IONISING_LUMINOSITY_IN_SI),
+        _mc_estimator(DEFAULT_MC_ESTIMATOR),
+        _mc_target_relative_error(DEFAULT_MC_TARGET_RELATIVE_ERROR),
+        _mc_maximum_number_of_photons(DEFAULT_MC_MAXIMUM_NUMBER_OF_PHOTONS),
+        _mc_ionisation_solver(DEFAULT_MC_IONISATION_SOLVER),
+        _checkpoint_interval_in_s(DEFAULT_CHECKPOINT_INTERVAL_IN_S),
+        _analysis_interval(DEFAULT_ANALYSIS_INTERVAL),
+        _analysis_quantities(DEFAULT_ANALYSIS_QUANTITIES),
+        _analysis_probe_radii_in_au(DEFAULT_ANALYSIS_PROBE_RADII_IN_AU),
+        _analysis_tolerance(DEFAULT_ANALYSIS_TOLERANCE),
+        _thread_pinning(DEFAULT_THREAD_PINNING),
+        _huge_pages(DEFAULT_HUGE_PAGES) {}
+
+  /**
+   * @brief Set the parameter with the given name to the given value.
+   *
+   * Unknown parameter names and invalid values abort the program.
+   *
+   * @param name Name of the parameter.
+   * @param value String representation of the value.
+   */
+  inline void set_parameter(const std::string name, const std::string value) {
+    if (name == "rmin_in_au") {
+      read_value(name, value, _rmin_in_au);
+    } else if (name == "rmax_in_au") {
+      read_value(name, value, _rmax_in_au);
+    } else if (name == "ncell") {
+      read_value(name, value, _ncell);
+    } else if (name == "gamma") {
+      read_value(name, value, _gamma);
+    } else if (name == "maxtime_in_yr") {
+      read_value(name, value, _maxtime_in_yr);
+    } else if (name == "number_of_snaps") {
+      read_value(name, value, _number_of_snaps);
+    } else if (name == "max_number_of_steps") {
+      read_value(name, value, _max_number_of_steps);
+    } else if (name == "ionisation_transition_width_in_au") {
+      read_value(name, value, _ionisation_transition_width_in_au);
+    } else if (name == "isothermal_temperature_in_k") {
+      read_value(name, value, _isothermal_temperature_in_k);
+    } else if (name == "g_internal") {
+      read_value(name, value, _g_internal);
+    } else if (name == "mass_point_mass_in_msol") {
+      read_value(name, value, _mass_point_mass_in_msol);
+    } else if (name == "bondi_density_in_si") {
+      read_value(name, value, _bondi_density_in_si);
+    } else if (name == "bondi_pressure_contrast") {
+      read_value(name, value, _bondi_pressure_contrast);
+    } else if (name == "ic_file_name") {
+      _ic_file_name = value;
+    } else if (name == "initial_ionisation_radius_in_au") {
+      read_value(name, value, _initial_ionisation_radius_in_au);
+    } else if (name == "unit_mass_in_si") {
+      read_value(name, value, _unit_mass_in_si);
+    } else if (name == "unit_length_in_si") {
+      read_value(name, value, _unit_length_in_si);
+    } else if (name == "courant_factor") {
+      read_value(name, value, _courant_factor);
+    } else if (name == "riemannsolver_type") {
+      _riemannsolver_type = read_option(name, value, riemannsolver_type_names,
+                                        riemannsolver_type_values, 2);
+    } else if (name == "dimensionality") {
+      _dimensionality = read_option(name, value, dimensionality_names,
+                                    dimensionality_values, 2);
+    } else if (name == "hydro_order") {
+      read_value(name, value, _hydro_order);
+      if (_hydro_order != 1 && _hydro_order != 2) {
+        invalid_value(name, value);
+      }
+    } else if (name == "grid_type") {
+      _grid_type =
+          read_option(name, value, grid_type_names, grid_type_values, 3);
+    } else if (name == "grid_file_name") {
+      _grid_file_name = value;
+    } else if (name == "refinement_interval") {
+      read_value(name, value, _refinement_interval);
+      if (_refinement_interval == 0) {
+        invalid_value(name, value);
+      }
+    } else if (name == "refinement_maximum_level") {
+      read_value(name, value, _refinement_maximum_level);
+      if (_refinement_maximum_level > 20) {
+        invalid_value(name, value);
+      }
+    } else if (name == "refinement_density_jump") {
+      read_value(name, value, _refinement_density_jump);
+    } else if (name == "snapshot_compression_tolerance") {
+      read_value(name, value, _snapshot_compression_tolerance);
+      if (_snapshot_compression_tolerance < 0.) {
+        invalid_value(name, value);
+      }
+    } else if (name == "logfile_tolerance") {
+      read_value(name, value, _logfile_tolerance);
+    } else if (name == "mc_number_of_photons") {
+      read_value(name, value, _mc_number_of_photons);
+    } else if (name == "mc_random_seed") {
+      read_value(name, value, _mc_random_seed);
+    } else if (name == "mc_ionising_luminosity_in_si") {
+      read_value(name, value, _mc_ionising_luminosity_in_si);
+    } else if (name == "mc_estimator") {
+      _mc_estimator = read_option(name, value, mc_estimator_names,
+                                  mc_estimator_values, 2);
+    } else if (name == "mc_target_relative_error") {
+      read_value(name, value, _mc_target_relative_error);
+      if (_mc_target_relative_error < 0.) {
+        invalid_value(name, value);
+      }
+    } else if (name == "mc_maximum_number_of_photons") {
+      read_value(name, value, _mc_maximum_number_of_photons);
+    } else if (name == "mc_ionisation_solver") {
+      _mc_ionisation_solver =
+          read_option(name, value, mc_ionisation_solver_names,
+                      mc_ionisation_solver_values, 2);
+    } else if (name == "checkpoint_interval_in_s") {
+      read_value(name, value, _checkpoint_interval_in_s);
+    } else if (name == "analysis_interval") {
+      read_value(name, value, _analysis_interval);
+    } else if (name == "analysis_quantities") {
+      _analysis_quantities = value;
+    } else if (name == "analysis_probe_radii_in_au") {
+      _analysis_probe_radii_in_au = value;
+    } else if (name == "analysis_tolerance") {
+      read_value(name, value, _analysis_tolerance);
+      if (_analysis_tolerance < 0.) {
+        invalid_value(name, value);
+      }
+    } else if (name == "thread_pinning") {
+      _thread_pinning = read_option(name, value, thread_pinning_names,
+                                    thread_pinning_values, 3);
+    } else if (name == "huge_pages") {
+      _huge_pages =
+          read_option(name, value, huge_pages_names, huge_pages_values, 2);
+    } else {
+      std::cerr << "Unknown parameter: \"" << name
+                << "\" (note that options that select a physics module can "
+                   "only be set when configuring the code)!"
+                << std::endl;
+      abort();
+    }
+  }
+
+  /**
+   * @brief Read the parameter file with the given name.
+   *
+   * @param filename Name of the parameter file.
+   */
+  inline void read_parameter_file(const std::string filename) {
+    std::ifstream ifile(filename);
+    if (!ifile) {
+      std::cerr << "Could not open parameter file \"" << filename << "\"!"
+                << std::endl;
+      abort();
+    }
+    std::string line;
+    while (std::getline(ifile, line)) {
+      // strip comments
+      const size_t comment = line.find('#');
+      if (comment != std::string::npos) {
+        line = line.substr(0, comment);
+      }
+      line = strip(line);
+      if (line.empty()) {
+        continue;
+      }
+      const size_t colon = line.find(':');
+      if (colon == std::string::npos) {
+        std::cerr << "Invalid line in parameter file \"" << filename
+                  << "\": " << line << "!" << std::endl;
+        abort();
+      }
+      set_parameter(strip(line.substr(0, colon)),
+                    strip(line.substr(colon + 1)));
+    }
+  }
+
+  /**
+   * @brief Print the parameters in the parameter file format.
+   *
+   * @param stream std::ostream to write to.
+   */
+  inline void print_parameters(std::ostream &stream) const {
+    const std::streamsize precision = stream.precision();
+    stream.precision(17);
+    stream << "rmin_in_au: " << _rmin_in_au << "\n";
+    stream << "rmax_in_au: " << _rmax_in_au << "\n";
+    stream << "ncell: " << _ncell << "\n";
+    stream << "gamma: " << _gamma << "\n";
+    stream << "maxtime_in_yr: " << _maxtime_in_yr << "\n";
+    stream << "number_of_snaps: " << _number_of_snaps << "\n";
+    stream << "max_number_of_steps: " << _max_number_of_steps << "\n";
+    stream << "ionisation_transition_width_in_au: "
+           << _ionisation_transition_width_in_au << "\n";
+    stream << "isothermal_temperature_in_k: " << _isothermal_temperature_in_k
+           << "\n";
+    stream << "g_internal: " << _g_internal << "\n";
+    stream << "mass_point_mass_in_msol: " << _mass_point_mass_in_msol << "\n";
+    stream << "bondi_density_in_si: " << _bondi_density_in_si << "\n";
+    stream << "bondi_pressure_contrast: " << _bondi_pressure_contrast << "\n";
+    stream << "ic_file_name: " << _ic_file_name << "\n";
+    stream << "initial_ionisation_radius_in_au: "
+           << _initial_ionisation_radius_in_au << "\n";
+    stream << "unit_mass_in_si: " << _unit_mass_in_si << "\n";
+    stream << "unit_length_in_si: " << _unit_length_in_si << "\n";
+    stream << "courant_factor: " << _courant_factor << "\n";
+    stream << "riemannsolver_type: "
+           << get_option_name(_riemannsolver_type, riemannsolver_type_names,
+                              riemannsolver_type_values, 2)
+           << "\n";
+    stream << "dimensionality: "
+           << get_option_name(_dimensionality, dimensionality_names,
+                              dimensionality_values, 2)
+           << "\n";
+    stream << "hydro_order: " << _hydro_order << "\n";
+    stream << "grid_type: "
+           << get_option_name(_grid_type, grid_type_names, grid_type_values, 3)
+           << "\n";
+    stream << "grid_file_name: " << _grid_file_name << "\n";
+    stream << "refinement_interval: " << _refinement_interval << "\n";
+    stream << "refinement_maximum_level: " << _refinement_maximum_level
+           << "\n";
+    stream << "refinement_density_jump: " << _refinement_density_jump << "\n";
+    stream << "snapshot_compression_tolerance: "
+           << _snapshot_compression_tolerance << "\n";
+    stream << "logfile_tolerance: " << _logfile_tolerance << "\n";
+    stream << "mc_number_of_photons: " << _mc_number_of_photons << "\n";
+    stream << "mc_random_seed: " << _mc_random_seed << "\n";
+    stream << "mc_ionising_luminosity_in_si: " << _mc_ionising_luminosity_in_si
+           << "\n";
+    stream << "mc_estimator: "
+           << get_option_name(_mc_estimator, mc_estimator_names,
+                              mc_estimator_values, 2)
+           << "\n";
+    stream << "mc_target_relative_error: " << _mc_target_relative_error
+           << "\n";
+    stream << "mc_maximum_number_of_photons: " << _mc_maximum_number_of_photons
+           << "\n";
+    stream << "mc_ionisation_solver: "
+           << get_option_name(_mc_ionisation_solver, mc_ionisation_solver_names,
+                              mc_ionisation_solver_values, 2)
+           << "\n";
+    stream << "checkpoint_interval_in_s: " << _checkpoint_interval_in_s
+           << "\n";
+    stream << "analysis_interval: " << _analysis_interval << "\n";
+    stream << "analysis_quantities: " << _analysis_quantities << "\n";
+    stream << "analysis_probe_radii_in_au: " << _analysis_probe_radii_in_au
+           << "\n";
+    stream << "analysis_tolerance: " << _analysis_tolerance << "\n";
+    stream << "thread_pinning: "
+           << get_option_name(_thread_pinning, thread_pinning_names,
+                              thread_pinning_values, 3)
+           << "\n";
+    stream << "huge_pages: "
+           << get_option_name(_huge_pages, huge_pages_names, huge_pages_values,
+                              2)
+           << std::endl;
+    stream.precision(precision);
+  }
+};
+
+/*! @brief Run time parameters of the program. */
+static RuntimeParameters runtime_parameters;
+
+/*! @brief Minimum radius (in AU). */
+#define RMIN_IN_AU (runtime_parameters._rmin_in_au)
+
+/*! @brief Maximum radius (in AU). */
+#define RMAX_IN_AU (runtime_parameters._rmax_in_au)
+
+/*! @brief Number of spherical shells (1D "cells") in between RMIN and RMAX. */
+#define NCELL (runtime_parameters._ncell)
+
+/*! @brief Polytropic index. */
+#define GAMMA (runtime_parameters._gamma)
+
+/*! @brief Maximum simulation time (in years). */
+#define MAXTIME_IN_YR (runtime_parameters._maxtime_in_yr)
+
+/*! @brief Number of snapshots to write during the simulation. */
+#define NUMBER_OF_SNAPS (runtime_parameters._number_of_snaps)
+
+/*! @brief Maximum number of time steps to perform, 0 means no limit. */
+#define MAX_NUMBER_OF_STEPS (runtime_parameters._max_number_of_steps)
+
+/*! @brief Width of the ionisation transition region (in AU). */
+#define IONISATION_TRANSITION_WIDTH_IN_AU                                      \
+  (runtime_parameters._ionisation_transition_width_in_au)
+
+/*! @brief Constant temperature in the neutral region (in K). */
+#define ISOTHERMAL_TEMPERATURE_IN_K                                            \
+  (runtime_parameters._isothermal_temperature_in_k)
+
+/*! @brief Value for Newton's gravity constant (in internal units of L^3 M^-1
+ *  T^-2). */
+#define G_INTERNAL (runtime_parameters._g_internal)
+
+/*! @brief Mass of the point mass (in solar masses). */
+#define MASS_POINT_MASS_IN_MSOL (runtime_parameters._mass_point_mass_in_msol)
+
+/*! @brief Central density of the Bondi set up (in kg m^-3). */
+#define BONDI_DENSITY_IN_SI (runtime_parameters._bondi_density_in_si)
+
+/*! @brief Pressure contrast between ionised and neutral region. */
+#define BONDI_PRESSURE_CONTRAST (runtime_parameters._bondi_pressure_contrast)
+
+/*! @brief Name of the initial condition file. */
+#define IC_FILE_NAME (runtime_parameters._ic_file_name)
+
+/*! @brief Initial ionisation radius (in AU). */
+#define INITIAL_IONISATION_RADIUS_IN_AU                                        \
+  (runtime_parameters._initial_ionisation_radius_in_au)
+
+/*! @brief Mass unit (in kg). */
+#define UNIT_MASS_IN_SI (runtime_parameters._unit_mass_in_si)
+
+/*! @brief Length unit (in m). */
+#define UNIT_LENGTH_IN_SI (runtime_parameters._unit_length_in_si)
+
+/*! @brief Courant factor for the time step criterion. */
+#define COURANT_FACTOR (runtime_parameters._courant_factor)
+
+/*! @brief Type of Riemann solver to use. */
+#define RIEMANNSOLVER_TYPE (runtime_parameters._riemannsolver_type)
+
+/*! @brief Dimensionality. */
+#define DIMENSIONALITY (runtime_parameters._dimensionality)
+
+/*! @brief Hydro scheme order. */
+#define HYDRO_ORDER (runtime_parameters._hydro_order)
+
+/*! @brief Type of radial grid. */
+#define GRID_TYPE (runtime_parameters._grid_type)
+
+/*! @brief Name of the file containing the cell face positions. */
+#define GRID_FILE_NAME (runtime_parameters._grid_file_name)
+
+/*! @brief Number of time steps in between two grid refinement updates. */
+#define REFINEMENT_INTERVAL (runtime_parameters._refinement_interval)
+
+/*! @brief Maximum grid refinement level. */
+#define REFINEMENT_MAXIMUM_LEVEL (runtime_parameters._refinement_maximum_level)
+
+/*! @brief Relative density change across a cell above which the cell is
+ *  refined. */
+#define REFINEMENT_DENSITY_JUMP (runtime_parameters._refinement_density_jump)
+
+/*! @brief Maximum relative error in the density and pressure in compressed
+ *  snapshots (if SNAPSHOT_COMPRESSION_LOSSY is selected). */
+#define SNAPSHOT_COMPRESSION_TOLERANCE                                         \
+  (runtime_parameters._snapshot_compression_tolerance)
+
+/*! @brief Relative change in a cell variable that triggers a new log file
+ *  entry. */
+#define LOGFILE_TOLERANCE (runtime_parameters._logfile_tolerance)
+
+/*! @brief Number of photon packets emitted by the source during every time
+ *  step. */
+#define MC_NUMBER_OF_PHOTONS (runtime_parameters._mc_number_of_photons)
+
+/*! @brief Seed for the Monte Carlo random number streams. */
+#define MC_RANDOM_SEED (runtime_parameters._mc_random_seed)
+
+/*! @brief Number of ionising photons emitted by the source per unit time (in
+ *  s^-1). */
+#define MC_IONISING_LUMINOSITY_IN_SI                                           \
+  (runtime_parameters._mc_ionising_luminosity_in_si)
+
+/*! @brief Monte Carlo path length estimator. */
+#define MC_ESTIMATOR (runtime_parameters._mc_estimator)
+
+/*! @brief Target relative error in the mean intensity in the cells at the
+ *  ionisation front (0 means the number of photons is fixed). */
+#define MC_TARGET_RELATIVE_ERROR (runtime_parameters._mc_target_relative_error)
+
+/*! @brief Maximum number of photon packets emitted by the source during every
+ *  time step if the number of photons is adapted. */
+#define MC_MAXIMUM_NUMBER_OF_PHOTONS                                           \
+  (runtime_parameters._mc_maximum_number_of_photons)
+
+/*! @brief Solver for the ionisation balance of the cells. */
+#define MC_IONISATION_SOLVER (runtime_parameters._mc_ionisation_solver)
+
+/*! @brief Wall clock time in between two checkpoints (in s, 0 means no
+ *  checkpoints are written). */
+#define CHECKPOINT_INTERVAL_IN_S (runtime_parameters._checkpoint_interval_in_s)
+
+/*! @brief Number of steps in between two in-situ analysis computations (0 means
+ *  no analysis is done). */
+#define ANALYSIS_INTERVAL (runtime_parameters._analysis_interval)
+
+/*! @brief Comma separated list of global quantities computed by the in-situ
+ *  analysis. */
+#define ANALYSIS_QUANTITIES (runtime_parameters._analysis_quantities)
+
+/*! @brief Comma separated list of radii at which the in-situ analysis probes
+ *  the density (in AU). */
+#define ANALYSIS_PROBE_RADII_IN_AU                                             \
+  (runtime_parameters._analysis_probe_radii_in_au)
+
+/*! @brief Relative change in any of the analysis values that triggers a new
+ *  analysis record. */
+#define ANALYSIS_TOLERANCE (runtime_parameters._analysis_tolerance)
+
+/*! @brief Pinning of the threads of a single simulation to CPUs. */
+#define THREAD_PINNING (runtime_parameters._thread_pinning)
+
+/*! @brief Type of memory pages for the memory arena of a simulation. */
+#define HUGE_PAGES (runtime_parameters._huge_pages)
+
+#endif // RUNTIMEPARAMETERS_HPP
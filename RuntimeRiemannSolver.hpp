@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file RuntimeRiemannSolver.hpp
+ *
+ * @brief Riemann solver that is selected at run time.
+ *
+ * Both Riemann solvers are compiled into the program, and the solver type
+ * (RIEMANNSOLVER_TYPE) selects which one is used. The selection is done once
+ * per call, outside the loops over the interfaces, so that the batched solvers
+ * keep their vectorised inner loops.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef RUNTIMERIEMANNSOLVER_HPP
+#define RUNTIMERIEMANNSOLVER_HPP
+
+#include "HLLCRiemannSolver.hpp" // fast HLLC Riemann solver
+#include "RiemannSolver.hpp"     // slow exact Riemann solver
+#include "SafeParameters.hpp"    // safe way to include Parameters.hpp
+
+#include <cstdint>
+
+/**
+ * @brief Riemann solver that is selected at run time.
+ */
+class RuntimeRiemannSolver {
+private:
+  /*! @brief Type of Riemann solver to use. */
+  const int _type;
+
+  /*! @brief HLLC Riemann solver. */
+  HLLCRiemannSolver _hllc_solver;
+
+  /*! @brief Exact Riemann solver. */
+  RiemannSolver _exact_solver;
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * @param type Type of Riemann solver to use (RIEMANNSOLVER_TYPE_XXX).
+   * @param gamma Adiabatic index \f$\gamma{}\f$.
+   */
+  inline RuntimeRiemannSolver(const int type, const double gamma)
+      : _type(type), _hllc_solver(gamma), _exact_solver(gamma) {}
+
+  /**
+   * @brief Solve the Riemann problem with the given left and right state
+   * directly for the flux.
+   *
+   * @param rhoL Left state density.
+   * @param uL Left state velocity.
+   * @param PL Left state pressure.
+   * @param rhoR Right state density.
+   * @param uR Right state velocity.
+   * @param PR Right state pressure.
+   * @param mflux Mass flux solution.
+   * @param pflux Momentum flux solution.
+   * @param Eflux Energy flux solution.
+   * @return Flag signaling whether the left state (-1), the right state (1), or
+   * a vacuum state (0) was sampled.
+   */
+  inline int solve_for_flux(double rhoL, double uL, double PL, double rhoR,
+                            double uR, double PR, double &mflux, double &pflux,
+                            double &Eflux) {
+    if (_type == RIEMANNSOLVER_TYPE_HLLC) {
+      return _hllc_solver.solve_for_flux(rhoL, uL, PL, rhoR, uR, PR, mflux,
+                                         pflux, Eflux);
+    } else {
+      return _exact_solver.solve_for_flux(rhoL, uL, PL, rhoR, uR, PR, mflux,
+                                          pflux, Eflux);
+    }
+  }
+
+  /**
+   * @brief Solve the Riemann problems for a batch of interfaces directly for
+   * the flux.
+   *
+   * @param n Number of interfaces in the batch.
+   * @param rhoL Left state densities.
+   * @param uL Left state velocities.
+   * @param PL Left state pressures.
+   * @param rhoR Right state densities.
+   * @param uR Right state velocities.
+   * @param PR Right state pressures.
+   * @param mflux Mass flux solutions.
+   * @param pflux Momentum flux solutions.
+   * @param Eflux Energy flux solutions.
+   */
+  inline void solve_for_flux_batch(const uint_fast32_t n, const double *rhoL,
+                                   const double *uL, const double *PL,
+                                   const double *rhoR, const double *uR,
+                                   const double *PR, double *mflux,
+                                   double *pflux, double *Eflux) {
+    if (_type == RIEMANNSOLVER_TYPE_HLLC) {
+      _hllc_solver.solve_for_flux_batch(n, rhoL, uL, PL, rhoR, uR, PR, mflux,
+                                        pflux, Eflux);
+    } else {
+      _exact_solver.solve_for_flux_batch(n, rhoL, uL, PL, rhoR, uR, PR, mflux,
+                                         pflux, Eflux);
+    }
+  }
+};
+
+#endif // RUNTIMERIEMANNSOLVER_HPP
@@ -21,7 +21,8 @@
  *
  * @brief File that should be included by all files that need parameters.
  * Contains sanity checks on the chosen parameter values. Parameter values
- * should be set in Parameters.hpp.
+ * should be set in Parameters.hpp, or in the parameter file for run time
+ * parameters (see RuntimeParameters.hpp).
  *
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
@@ -107,26 +108,150 @@
 #endif
 
 // check Riemann solver type
-#ifndef RIEMANNSOLVER_TYPE
+#ifndef DEFAULT_RIEMANNSOLVER_TYPE
 #error "No Riemann solver selected!"
 #else
-#if RIEMANNSOLVER_TYPE != RIEMANNSOLVER_TYPE_EXACT &&                          \
-    RIEMANNSOLVER_TYPE != RIEMANNSOLVER_TYPE_HLLC
-#pragma message(value_of_macro(RIEMANNSOLVER_TYPE))
+#if DEFAULT_RIEMANNSOLVER_TYPE != RIEMANNSOLVER_TYPE_EXACT &&                  \
+    DEFAULT_RIEMANNSOLVER_TYPE != RIEMANNSOLVER_TYPE_HLLC
+#pragma message(value_of_macro(DEFAULT_RIEMANNSOLVER_TYPE))
 #error "Invalid Riemann solver selected!"
 #endif
 #endif
 
 // check dimensionality
-#ifndef DIMENSIONALITY
+#ifndef DEFAULT_DIMENSIONALITY
 #error "No dimensionality selected!"
 #else
-#if DIMENSIONALITY != DIMENSIONALITY_1D && DIMENSIONALITY != DIMENSIONALITY_3D
-#pragma message(value_of_macro(DIMENSIONALITY))
+#if DEFAULT_DIMENSIONALITY != DIMENSIONALITY_1D &&                             \
+    DEFAULT_DIMENSIONALITY != DIMENSIONALITY_3D
+#pragma message(value_of_macro(DEFAULT_DIMENSIONALITY))
 #error "Invalid dimensionality selected!"
 #endif
 #endif
 
+// check hydro order
+#ifndef DEFAULT_HYDRO_ORDER
+#error "No hydro order selected!"
+#else
+#if DEFAULT_HYDRO_ORDER != 1 && DEFAULT_HYDRO_ORDER != 2
+#pragma message(value_of_macro(DEFAULT_HYDRO_ORDER))
+#error "Invalid hydro order selected!"
+#endif
+#endif
+
+// check hydro sweep type
+#ifndef HYDRO_SWEEP
+#error "No hydro sweep type selected!"
+#else
+#if HYDRO_SWEEP != HYDRO_SWEEP_PASSES && HYDRO_SWEEP != HYDRO_SWEEP_FUSED
+#pragma message(value_of_macro(HYDRO_SWEEP))
+#error "Invalid hydro sweep type selected!"
+#endif
+#if HYDRO_SWEEP_BLOCK_SIZE < 1
+#error "The hydro sweep block size should be at least 1!"
+#endif
+#endif
+
+// check time stepping type
+#ifndef TIME_STEPPING
+#error "No time stepping type selected!"
+#else
+#if TIME_STEPPING != TIME_STEPPING_FIXED &&                                    \
+    TIME_STEPPING != TIME_STEPPING_INDIVIDUAL &&                               \
+    TIME_STEPPING != TIME_STEPPING_GLOBAL_CFL
+#pragma message(value_of_macro(TIME_STEPPING))
+#error "Invalid time stepping type selected!"
+#endif
+#if TIME_STEPPING == TIME_STEPPING_INDIVIDUAL &&                               \
+    HYDRO_SWEEP != HYDRO_SWEEP_PASSES
+#error "Individual time stepping only works with HYDRO_SWEEP_PASSES!"
+#endif
+#endif
+
+// check refinement type
+#ifndef REFINEMENT
+#error "No refinement type selected!"
+#else
+#if REFINEMENT != REFINEMENT_NONE && REFINEMENT != REFINEMENT_IONISATION_FRONT
+#pragma message(value_of_macro(REFINEMENT))
+#error "Invalid refinement type selected!"
+#endif
+#if REFINEMENT == REFINEMENT_IONISATION_FRONT &&                               \
+    TIME_STEPPING == TIME_STEPPING_INDIVIDUAL
+#error "Grid refinement does not work with individual time stepping!"
+#endif
+#if REFINEMENT == REFINEMENT_IONISATION_FRONT &&                               \
+    IONISATION_MODE == IONISATION_MODE_MONTE_CARLO_TRANSFER
+#error "Grid refinement does not work with Monte Carlo photoionisation!"
+#endif
+#endif
+
+// check snapshot type
+#ifndef SNAPSHOT_TYPE
+#error "No snapshot type selected!"
+#else
+#if SNAPSHOT_TYPE != SNAPSHOT_TYPE_TEXT &&                                     \
+    SNAPSHOT_TYPE != SNAPSHOT_TYPE_BINARY &&                                   \
+    SNAPSHOT_TYPE != SNAPSHOT_TYPE_CONTAINER
+#pragma message(value_of_macro(SNAPSHOT_TYPE))
+#error "Invalid snapshot type selected!"
+#endif
+#if SNAPSHOT_CONTAINER_IONISATION_RADIUS != 0 &&                               \
+    SNAPSHOT_CONTAINER_IONISATION_RADIUS != 1
+#error "The snapshot container ionisation radius flag should be 0 or 1!"
+#endif
+#endif
+
+// check snapshot compression type
+#ifndef SNAPSHOT_COMPRESSION
+#error "No snapshot compression type selected!"
+#else
+#if SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_NONE &&                       \
+    SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_LOSSLESS &&                   \
+    SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_LOSSY
+#pragma message(value_of_macro(SNAPSHOT_COMPRESSION))
+#error "Invalid snapshot compression type selected!"
+#endif
+#if SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_NONE &&                       \
+    SNAPSHOT_TYPE == SNAPSHOT_TYPE_TEXT
+#error "Snapshot compression does not work with text snapshots!"
+#endif
+#endif
+
+// check log file type
+#ifndef LOGFILE
+#error "No log file type selected!"
+#else
+#if LOGFILE != LOGFILE_NONE && LOGFILE != LOGFILE_EVENTS
+#pragma message(value_of_macro(LOGFILE))
+#error "Invalid log file type selected!"
+#endif
+#endif
+
+// check hardware counter type
+#ifndef HARDWARE_COUNTERS
+#error "No hardware counter type selected!"
+#else
+#if HARDWARE_COUNTERS != HARDWARE_COUNTERS_NONE &&                             \
+    HARDWARE_COUNTERS != HARDWARE_COUNTERS_PERF
+#pragma message(value_of_macro(HARDWARE_COUNTERS))
+#error "Invalid hardware counter type selected!"
+#endif
+#endif
+
+// check offload type
+#ifndef OFFLOAD
+#error "No offload type selected!"
+#else
+#if OFFLOAD != OFFLOAD_NONE && OFFLOAD != OFFLOAD_OPENMP_TARGET
+#pragma message(value_of_macro(OFFLOAD))
+#error "Invalid offload type selected!"
+#endif
+#endif
+
+// include the run time parameters
+#include "RuntimeParameters.hpp"
+
 // include derived parameters
 #include "DerivedParameters.hpp"
 
@@ -0,0 +1,1791 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file Simulation.cpp
+ *
+ * @brief Simulation library: implementation of the Simulation class.
+ *
+ * This is the only file of the library that includes the physics modules. The
+ * physics modules are selected when configuring the code, and inject their code
+ * using macros that refer to the variables of the simulation (cells, ncell,
+ * output...) and to the variables they declare themselves. All these variables
+ * are members of SimulationState, so that the macros can be used within its
+ * member functions: the *_variables macros declare the variables of the
+ * physics modules as members, while the *_initialize() macros set them up.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+
+// project includes
+#include "Simulation.hpp"           // Simulation class
+#include "Bondi.hpp"                // for EOS_BONDI, BOUNDARIES_BONDI, IC_BONDI
+#include "Boundaries.hpp"           // for non Bondi boundary conditions
+#include "Cell.hpp"                 // Cell class
+#include "CellLog.hpp"              // cell event log output
+#include "Checkpoint.hpp"           // checkpoint writer and reader
+#include "EOS.hpp"                  // for non Bondi equations of state
+#include "Grid.hpp"                 // radial grid
+#include "Hydro.hpp"                // hydro kernels
+#include "IC.hpp"                   // general initial condition interface
+#include "InSituAnalysis.hpp"       // in-situ analysis time series
+#include "InterfaceStates.hpp"      // interface state storage
+#include "MemoryArena.hpp"          // memory arena for the fixed size arrays
+#include "Potential.hpp"            // external gravity
+#include "Refinement.hpp"           // adaptive grid refinement
+#include "RuntimeRiemannSolver.hpp" // run time selected Riemann solver
+#include "SafeParameters.hpp"       // safe way to include Parameter.hpp
+#include "SnapshotWriter.hpp"       // asynchronous snapshot output
+#include "Spherical.hpp"            // spherical source terms
+#include "PhaseTimers.hpp"          // main loop phase timers
+#include "TimeBins.hpp"             // time step bins for individual time steps
+#include "ThreadPlacement.hpp"      // thread pinning and first touch
+#include "Timer.hpp"                // program timers
+#include "Units.hpp"                // unit information
+
+// standard libraries
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <omp.h>
+#include <sstream>
+#include <vector>
+
+/*! @brief Flag that is set when the simulations are interrupted (e.g. because
+ *  the program received a SIGTERM signal). */
+static volatile std::sig_atomic_t interrupt_received = 0;
+
+/**
+ * @brief Get the current time as a string.
+ *
+ * @return Current system time as a string with format YYYY:MM:DD:HH:MM:SS.
+ */
+static std::string get_timestamp() {
+  const std::time_t timestamp = std::time(nullptr);
+  // we use the reentrant version, since ensemble members call this function
+  // from different threads
+  std::tm time_buffer;
+  const std::tm *time = localtime_r(&timestamp, &time_buffer);
+  std::stringstream timestream;
+  timestream << (time->tm_year + 1900) << ":";
+  if (time->tm_mon < 9) {
+    timestream << "0";
+  }
+  timestream << (time->tm_mon + 1) << ":";
+  if (time->tm_mday < 10) {
+    timestream << "0";
+  }
+  timestream << time->tm_mday << ":";
+  if (time->tm_hour < 10) {
+    timestream << "0";
+  }
+  timestream << time->tm_hour << ":";
+  if (time->tm_min < 10) {
+    timestream << "0";
+  }
+  timestream << time->tm_min << ":";
+  if (time->tm_sec < 10) {
+    timestream << "0";
+  }
+  timestream << time->tm_sec;
+  return timestream.str();
+}
+
+/**
+ * @brief Write a snapshot with the given index.
+ *
+ * The actual writing is done asynchronously by the given SnapshotWriter.
+ *
+ * @param output std::ostream to write messages to.
+ * @param writer SnapshotWriter to use.
+ * @param istep Index of the snapshot file.
+ * @param time Current simulation time (in internal units of T).
+ * @param cells Cells to write.
+ */
+void write_snapshot(std::ostream &output, SnapshotWriter &writer,
+                    uint_fast64_t istep, double time, const Cell *cells) {
+  output << "Writing snapshot " << SnapshotWriter::get_name(istep)
+         << std::endl;
+  writer.write(istep, time, cells);
+}
+
+/**
+ * @brief Round the given integer down to the nearest power of 2.
+ *
+ * @param x Integer.
+ * @return Nearest lower power of 2.
+ */
+static inline uint_fast64_t round_power2_down(uint_fast64_t x) {
+  --x;
+  x |= (x >> 1);
+  x |= (x >> 2);
+  x |= (x >> 4);
+  x |= (x >> 8);
+  x |= (x >> 16);
+  x |= (x >> 32);
+  x >>= 1;
+  ++x;
+  return x;
+}
+
+/**
+ * @brief Convert the given time step to a time step on the integer time line.
+ *
+ * Time steps that are larger than the total simulation time are capped to the
+ * length of the integer time line, as they would otherwise overflow.
+ *
+ * @param dt Time step (in internal units of T).
+ * @param maxtime Total simulation time (in internal units of T).
+ * @param integer_maxtime Length of the integer time line.
+ * @return Integer time step.
+ */
+static inline uint_fast64_t
+get_integer_dt(const double dt, const double maxtime,
+               const uint_fast64_t integer_maxtime) {
+  if (dt >= maxtime) {
+    return integer_maxtime;
+  }
+  return (dt / maxtime) * integer_maxtime;
+}
+
+/**
+ * @brief Set the number of threads used by the OpenMP parallel regions of the
+ * calling thread.
+ *
+ * @param number_of_threads Requested number of threads (can be a nullptr, in
+ * which case the number of threads is not changed).
+ * @param max_number_of_threads Maximum number of threads.
+ */
+static inline void
+set_number_of_threads(const std::atomic_int *number_of_threads,
+                      const int max_number_of_threads) {
+  if (number_of_threads != nullptr) {
+    omp_set_num_threads(
+        std::min<int>(*number_of_threads, max_number_of_threads));
+  }
+}
+
+/**
+ * @brief Get the size of the memory arena of a simulation.
+ *
+ * This is the total size of all arrays that are allocated from the arena: the
+ * cells, the interface states (or the predicted primitive variables and the
+ * per-thread block interface states of the fused hydro sweep), the Monte Carlo
+ * path length arrays and the snapshot buffers.
+ *
+ * @param ncell Number of cells.
+ * @param max_number_of_threads Maximum number of threads of the simulation.
+ * @return Size of the arena (in bytes).
+ */
+static size_t get_arena_size(const unsigned int ncell,
+                             const int max_number_of_threads) {
+  size_t size = MemoryArena::get_block_size<Cell>(ncell + 2);
+#if HYDRO_SWEEP == HYDRO_SWEEP_PASSES
+  size += InterfaceStates::get_memory_size(ncell + 1);
+#elif HYDRO_SWEEP == HYDRO_SWEEP_FUSED
+  size += MemoryArena::get_block_size<double>(3 * (ncell + 2));
+  size += max_number_of_threads *
+          InterfaceStates::get_memory_size(HYDRO_SWEEP_BLOCK_SIZE + 1);
+#endif
+#if EOS == EOS_BONDI &&                                                        \
+    IONISATION_MODE == IONISATION_MODE_MONTE_CARLO_TRANSFER &&                 \
+    OFFLOAD != OFFLOAD_OPENMP_TARGET
+  size += 2 * MemoryArena::get_block_size<double>(max_number_of_threads *
+                                                  (ncell + 2));
+#endif
+  (void)max_number_of_threads;
+  size += SnapshotWriter::get_memory_size(ncell);
+  return size;
+}
+
+/**
+ * @brief Get the run time parameters that need to match for a restart.
+ *
+ * @return Run time parameters in the parameter file format, excluding the
+ * checkpoint interval, the thread pinning and the memory page type (which can
+ * be changed when restarting).
+ */
+static std::string get_checkpoint_parameters() {
+  std::stringstream parameters;
+  runtime_parameters.print_parameters(parameters);
+  std::stringstream checkpoint_parameters;
+  std::string line;
+  while (std::getline(parameters, line)) {
+    if (line.compare(0, 25, "checkpoint_interval_in_s:") != 0 &&
+        line.compare(0, 15, "thread_pinning:") != 0 &&
+        line.compare(0, 11, "huge_pages:") != 0) {
+      checkpoint_parameters << line << "\n";
+    }
+  }
+  return checkpoint_parameters.str();
+}
+
+/**
+ * @brief Start a new checkpoint and add the parameters of the run to it.
+ *
+ * @param checkpoint CheckpointWriter.
+ * @param ncell Number of cells.
+ * @param ic_file_name Name of the initial condition file.
+ * @param transition_width Width of the ionisation transition region (in
+ * internal units of L).
+ * @param bondi_pressure_contrast Pressure contrast between ionised and neutral
+ * region.
+ * @param finished Has the run finished? If so, the checkpoint contains no
+ * further state.
+ */
+static void start_checkpoint(CheckpointWriter &checkpoint,
+                             const unsigned int ncell,
+                             const std::string ic_file_name,
+                             const double transition_width,
+                             const double bondi_pressure_contrast,
+                             const bool finished) {
+  checkpoint.start();
+  checkpoint.write(ncell);
+  checkpoint.write(ic_file_name);
+  checkpoint.write(transition_width);
+  checkpoint.write(bondi_pressure_contrast);
+  checkpoint.write(get_checkpoint_parameters());
+  checkpoint.write(finished);
+}
+
+/**
+ * @brief Check that the parameters in the given checkpoint match those of the
+ * run that is restarted from it.
+ *
+ * @param checkpoint CheckpointReader.
+ * @param ncell Number of cells.
+ * @param ic_file_name Name of the initial condition file.
+ * @param transition_width Width of the ionisation transition region (in
+ * internal units of L).
+ * @param bondi_pressure_contrast Pressure contrast between ionised and neutral
+ * region.
+ * @return True if the checkpoint was written at the end of a finished run.
+ */
+static bool check_checkpoint(CheckpointReader &checkpoint,
+                             const unsigned int ncell,
+                             const std::string ic_file_name,
+                             const double transition_width,
+                             const double bondi_pressure_contrast) {
+  checkpoint.check("ncell", ncell);
+  checkpoint.check("ic_file_name", ic_file_name);
+  checkpoint.check("transition_width", transition_width);
+  checkpoint.check("bondi_pressure_contrast", bondi_pressure_contrast);
+  checkpoint.check("the run time parameters", get_checkpoint_parameters());
+  return checkpoint.read<bool>();
+}
+
+/**
+ * @brief State of a single simulation.
+ *
+ * The members are the variables of the simulation, and have the names used by
+ * the physics macros. They are initialized in the order in which they are
+ * declared, so that every member can use the members declared before it.
+ */
+class SimulationState {
+public:
+  /*! @brief Number of cells to use. */
+  const unsigned int ncell;
+
+  /*! @brief Name of the initial condition file (if IC_FILE was selected when
+   *  configuring the code). */
+  const std::string ic_file_name;
+
+  /*! @brief Width of the linear transition region between ionised and neutral
+   *  region (in internal units of L). */
+  const double transition_width;
+
+  /*! @brief Pressure contrast between ionised and neutral region. */
+  const double bondi_pressure_contrast;
+
+  /*! @brief Prefix for the names of all output files. */
+  const std::string output_prefix;
+
+  /*! @brief std::ostream to write messages to. */
+  std::ostream &output;
+
+  /*! @brief Number of threads to use (can change during the run). If this is
+   *  a nullptr, the default OpenMP number of threads is used. */
+  const std::atomic_int *number_of_threads;
+
+  /*! @brief Was the simulation restarted from a checkpoint file? */
+  const bool restart;
+
+  /*! @brief Maximum number of threads. The per thread buffers are sized for the
+   *  maximum number of threads, since the number of threads of an ensemble
+   *  member can grow during the run. */
+  const int max_number_of_threads;
+
+  /*! @brief Description of the thread placement, used for output. */
+  const std::string thread_placement;
+
+  /*! @brief Checkpoint file to restart from (only during setup()). */
+  std::unique_ptr<CheckpointReader> restart_checkpoint;
+
+  /*! @brief Total program time. */
+  Timer total_time;
+
+  // the time line used for time stepping
+  // we use a classical power of 2 integer time line as e.g. Gadget2
+  /*! @brief Total simulation time (in internal units of T). */
+  const double maxtime = MAXTIME;
+  /*! @brief Length of the integer time line. */
+  const uint_fast64_t integer_maxtime = 0x8000000000000000; // 2^63
+  /*! @brief Conversion factor from integer time to internal units of T. */
+  const double time_conversion_factor = maxtime / integer_maxtime;
+  const double Physical_Timestep = 1E3;	/*Timestep in SI units, used for MC transfer*/
+  /*! @brief Snapshots are written at multiples of this integer time. */
+  const uint_fast64_t snaptime = integer_maxtime / NUMBER_OF_SNAPS;
+
+  /*! @brief Memory arena that contains all arrays whose size only depends on
+   *  the number of cells and the configuration. It is sized once, and frees
+   *  all these arrays at once when the simulation is destroyed. */
+  MemoryArena arena{get_arena_size(ncell, max_number_of_threads), HUGE_PAGES};
+
+  /*! @brief Cells. We create 2 ghost cells to the left and to the right of the
+   *  simulation box to handle boundary conditions. */
+  Cell *cells = nullptr;
+
+  /*! @brief Courant factor for the CFL time step criterion. We use a very
+   *  conservative value. */
+  const double courant_factor = COURANT_FACTOR;
+
+  /*! @brief Minimum integer time step among all cells. */
+  uint_fast64_t min_integer_dt = integer_maxtime;
+
+#if LOGFILE == LOGFILE_EVENTS
+  /*! @brief Cell event log file. */
+  CellLog logfile{output_prefix + "logfile.dat", 100, ncell,
+                  max_number_of_threads};
+#endif
+
+#if TIME_STEPPING == TIME_STEPPING_FIXED
+  // the physical time step is no longer a compile time constant, so we need to
+  // make sure the conversion does not overflow for very short simulations
+  /*! @brief Integer time step of all cells. */
+  uint_fast64_t global_integer_dt = get_integer_dt(
+      Physical_Timestep / UNIT_TIME_IN_SI, maxtime, integer_maxtime);
+  /*uint_fast64_t global_integer_dt =round_power2_down(min_integer_dt);*/
+#elif TIME_STEPPING == TIME_STEPPING_INDIVIDUAL
+  /*! @brief Courant time step of every cell (the time step of an active cell
+   *  is limited by the Courant time steps of its neighbours; this also holds
+   *  for the ghost cells, which never limit the time step). */
+  std::vector<uint_fast64_t> courant_integer_dt =
+      std::vector<uint_fast64_t>(ncell + 2, integer_maxtime);
+  /*! @brief Time step bins. */
+  TimeBins time_bins;
+  /*! @brief Lists of the active cells, the active interfaces and the cells
+   *  that need a flux update during the current step, and of the cells that
+   *  end their time step at the end of the current step. */
+  std::vector<uint_fast32_t> active_cells, active_interfaces, updated_cells,
+      ending_cells;
+  /*! @brief Index of every active interface in the compact interface arrays.
+   */
+  std::vector<uint_fast32_t> interface_index =
+      std::vector<uint_fast32_t>(ncell + 1);
+  /*! @brief Saved primitive variables of inactive cells during snapshot
+   *  output. */
+  std::vector<double> saved_primitives;
+#endif
+
+  /*! @brief Background snapshot writer (it can also contain the ionisation
+   *  radius log, so it needs to be created first). */
+  SnapshotWriter snapshot_writer{ncell, arena, output_prefix, restart,
+                                 SNAPSHOT_COMPRESSION_TOLERANCE};
+
+  // boundary condition and ionisation variables
+  // these bits are handled in EOS.hpp (and Bondi.hpp for EOS_BONDI), and
+  // Boundaries.hpp (and Bondi.hpp for BOUNDARIES_BONDI).
+  boundary_conditions_variables
+  ionisation_variables
+
+  /*! @brief In-situ analysis of global quantities and probe values (only
+   *  active if ANALYSIS_INTERVAL > 0). */
+  InSituAnalysis analysis{output_prefix, restart};
+
+  /*! @brief Riemann solver. The solver type is a run time parameter: a fast
+   *  HLLC solver, or a slower, exact solver. */
+  RuntimeRiemannSolver solver{RIEMANNSOLVER_TYPE, GAMMA};
+
+#if HYDRO_SWEEP == HYDRO_SWEEP_PASSES
+  /*! @brief Reconstructed states and fluxes at the ncell + 1 cell interfaces.
+   */
+  InterfaceStates interfaces{ncell + 1, arena};
+  /*! @brief The Riemann problems are solved in batches of this many
+   *  interfaces. */
+  const uint_fast32_t interface_batch_size = 256;
+  /*! @brief Number of batches of interfaces. */
+  const uint_fast32_t number_of_interface_batches =
+      (ncell + interface_batch_size) / interface_batch_size;
+#elif HYDRO_SWEEP == HYDRO_SWEEP_FUSED
+  /*! @brief Number of blocks of the fused hydro sweep. */
+  const uint_fast32_t number_of_blocks =
+      (ncell + HYDRO_SWEEP_BLOCK_SIZE - 1) / HYDRO_SWEEP_BLOCK_SIZE;
+  /*! @brief Local copy of the hydro order, which is constant within the
+   *  sweep. */
+  const int hydro_order = HYDRO_ORDER;
+  /*! @brief Buffer for the predicted primitive variables. */
+  double *predicted_primitives = arena.allocate<double>(3 * (ncell + 2));
+  /*! @brief Reconstructed states and fluxes at the interfaces of a block, for
+   *  every thread (created by setup()). */
+  std::vector<std::unique_ptr<InterfaceStates>> thread_block_interfaces;
+#endif
+
+#if REFINEMENT == REFINEMENT_IONISATION_FRONT
+  /*! @brief Adaptive grid refinement, which uses the initial grid as base
+   *  grid. */
+  GridRefinement grid_refinement{ncell};
+#endif
+
+  /*! @brief Timers for the different phases of the main loop. */
+  PhaseTimers phase_timers{max_number_of_threads};
+
+  // variables used to guesstimate the remaing run time
+  /*! @brief Step timer. */
+  Timer step_time;
+  /*! @brief Time spent since the last snapshot (in s). */
+  double time_since_last = 0.;
+  /*! @brief Time spent since the start of the run (in s). */
+  double time_since_start = 0.;
+  /*! @brief Number of steps since the last snapshot. */
+  unsigned int steps_since_last = 0;
+
+  /*! @brief Current integer time. */
+  uint_fast64_t current_integer_time = 0;
+#if TIME_STEPPING == TIME_STEPPING_FIXED
+  /*! @brief Current integer system time step. */
+  uint_fast64_t current_integer_dt = global_integer_dt;
+#else
+  /*! @brief Current integer system time step (set by the time step
+   *  calculation at the start of every step). */
+  uint_fast64_t current_integer_dt = 0;
+#endif
+  /*! @brief Index of the next snapshot. */
+  uint_fast64_t isnap = 0;
+  /*! @brief Step counter (only used to limit the number of steps). */
+  uint_fast64_t number_of_steps = 0;
+
+  /*! @brief Checkpoint output. Checkpoints are written by a background thread.
+   */
+  CheckpointWriter checkpoint_writer{output_prefix + CHECKPOINT_FILE_NAME};
+  /*! @brief Wall clock time since the last checkpoint. */
+  Timer checkpoint_time;
+  /*! @brief Was the run interrupted? */
+  bool interrupted = false;
+
+  /**
+   * @brief Constructor.
+   *
+   * @param parameters Parameters of the simulation.
+   * @param output_stream std::ostream to write messages to.
+   * @param threads Number of threads to use (can be a nullptr).
+   * @param max_threads Maximum number of threads.
+   * @param placement Description of the thread placement.
+   * @param checkpoint Checkpoint file to restart from (if this is a restart).
+   * @param timer Total program time (already started).
+   */
+  inline SimulationState(const SimulationParameters &parameters,
+                         std::ostream &output_stream,
+                         const std::atomic_int *threads,
+                         const int max_threads, const std::string placement,
+                         std::unique_ptr<CheckpointReader> &checkpoint,
+                         const Timer timer)
+      : ncell(parameters._ncell), ic_file_name(parameters._ic_file_name),
+        transition_width(parameters._transition_width),
+        bondi_pressure_contrast(parameters._bondi_pressure_contrast),
+        output_prefix(parameters._output_prefix), output(output_stream),
+        number_of_threads(threads), restart(parameters._restart),
+        max_number_of_threads(max_threads), thread_placement(placement),
+        restart_checkpoint(std::move(checkpoint)), total_time(timer) {}
+
+  /**
+   * @brief Set up the grid and the initial condition, and restore the state of
+   * the run from the checkpoint if this is a restart.
+   *
+   * @return Exit code: 0 on success, 1 if the initial condition file could not
+   * be found.
+   */
+  inline int setup() {
+    // output: most of this was useful at some point
+    output << "Slope: " << (1.5 / transition_width) / UNIT_LENGTH_IN_SI
+           << std::endl;
+
+    output << "UNIT_LENGTH_IN_SI: " << UNIT_LENGTH_IN_SI << std::endl;
+    output << "UNIT_MASS_IN_SI: " << UNIT_MASS_IN_SI << std::endl;
+    output << "UNIT_TIME_IN_SI: " << UNIT_TIME_IN_SI << std::endl;
+    output << "UNIT_DENSITY_IN_SI: " << UNIT_DENSITY_IN_SI << std::endl;
+    output << "UNIT_VELOCITY_IN_SI: " << UNIT_VELOCITY_IN_SI << std::endl;
+    output << "UNIT_PRESSURE_IN_SI: " << UNIT_PRESSURE_IN_SI << std::endl;
+
+#if EOS == EOS_ISOTHERMAL || EOS == EOS_BONDI
+    output << "Newton G: "
+           << G_INTERNAL *
+                  (UNIT_LENGTH_IN_SI * UNIT_LENGTH_IN_SI * UNIT_LENGTH_IN_SI /
+                   UNIT_MASS_IN_SI / UNIT_TIME_IN_SI / UNIT_TIME_IN_SI)
+           << " m^3 kg^-1 s^-2" << std::endl;
+    output << "ISOTHERMAL_C_SQUARED: " << ISOTHERMAL_C_SQUARED << std::endl;
+    output << "Neutral sound speed: "
+           << std::sqrt(ISOTHERMAL_C_SQUARED) * UNIT_VELOCITY_IN_SI
+           << " m s^-1" << std::endl;
+    output << "Neutral temperature: "
+           << ISOTHERMAL_C_SQUARED * HYDROGEN_MASS_IN_SI *
+                  UNIT_VELOCITY_IN_SI * UNIT_VELOCITY_IN_SI / BOLTZMANN_K_IN_SI
+           << " K" << std::endl;
+    output << "Neutral Bondi radius: " << RBONDI << " ("
+           << RBONDI * UNIT_LENGTH_IN_SI / AU_IN_SI << " AU)" << std::endl;
+    output << "Density at R_Bondi: "
+           << bondi_density(RBONDI * UNIT_LENGTH_IN_SI / (20. * AU_IN_SI)) *
+                  UNIT_DENSITY_IN_SI
+           << std::endl;
+#endif
+
+    output << "Initial ionisation radius: "
+           << INITIAL_IONISATION_RADIUS * UNIT_LENGTH_IN_SI / AU_IN_SI
+           << " AU (" << INITIAL_IONISATION_RADIUS << ")" << std::endl;
+
+    output << "Point mass: " << MASS_POINT_MASS * UNIT_MASS_IN_SI << " kg"
+           << std::endl;
+
+    output << "Useful units:" << std::endl;
+    output << "Point mass: " << MASS_POINT_MASS * UNIT_MASS_IN_MSOL << " Msol"
+           << std::endl;
+    output << "Total simulation time: " << MAXTIME * UNIT_TIME_IN_YR << " yr"
+           << std::endl;
+    output << "Time in between snapshots: "
+           << (MAXTIME / NUMBER_OF_SNAPS) * UNIT_TIME_IN_YR << " yr "
+           << std::endl;
+    output << "Minimum radius: " << RMIN * UNIT_LENGTH_IN_AU << " AU (" << RMIN
+           << ")" << std::endl;
+    output << "Maximum radius: " << RMAX * UNIT_LENGTH_IN_AU << " AU (" << RMAX
+           << ")" << std::endl;
+
+// figure out how many threads we are using and tell the user about this
+#pragma omp parallel
+    {
+#pragma omp single
+      {
+        int num_thread = omp_get_num_threads();
+        output << "Running on " << num_thread << " thread(s) ("
+               << thread_placement << ")." << std::endl;
+      }
+    }
+
+    output << "Memory arena: " << arena.get_size() << " bytes ("
+           << arena.get_page_description() << ")." << std::endl;
+
+    // create the 1D spherical grid
+    cells = arena.allocate<Cell>(ncell + 2);
+    // the cells are not touched by the arena, so that they are first touched by
+    // the loop below, which uses the same static schedule as all other loops
+    // over the cells: every thread then places its own range of cells on the
+    // memory of its socket (see ThreadPlacement.hpp)
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 0; i < ncell + 2; ++i) {
+      cells[i]._integer_dt = 0;
+      cells[i]._sigma = 6.3e-22;
+      cells[i]._alphaB = 2.7e-19;
+      cells[i]._nfac_MC = 1.0;
+      cells[i]._ifrac=1.0-cells[i]._nfac_MC;
+      cells[i]._ft0=cells[i]._ifrac;
+      cells[i]._last_jmean=0.0;
+      // initialize the time step to a sensible value: the requested snapshot
+      // time interval
+      /*ORIGINAL: cells[i]._dt = (MAXTIME / NUMBER_OF_SNAPS);*/
+      cells[i]._dt = Physical_Timestep/UNIT_TIME_IN_SI;
+      // only actual cells have an index in the range [0, ncell[. The two ghost
+      // cells are excluded by the bit of conditional magic below.
+      cells[i]._index = (i != 0 && i != ncell + 2) ? (i - 1) : ncell + 2;
+    }
+
+#if HYDRO_SWEEP == HYDRO_SWEEP_FUSED
+    // every thread uses its own interface states for the blocks of the fused
+    // hydro sweep
+    for (int ithread = 0; ithread < max_number_of_threads; ++ithread) {
+      thread_block_interfaces.emplace_back(
+          new InterfaceStates(HYDRO_SWEEP_BLOCK_SIZE + 1, arena));
+    }
+#endif
+    // the cell positions and widths depend on the (run time) grid type, and are
+    // set by Grid.hpp
+    initialize_grid(cells, ncell);
+
+    // set up the initial condition
+    // this bit is handled by IC.hpp, and specific implementations in ICFile.hpp
+    // (if configured with IC_FILE), Bondi.hpp (if configured with IC_BONDI), or
+    // Sod.hpp (if configured with IC_SOD).
+    initialize(cells, ncell);
+
+    output << "Courant factor: " << courant_factor << std::endl;
+
+    // convert the input primitive variables into conserved variables, and
+    // compute the initial time step
+    // we use a global time step, which is the minimum time step among all cells
+#pragma omp parallel for schedule(static) reduction(min : min_integer_dt)
+    // convert primitive variables to conserved variables
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+      // apply the equation of state to get the initial pressure (if necessary)
+      // this bit is handled by EOS.hpp and Bondi.hpp (for EOS_BONDI)
+      initial_pressure(cells[i]);
+
+      // use the cell volume to convert primitive into conserved variables
+      cells[i]._m = cells[i]._rho * cells[i]._V;
+      cells[i]._p = cells[i]._m * cells[i]._u;
+      cells[i]._E = cells[i]._P * cells[i]._V / (GAMMA - 1.) +
+                    0.5 * cells[i]._u * cells[i]._p;
+
+      // time step criterion
+      const double cs = std::sqrt(GAMMA * cells[i]._P / cells[i]._rho) +
+                        std::abs(cells[i]._u);
+      const double dt = courant_factor * cells[i]._V / cs;
+      const uint_fast64_t integer_dt =
+          get_integer_dt(dt, maxtime, integer_maxtime);
+      min_integer_dt = std::min(min_integer_dt, integer_dt);
+#if TIME_STEPPING == TIME_STEPPING_INDIVIDUAL
+      // individual time steps: keep the time step of every cell
+      cells[i]._integer_dt = integer_dt;
+#endif
+
+      // initialize variables used for the log file
+      cells[i]._last_rho = cells[i]._rho;
+      cells[i]._last_u = cells[i]._u;
+      cells[i]._last_P = cells[i]._P;
+      cells[i]._last_nfac = cells[i]._nfac;
+    }
+
+#if LOGFILE == LOGFILE_EVENTS
+    // write the first entry of the log file
+    if (!restart) {
+      logfile.write(cells, 0., true);
+    }
+#endif
+
+#if TIME_STEPPING == TIME_STEPPING_FIXED
+    // set cell time steps
+    // round min_integer_dt to closest smaller power of 2
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+      cells[i]._integer_dt = global_integer_dt;
+      cells[i]._dt = cells[i]._integer_dt * time_conversion_factor;
+    }
+#elif TIME_STEPPING == TIME_STEPPING_INDIVIDUAL
+    // set cell time steps
+    // every cell time step is rounded down to the closest smaller power of 2,
+    // and is not allowed to be larger than the snapshot interval
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+      courant_integer_dt[i] = round_power2_down(
+          std::max<uint_fast64_t>(std::min(cells[i]._integer_dt, snaptime), 1));
+      cells[i]._integer_dt = courant_integer_dt[i];
+      cells[i]._dt = cells[i]._integer_dt * time_conversion_factor;
+      time_bins.add_cell(i, cells[i]._integer_dt);
+    }
+    // the ghost cells have the same time step as their neighbouring cell
+    cells[0]._integer_dt = cells[1]._integer_dt;
+    cells[0]._dt = cells[1]._dt;
+    cells[ncell + 1]._integer_dt = cells[ncell]._integer_dt;
+    cells[ncell + 1]._dt = cells[ncell]._dt;
+#endif
+
+    // initialize boundary condition and ionisation variables
+    // these bits are handled in EOS.hpp (and Bondi.hpp for EOS_BONDI), and
+    // Boundaries.hpp (and Bondi.hpp for BOUNDARIES_BONDI).
+    boundary_conditions_initialize();
+    ionisation_initialize();
+
+    checkpoint_time.start();
+
+    if (restart) {
+      // restore the state of the run from the checkpoint, in the same order in
+      // which it was written by step()
+      CheckpointReader &checkpoint = *restart_checkpoint;
+      checkpoint.read(current_integer_time);
+      checkpoint.read(current_integer_dt);
+      checkpoint.read(isnap);
+      checkpoint.read(number_of_steps);
+      checkpoint.read(min_integer_dt);
+      checkpoint.read(time_since_start);
+      checkpoint.read(time_since_last);
+      checkpoint.read(steps_since_last);
+      checkpoint.read(cells, ncell + 2);
+#if REFINEMENT == REFINEMENT_IONISATION_FRONT
+      grid_refinement.read_checkpoint(checkpoint);
+#endif
+#if TIME_STEPPING == TIME_STEPPING_INDIVIDUAL
+      checkpoint.read(courant_integer_dt);
+      time_bins.read_checkpoint(checkpoint);
+#endif
+#if LOGFILE == LOGFILE_EVENTS
+      logfile.read_checkpoint(checkpoint);
+#endif
+      snapshot_writer.read_checkpoint(checkpoint);
+      ionisation_read_checkpoint(checkpoint);
+      analysis.read_checkpoint(checkpoint);
+      restart_checkpoint.reset();
+    }
+
+    return 0;
+  }
+
+  /**
+   * @brief Is the run finished?
+   *
+   * @return True if the end of the simulation time or the maximum number of
+   * steps was reached, or if the run was interrupted.
+   */
+  inline bool is_finished() const {
+    return interrupted || current_integer_time >= integer_maxtime ||
+           (MAX_NUMBER_OF_STEPS > 0 && number_of_steps >= MAX_NUMBER_OF_STEPS);
+  }
+
+  /**
+   * @brief Do a single step.
+   */
+  inline void step() {
+
+    // start the step timer
+    step_time.start();
+
+    // pick up threads that were handed to this run while it was running
+    set_number_of_threads(number_of_threads, max_number_of_threads);
+
+#if TIME_STEPPING == TIME_STEPPING_GLOBAL_CFL
+    // compute the new system time step: the minimal Courant time step of all
+    // cells (using up to date primitive variables), rounded down to a power of
+    // 2 and limited so that the step ends exactly on the next snapshot time
+    // (or the end of the simulation) if it would otherwise step over it
+    phase_timers.start(PHASE_TIME_STEP);
+    min_integer_dt = snaptime;
+#pragma omp parallel for schedule(static) reduction(min : min_integer_dt)
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+      cells[i]._rho = cells[i]._m / cells[i]._V;
+      cells[i]._u = cells[i]._p / cells[i]._m;
+      update_pressure(cells[i]);
+      const double cs = std::sqrt(GAMMA * cells[i]._P / cells[i]._rho) +
+                        std::abs(cells[i]._u);
+      const double dt = courant_factor * cells[i]._V / cs;
+      const uint_fast64_t integer_dt =
+          get_integer_dt(dt, maxtime, integer_maxtime);
+      min_integer_dt = std::min(min_integer_dt, integer_dt);
+    }
+    current_integer_dt =
+        round_power2_down(std::max<uint_fast64_t>(min_integer_dt, 1));
+    // snaptime is rounded down, so the last snapshot time is slightly before
+    // the end of the run: the last snapshot is the final snapshot, written at
+    // the end of the run
+    const uint_fast64_t next_snapshot = current_integer_time / snaptime + 1;
+    const uint_fast64_t next_snapshot_time =
+        (next_snapshot >= NUMBER_OF_SNAPS) ? integer_maxtime
+                                           : next_snapshot * snaptime;
+    if (current_integer_time + current_integer_dt > next_snapshot_time) {
+      current_integer_dt = next_snapshot_time - current_integer_time;
+    }
+    // all cells (including the ghost cells) use the system time step
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 0; i < ncell + 2; ++i) {
+      cells[i]._integer_dt = current_integer_dt;
+      cells[i]._dt = current_integer_dt * time_conversion_factor;
+    }
+    phase_timers.stop(PHASE_TIME_STEP);
+#endif
+
+#if TIME_STEPPING != TIME_STEPPING_INDIVIDUAL
+    // add the spherical source term. Handled by Spherical.hpp
+    phase_timers.start(PHASE_SOURCE_TERMS);
+    add_spherical_source_term();
+
+    // do first gravity kick, handled by Potential.hpp
+    do_gravity();
+    phase_timers.stop(PHASE_SOURCE_TERMS);
+#else
+    // get the cells that start a new time step and compute their new time step
+    // we first compute the Courant time step of every active cell, using up to
+    // date primitive variables
+    phase_timers.start(PHASE_TIME_STEP);
+    time_bins.get_active_cells(current_integer_time, active_cells);
+    const uint_fast32_t number_of_active_cells = active_cells.size();
+#pragma omp parallel for
+    for (uint_fast32_t k = 0; k < number_of_active_cells; ++k) {
+      const uint_fast32_t i = active_cells[k];
+      cells[i]._rho = cells[i]._m / cells[i]._V;
+      cells[i]._u = cells[i]._p / cells[i]._m;
+      update_pressure(cells[i]);
+      const double cs = std::sqrt(GAMMA * cells[i]._P / cells[i]._rho) +
+                        std::abs(cells[i]._u);
+      const double dt = courant_factor * cells[i]._V / cs;
+      const uint_fast64_t integer_dt =
+          get_integer_dt(dt, maxtime, integer_maxtime);
+      courant_integer_dt[i] = round_power2_down(
+          std::max<uint_fast64_t>(std::min(integer_dt, snaptime), 1));
+    }
+    // now limit the time steps: a time step cannot be more than a factor 2
+    // larger than the Courant time step of a neighbour (inactive neighbours use
+    // the Courant time step at the start of their current step) or than the
+    // previous time step of the cell, and needs to be synchronised with the
+    // current time
+#pragma omp parallel for
+    for (uint_fast32_t k = 0; k < number_of_active_cells; ++k) {
+      const uint_fast32_t i = active_cells[k];
+      uint_fast64_t integer_dt = courant_integer_dt[i];
+      if (courant_integer_dt[i - 1] < (integer_dt >> 1)) {
+        integer_dt = courant_integer_dt[i - 1] << 1;
+      }
+      if (courant_integer_dt[i + 1] < (integer_dt >> 1)) {
+        integer_dt = courant_integer_dt[i + 1] << 1;
+      }
+      if (cells[i]._integer_dt < (integer_dt >> 1)) {
+        integer_dt = cells[i]._integer_dt << 1;
+      }
+      while (!TimeBins::is_active(current_integer_time, integer_dt)) {
+        integer_dt >>= 1;
+      }
+      cells[i]._integer_dt = integer_dt;
+      cells[i]._dt = integer_dt * time_conversion_factor;
+    }
+    // the ghost cells have the same time step as their neighbouring cell
+    cells[0]._integer_dt = cells[1]._integer_dt;
+    cells[0]._dt = cells[1]._dt;
+    cells[ncell + 1]._integer_dt = cells[ncell]._integer_dt;
+    cells[ncell + 1]._dt = cells[ncell]._dt;
+    time_bins.rebin_active_cells(current_integer_time, active_cells, cells);
+    // the system time step is the time until the next cells become active
+    current_integer_dt =
+        time_bins.get_next_time(current_integer_time) - current_integer_time;
+    phase_timers.stop(PHASE_TIME_STEP);
+
+    // add the spherical source term and do the first gravity kick for the
+    // active cells. Handled by Spherical.hpp and Potential.hpp
+    phase_timers.start(PHASE_SOURCE_TERMS);
+#pragma omp parallel for
+    for (uint_fast32_t k = 0; k < number_of_active_cells; ++k) {
+      const uint_fast32_t i = active_cells[k];
+      add_spherical_source_term_cell(cells[i]);
+      do_gravity_cell(cells[i]);
+    }
+    phase_timers.stop(PHASE_SOURCE_TERMS);
+#endif
+
+    // do ionisation, handled by EOS.hpp (and Bondi.hpp for EOS_BONDI).
+    phase_timers.start(PHASE_IONISATION);
+    do_ionisation();
+    phase_timers.stop(PHASE_IONISATION);
+
+    // update the primitive variables based on the values of the conserved
+    // variables and the current cell volume
+    // also compute the new time step
+    phase_timers.start(PHASE_PRIMITIVES);
+#if TIME_STEPPING != TIME_STEPPING_INDIVIDUAL
+    min_integer_dt = snaptime;
+#pragma omp parallel for schedule(static) reduction(min : min_integer_dt)
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+      cells[i]._rho = cells[i]._m / cells[i]._V;
+      cells[i]._u = cells[i]._p / cells[i]._m;
+      // the pressure update depends on the equation of state
+      // this is handled in EOS.hpp (and Bondi.hpp for EOS_BONDI)
+      update_pressure(cells[i]);
+      const double cs = std::sqrt(GAMMA * cells[i]._P / cells[i]._rho) +
+                        std::abs(cells[i]._u);
+      const double dt = courant_factor * cells[i]._V / cs;
+      const uint_fast64_t integer_dt =
+          get_integer_dt(dt, maxtime, integer_maxtime);
+      min_integer_dt = std::min(min_integer_dt, integer_dt);
+    }
+#else
+    // only the active cells are updated, the conserved variables of inactive
+    // cells are only up to date at the end of their current step
+#pragma omp parallel for
+    for (uint_fast32_t k = 0; k < number_of_active_cells; ++k) {
+      const uint_fast32_t i = active_cells[k];
+      cells[i]._rho = cells[i]._m / cells[i]._V;
+      cells[i]._u = cells[i]._p / cells[i]._m;
+      update_pressure(cells[i]);
+    }
+#endif
+    phase_timers.stop(PHASE_PRIMITIVES);
+
+#if LOGFILE == LOGFILE_EVENTS
+    // now is the time to write to the log file
+    phase_timers.start(PHASE_LOGFILE);
+    logfile.write(cells, current_integer_time * time_conversion_factor);
+    phase_timers.stop(PHASE_LOGFILE);
+#endif
+
+    if (ANALYSIS_INTERVAL > 0 && number_of_steps % ANALYSIS_INTERVAL == 0) {
+      phase_timers.start(PHASE_ANALYSIS);
+      analysis.compute(cells, ncell,
+                       current_integer_time * time_conversion_factor,
+                       ionisation_front_radius(), ionisation_central_mass());
+      phase_timers.stop(PHASE_ANALYSIS);
+    }
+
+#if TIME_STEPPING == TIME_STEPPING_FIXED
+    current_integer_dt = global_integer_dt;
+#endif
+
+    // check if we need to output a snapshot
+    if (current_integer_time >= isnap * snaptime) {
+      // yes: display some statistics and a guesstimate of the remaining run
+      // time
+      const double pct = current_integer_time * 100. / integer_maxtime;
+      output << get_timestamp() << "\t" << ncell << ": "
+             << "time " << current_integer_time * time_conversion_factor
+             << " of " << maxtime << " (" << pct << " %)" << std::endl;
+      output << "\t\t\tSystem time step: "
+             << current_integer_dt * time_conversion_factor << std::endl;
+      const double avg_time_since_last = time_since_last / steps_since_last;
+      output << "\t\t\tAverage time per step: " << avg_time_since_last
+             << " s" << std::endl;
+      time_since_start += time_since_last;
+      const double time_to_go = time_since_start * (100. - pct) / pct;
+      output << "\t\t\tEstimated time to go: " << time_to_go << " s"
+             << std::endl;
+#if EOS == EOS_BONDI
+      // we added this bit for the case where we want to add accreted material
+      // to the central mass (currently not used)
+      output << "\t\t\tCentral mass: " << central_mass << " ("
+             << (central_mass / MASS_POINT_MASS) << ")" << std::endl;
+#endif
+#if REFINEMENT == REFINEMENT_IONISATION_FRONT
+      output << "\t\t\tGrid updates: "
+             << grid_refinement.get_number_of_updates() << std::endl;
+#endif
+      // reset guesstimate counters
+      time_since_last = 0.;
+      steps_since_last = 0;
+      // write the actual snapshot
+      phase_timers.start(PHASE_SNAPSHOT);
+#if TIME_STEPPING == TIME_STEPPING_INDIVIDUAL
+      // the primitive variables of inactive cells are those at the start of
+      // their current step: drift them to the current time using the gradients
+      // within the cells (the snapshot writer copies the cells, so we can
+      // restore the old values immediately afterwards)
+      saved_primitives.resize(3 * (ncell + 2));
+#pragma omp parallel for schedule(static)
+      for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+        saved_primitives[3 * i] = cells[i]._rho;
+        saved_primitives[3 * i + 1] = cells[i]._u;
+        saved_primitives[3 * i + 2] = cells[i]._P;
+        predict_primitive_variables(
+            cells[i], TimeBins::get_elapsed_time(current_integer_time,
+                                                cells[i]._integer_dt) *
+                          time_conversion_factor);
+      }
+#endif
+      write_snapshot(output, snapshot_writer, isnap,
+                     current_integer_time * time_conversion_factor, cells);
+#if TIME_STEPPING == TIME_STEPPING_INDIVIDUAL
+#pragma omp parallel for schedule(static)
+      for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+        cells[i]._rho = saved_primitives[3 * i];
+        cells[i]._u = saved_primitives[3 * i + 1];
+        cells[i]._P = saved_primitives[3 * i + 2];
+      }
+#endif
+      phase_timers.stop(PHASE_SNAPSHOT);
+      ++isnap;
+    }
+
+    // apply boundary conditions
+    // handled by Boundaries.hpp (and Bondi.hpp for BOUNDARIES_BONDI)
+    phase_timers.start(PHASE_BOUNDARIES);
+    boundary_conditions_primitive_variables();
+    phase_timers.stop(PHASE_BOUNDARIES);
+
+#if TIME_STEPPING == TIME_STEPPING_INDIVIDUAL
+    // compute slope limited gradients for the primitive variables in each
+    // active cell
+    // the gradients of inactive cells are those at the start of their step
+    phase_timers.start(PHASE_GRADIENTS);
+#pragma omp parallel for
+    for (uint_fast32_t k = 0; k < number_of_active_cells; ++k) {
+      const uint_fast32_t i = active_cells[k];
+      compute_gradients(cells[i - 1], cells[i], cells[i + 1], cells[i]);
+    }
+
+    // apply boundary conditions for the gradients
+    // handled by Boundaries.hpp (and Bondi.hpp for BOUNDARIES_BONDI)
+    boundary_conditions_gradients();
+
+    if (HYDRO_ORDER == 1) {
+// reset all gradients of the active cells and the ghost cells to zero to
+// disable the second order scheme
+#pragma omp parallel for
+      for (uint_fast32_t k = 0; k < number_of_active_cells; ++k) {
+        const uint_fast32_t i = active_cells[k];
+        cells[i]._grad_rho = 0.;
+        cells[i]._grad_u = 0.;
+        cells[i]._grad_P = 0.;
+      }
+      cells[0]._grad_rho = 0.;
+      cells[0]._grad_u = 0.;
+      cells[0]._grad_P = 0.;
+      cells[ncell + 1]._grad_rho = 0.;
+      cells[ncell + 1]._grad_u = 0.;
+      cells[ncell + 1]._grad_P = 0.;
+    }
+    phase_timers.stop(PHASE_GRADIENTS);
+
+    // get the interfaces that touch an active cell and the cells that receive
+    // a flux through these interfaces
+    // a flux through interface i is integrated over the time step of the
+    // neighbouring cell with the smallest time step, which is always an active
+    // cell. Both neighbours receive the same flux, so that the scheme remains
+    // conservative. An inactive cell accumulates the fluxes from its active
+    // neighbours over its own time step.
+    phase_timers.start(PHASE_PREDICTION);
+    TimeBins::get_active_interfaces(current_integer_time, active_cells, cells,
+                                    ncell, active_interfaces, updated_cells);
+    const uint_fast32_t number_of_active_interfaces = active_interfaces.size();
+    const uint_fast32_t number_of_updated_cells = updated_cells.size();
+    const uint_fast32_t number_of_active_interface_batches =
+        (number_of_active_interfaces + interface_batch_size - 1) /
+        interface_batch_size;
+
+// evolve the primitive variables on both sides of every active interface
+// forward in time to the middle of the interface time step, and reconstruct
+// the left and right state at the interface
+// the primitive variables and gradients of a cell are those at the start of its
+// current step, so we also need to account for the time that passed since then
+// the reconstructed states are stored in a compact way: active interface k is
+// stored at position k
+#pragma omp parallel for
+    for (uint_fast32_t k = 0; k < number_of_active_interfaces; ++k) {
+      const uint_fast32_t i = active_interfaces[k];
+      const uint_fast64_t interface_integer_dt =
+          std::min(cells[i]._integer_dt, cells[i + 1]._integer_dt);
+      HydroState left, right;
+      copy_hydro_state(cells[i], left);
+      copy_hydro_state(cells[i + 1], right);
+      predict_primitive_variables(
+          left, (TimeBins::get_elapsed_time(current_integer_time,
+                                            cells[i]._integer_dt) +
+                 0.5 * interface_integer_dt) *
+                    time_conversion_factor);
+      predict_primitive_variables(
+          right, (TimeBins::get_elapsed_time(current_integer_time,
+                                             cells[i + 1]._integer_dt) +
+                  0.5 * interface_integer_dt) *
+                     time_conversion_factor);
+      reconstruct_interface_states(
+          left, right, cells[i]._uplim - cells[i]._midpoint,
+          cells[i + 1]._midpoint - cells[i + 1]._lowlim, interfaces._rhoL[k],
+          interfaces._uL[k], interfaces._PL[k], interfaces._rhoR[k],
+          interfaces._uR[k], interfaces._PR[k]);
+      interface_index[i] = k;
+    }
+    phase_timers.stop(PHASE_PREDICTION);
+
+    // solve the Riemann problem at every active interface, using the batched
+    // solver
+    // every thread records the time it spent on its own batches
+    phase_timers.start(PHASE_RIEMANN);
+#pragma omp parallel
+    {
+      Timer thread_time;
+#pragma omp for nowait
+      for (uint_fast32_t ibatch = 0;
+           ibatch < number_of_active_interface_batches; ++ibatch) {
+        const uint_fast32_t ifirst = ibatch * interface_batch_size;
+        const uint_fast32_t nbatch = std::min<uint_fast32_t>(
+            interface_batch_size, number_of_active_interfaces - ifirst);
+        solver.solve_for_flux_batch(
+            nbatch, interfaces._rhoL + ifirst, interfaces._uL + ifirst,
+            interfaces._PL + ifirst, interfaces._rhoR + ifirst,
+            interfaces._uR + ifirst, interfaces._PR + ifirst,
+            interfaces._mflux + ifirst, interfaces._pflux + ifirst,
+            interfaces._Eflux + ifirst);
+      }
+      phase_timers.add_thread_time(PHASE_RIEMANN, omp_get_thread_num(),
+                                   thread_time.stop());
+    }
+    phase_timers.stop(PHASE_RIEMANN);
+
+    // do the flux exchange for all cells that have an active interface
+    // every cell only updates its own conserved variables, so that there is no
+    // thread concurrency
+    phase_timers.start(PHASE_FLUX_EXCHANGE);
+#pragma omp parallel for
+    for (uint_fast32_t k = 0; k < number_of_updated_cells; ++k) {
+      const uint_fast32_t i = updated_cells[k];
+      const bool active = TimeBins::is_active(current_integer_time,
+                                              cells[i]._integer_dt);
+      // left flux
+      if (active || TimeBins::is_active(current_integer_time,
+                                        cells[i - 1]._integer_dt)) {
+        const uint_fast32_t j = interface_index[i - 1];
+        const double dt =
+            std::min(cells[i - 1]._integer_dt, cells[i]._integer_dt) *
+            time_conversion_factor;
+        const double mflux = interfaces._mflux[j];
+        const double pflux = interfaces._pflux[j];
+        const double Eflux = interfaces._Eflux[j];
+
+        cells[i]._m += dt * mflux;
+        cells[i]._p += dt * pflux;
+        cells[i]._E += dt * Eflux;
+
+        // call a special function for flux that crosses the inner outflow
+        // boundary (this currently does not do anything), and record the
+        // flux for the in-situ analysis
+        if (i == 1) {
+          flux_into_inner_mask(dt * mflux);
+          analysis.add_inner_mass_flux(dt * mflux);
+        }
+      }
+      // right flux
+      if (active || TimeBins::is_active(current_integer_time,
+                                        cells[i + 1]._integer_dt)) {
+        const uint_fast32_t j = interface_index[i];
+        const double dt =
+            std::min(cells[i]._integer_dt, cells[i + 1]._integer_dt) *
+            time_conversion_factor;
+        const double mflux = interfaces._mflux[j];
+        const double pflux = interfaces._pflux[j];
+        const double Eflux = interfaces._Eflux[j];
+
+        cells[i]._m -= dt * mflux;
+        cells[i]._p -= dt * pflux;
+        cells[i]._E -= dt * Eflux;
+      }
+    }
+    phase_timers.stop(PHASE_FLUX_EXCHANGE);
+
+    // add the spherical source term and do the second gravity kick for the
+    // cells that end their time step
+    // handled by Spherical.hpp and Potential.hpp
+    phase_timers.start(PHASE_SOURCE_TERMS);
+    time_bins.get_active_cells(current_integer_time + current_integer_dt,
+                               ending_cells);
+    const uint_fast32_t number_of_ending_cells = ending_cells.size();
+#pragma omp parallel for
+    for (uint_fast32_t k = 0; k < number_of_ending_cells; ++k) {
+      const uint_fast32_t i = ending_cells[k];
+      add_spherical_source_term_cell(cells[i]);
+      do_gravity_cell(cells[i]);
+    }
+    phase_timers.stop(PHASE_SOURCE_TERMS);
+#elif HYDRO_SWEEP == HYDRO_SWEEP_PASSES
+    // compute slope limited gradients for the primitive variables in each cell
+    phase_timers.start(PHASE_GRADIENTS);
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+      compute_gradients(cells[i - 1], cells[i], cells[i + 1], cells[i]);
+    }
+
+    // apply boundary conditions for the gradients
+    // handled by Boundaries.hpp (and Bondi.hpp for BOUNDARIES_BONDI)
+    boundary_conditions_gradients();
+
+    if (HYDRO_ORDER == 1) {
+// reset all gradients to zero to disable the second order scheme
+#pragma omp parallel for schedule(static)
+      for (uint_fast32_t i = 0; i < ncell + 2; ++i) {
+        cells[i]._grad_rho = 0.;
+        cells[i]._grad_u = 0.;
+        cells[i]._grad_P = 0.;
+      }
+    }
+    phase_timers.stop(PHASE_GRADIENTS);
+
+    // evolve all primitive variables forward in time for half a time step
+    // using the Euler equations and the spatial gradients within the cells
+    phase_timers.start(PHASE_PREDICTION);
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 0; i < ncell + 2; ++i) {
+      predict_primitive_variables(cells[i], 0.5 * cells[i]._dt);
+    }
+
+// reconstruct the left and right state at every interface
+// interface i is the interface between cell i and cell i + 1
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 0; i < ncell + 1; ++i) {
+      reconstruct_interface_states(
+          cells[i], cells[i + 1], cells[i]._uplim - cells[i]._midpoint,
+          cells[i + 1]._midpoint - cells[i + 1]._lowlim, interfaces._rhoL[i],
+          interfaces._uL[i], interfaces._PL[i], interfaces._rhoR[i],
+          interfaces._uR[i], interfaces._PR[i]);
+    }
+    phase_timers.stop(PHASE_PREDICTION);
+
+    // solve the Riemann problem at every interface, using the batched solver
+    // every thread records the time it spent on its own batches
+    phase_timers.start(PHASE_RIEMANN);
+#pragma omp parallel
+    {
+      Timer thread_time;
+#pragma omp for nowait
+      for (uint_fast32_t ibatch = 0; ibatch < number_of_interface_batches;
+           ++ibatch) {
+        const uint_fast32_t ifirst = ibatch * interface_batch_size;
+        const uint_fast32_t nbatch =
+            std::min<uint_fast32_t>(interface_batch_size, ncell + 1 - ifirst);
+        solver.solve_for_flux_batch(
+            nbatch, interfaces._rhoL + ifirst, interfaces._uL + ifirst,
+            interfaces._PL + ifirst, interfaces._rhoR + ifirst,
+            interfaces._uR + ifirst, interfaces._PR + ifirst,
+            interfaces._mflux + ifirst, interfaces._pflux + ifirst,
+            interfaces._Eflux + ifirst);
+      }
+      phase_timers.add_thread_time(PHASE_RIEMANN, omp_get_thread_num(),
+                                   thread_time.stop());
+    }
+    phase_timers.stop(PHASE_RIEMANN);
+
+    // do the flux exchange
+    // every cell only updates its own conserved variables, so that there is no
+    // thread concurrency
+    phase_timers.start(PHASE_FLUX_EXCHANGE);
+#pragma omp parallel for schedule(static)
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+      const double dt = cells[i]._dt;
+      // left flux
+      {
+        const double mflux = interfaces._mflux[i - 1];
+        const double pflux = interfaces._pflux[i - 1];
+        const double Eflux = interfaces._Eflux[i - 1];
+
+        cells[i]._m += dt * mflux;
+        cells[i]._p += dt * pflux;
+        cells[i]._E += dt * Eflux;
+
+        // call a special function for flux that crosses the inner outflow
+        // boundary (this currently does not do anything), and record the
+        // flux for the in-situ analysis
+        if (i == 1) {
+          flux_into_inner_mask(dt * mflux);
+          analysis.add_inner_mass_flux(dt * mflux);
+        }
+      }
+      // right flux
+      {
+        const double mflux = interfaces._mflux[i];
+        const double pflux = interfaces._pflux[i];
+        const double Eflux = interfaces._Eflux[i];
+
+        cells[i]._m -= dt * mflux;
+        cells[i]._p -= dt * pflux;
+        cells[i]._E -= dt * Eflux;
+      }
+    }
+    phase_timers.stop(PHASE_FLUX_EXCHANGE);
+
+    // add the spherical source term
+    // handled by Spherical.hpp
+    phase_timers.start(PHASE_SOURCE_TERMS);
+    add_spherical_source_term();
+
+    // do the second gravity kick
+    // handled by Potential.hpp
+    do_gravity();
+    phase_timers.stop(PHASE_SOURCE_TERMS);
+#else
+    // the Bondi boundary conditions for the gradients need the gradients in
+    // the first and last cell, which would otherwise only be computed within
+    // the sweep
+    phase_timers.start(PHASE_FUSED_SWEEP);
+    compute_gradients(cells[0], cells[1], cells[2], cells[1]);
+    compute_gradients(cells[ncell - 1], cells[ncell], cells[ncell + 1],
+                      cells[ncell]);
+
+    // apply boundary conditions for the gradients
+    // handled by Boundaries.hpp (and Bondi.hpp for BOUNDARIES_BONDI)
+    boundary_conditions_gradients();
+
+    if (HYDRO_ORDER == 1) {
+      // reset the ghost cell gradients to zero to disable the second order
+      // scheme (the gradients of the other cells are reset within the sweep)
+      cells[0]._grad_rho = 0.;
+      cells[0]._grad_u = 0.;
+      cells[0]._grad_P = 0.;
+      cells[ncell + 1]._grad_rho = 0.;
+      cells[ncell + 1]._grad_u = 0.;
+      cells[ncell + 1]._grad_P = 0.;
+    }
+
+// fused hydro sweep over blocks of HYDRO_SWEEP_BLOCK_SIZE cells
+// in a first pass over a block, we compute the gradients, predicted primitive
+// variables and fluxes for the cells in the block, while they are still in the
+// cache. The predicted primitive variables cannot be stored in the cells yet,
+// since the neighbouring blocks still need the old values to compute the
+// gradients and predicted primitive variables for their halo cells. They are
+// stored in a separate buffer and are copied into the cells in a second pass
+// over the block, after all blocks have been processed. The second pass also
+// adds the source terms.
+// every step of the scheme is still done in a separate loop over the cells in
+// the block, and every cell update uses exactly the same operations in exactly
+// the same order as the pass by pass scheme, so that both produce identical
+// results.
+#pragma omp parallel
+    {
+      // predicted state of the cells in the block and the two halo cells
+      HydroState block_state[HYDRO_SWEEP_BLOCK_SIZE + 2];
+      // reconstructed states and fluxes at the interfaces of the block
+      InterfaceStates &block_interfaces =
+          *thread_block_interfaces[omp_get_thread_num()];
+
+#pragma omp for schedule(static)
+      for (uint_fast32_t iblock = 0; iblock < number_of_blocks; ++iblock) {
+        const uint_fast32_t ibegin = 1 + iblock * HYDRO_SWEEP_BLOCK_SIZE;
+        const uint_fast32_t iend = std::min<uint_fast32_t>(
+            ibegin + HYDRO_SWEEP_BLOCK_SIZE, ncell + 1);
+
+        // compute slope limited gradients for the cells in the block and the
+        // halo cells
+        // block_state[j] holds the state of cell ibegin - 1 + j
+        for (uint_fast32_t i = ibegin - 1; i < iend + 1; ++i) {
+          HydroState &state = block_state[i + 1 - ibegin];
+          state._rho = cells[i]._rho;
+          state._u = cells[i]._u;
+          state._P = cells[i]._P;
+          state._a = cells[i]._a;
+          if (i == 0 || i == ncell + 1) {
+            // ghost cell: gradients are set by the boundary conditions
+            state._grad_rho = cells[i]._grad_rho;
+            state._grad_u = cells[i]._grad_u;
+            state._grad_P = cells[i]._grad_P;
+          } else if (hydro_order == 1) {
+            state._grad_rho = 0.;
+            state._grad_u = 0.;
+            state._grad_P = 0.;
+          } else {
+            compute_gradients(cells[i - 1], cells[i], cells[i + 1], state);
+          }
+        }
+        for (uint_fast32_t i = ibegin; i < iend; ++i) {
+          const HydroState &state = block_state[i + 1 - ibegin];
+          cells[i]._grad_rho = state._grad_rho;
+          cells[i]._grad_u = state._grad_u;
+          cells[i]._grad_P = state._grad_P;
+        }
+
+        // evolve the primitive variables forward in time for half a time step
+        for (uint_fast32_t i = ibegin - 1; i < iend + 1; ++i) {
+          predict_primitive_variables(block_state[i + 1 - ibegin],
+                                      0.5 * cells[i]._dt);
+        }
+
+        // compute the fluxes through the interfaces of the block
+        // interface j is the left interface of cell ibegin + j
+        for (uint_fast32_t i = ibegin; i < iend + 1; ++i) {
+          const uint_fast32_t j = i - ibegin;
+          reconstruct_interface_states(
+              block_state[j], block_state[j + 1],
+              cells[i - 1]._uplim - cells[i - 1]._midpoint,
+              cells[i]._midpoint - cells[i]._lowlim, block_interfaces._rhoL[j],
+              block_interfaces._uL[j], block_interfaces._PL[j],
+              block_interfaces._rhoR[j], block_interfaces._uR[j],
+              block_interfaces._PR[j]);
+        }
+        solver.solve_for_flux_batch(
+            iend + 1 - ibegin, block_interfaces._rhoL, block_interfaces._uL,
+            block_interfaces._PL, block_interfaces._rhoR, block_interfaces._uR,
+            block_interfaces._PR, block_interfaces._mflux,
+            block_interfaces._pflux, block_interfaces._Eflux);
+
+        // do the flux exchange
+        for (uint_fast32_t i = ibegin; i < iend; ++i) {
+          const uint_fast32_t j = i - ibegin;
+          const double dt = cells[i]._dt;
+          // left flux
+          {
+            const double mflux = block_interfaces._mflux[j];
+            const double pflux = block_interfaces._pflux[j];
+            const double Eflux = block_interfaces._Eflux[j];
+
+            cells[i]._m += dt * mflux;
+            cells[i]._p += dt * pflux;
+            cells[i]._E += dt * Eflux;
+
+            // call a special function for flux that crosses the inner outflow
+            // boundary (this currently does not do anything), and record the
+            // flux for the in-situ analysis
+            if (i == 1) {
+              flux_into_inner_mask(dt * mflux);
+              analysis.add_inner_mass_flux(dt * mflux);
+            }
+          }
+          // right flux
+          {
+            const double mflux = block_interfaces._mflux[j + 1];
+            const double pflux = block_interfaces._pflux[j + 1];
+            const double Eflux = block_interfaces._Eflux[j + 1];
+
+            cells[i]._m -= dt * mflux;
+            cells[i]._p -= dt * pflux;
+            cells[i]._E -= dt * Eflux;
+          }
+        }
+
+        // store the predicted primitive variables (including those of the
+        // ghost cells)
+        const uint_fast32_t jbegin = (ibegin == 1) ? 0 : ibegin;
+        const uint_fast32_t jend = (iend == ncell + 1) ? ncell + 2 : iend;
+        for (uint_fast32_t i = jbegin; i < jend; ++i) {
+          const HydroState &state = block_state[i + 1 - ibegin];
+          predicted_primitives[3 * i] = state._rho;
+          predicted_primitives[3 * i + 1] = state._u;
+          predicted_primitives[3 * i + 2] = state._P;
+        }
+      }
+
+#pragma omp for schedule(static)
+      for (uint_fast32_t iblock = 0; iblock < number_of_blocks; ++iblock) {
+        const uint_fast32_t ibegin = 1 + iblock * HYDRO_SWEEP_BLOCK_SIZE;
+        const uint_fast32_t iend = std::min<uint_fast32_t>(
+            ibegin + HYDRO_SWEEP_BLOCK_SIZE, ncell + 1);
+
+        // copy the predicted primitive variables into the cells
+        const uint_fast32_t jbegin = (ibegin == 1) ? 0 : ibegin;
+        const uint_fast32_t jend = (iend == ncell + 1) ? ncell + 2 : iend;
+        for (uint_fast32_t i = jbegin; i < jend; ++i) {
+          cells[i]._rho = predicted_primitives[3 * i];
+          cells[i]._u = predicted_primitives[3 * i + 1];
+          cells[i]._P = predicted_primitives[3 * i + 2];
+        }
+
+        // add the spherical source term
+        // handled by Spherical.hpp
+        for (uint_fast32_t i = ibegin; i < iend; ++i) {
+          add_spherical_source_term_cell(cells[i]);
+        }
+
+        // do the second gravity kick
+        // handled by Potential.hpp
+        for (uint_fast32_t i = ibegin; i < iend; ++i) {
+          do_gravity_cell(cells[i]);
+        }
+      }
+    }
+    phase_timers.stop(PHASE_FUSED_SWEEP);
+#endif
+
+    // stop the step timer, and update guesstimate counters
+    step_time.stop();
+    time_since_last += step_time.value();
+    ++steps_since_last;
+    step_time.reset();
+
+    // update the system time
+    current_integer_time += current_integer_dt;
+    ++number_of_steps;
+
+#if REFINEMENT == REFINEMENT_IONISATION_FRONT
+    // adapt the grid to the current ionisation front and density gradients
+    // handled by Refinement.hpp
+    // if the grid changed, the primitive variables and the gravitational
+    // acceleration need to be updated for the new cells
+    if (number_of_steps % REFINEMENT_INTERVAL == 0) {
+      phase_timers.start(PHASE_REFINEMENT);
+      if (grid_refinement.refine(cells, ionisation_front_radius(),
+                                 transition_width)) {
+#pragma omp parallel for schedule(static)
+        for (uint_fast32_t i = 1; i < ncell + 1; ++i) {
+          cells[i]._rho = cells[i]._m / cells[i]._V;
+          cells[i]._u = cells[i]._p / cells[i]._m;
+          update_pressure(cells[i]);
+          update_gravitational_acceleration(cells[i]);
+        }
+      }
+      phase_timers.stop(PHASE_REFINEMENT);
+    }
+#endif
+
+    // write a checkpoint if the checkpoint interval has passed, or if we
+    // received a SIGTERM signal (in which case we stop after the checkpoint)
+    interrupted = (interrupt_received != 0);
+    if (interrupted ||
+        (CHECKPOINT_INTERVAL_IN_S > 0. &&
+         checkpoint_time.interval() >= CHECKPOINT_INTERVAL_IN_S)) {
+      phase_timers.start(PHASE_CHECKPOINT);
+      start_checkpoint(checkpoint_writer, ncell, ic_file_name,
+                       transition_width, bondi_pressure_contrast, false);
+      checkpoint_writer.write(current_integer_time);
+      checkpoint_writer.write(current_integer_dt);
+      checkpoint_writer.write(isnap);
+      checkpoint_writer.write(number_of_steps);
+      checkpoint_writer.write(min_integer_dt);
+      checkpoint_writer.write(time_since_start);
+      checkpoint_writer.write(time_since_last);
+      checkpoint_writer.write(steps_since_last);
+      checkpoint_writer.write(cells, ncell + 2);
+#if REFINEMENT == REFINEMENT_IONISATION_FRONT
+      grid_refinement.write_checkpoint(checkpoint_writer);
+#endif
+#if TIME_STEPPING == TIME_STEPPING_INDIVIDUAL
+      checkpoint_writer.write(courant_integer_dt);
+      time_bins.write_checkpoint(checkpoint_writer);
+#endif
+#if LOGFILE == LOGFILE_EVENTS
+      logfile.write_checkpoint(checkpoint_writer);
+#endif
+      snapshot_writer.write_checkpoint(checkpoint_writer);
+      ionisation_write_checkpoint(checkpoint_writer);
+      analysis.write_checkpoint(checkpoint_writer);
+      checkpoint_writer.submit();
+      phase_timers.stop(PHASE_CHECKPOINT);
+      checkpoint_time.restart();
+    }
+  }
+
+  /**
+   * @brief Finish the run.
+   *
+   * @return Exit code: 0 on success, 1 if the run was interrupted.
+   */
+  inline int finalize() {
+    if (interrupted) {
+      // make sure the checkpoint is on disk, and leave all output files in a
+      // valid state
+      checkpoint_writer.flush();
+#if LOGFILE == LOGFILE_EVENTS
+      logfile.close_file();
+#endif
+      snapshot_writer.flush();
+      analysis.flush();
+      output << "Run interrupted at time "
+             << current_integer_time * time_conversion_factor
+             << ", use --restart to continue the run." << std::endl;
+    } else {
+#if LOGFILE == LOGFILE_EVENTS
+      // write the final logfile entry
+      logfile.write(cells, current_integer_time * time_conversion_factor, true);
+      // write the log file index and close the log file
+      logfile.close_file();
+#endif
+
+      // write the final analysis record
+      analysis.write_final_record(cells, ncell,
+                                  current_integer_time * time_conversion_factor,
+                                  ionisation_central_mass());
+
+      // write the final snapshots
+      write_snapshot(output, snapshot_writer, isnap,
+                     current_integer_time * time_conversion_factor, cells);
+      // the last snapshot is always a binary snapshot, so that it can be used
+      // as initial condition file
+      snapshot_writer.write_binary_file(
+          "lastsnap.dat", current_integer_time * time_conversion_factor, cells);
+      snapshot_writer.flush();
+
+      // mark the checkpoint as finished, so that a restart does not repeat the
+      // end of the run
+      if (CHECKPOINT_INTERVAL_IN_S > 0. || restart) {
+        start_checkpoint(checkpoint_writer, ncell, ic_file_name,
+                         transition_width, bondi_pressure_contrast, true);
+        checkpoint_writer.submit();
+        checkpoint_writer.flush();
+      }
+    }
+
+    // stop timing the program and display run time information
+    total_time.stop();
+    output << "Total program time: " << total_time.value() << " s."
+           << std::endl;
+    // display the phase timers and write them to a file for further analysis
+    phase_timers.print_summary(output, total_time.value());
+    phase_timers.write_csv(output_prefix + "timers.csv");
+
+    // all went well: return with exit code 0 (unless the run was interrupted)
+    return interrupted ? 1 : 0;
+  }
+
+  /**
+   * @brief Get a view on the given quantity of the cells.
+   *
+   * @param first_value Value of the quantity for the first cell (excluding the
+   * ghost cell).
+   * @param unit_in_si Internal unit of the quantity in SI units.
+   * @return SimulationArray.
+   */
+  inline SimulationArray get_array(const double &first_value,
+                                   const double unit_in_si) const {
+    SimulationArray array;
+    array._data = &first_value;
+    array._size = ncell;
+    array._stride = sizeof(Cell);
+    array._unit_in_si = unit_in_si;
+    return array;
+  }
+};
+
+void Simulation::read_parameter_file(const std::string filename) {
+  runtime_parameters.read_parameter_file(filename);
+}
+
+void Simulation::set_parameter(const std::string name,
+                               const std::string value) {
+  runtime_parameters.set_parameter(name, value);
+}
+
+void Simulation::print_parameters(std::ostream &stream) {
+  runtime_parameters.print_parameters(stream);
+}
+
+SimulationParameters Simulation::get_default_parameters() {
+  // default values are given in Parameters.hpp.in (or the parameter file),
+  // DerivedParameters.hpp and Bondi.hpp
+  SimulationParameters parameters;
+  parameters._ncell = NCELL;
+  parameters._ic_file_name = IC_FILE_NAME;
+  parameters._transition_width = IONISATION_TRANSITION_WIDTH;
+  parameters._bondi_pressure_contrast = BONDI_PRESSURE_CONTRAST;
+  parameters._output_prefix = "";
+  parameters._restart = false;
+  return parameters;
+}
+
+bool Simulation::has_checkpoint(const std::string output_prefix) {
+  return CheckpointReader::exists(output_prefix + CHECKPOINT_FILE_NAME);
+}
+
+void Simulation::interrupt() { interrupt_received = 1; }
+
+bool Simulation::is_interrupted() { return interrupt_received != 0; }
+
+Simulation::Simulation() {}
+
+Simulation::~Simulation() {}
+
+int Simulation::init(const SimulationParameters &parameters,
+                     std::ostream &output,
+                     const std::atomic_int *number_of_threads) {
+
+  // time the run
+  Timer total_time;
+  total_time.start();
+
+  // the per thread buffers are sized for the maximum number of threads, since
+  // the number of threads of an ensemble member can grow during the run
+  const int max_number_of_threads = omp_get_max_threads();
+  set_number_of_threads(number_of_threads, max_number_of_threads);
+
+  // open the checkpoint file (if this is a restart) and make sure it belongs
+  // to this run
+  // the rest of the checkpoint is only read once the run has been initialized
+  std::unique_ptr<CheckpointReader> restart_checkpoint;
+  if (parameters._restart) {
+    restart_checkpoint.reset(new CheckpointReader(
+        parameters._output_prefix + CHECKPOINT_FILE_NAME));
+    if (check_checkpoint(*restart_checkpoint, parameters._ncell,
+                         parameters._ic_file_name,
+                         parameters._transition_width,
+                         parameters._bondi_pressure_contrast)) {
+      output << "Run already finished, nothing to do." << std::endl;
+      _state.reset();
+      return 0;
+    }
+    output << "Restarting from " << parameters._output_prefix
+           << CHECKPOINT_FILE_NAME << std::endl;
+  }
+
+  // pin the threads to CPUs (if requested) before anything is allocated, so
+  // that they stay close to the cells they first touch
+  // the threads of ensemble members are not pinned, since their number changes
+  // during the run
+  std::string thread_placement = "not pinned";
+  if (number_of_threads == nullptr) {
+    thread_placement = pin_threads(THREAD_PINNING);
+  }
+
+  _state.reset(new SimulationState(parameters, output, number_of_threads,
+                                   max_number_of_threads, thread_placement,
+                                   restart_checkpoint, total_time));
+  const int exit_code = _state->setup();
+  if (exit_code != 0) {
+    _state.reset();
+  }
+  return exit_code;
+}
+
+uint_fast64_t Simulation::step(const uint_fast64_t number_of_steps) {
+  uint_fast64_t istep = 0;
+  while (istep < number_of_steps && !is_finished()) {
+    _state->step();
+    ++istep;
+  }
+  return istep;
+}
+
+uint_fast64_t Simulation::advance_to(const double time_in_s) {
+  uint_fast64_t istep = 0;
+  while (!is_finished() && get_time() < time_in_s) {
+    _state->step();
+    ++istep;
+  }
+  return istep;
+}
+
+bool Simulation::is_finished() const {
+  return _state == nullptr || _state->is_finished();
+}
+
+int Simulation::finalize() {
+  if (_state == nullptr) {
+    return 0;
+  }
+  const int exit_code = _state->finalize();
+  _state.reset();
+  return exit_code;
+}
+
+int Simulation::run(const SimulationParameters &parameters,
+                    std::ostream &output,
+                    const std::atomic_int *number_of_threads) {
+  const int exit_code = init(parameters, output, number_of_threads);
+  if (exit_code != 0) {
+    return exit_code;
+  }
+  while (!is_finished()) {
+    step();
+  }
+  return finalize();
+}
+
+double Simulation::get_time() const {
+  return _state->current_integer_time * _state->time_conversion_factor *
+         UNIT_TIME_IN_SI;
+}
+
+uint_fast64_t Simulation::get_number_of_steps() const {
+  return _state->number_of_steps;
+}
+
+size_t Simulation::get_number_of_cells() const { return _state->ncell; }
+
+SimulationArray Simulation::get_radius() const {
+  return _state->get_array(_state->cells[1]._midpoint, UNIT_LENGTH_IN_SI);
+}
+
+SimulationArray Simulation::get_density() const {
+  return _state->get_array(_state->cells[1]._rho, UNIT_DENSITY_IN_SI);
+}
+
+SimulationArray Simulation::get_velocity() const {
+  return _state->get_array(_state->cells[1]._u, UNIT_VELOCITY_IN_SI);
+}
+
+SimulationArray Simulation::get_pressure() const {
+  return _state->get_array(_state->cells[1]._P, UNIT_PRESSURE_IN_SI);
+}
+
+SimulationArray Simulation::get_neutral_fraction() const {
+  return _state->get_array(_state->cells[1]._nfac, 1.);
+}
@@ -0,0 +1,354 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file Simulation.hpp
+ *
+ * @brief Library interface: a simulation that can be advanced step by step.
+ *
+ * This header only depends on the standard library, so that it can be used by
+ * programs that embed the code (e.g. Python bindings) without knowing about the
+ * configuration of the code. The physics modules are selected when configuring
+ * the code and are compiled into the HydroCodeSpherical1DCore library (see
+ * Simulation.cpp).
+ *
+ * A simulation is used as follows:
+ * @code
+ *   Simulation simulation;
+ *   simulation.init(Simulation::get_default_parameters());
+ *   while (!simulation.is_finished()) {
+ *     simulation.step(100);
+ *     const SimulationArray density = simulation.get_density();
+ *     ...
+ *   }
+ *   simulation.finalize();
+ * @endcode
+ *
+ * The run time parameters (see RuntimeParameters.hpp) are shared by all
+ * simulations in the process, and should be set before a simulation is
+ * initialized.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Parameters of a single simulation that are not run time parameters.
+ *
+ * These are the command line arguments of the program, and the parameters of an
+ * ensemble member (see Ensemble.hpp).
+ */
+class SimulationParameters {
+public:
+  /*! @brief Number of cells. */
+  unsigned int _ncell;
+
+  /*! @brief Name of the initial condition file (if IC_FILE was selected when
+   *  configuring the code). */
+  std::string _ic_file_name;
+
+  /*! @brief Width of the linear transition region between ionised and neutral
+   *  region (in internal units of L). */
+  double _transition_width;
+
+  /*! @brief Pressure contrast between ionised and neutral region. */
+  double _bondi_pressure_contrast;
+
+  /*! @brief Prefix for the names of all output files. */
+  std::string _output_prefix;
+
+  /*! @brief Restart the simulation from the checkpoint file with the given
+   *  prefix? */
+  bool _restart;
+};
+
+/**
+ * @brief View on the values of a single quantity for all cells of a
+ * simulation.
+ *
+ * The values are not copied: they are read directly from the cells, which
+ * store all quantities of a cell next to each other. Value i is therefore
+ * located _stride bytes after value i - 1, which corresponds to a NumPy array
+ * with shape (_size,) and strides (_stride,). The view is only valid until the
+ * next call to a function that changes the simulation.
+ */
+class SimulationArray {
+public:
+  /*! @brief Pointer to the value for the first cell. */
+  const double *_data;
+
+  /*! @brief Number of values (the number of cells, without ghost cells). */
+  size_t _size;
+
+  /*! @brief Distance between two consecutive values (in bytes). */
+  size_t _stride;
+
+  /*! @brief Value of the internal unit of the quantity in SI units (the
+   *  values need to be multiplied with this factor to convert them to SI
+   *  units). */
+  double _unit_in_si;
+
+  /**
+   * @brief Get the value for the cell with the given index.
+   *
+   * @param index Index of a cell.
+   * @return Value for that cell (in internal units).
+   */
+  inline double operator[](const size_t index) const {
+    return *reinterpret_cast<const double *>(
+        reinterpret_cast<const char *>(_data) + index * _stride);
+  }
+};
+
+class SimulationState;
+
+/**
+ * @brief Single simulation.
+ *
+ * All output files are written with the output prefix of the simulation, and
+ * all messages are written to the stream given to init(), so that different
+ * simulations can run at the same time within the same process (see
+ * Ensemble.hpp).
+ */
+class Simulation {
+private:
+  /*! @brief State of the simulation (a nullptr before init() and after
+   *  finalize(), or if the simulation was already finished). */
+  std::unique_ptr<SimulationState> _state;
+
+public:
+  /**
+   * @brief Read the given parameter file.
+   *
+   * The parameters in the file overwrite the default values of the run time
+   * parameters (see RuntimeParameters.hpp).
+   *
+   * @param filename Name of the parameter file.
+   */
+  static void read_parameter_file(const std::string filename);
+
+  /**
+   * @brief Set the run time parameter with the given name to the given value.
+   *
+   * Unknown parameter names and invalid values abort the program.
+   *
+   * @param name Name of the parameter.
+   * @param value String representation of the value.
+   */
+  static void set_parameter(const std::string name, const std::string value);
+
+  /**
+   * @brief Print the run time parameters in the parameter file format.
+   *
+   * @param stream std::ostream to write to.
+   */
+  static void print_parameters(std::ostream &stream);
+
+  /**
+   * @brief Get the default parameters for a simulation.
+   *
+   * @return Parameters that use the values of the run time parameters, with
+   * an empty output prefix and without restart.
+   */
+  static SimulationParameters get_default_parameters();
+
+  /**
+   * @brief Does a checkpoint file exist for the given output prefix?
+   *
+   * @param output_prefix Prefix for the names of all output files.
+   * @return True if the checkpoint file exists.
+   */
+  static bool has_checkpoint(const std::string output_prefix);
+
+  /**
+   * @brief Interrupt all running simulations.
+   *
+   * Running simulations write a checkpoint at the end of their current step
+   * and then stop. This function can be called from a signal handler.
+   */
+  static void interrupt();
+
+  /**
+   * @brief Was interrupt() called?
+   *
+   * @return True if the simulations were interrupted.
+   */
+  static bool is_interrupted();
+
+  /**
+   * @brief Constructor.
+   *
+   * The simulation is set up by init().
+   */
+  Simulation();
+
+  /**
+   * @brief Destructor.
+   *
+   * Frees the memory used by the simulation and closes all output files.
+   */
+  ~Simulation();
+
+  /**
+   * @brief Set up the simulation: create the grid and the initial condition,
+   * or restore the simulation from its checkpoint file.
+   *
+   * If the simulation is restarted from the checkpoint written at the end of a
+   * finished run, there is nothing to set up, and is_finished() returns true.
+   *
+   * @param parameters Parameters of the simulation.
+   * @param output std::ostream to write messages to.
+   * @param number_of_threads Number of threads to use (can change during the
+   * run). If this is a nullptr, the default OpenMP number of threads is used,
+   * and the threads are pinned as requested by the run time parameters.
+   * @return Exit code: 0 on success, 1 if the initial condition file could not
+   * be found.
+   */
+  int init(const SimulationParameters &parameters,
+           std::ostream &output = std::cout,
+           const std::atomic_int *number_of_threads = nullptr);
+
+  /**
+   * @brief Do the given number of steps.
+   *
+   * Fewer steps are done if the simulation finishes or is interrupted.
+   *
+   * @param number_of_steps Number of steps to do.
+   * @return Number of steps that were done.
+   */
+  uint_fast64_t step(const uint_fast64_t number_of_steps = 1);
+
+  /**
+   * @brief Do steps until the simulation time reaches the given time.
+   *
+   * The simulation time after the last step can be larger than the given
+   * time, since the time steps are not adapted.
+   *
+   * @param time_in_s Time to reach (in s).
+   * @return Number of steps that were done.
+   */
+  uint_fast64_t advance_to(const double time_in_s);
+
+  /**
+   * @brief Is the simulation finished?
+   *
+   * @return True if the end of the simulation time or the maximum number of
+   * steps was reached, or if the simulation was interrupted.
+   */
+  bool is_finished() const;
+
+  /**
+   * @brief Finish the simulation.
+   *
+   * If the simulation was interrupted, this makes sure the checkpoint is
+   * written. Otherwise, this writes the final snapshots and log file entries.
+   * The run time information is written to the output stream, and all memory
+   * is freed.
+   *
+   * @return Exit code: 0 on success, 1 if the simulation was interrupted.
+   */
+  int finalize();
+
+  /**
+   * @brief Run the complete simulation.
+   *
+   * @param parameters Parameters of the simulation.
+   * @param output std::ostream to write messages to.
+   * @param number_of_threads Number of threads to use (see init()).
+   * @return Exit code: 0 on success, 1 if the initial condition file could not
+   * be found or if the simulation was interrupted.
+   */
+  int run(const SimulationParameters &parameters,
+          std::ostream &output = std::cout,
+          const std::atomic_int *number_of_threads = nullptr);
+
+  /**
+   * @brief Get the current simulation time.
+   *
+   * @return Current simulation time (in s).
+   */
+  double get_time() const;
+
+  /**
+   * @brief Get the number of steps that were done.
+   *
+   * @return Number of steps (including the steps before a restart).
+   */
+  uint_fast64_t get_number_of_steps() const;
+
+  /**
+   * @brief Get the number of cells.
+   *
+   * @return Number of cells (without ghost cells).
+   */
+  size_t get_number_of_cells() const;
+
+  /**
+   * @brief Get the midpoint radius of the cells.
+   *
+   * @return SimulationArray with the midpoints (in internal units of L).
+   */
+  SimulationArray get_radius() const;
+
+  /**
+   * @brief Get the density of the cells.
+   *
+   * The primitive variables are those the hydro scheme works with: after a
+   * step, they are predicted to the middle of that step (the primitive
+   * variables at the current time are computed at the start of the next step,
+   * and are the ones written to the snapshots).
+   *
+   * @return SimulationArray with the densities (in internal units).
+   */
+  SimulationArray get_density() const;
+
+  /**
+   * @brief Get the fluid velocity of the cells.
+   *
+   * See get_density() for the time at which the velocity is given.
+   *
+   * @return SimulationArray with the velocities (in internal units).
+   */
+  SimulationArray get_velocity() const;
+
+  /**
+   * @brief Get the pressure of the cells.
+   *
+   * See get_density() for the time at which the pressure is given.
+   *
+   * @return SimulationArray with the pressures (in internal units).
+   */
+  SimulationArray get_pressure() const;
+
+  /**
+   * @brief Get the neutral fraction of the cells.
+   *
+   * @return SimulationArray with the neutral fractions (without unit).
+   */
+  SimulationArray get_neutral_fraction() const;
+};
+
+#endif // SIMULATION_HPP
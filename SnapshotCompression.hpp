@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file SnapshotCompression.hpp
+ *
+ * @brief Compression of blocks of doubles for the snapshot files.
+ *
+ * A block of n doubles is compressed in three steps:
+ *  - (optional) the mantissa of every value is rounded to the smallest number
+ *    of bits that guarantees the requested maximum relative error
+ *    (SNAPSHOT_COMPRESSION_LOSSY, only used for the density and pressure)
+ *  - the bytes are shuffled: the first bytes of all n values are stored first,
+ *    followed by all second bytes, and so on. The exponent and high mantissa
+ *    bytes of neighbouring cells are very similar, so that this creates long
+ *    runs of (nearly) identical bytes. Rounded mantissas produce blocks that
+ *    only contain zeros.
+ *  - the shuffled bytes are compressed with deflate (zlib, fastest level)
+ * Every block is compressed on its own, so that it can be decompressed without
+ * reading any other block. The compressed blocks can be decompressed with the
+ * zlib module of the Python standard library (see read_snapshot.py).
+ *
+ * This is only available if the code is configured with snapshot compression,
+ * since it needs zlib.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef SNAPSHOTCOMPRESSION_HPP
+#define SNAPSHOTCOMPRESSION_HPP
+
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+
+#if SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_NONE
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <zlib.h>
+
+/*! @brief Number of mantissa bits in a double. */
+#define SNAPSHOTCOMPRESSION_MANTISSA_BITS 52
+
+/**
+ * @brief Compressor for blocks of doubles.
+ *
+ * The compressor keeps its work buffers in between calls, so that a single
+ * compressor should only be used by a single thread.
+ */
+class SnapshotCompressor {
+private:
+  /*! @brief Work buffer containing the rounded values. */
+  std::vector<double> _rounded;
+
+  /*! @brief Work buffer containing the shuffled bytes. */
+  std::vector<unsigned char> _shuffled;
+
+  /**
+   * @brief Get the number of mantissa bits that need to be kept to guarantee
+   * the given maximum relative error.
+   *
+   * Rounding to nbit mantissa bits gives a relative error of at most
+   * 2^-(nbit + 1).
+   *
+   * @param tolerance Maximum relative error (0 means lossless).
+   * @return Number of mantissa bits to keep.
+   */
+  inline static unsigned int get_mantissa_bits(const double tolerance) {
+    if (!(tolerance > 0.)) {
+      return SNAPSHOTCOMPRESSION_MANTISSA_BITS;
+    }
+    const int nbit = static_cast<int>(std::ceil(-std::log2(tolerance))) - 1;
+    if (nbit < 0) {
+      return 0;
+    }
+    if (nbit > SNAPSHOTCOMPRESSION_MANTISSA_BITS) {
+      return SNAPSHOTCOMPRESSION_MANTISSA_BITS;
+    }
+    return nbit;
+  }
+
+public:
+  /**
+   * @brief Get the actual maximum relative error for the given tolerance.
+   *
+   * @param tolerance Requested maximum relative error (0 means lossless).
+   * @return Maximum relative error that is guaranteed by the rounding (0 if no
+   * rounding is done).
+   */
+  inline static double get_error_bound(const double tolerance) {
+    const unsigned int nbit = get_mantissa_bits(tolerance);
+    if (nbit == SNAPSHOTCOMPRESSION_MANTISSA_BITS) {
+      return 0.;
+    }
+    return std::ldexp(1., -static_cast<int>(nbit) - 1);
+  }
+
+  /**
+   * @brief Compress the given block of values.
+   *
+   * @param values Values to compress.
+   * @param size Number of values.
+   * @param tolerance Maximum relative error in the values (0 means lossless).
+   * @param output Output buffer, is resized to the compressed size.
+   */
+  inline void compress(const double *values, const size_t size,
+                       const double tolerance,
+                       std::vector<unsigned char> &output) {
+    const unsigned int nbit = get_mantissa_bits(tolerance);
+    if (nbit < SNAPSHOTCOMPRESSION_MANTISSA_BITS) {
+      // round half up in the last kept bit; a carry into the exponent gives
+      // the correctly rounded next power of two
+      const uint64_t half = uint64_t(1)
+                            << (SNAPSHOTCOMPRESSION_MANTISSA_BITS - nbit - 1);
+      const uint64_t mask =
+          ~((uint64_t(1) << (SNAPSHOTCOMPRESSION_MANTISSA_BITS - nbit)) - 1);
+      const uint64_t exponent_mask = uint64_t(0x7ff)
+                                     << SNAPSHOTCOMPRESSION_MANTISSA_BITS;
+      _rounded.resize(size);
+      for (size_t i = 0; i < size; ++i) {
+        uint64_t bits;
+        std::memcpy(&bits, &values[i], sizeof(double));
+        // infinities and NaNs are kept as they are
+        if ((bits & exponent_mask) != exponent_mask) {
+          bits = (bits + half) & mask;
+        }
+        std::memcpy(&_rounded[i], &bits, sizeof(double));
+      }
+      values = &_rounded[0];
+    }
+
+    _shuffled.resize(size * sizeof(double));
+    const unsigned char *bytes =
+        reinterpret_cast<const unsigned char *>(values);
+    for (size_t ibyte = 0; ibyte < sizeof(double); ++ibyte) {
+      unsigned char *shuffled = &_shuffled[ibyte * size];
+      for (size_t i = 0; i < size; ++i) {
+        shuffled[i] = bytes[i * sizeof(double) + ibyte];
+      }
+    }
+
+    uLongf compressed_size = compressBound(_shuffled.size());
+    output.resize(compressed_size);
+    if (compress2(&output[0], &compressed_size, &_shuffled[0],
+                  _shuffled.size(), Z_BEST_SPEED) != Z_OK) {
+      std::cerr << "Error compressing snapshot data!" << std::endl;
+      abort();
+    }
+    output.resize(compressed_size);
+  }
+
+  /**
+   * @brief Decompress the given compressed block.
+   *
+   * @param data Compressed block.
+   * @param compressed_size Size of the compressed block (in bytes).
+   * @param size Number of values in the block.
+   * @param values Output array (of at least size values).
+   * @return True if the block was decompressed successfully, false if it is
+   * corrupt or does not contain size values.
+   */
+  inline bool decompress(const char *data, const size_t compressed_size,
+                         const size_t size, double *values) {
+    _shuffled.resize(size * sizeof(double));
+    uLongf uncompressed_size = _shuffled.size();
+    if (uncompress(&_shuffled[0], &uncompressed_size,
+                   reinterpret_cast<const Bytef *>(data),
+                   compressed_size) != Z_OK ||
+        uncompressed_size != _shuffled.size()) {
+      return false;
+    }
+    unsigned char *bytes = reinterpret_cast<unsigned char *>(values);
+    for (size_t ibyte = 0; ibyte < sizeof(double); ++ibyte) {
+      const unsigned char *shuffled = &_shuffled[ibyte * size];
+      for (size_t i = 0; i < size; ++i) {
+        bytes[i * sizeof(double) + ibyte] = shuffled[i];
+      }
+    }
+    return true;
+  }
+};
+
+#endif // SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_NONE
+
+#endif // SNAPSHOTCOMPRESSION_HPP
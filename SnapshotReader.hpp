@@ -0,0 +1,346 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file SnapshotReader.hpp
+ *
+ * @brief Memory-mapped reader for binary snapshot files.
+ *
+ * Reads files in the binary snapshot format written by SnapshotWriter (see
+ * SnapshotWriter.hpp for the layout). The header is validated, and the file
+ * size has to match the number of fields and cells in the header, so that a
+ * truncated file is detected before any values are read.
+ *
+ * Compressed snapshot files (format version 2) are decompressed into memory
+ * when they are opened. This is only possible if the code is configured with
+ * snapshot compression.
+ *
+ * For backwards compatibility, files without a header are interpreted as the
+ * old lastsnap.dat format: 4 doubles per cell (density, velocity, pressure and
+ * gravitational acceleration, in internal units), for a number of cells that
+ * follows from the file size.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef SNAPSHOTREADER_HPP
+#define SNAPSHOTREADER_HPP
+
+#include "SnapshotWriter.hpp" // binary snapshot format
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/*! @brief Number of fields in an old format file without header. */
+#define SNAPSHOTREADER_LEGACY_NUMBER_OF_FIELDS 4
+
+/**
+ * @brief Memory-mapped reader for binary snapshot files.
+ */
+class SnapshotReader {
+private:
+  /*! @brief Name of the file. */
+  const std::string _filename;
+
+  /*! @brief Size of the file (in bytes). */
+  size_t _size;
+
+  /*! @brief Memory-mapped file contents (nullptr if the file could not be
+   *  opened). */
+  const char *_data;
+
+  /*! @brief Is this an old format file without header? */
+  bool _legacy;
+
+  /*! @brief Number of cells in the file. */
+  uint_fast64_t _ncell;
+
+  /*! @brief Simulation time of the snapshot (in s; 0 for old format files). */
+  double _time;
+
+  /*! @brief Names of the fields. */
+  std::vector<std::string> _names;
+
+  /*! @brief SI units of the fields (empty for old format files, which use
+   *  internal units). */
+  std::vector<std::string> _units;
+
+  /*! @brief Start of the field values. */
+  const double *_values;
+
+  /*! @brief Decompressed field values (for compressed files). */
+  std::vector<double> _decompressed;
+
+  /**
+   * @brief Abort with an error message about the file.
+   *
+   * @param message Error message.
+   */
+  inline void error(const std::string message) const {
+    std::cerr << "Invalid snapshot file \"" << _filename << "\": " << message
+              << "!" << std::endl;
+    abort();
+  }
+
+  /**
+   * @brief Read a value from the header.
+   *
+   * @param offset Offset of the value in the file, is moved past the value.
+   * @return Value.
+   */
+  template <typename _datatype_>
+  inline _datatype_ read_header_value(size_t &offset) const {
+    if (offset + sizeof(_datatype_) > _size) {
+      error("header is truncated");
+    }
+    _datatype_ value;
+    std::memcpy(&value, _data + offset, sizeof(_datatype_));
+    offset += sizeof(_datatype_);
+    return value;
+  }
+
+  /**
+   * @brief Read a zero padded name or unit from the header.
+   *
+   * @param offset Offset of the name in the file, is moved past the name.
+   * @return Name.
+   */
+  inline std::string read_header_name(size_t &offset) const {
+    if (offset + SNAPSHOTWRITER_NAME_LENGTH > _size) {
+      error("header is truncated");
+    }
+    const char *name = _data + offset;
+    offset += SNAPSHOTWRITER_NAME_LENGTH;
+    return std::string(name, strnlen(name, SNAPSHOTWRITER_NAME_LENGTH));
+  }
+
+  /**
+   * @brief Decompress the fields of a compressed snapshot file.
+   *
+   * @param nfield Number of fields.
+   * @param offset Offset of the table with the compressed sizes in the file.
+   */
+  inline void read_compressed_values(const uint_fast32_t nfield,
+                                     size_t offset) {
+#if SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_NONE
+    std::vector<uint64_t> sizes(nfield);
+    for (uint_fast32_t ifield = 0; ifield < nfield; ++ifield) {
+      sizes[ifield] = read_header_value<uint64_t>(offset);
+      // the maximum relative error is not needed to read the values
+      read_header_value<double>(offset);
+    }
+    size_t file_size = offset;
+    for (uint_fast32_t ifield = 0; ifield < nfield; ++ifield) {
+      file_size += sizes[ifield];
+    }
+    if (_size != file_size) {
+      error("file size does not match the compressed sizes in the header");
+    }
+    SnapshotCompressor compressor;
+    _decompressed.resize(nfield * _ncell);
+    for (uint_fast32_t ifield = 0; ifield < nfield; ++ifield) {
+      if (!compressor.decompress(_data + offset, sizes[ifield], _ncell,
+                                 &_decompressed[ifield * _ncell])) {
+        error("unable to decompress field " + _names[ifield]);
+      }
+      offset += sizes[ifield];
+    }
+    _values = &_decompressed[0];
+#else
+    (void)nfield;
+    (void)offset;
+    error("compressed snapshot files can only be read if the code is "
+          "configured with snapshot compression");
+#endif
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * If the file does not exist, is_open() returns false. Files that exist but
+   * are not valid snapshot files abort the program.
+   *
+   * @param filename Name of the file.
+   */
+  inline SnapshotReader(const std::string filename)
+      : _filename(filename), _size(0), _data(nullptr), _legacy(false),
+        _ncell(0), _time(0.), _values(nullptr) {
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+      close(fd);
+      return;
+    }
+    _size = file_stat.st_size;
+    if (_size == 0) {
+      close(fd);
+      error("file is empty");
+    }
+    void *data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping remains valid after the file is closed
+    close(fd);
+    if (data == MAP_FAILED) {
+      error("unable to map file into memory");
+    }
+    _data = static_cast<const char *>(data);
+
+    if (_size >= 8 && std::strncmp(_data, "HCS1DSNP", 8) == 0) {
+      size_t offset = 8;
+      const uint32_t version = read_header_value<uint32_t>(offset);
+      if (version != SNAPSHOTWRITER_BINARY_VERSION &&
+          version != SNAPSHOTWRITER_COMPRESSED_VERSION) {
+        error("unknown version " + std::to_string(version));
+      }
+      const uint32_t nfield = read_header_value<uint32_t>(offset);
+      _ncell = read_header_value<uint64_t>(offset);
+      _time = read_header_value<double>(offset);
+      for (uint_fast32_t ifield = 0; ifield < nfield; ++ifield) {
+        _names.push_back(read_header_name(offset));
+        _units.push_back(read_header_name(offset));
+      }
+      if (version == SNAPSHOTWRITER_COMPRESSED_VERSION) {
+        read_compressed_values(nfield, offset);
+      } else {
+        if (_size != offset + nfield * _ncell * sizeof(double)) {
+          error("file size does not match the " + std::to_string(_ncell) +
+                " cells in the header");
+        }
+        _values = reinterpret_cast<const double *>(_data + offset);
+      }
+    } else if (_size >= 8 && std::strncmp(_data, "HCS1DCNT", 8) == 0) {
+      error("snapshot container files cannot be read directly, convert the "
+            "snapshot to a binary snapshot file first");
+    } else {
+      _legacy = true;
+      const size_t cell_size =
+          SNAPSHOTREADER_LEGACY_NUMBER_OF_FIELDS * sizeof(double);
+      if (_size % cell_size != 0) {
+        error("file without header has a size that is not a multiple of " +
+              std::to_string(cell_size) + " bytes");
+      }
+      _ncell = _size / cell_size;
+      _names.push_back("density");
+      _names.push_back("velocity");
+      _names.push_back("pressure");
+      _names.push_back("acceleration");
+      _units.resize(SNAPSHOTREADER_LEGACY_NUMBER_OF_FIELDS);
+      _values = reinterpret_cast<const double *>(_data);
+    }
+  }
+
+  /**
+   * @brief Destructor.
+   *
+   * Unmaps the file.
+   */
+  inline ~SnapshotReader() {
+    if (_data != nullptr) {
+      munmap(const_cast<char *>(_data), _size);
+    }
+  }
+
+  /**
+   * @brief Was the file opened successfully?
+   *
+   * @return True if the file exists.
+   */
+  inline bool is_open() const { return _data != nullptr; }
+
+  /**
+   * @brief Get the name of the file.
+   *
+   * @return Name of the file.
+   */
+  inline const std::string &get_filename() const { return _filename; }
+
+  /**
+   * @brief Is this an old format file without header (with values in internal
+   * units)?
+   *
+   * @return True for old format files.
+   */
+  inline bool is_legacy() const { return _legacy; }
+
+  /**
+   * @brief Get the number of cells in the file.
+   *
+   * @return Number of cells.
+   */
+  inline uint_fast64_t get_ncell() const { return _ncell; }
+
+  /**
+   * @brief Get the simulation time of the snapshot.
+   *
+   * @return Simulation time (in s).
+   */
+  inline double get_time() const { return _time; }
+
+  /**
+   * @brief Get the index of the field with the given name.
+   *
+   * @param name Name of the field.
+   * @return Index of the field, or -1 if the file does not contain the field.
+   */
+  inline int get_field_index(const std::string name) const {
+    for (uint_fast32_t ifield = 0; ifield < _names.size(); ++ifield) {
+      if (_names[ifield] == name) {
+        return ifield;
+      }
+    }
+    return -1;
+  }
+
+  /**
+   * @brief Get the SI unit of the field with the given index.
+   *
+   * @param ifield Index of the field.
+   * @return SI unit (empty for old format files).
+   */
+  inline const std::string &get_unit(const int ifield) const {
+    return _units[ifield];
+  }
+
+  /**
+   * @brief Get the value of the given field in the given cell.
+   *
+   * @param ifield Index of the field.
+   * @param i Index of the cell (in the range [0, get_ncell()[).
+   * @return Value (in SI units, or in internal units for old format files).
+   */
+  inline double get_value(const int ifield, const uint_fast64_t i) const {
+    if (_legacy) {
+      return _values[SNAPSHOTREADER_LEGACY_NUMBER_OF_FIELDS * i + ifield];
+    } else {
+      return _values[ifield * _ncell + i];
+    }
+  }
+};
+
+#endif // SNAPSHOTREADER_HPP
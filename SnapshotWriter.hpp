@@ -0,0 +1,880 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file SnapshotWriter.hpp
+ *
+ * @brief Asynchronous snapshot writer.
+ *
+ * The primitive variables are copied into one of two buffers, and are written
+ * to disk by a background thread, so that the main simulation loop does not
+ * need to wait for the disk.
+ *
+ * Depending on the configuration option SNAPSHOT_TYPE, snapshots are written
+ * as text files (SNAPSHOT_TYPE_TEXT, snapshot_XXXX.txt, identical to the old
+ * text output), as binary files (SNAPSHOT_TYPE_BINARY, snapshot_XXXX.dat), or
+ * are all appended to a single container file (SNAPSHOT_TYPE_CONTAINER,
+ * snapshots.dat).
+ *
+ * The binary files have the following layout (all values in native byte
+ * order):
+ *  - 8 characters: "HCS1DSNP"
+ *  - uint32: format version (currently 1)
+ *  - uint32: number of fields, nfield
+ *  - uint64: number of cells, ncell
+ *  - double: simulation time (in s)
+ *  - nfield times: 32 character field name and 32 character SI unit, both
+ *    padded with zeros
+ *  - nfield times: ncell doubles containing the field values (in SI units)
+ * The fields are the same as the columns of the text files: radius, density,
+ * velocity, pressure and neutral fraction. The final snapshot lastsnap.dat
+ * always uses this format, and binary snapshot files can be used as initial
+ * condition files (see SnapshotReader.hpp and ICFile.hpp).
+ *
+ * The container file has the following layout:
+ *  - 8 characters: "HCS1DCNT"
+ *  - uint32: format version (currently 1)
+ *  - uint32: number of fields, nfield
+ *  - uint64: number of cells, ncell
+ *  - nfield times: 32 character field name and 32 character SI unit
+ *  - the data chunks, in the order in which they were written:
+ *     - snapshot chunks: nfield times ncell doubles (one contiguous block per
+ *       field, so that a single field can be read without reading the others)
+ *     - ionisation radius chunks (if SNAPSHOT_CONTAINER_IONISATION_RADIUS is
+ *       set): records of 3 doubles, with the same contents as the records in
+ *       ionisation_radius.dat (time, ionisation radius and luminosity, in SI
+ *       units)
+ *  - snapshot index: for every snapshot, a double containing the time (in s)
+ *    and a uint64 containing the file offset of its chunk
+ *  - ionisation radius index: for every ionisation radius chunk, a uint64 file
+ *    offset and a uint64 number of records
+ *  - footer: uint64 number of snapshots, uint64 snapshot index offset, uint64
+ *    number of ionisation radius chunks, uint64 ionisation radius index offset
+ *    and the 8 characters "HCS1DEND"
+ * New chunks are written over the old index, after which the index and footer
+ * are written again, so that the file is a valid container after every
+ * snapshot.
+ *
+ * If the code is configured with SNAPSHOT_COMPRESSION_LOSSLESS or
+ * SNAPSHOT_COMPRESSION_LOSSY, every field of every snapshot is compressed as a
+ * separate block (see SnapshotCompression.hpp) by the background thread, and
+ * the binary files and the container use format version 2:
+ *  - binary files: the same header as version 1, followed by nfield times a
+ *    uint64 compressed size (in bytes) and a double maximum relative error (0
+ *    for lossless compression), followed by the nfield compressed blocks
+ *  - container: the same header as version 1, snapshot chunks contain the same
+ *    compressed size and error table and compressed blocks as the binary
+ *    files, and ionisation radius chunks contain a uint64 compressed size and a
+ *    compressed block with all times, followed by all ionisation radii and all
+ *    luminosities of the records in the chunk
+ * With SNAPSHOT_COMPRESSION_LOSSY, the density and pressure are rounded to a
+ * maximum relative error SNAPSHOT_COMPRESSION_TOLERANCE; all other fields are
+ * always compressed losslessly. lastsnap.dat is never compressed.
+ *
+ * The ionisation radius log is then also compressed, unless it is stored in the
+ * container. The records are handed to the writer and are written together with
+ * the next snapshot, as a compressed chunk in ionisation_radius.dat:
+ *  - 8 characters: "HCS1DRAD"
+ *  - uint32: format version (currently 1)
+ *  - uint32: number of values per record (3)
+ *  - the chunks: a uint64 number of records, a uint64 compressed size and a
+ *    compressed block with the values of the records (in the same order as in
+ *    the container)
+ *
+ * read_snapshot.py contains a Python reader for all formats.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef SNAPSHOTWRITER_HPP
+#define SNAPSHOTWRITER_HPP
+
+#include "Cell.hpp"
+#include "Checkpoint.hpp"
+#include "MemoryArena.hpp"
+#include "SafeParameters.hpp"
+#include "SnapshotCompression.hpp"
+#include "ThreadPlacement.hpp"
+#include "Units.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/*! @brief Number of fields in a snapshot. */
+#define SNAPSHOTWRITER_NUMBER_OF_FIELDS 5
+
+/*! @brief Version of the (uncompressed) binary snapshot format. */
+#define SNAPSHOTWRITER_BINARY_VERSION 1
+
+/*! @brief Version of the compressed binary snapshot format. */
+#define SNAPSHOTWRITER_COMPRESSED_VERSION 2
+
+/*! @brief Version of the snapshot files and container written by the writer. */
+#if SNAPSHOT_COMPRESSION == SNAPSHOT_COMPRESSION_NONE
+#define SNAPSHOTWRITER_VERSION SNAPSHOTWRITER_BINARY_VERSION
+#else
+#define SNAPSHOTWRITER_VERSION SNAPSHOTWRITER_COMPRESSED_VERSION
+#endif
+
+/*! @brief Length of the field names and units in the binary snapshot header. */
+#define SNAPSHOTWRITER_NAME_LENGTH 32
+
+/*! @brief Name of the snapshot container file (if SNAPSHOT_TYPE_CONTAINER is
+ *  selected). */
+#define SNAPSHOTWRITER_CONTAINER_NAME "snapshots.dat"
+
+/*! @brief Name of the compressed ionisation radius log file. */
+#define SNAPSHOTWRITER_RADIUS_FILE_NAME "ionisation_radius.dat"
+
+/*! @brief Version of the compressed ionisation radius log format. */
+#define SNAPSHOTWRITER_RADIUS_FILE_VERSION 1
+
+/*! @brief Does the writer store the ionisation radius log in a compressed
+ *  ionisation_radius.dat (1) or not (0)? */
+#if SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_NONE &&                       \
+    !(SNAPSHOT_TYPE == SNAPSHOT_TYPE_CONTAINER &&                              \
+      SNAPSHOT_CONTAINER_IONISATION_RADIUS == 1)
+#define SNAPSHOTWRITER_RADIUS_FILE 1
+#else
+#define SNAPSHOTWRITER_RADIUS_FILE 0
+#endif
+
+/**
+ * @brief Asynchronous snapshot writer.
+ */
+class SnapshotWriter {
+private:
+  /*! @brief Number of cells. */
+  const unsigned int _ncell;
+
+  /*! @brief Prefix for the names of all output files. */
+  const std::string _prefix;
+
+  /*! @brief Maximum relative error in the density and pressure (if
+   *  SNAPSHOT_COMPRESSION_LOSSY is selected). */
+  const double _compression_tolerance;
+
+  /*! @brief Field buffers: SNAPSHOTWRITER_NUMBER_OF_FIELDS arrays of _ncell
+   *  values each (part of the memory arena of the simulation). */
+  double *_buffer[2];
+
+  /*! @brief Snapshot index of the snapshot in each buffer. */
+  uint_fast64_t _isnap[2];
+
+  /*! @brief Simulation time of the snapshot in each buffer (in s). */
+  double _time[2];
+
+  /*! @brief Flags signalling whether a buffer contains a snapshot (if not, it
+   *  only contains ionisation radius records). */
+  bool _has_snapshot[2];
+
+  /*! @brief Ionisation radius records that are written together with each
+   *  buffer (3 values per record). */
+  std::vector<double> _records[2];
+
+  /*! @brief Ionisation radius records added since the last snapshot. */
+  std::vector<double> _new_records;
+
+  /*! @brief Flags signalling whether a buffer still needs to be written. */
+  bool _pending[2];
+
+  /*! @brief Buffer that will be filled next. */
+  unsigned char _next_fill;
+
+  /*! @brief Buffer that will be written next. */
+  unsigned char _next_write;
+
+  /*! @brief Flag signalling the background thread to stop. */
+  bool _stop;
+
+  /*! @brief Lock protecting the buffer flags. */
+  std::mutex _mutex;
+
+  /*! @brief Condition used to signal changes in the buffer flags. */
+  std::condition_variable _condition;
+
+  /*! @brief Background I/O thread. */
+  std::thread _thread;
+
+  /*! @brief Container file (if SNAPSHOT_TYPE_CONTAINER is selected). */
+  std::ofstream _container;
+
+  /*! @brief Offset of the end of the last data chunk in the container file. */
+  uint64_t _container_end;
+
+  /*! @brief Times of the snapshots in the container file (in s). */
+  std::vector<double> _index_time;
+
+  /*! @brief Offsets of the snapshots in the container file. */
+  std::vector<uint64_t> _index_offset;
+
+  /*! @brief Offsets of the ionisation radius chunks in the container file. */
+  std::vector<uint64_t> _radius_offset;
+
+  /*! @brief Number of records in the ionisation radius chunks in the container
+   *  file. */
+  std::vector<uint64_t> _radius_size;
+
+  /*! @brief Compressed ionisation radius log file (if
+   *  SNAPSHOTWRITER_RADIUS_FILE is set; opened when the first chunk is
+   *  written). */
+  std::ofstream _radius_file;
+
+  /*! @brief Offset of the end of the last chunk in the compressed ionisation
+   *  radius log file (0 if the file was not created yet). */
+  uint64_t _radius_file_end;
+
+#if SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_NONE
+  /*! @brief Compressor (only used by the background thread). */
+  SnapshotCompressor _compressor;
+
+  /*! @brief Compressed blocks of the fields of the snapshot that is written. */
+  std::vector<unsigned char> _compressed[SNAPSHOTWRITER_NUMBER_OF_FIELDS];
+
+  /*! @brief Ionisation radius records that are written, reordered per value. */
+  std::vector<double> _record_values;
+#endif
+
+  /**
+   * @brief Copy the snapshot fields of the given cells into the given buffer.
+   *
+   * @param buffer Field buffer (SNAPSHOTWRITER_NUMBER_OF_FIELDS times _ncell
+   * values).
+   * @param cells Cells.
+   */
+  inline void fill_buffer(double *buffer, const Cell *cells) const {
+    const unsigned int ncell = _ncell;
+#pragma omp parallel for schedule(static)
+    for (unsigned int i = 0; i < ncell; ++i) {
+      const Cell &cell = cells[i + 1];
+      buffer[i] = cell._midpoint * UNIT_LENGTH_IN_SI;
+      buffer[ncell + i] = cell._rho * UNIT_DENSITY_IN_SI;
+      buffer[2 * ncell + i] = cell._u * UNIT_VELOCITY_IN_SI;
+      buffer[3 * ncell + i] = cell._P * UNIT_PRESSURE_IN_SI;
+      buffer[4 * ncell + i] = cell._nfac;
+    }
+  }
+
+  /**
+   * @brief Write the given buffer as a text file.
+   *
+   * @param filename Name of the file.
+   * @param time Simulation time (in s).
+   * @param buffer Field buffer.
+   */
+  inline void write_text(const std::string filename, const double time,
+                         const double *buffer) const {
+    std::ofstream ofile(filename.c_str());
+    ofile << "# time: " << time << "\n";
+    for (unsigned int i = 0; i < _ncell; ++i) {
+      ofile << buffer[i] << "\t" << buffer[_ncell + i] << "\t"
+            << buffer[2 * _ncell + i] << "\t" << buffer[3 * _ncell + i] << "\t"
+            << buffer[4 * _ncell + i] << "\n";
+    }
+    ofile.close();
+  }
+
+  /**
+   * @brief Write a string to the given file, padded with zeros to
+   * SNAPSHOTWRITER_NAME_LENGTH characters.
+   *
+   * @param ofile File to write to.
+   * @param value String to write.
+   */
+  inline static void write_name(std::ofstream &ofile, const char *value) {
+    char name[SNAPSHOTWRITER_NAME_LENGTH];
+    std::memset(name, 0, SNAPSHOTWRITER_NAME_LENGTH);
+    std::strncpy(name, value, SNAPSHOTWRITER_NAME_LENGTH - 1);
+    ofile.write(name, SNAPSHOTWRITER_NAME_LENGTH);
+  }
+
+  /**
+   * @brief Write a single value to the given binary file.
+   *
+   * @param ofile File to write to.
+   * @param value Value to write.
+   */
+  template <typename _datatype_>
+  inline static void write_value(std::ofstream &ofile, const _datatype_ value) {
+    ofile.write(reinterpret_cast<const char *>(&value), sizeof(_datatype_));
+  }
+
+  /**
+   * @brief Write the version, the number of fields and cells, and the field
+   * names and units to the given binary file.
+   *
+   * @param ofile File to write to.
+   * @param time Simulation time to write in between the number of cells and the
+   * field names (in s), or nullptr if no time should be written.
+   * @param version Format version.
+   */
+  inline void write_header(std::ofstream &ofile, const double *time,
+                           const uint32_t version) const {
+    static const char *field_names[SNAPSHOTWRITER_NUMBER_OF_FIELDS] = {
+        "radius", "density", "velocity", "pressure", "neutral_fraction"};
+    static const char *field_units[SNAPSHOTWRITER_NUMBER_OF_FIELDS] = {
+        "m", "kg m^-3", "m s^-1", "kg m^-1 s^-2", ""};
+
+    write_value<uint32_t>(ofile, version);
+    write_value<uint32_t>(ofile, SNAPSHOTWRITER_NUMBER_OF_FIELDS);
+    write_value<uint64_t>(ofile, _ncell);
+    if (time != nullptr) {
+      write_value<double>(ofile, *time);
+    }
+    for (uint_fast32_t ifield = 0; ifield < SNAPSHOTWRITER_NUMBER_OF_FIELDS;
+         ++ifield) {
+      write_name(ofile, field_names[ifield]);
+      write_name(ofile, field_units[ifield]);
+    }
+  }
+
+  /**
+   * @brief Write the given buffer as a binary file.
+   *
+   * @param filename Name of the file.
+   * @param time Simulation time (in s).
+   * @param buffer Field buffer.
+   */
+  inline void write_binary(const std::string filename, const double time,
+                           const double *buffer) const {
+    std::ofstream ofile(filename.c_str(), std::ios::binary);
+    ofile.write("HCS1DSNP", 8);
+    write_header(ofile, &time, SNAPSHOTWRITER_BINARY_VERSION);
+    ofile.write(reinterpret_cast<const char *>(buffer),
+                SNAPSHOTWRITER_NUMBER_OF_FIELDS * _ncell * sizeof(double));
+    ofile.close();
+  }
+
+#if SNAPSHOT_COMPRESSION != SNAPSHOT_COMPRESSION_NONE
+  /**
+   * @brief Compress the fields in the given buffer, and write the table with
+   * the compressed sizes and errors and the compressed blocks to the given
+   * file.
+   *
+   * @param ofile File to write to.
+   * @param buffer Field buffer.
+   * @return Number of bytes written.
+   */
+  inline uint64_t write_compressed_fields(std::ofstream &ofile,
+                                          const double *buffer) {
+    double tolerance[SNAPSHOTWRITER_NUMBER_OF_FIELDS] = {0.};
+#if SNAPSHOT_COMPRESSION == SNAPSHOT_COMPRESSION_LOSSY
+    // only the density and pressure are stored with a finite precision
+    tolerance[1] = SnapshotCompressor::get_error_bound(_compression_tolerance);
+    tolerance[3] = tolerance[1];
+#endif
+    uint64_t size = 0;
+    for (uint_fast32_t ifield = 0; ifield < SNAPSHOTWRITER_NUMBER_OF_FIELDS;
+         ++ifield) {
+      _compressor.compress(buffer + ifield * _ncell, _ncell, tolerance[ifield],
+                           _compressed[ifield]);
+      write_value<uint64_t>(ofile, _compressed[ifield].size());
+      write_value<double>(ofile, tolerance[ifield]);
+      size += sizeof(uint64_t) + sizeof(double);
+    }
+    for (uint_fast32_t ifield = 0; ifield < SNAPSHOTWRITER_NUMBER_OF_FIELDS;
+         ++ifield) {
+      ofile.write(reinterpret_cast<const char *>(&_compressed[ifield][0]),
+                  _compressed[ifield].size());
+      size += _compressed[ifield].size();
+    }
+    return size;
+  }
+
+  /**
+   * @brief Compress the given ionisation radius records (losslessly), and
+   * write the compressed size and the compressed block to the given file.
+   *
+   * The values are reordered per value (all times, all radii, all
+   * luminosities) before they are compressed.
+   *
+   * @param ofile File to write to.
+   * @param records Ionisation radius records.
+   * @return Number of bytes written.
+   */
+  inline uint64_t write_compressed_records(std::ofstream &ofile,
+                                           const std::vector<double> &records) {
+    const size_t nrecord = records.size() / 3;
+    _record_values.resize(records.size());
+    for (size_t i = 0; i < nrecord; ++i) {
+      for (unsigned char ivalue = 0; ivalue < 3; ++ivalue) {
+        _record_values[ivalue * nrecord + i] = records[3 * i + ivalue];
+      }
+    }
+    _compressor.compress(&_record_values[0], records.size(), 0.,
+                         _compressed[0]);
+    write_value<uint64_t>(ofile, _compressed[0].size());
+    ofile.write(reinterpret_cast<const char *>(&_compressed[0][0]),
+                _compressed[0].size());
+    return sizeof(uint64_t) + _compressed[0].size();
+  }
+
+  /**
+   * @brief Write the given buffer as a compressed binary file.
+   *
+   * @param filename Name of the file.
+   * @param time Simulation time (in s).
+   * @param buffer Field buffer.
+   */
+  inline void write_compressed_binary(const std::string filename,
+                                      const double time, const double *buffer) {
+    std::ofstream ofile(filename.c_str(), std::ios::binary);
+    ofile.write("HCS1DSNP", 8);
+    write_header(ofile, &time, SNAPSHOTWRITER_COMPRESSED_VERSION);
+    write_compressed_fields(ofile, buffer);
+    ofile.close();
+  }
+#endif
+
+  /**
+   * @brief Append the given buffer and ionisation radius records to the
+   * container file, and write the new index and footer (see
+   * write_container_index()).
+   *
+   * @param has_snapshot Does the buffer contain a snapshot?
+   * @param time Simulation time (in s).
+   * @param buffer Field buffer.
+   * @param records Ionisation radius records.
+   */
+  inline void write_container(const bool has_snapshot, const double time,
+                              const double *buffer,
+                              const std::vector<double> &records) {
+    // overwrite the old index with the new chunks
+    _container.seekp(_container_end);
+    if (has_snapshot) {
+      _index_time.push_back(time);
+      _index_offset.push_back(_container_end);
+#if SNAPSHOT_COMPRESSION == SNAPSHOT_COMPRESSION_NONE
+      const uint64_t size =
+          SNAPSHOTWRITER_NUMBER_OF_FIELDS * _ncell * sizeof(double);
+      _container.write(reinterpret_cast<const char *>(buffer), size);
+#else
+      const uint64_t size = write_compressed_fields(_container, buffer);
+#endif
+      _container_end += size;
+    }
+#if SNAPSHOT_CONTAINER_IONISATION_RADIUS == 1
+    if (records.size() > 0) {
+      _radius_offset.push_back(_container_end);
+      _radius_size.push_back(records.size() / 3);
+#if SNAPSHOT_COMPRESSION == SNAPSHOT_COMPRESSION_NONE
+      const uint64_t size = records.size() * sizeof(double);
+      _container.write(reinterpret_cast<const char *>(&records[0]), size);
+#else
+      const uint64_t size = write_compressed_records(_container, records);
+#endif
+      _container_end += size;
+    }
+#else
+    (void)records;
+#endif
+
+    // write the new index and footer
+    write_container_index();
+  }
+
+  /**
+   * @brief Write the index and footer at the end of the container file.
+   */
+  inline void write_container_index() {
+    _container.seekp(_container_end);
+    const uint64_t index_offset = _container_end;
+    for (size_t i = 0; i < _index_time.size(); ++i) {
+      write_value(_container, _index_time[i]);
+      write_value(_container, _index_offset[i]);
+    }
+    const uint64_t radius_index_offset =
+        index_offset + _index_time.size() * (sizeof(double) + sizeof(uint64_t));
+    for (size_t i = 0; i < _radius_offset.size(); ++i) {
+      write_value(_container, _radius_offset[i]);
+      write_value(_container, _radius_size[i]);
+    }
+    write_value<uint64_t>(_container, _index_time.size());
+    write_value(_container, index_offset);
+    write_value<uint64_t>(_container, _radius_offset.size());
+    write_value(_container, radius_index_offset);
+    _container.write("HCS1DEND", 8);
+    _container.flush();
+  }
+
+#if SNAPSHOTWRITER_RADIUS_FILE == 1
+  /**
+   * @brief Append the given ionisation radius records as a compressed chunk to
+   * the ionisation radius log file.
+   *
+   * The file is created (or opened for a restart) when the first chunk is
+   * written.
+   *
+   * @param records Ionisation radius records.
+   */
+  inline void write_radius_file(const std::vector<double> &records) {
+    if (!_radius_file.is_open()) {
+      const std::string filename = _prefix + SNAPSHOTWRITER_RADIUS_FILE_NAME;
+      if (_radius_file_end > 0) {
+        _radius_file.open(filename.c_str(),
+                          std::ios::binary | std::ios::in | std::ios::out);
+      } else {
+        _radius_file.open(filename.c_str(), std::ios::binary);
+        _radius_file.write("HCS1DRAD", 8);
+        write_value<uint32_t>(_radius_file,
+                              SNAPSHOTWRITER_RADIUS_FILE_VERSION);
+        write_value<uint32_t>(_radius_file, 3);
+        _radius_file_end = _radius_file.tellp();
+      }
+    }
+    _radius_file.seekp(_radius_file_end);
+    write_value<uint64_t>(_radius_file, records.size() / 3);
+    _radius_file_end +=
+        sizeof(uint64_t) + write_compressed_records(_radius_file, records);
+    _radius_file.flush();
+  }
+#endif
+
+  /**
+   * @brief Main loop of the background I/O thread.
+   *
+   * Writes the pending buffers in the order in which they were filled, until
+   * the writer is stopped and no buffers are pending anymore.
+   */
+  inline void run() {
+    // do not stay on the CPU of the compute thread that created this thread
+    release_thread_pinning();
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+      while (!_pending[_next_write] && !_stop) {
+        _condition.wait(lock);
+      }
+      if (!_pending[_next_write]) {
+        // stopped and nothing left to write
+        return;
+      }
+      const unsigned char ibuffer = _next_write;
+      lock.unlock();
+
+#if SNAPSHOT_TYPE == SNAPSHOT_TYPE_TEXT
+      if (_has_snapshot[ibuffer]) {
+        write_text(_prefix + get_name(_isnap[ibuffer]), _time[ibuffer],
+                   &_buffer[ibuffer][0]);
+      }
+#elif SNAPSHOT_TYPE == SNAPSHOT_TYPE_BINARY
+      if (_has_snapshot[ibuffer]) {
+#if SNAPSHOT_COMPRESSION == SNAPSHOT_COMPRESSION_NONE
+        write_binary(_prefix + get_name(_isnap[ibuffer]), _time[ibuffer],
+                     &_buffer[ibuffer][0]);
+#else
+        write_compressed_binary(_prefix + get_name(_isnap[ibuffer]),
+                                _time[ibuffer], &_buffer[ibuffer][0]);
+#endif
+      }
+#else
+      write_container(_has_snapshot[ibuffer], _time[ibuffer],
+                      &_buffer[ibuffer][0], _records[ibuffer]);
+#endif
+#if SNAPSHOTWRITER_RADIUS_FILE == 1
+      if (_records[ibuffer].size() > 0) {
+        write_radius_file(_records[ibuffer]);
+      }
+#endif
+
+      lock.lock();
+      _pending[ibuffer] = false;
+      _next_write = ibuffer ^ 1;
+      _condition.notify_all();
+    }
+  }
+
+  /**
+   * @brief Hand a snapshot and the new ionisation radius records over to the
+   * background thread.
+   *
+   * The cell variables are copied into a free buffer (if both buffers are
+   * still pending, we wait until one of them has been written), and the actual
+   * write is done by the background thread.
+   *
+   * @param has_snapshot Should the cell variables be written?
+   * @param isnap Index of the snapshot.
+   * @param time Current simulation time (in internal units of T).
+   * @param cells Cells to write.
+   */
+  inline void submit(const bool has_snapshot, const uint_fast64_t isnap,
+                     const double time, const Cell *cells) {
+    const unsigned char ibuffer = _next_fill;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (_pending[ibuffer]) {
+        _condition.wait(lock);
+      }
+    }
+
+    // the buffer is not pending, so the background thread does not touch it
+    if (has_snapshot) {
+      fill_buffer(&_buffer[ibuffer][0], cells);
+    }
+    _has_snapshot[ibuffer] = has_snapshot;
+    _isnap[ibuffer] = isnap;
+    _time[ibuffer] = time * UNIT_TIME_IN_SI;
+    _records[ibuffer].swap(_new_records);
+    _new_records.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _pending[ibuffer] = true;
+    }
+    _condition.notify_all();
+    _next_fill = ibuffer ^ 1;
+  }
+
+public:
+  /**
+   * @brief Constructor.
+   *
+   * Opens the container file (if SNAPSHOT_TYPE_CONTAINER is selected) and
+   * starts the background I/O thread.
+   *
+   * @param ncell Number of cells.
+   * @param arena Memory arena that contains the field buffers (see
+   * get_memory_size()).
+   * @param prefix Prefix for the names of all output files (e.g. a folder
+   * name, including the trailing '/').
+   * @param restart Is this a restart? If so, the existing container file is
+   * opened, and is continued after a call to read_checkpoint().
+   * @param compression_tolerance Maximum relative error in the density and
+   * pressure (if SNAPSHOT_COMPRESSION_LOSSY is selected).
+   */
+  inline SnapshotWriter(const unsigned int ncell, MemoryArena &arena,
+                        const std::string prefix = "",
+                        const bool restart = false,
+                        const double compression_tolerance = 0.)
+      : _ncell(ncell), _prefix(prefix),
+        _compression_tolerance(compression_tolerance), _next_fill(0),
+        _next_write(0), _stop(false), _container_end(0), _radius_file_end(0) {
+    for (unsigned char ibuffer = 0; ibuffer < 2; ++ibuffer) {
+      // the buffers are only touched when the first snapshot is copied into
+      // them, by the same threads that own the cells
+      _buffer[ibuffer] =
+          arena.allocate<double>(SNAPSHOTWRITER_NUMBER_OF_FIELDS * ncell);
+      _isnap[ibuffer] = 0;
+      _time[ibuffer] = 0.;
+      _has_snapshot[ibuffer] = false;
+      _pending[ibuffer] = false;
+    }
+#if SNAPSHOT_TYPE == SNAPSHOT_TYPE_CONTAINER
+    if (restart) {
+      _container.open(_prefix + SNAPSHOTWRITER_CONTAINER_NAME,
+                      std::ios::binary | std::ios::in | std::ios::out);
+    } else {
+      _container.open(_prefix + SNAPSHOTWRITER_CONTAINER_NAME,
+                      std::ios::binary);
+      _container.write("HCS1DCNT", 8);
+      write_header(_container, nullptr, SNAPSHOTWRITER_VERSION);
+      _container_end = _container.tellp();
+    }
+#else
+    (void)restart;
+#endif
+    _thread = std::thread(&SnapshotWriter::run, this);
+  }
+
+  /**
+   * @brief Get the size of the memory in the arena used by the field buffers.
+   *
+   * @param ncell Number of cells.
+   * @return Size of the memory (in bytes).
+   */
+  inline static size_t get_memory_size(const unsigned int ncell) {
+    return 2 * MemoryArena::get_block_size<double>(
+                   SNAPSHOTWRITER_NUMBER_OF_FIELDS * ncell);
+  }
+
+  /**
+   * @brief Destructor.
+   *
+   * Writes the remaining ionisation radius records, waits for all pending
+   * snapshots to be written and stops the background I/O thread.
+   */
+  inline ~SnapshotWriter() {
+    if (_new_records.size() > 0) {
+      submit(false, 0, 0., nullptr);
+    }
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _condition.notify_all();
+    _thread.join();
+  }
+
+  /**
+   * @brief Get the name of the snapshot with the given index.
+   *
+   * For text and binary snapshots, this is the name of the snapshot file.
+   *
+   * @param isnap Index of the snapshot.
+   * @return Name of the snapshot.
+   */
+  inline static std::string get_name(const uint_fast64_t isnap) {
+    std::stringstream name;
+#if SNAPSHOT_TYPE == SNAPSHOT_TYPE_CONTAINER
+    name << SNAPSHOTWRITER_CONTAINER_NAME << " (snapshot ";
+#else
+    name << "snapshot_";
+#endif
+    name.fill('0');
+    name.width(4);
+    name << isnap;
+#if SNAPSHOT_TYPE == SNAPSHOT_TYPE_TEXT
+    name << ".txt";
+#elif SNAPSHOT_TYPE == SNAPSHOT_TYPE_BINARY
+    name << ".dat";
+#else
+    name << ")";
+#endif
+    return name.str();
+  }
+
+  /**
+   * @brief Add a record to the ionisation radius log.
+   *
+   * The records are written to the container file (or to the compressed
+   * ionisation radius log file) together with the next snapshot.
+   *
+   * @param time Simulation time (in s).
+   * @param ionisation_radius Ionisation radius (in m).
+   * @param luminosity Ionising luminosity (in s^-1).
+   */
+  inline void add_ionisation_radius(const double time,
+                                    const double ionisation_radius,
+                                    const double luminosity) {
+    _new_records.push_back(time);
+    _new_records.push_back(ionisation_radius);
+    _new_records.push_back(luminosity);
+  }
+
+  /**
+   * @brief Write a snapshot with the given index.
+   *
+   * The actual write is done by the background thread.
+   *
+   * @param isnap Index of the snapshot.
+   * @param time Current simulation time (in internal units of T).
+   * @param cells Cells to write.
+   */
+  inline void write(const uint_fast64_t isnap, const double time,
+                    const Cell *cells) {
+    submit(true, isnap, time, cells);
+  }
+
+  /**
+   * @brief Write the given cells to a binary snapshot file with the given
+   * name, independent of SNAPSHOT_TYPE.
+   *
+   * The write is done immediately, by the calling thread. This is used for
+   * the final snapshot lastsnap.dat, which can be used as initial condition
+   * file (see ICFile.hpp). The file is never compressed.
+   *
+   * @param filename Name of the file (without the output prefix).
+   * @param time Current simulation time (in internal units of T).
+   * @param cells Cells to write.
+   */
+  inline void write_binary_file(const std::string filename, const double time,
+                                const Cell *cells) const {
+    std::vector<double> buffer(SNAPSHOTWRITER_NUMBER_OF_FIELDS * _ncell);
+    fill_buffer(&buffer[0], cells);
+    write_binary(_prefix + filename, time * UNIT_TIME_IN_SI, &buffer[0]);
+  }
+
+  /**
+   * @brief Wait until all pending snapshots have been written to disk.
+   */
+  inline void flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_pending[0] || _pending[1]) {
+      _condition.wait(lock);
+    }
+  }
+
+  /**
+   * @brief Add the state of the writer to the given checkpoint.
+   *
+   * We first wait for all pending snapshots to be written, so that the
+   * checkpoint contains the final state of the container index.
+   *
+   * @param checkpoint CheckpointWriter.
+   */
+  inline void write_checkpoint(CheckpointWriter &checkpoint) {
+    flush();
+    checkpoint.write(_new_records);
+    checkpoint.write(_container_end);
+    checkpoint.write(_index_time);
+    checkpoint.write(_index_offset);
+    checkpoint.write(_radius_offset);
+    checkpoint.write(_radius_size);
+    checkpoint.write(_radius_file_end);
+  }
+
+  /**
+   * @brief Restore the state of the writer from the given checkpoint.
+   *
+   * Must be called before the first snapshot is written. New chunks in the
+   * container file and the compressed ionisation radius log file overwrite
+   * everything that was written after the checkpoint.
+   *
+   * @param checkpoint CheckpointReader.
+   */
+  inline void read_checkpoint(CheckpointReader &checkpoint) {
+    checkpoint.read(_new_records);
+    checkpoint.read(_container_end);
+    checkpoint.read(_index_time);
+    checkpoint.read(_index_offset);
+    checkpoint.read(_radius_offset);
+    checkpoint.read(_radius_size);
+    checkpoint.read(_radius_file_end);
+#if SNAPSHOTWRITER_RADIUS_FILE == 1
+    if (_radius_file_end > 0 &&
+        truncate((_prefix + SNAPSHOTWRITER_RADIUS_FILE_NAME).c_str(),
+                 _radius_file_end) != 0) {
+      std::cerr << "Error truncating ionisation radius file!" << std::endl;
+      abort();
+    }
+#endif
+#if SNAPSHOT_TYPE == SNAPSHOT_TYPE_CONTAINER
+    // remove everything that was written after the checkpoint, and make the
+    // container valid again
+    if (truncate((_prefix + SNAPSHOTWRITER_CONTAINER_NAME).c_str(),
+                 _container_end) != 0) {
+      std::cerr << "Error truncating snapshot container!" << std::endl;
+      abort();
+    }
+    write_container_index();
+#endif
+  }
+
+  // the writer owns a running thread, so it cannot be copied
+  SnapshotWriter(const SnapshotWriter &) = delete;
+  SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+};
+
+#endif // SNAPSHOTWRITER_HPP
@@ -32,39 +32,44 @@
  * See Toro, 2009, chapter 17.
  * We use a second order Runge-Kutta step and apply an operator splitting method
  * to couple the source term to the hydro step.
+ *
+ * add_spherical_source_term_cell() applies the source term to a single cell,
+ * add_spherical_source_term() applies it to all cells. Both do nothing if the
+ * (run time) dimensionality is DIMENSIONALITY_1D.
  */
-#if DIMENSIONALITY == DIMENSIONALITY_1D
-#define add_spherical_source_term()
-#elif DIMENSIONALITY == DIMENSIONALITY_3D
-#define add_spherical_source_term()                                            \
-  _Pragma("omp parallel for") for (uint_fast32_t i = 1; i < ncell + 1; ++i) {  \
-    if (cells[i]._m > 0.) {                                                    \
-      const double r = cells[i]._midpoint;                                     \
-      const double rinv = 1. / r;                                              \
-      const double Vinv = 1. / cells[i]._V;                                    \
-      const double dt = cells[i]._dt;                                          \
-      const double Ui[3] = {cells[i]._m * Vinv, cells[i]._p * Vinv,            \
-                            cells[i]._E * Vinv};                               \
-      const double Ui0inv = 1. / Ui[0];                                        \
-      const double Ui12 = Ui[1] * Ui[1];                                       \
-      const double p1 = (GAMMA - 1.) * (Ui[2] - 0.5 * Ui12 * Ui0inv);          \
-      const double K1[3] = {-dt * Ui[1] * rinv, -dt * Ui12 * Ui0inv * rinv,    \
-                            -dt * Ui[1] * (Ui[2] + p1) * Ui0inv * rinv};       \
-      double U[3] = {Ui[0] + K1[0], Ui[1] + K1[1], Ui[2] + K1[2]};             \
-      const double U0inv = 1. / U[0];                                          \
-      const double U12 = U[1] * U[1];                                          \
-      const double p2 = (GAMMA - 1.) * (U[2] - 0.5 * U12 * U0inv);             \
-      const double K2[3] = {-dt * U[1] * rinv, -dt * U12 * U0inv * rinv,       \
-                            -dt * U[1] * (U[2] + p2) * U0inv * rinv};          \
-      U[0] = Ui[0] + 0.5 * (K1[0] + K2[0]);                                    \
-      U[1] = Ui[1] + 0.5 * (K1[1] + K2[1]);                                    \
-      U[2] = Ui[2] + 0.5 * (K1[2] + K2[2]);                                    \
+#define add_spherical_source_term_cell(cell)                                   \
+  if (DIMENSIONALITY == DIMENSIONALITY_3D && cell._m > 0.) {                   \
+    const double r = cell._midpoint;                                           \
+    const double rinv = 1. / r;                                                \
+    const double Vinv = 1. / cell._V;                                          \
+    const double dt = cell._dt;                                                \
+    const double Ui[3] = {cell._m * Vinv, cell._p * Vinv,                      \
+                          cell._E * Vinv};                                     \
+    const double Ui0inv = 1. / Ui[0];                                          \
+    const double Ui12 = Ui[1] * Ui[1];                                         \
+    const double p1 = (GAMMA - 1.) * (Ui[2] - 0.5 * Ui12 * Ui0inv);            \
+    const double K1[3] = {-dt * Ui[1] * rinv, -dt * Ui12 * Ui0inv * rinv,      \
+                          -dt * Ui[1] * (Ui[2] + p1) * Ui0inv * rinv};         \
+    double U[3] = {Ui[0] + K1[0], Ui[1] + K1[1], Ui[2] + K1[2]};               \
+    const double U0inv = 1. / U[0];                                            \
+    const double U12 = U[1] * U[1];                                            \
+    const double p2 = (GAMMA - 1.) * (U[2] - 0.5 * U12 * U0inv);               \
+    const double K2[3] = {-dt * U[1] * rinv, -dt * U12 * U0inv * rinv,         \
+                          -dt * U[1] * (U[2] + p2) * U0inv * rinv};            \
+    U[0] = Ui[0] + 0.5 * (K1[0] + K2[0]);                                      \
+    U[1] = Ui[1] + 0.5 * (K1[1] + K2[1]);                                      \
+    U[2] = Ui[2] + 0.5 * (K1[2] + K2[2]);                                      \
                                                                                \
-      cells[i]._m = U[0] * cells[i]._V;                                        \
-      cells[i]._p = U[1] * cells[i]._V;                                        \
-      cells[i]._E = U[2] * cells[i]._V;                                        \
+    cell._m = U[0] * cell._V;                                                  \
+    cell._p = U[1] * cell._V;                                                  \
+    cell._E = U[2] * cell._V;                                                  \
+  }
+#define add_spherical_source_term()                                            \
+  if (DIMENSIONALITY == DIMENSIONALITY_3D) {                                   \
+    _Pragma("omp parallel for schedule(static)")                               \
+    for (uint_fast32_t i = 1; i < ncell + 1; ++i) {                            \
+      add_spherical_source_term_cell(cells[i]);                                \
     }                                                                          \
   }
-#endif
 
 #endif // SPHERICAL_HPP
@@ -0,0 +1,221 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file ThreadPlacement.hpp
+ *
+ * @brief Placement of threads and memory on multi-socket (NUMA) nodes.
+ *
+ * Memory pages are placed on the socket of the thread that first writes to
+ * them (first touch). All loops over the cells use schedule(static) over the
+ * same index range (the cells 1 to ncell), so that every thread always works
+ * on the same contiguous range of cells (for a fixed number of threads), and
+ * the cells are first touched with the same schedule before the grid and the
+ * initial condition are set up (see SimulationState::setup()). Threads then
+ * mostly access memory on their own socket.
+ *
+ * This only works if threads do not move between sockets. The threads of a
+ * single simulation can be pinned to CPUs with the run time parameter
+ * THREAD_PINNING (unless the OpenMP runtime already binds them, e.g. using
+ * OMP_PROC_BIND). Background I/O threads are released from the pinning (see
+ * release_thread_pinning()), so that they do not compete with the compute
+ * thread that created them.
+ *
+ * Arrays that are not part of the cells, like the photon packet bank and the
+ * per-thread path length arrays of the Monte Carlo transport, use
+ * FirstTouchAllocator, which does not initialize the memory, so that it can be
+ * first touched in parallel by the threads that use it.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef THREADPLACEMENT_HPP
+#define THREADPLACEMENT_HPP
+
+#include "SafeParameters.hpp" // safe way to include Parameters.hpp
+
+#include <algorithm>
+#include <memory>
+#include <omp.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Allocator that does not initialize the elements of a container
+ * unless an initial value is given.
+ *
+ * std::vector<_datatype_, FirstTouchAllocator<_datatype_>>(n) allocates n
+ * elements without writing to them, so that the memory pages are only placed
+ * when they are first touched.
+ */
+template <typename _datatype_>
+class FirstTouchAllocator : public std::allocator<_datatype_> {
+public:
+  /**
+   * @brief Allocator for another data type.
+   */
+  template <typename _other_datatype_> struct rebind {
+    /*! @brief Allocator type. */
+    typedef FirstTouchAllocator<_other_datatype_> other;
+  };
+
+  /**
+   * @brief Constructor.
+   */
+  inline FirstTouchAllocator() {}
+
+  /**
+   * @brief Copy constructor for an allocator of another data type.
+   */
+  template <typename _other_datatype_>
+  inline FirstTouchAllocator(const FirstTouchAllocator<_other_datatype_> &) {}
+
+  /**
+   * @brief Default initialize the element at the given location (this does
+   * not write to memory for built-in types).
+   *
+   * @param location Location of the element.
+   */
+  template <typename _other_datatype_>
+  inline void construct(_other_datatype_ *location) {
+    ::new (static_cast<void *>(location)) _other_datatype_;
+  }
+
+  /**
+   * @brief Construct the element at the given location using the given
+   * arguments.
+   *
+   * @param location Location of the element.
+   * @param args Constructor arguments.
+   */
+  template <typename _other_datatype_, typename... _arguments_>
+  inline void construct(_other_datatype_ *location, _arguments_ &&... args) {
+    ::new (static_cast<void *>(location))
+        _other_datatype_(std::forward<_arguments_>(args)...);
+  }
+};
+
+/**
+ * @brief Resize the given vector, first touching the new memory in parallel.
+ *
+ * The existing elements are copied and the new elements are set to zero in a
+ * loop with schedule(static), so that the memory is spread over the sockets
+ * of the threads.
+ *
+ * @param values Vector to resize.
+ * @param new_size New size of the vector.
+ */
+template <typename _datatype_>
+inline static void first_touch_resize(
+    std::vector<_datatype_, FirstTouchAllocator<_datatype_>> &values,
+    const size_t new_size) {
+  std::vector<_datatype_, FirstTouchAllocator<_datatype_>> new_values(
+      new_size);
+  const _datatype_ *old_data = values.data();
+  _datatype_ *new_data = new_values.data();
+  const size_t old_size = std::min(values.size(), new_size);
+#pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < new_size; ++i) {
+    new_data[i] = (i < old_size) ? old_data[i] : _datatype_(0);
+  }
+  values.swap(new_values);
+}
+
+/*! @brief CPUs the process was allowed to run on before the threads were
+ *  pinned. */
+static cpu_set_t threadplacement_process_cpus;
+
+/*! @brief Were the threads pinned? */
+static bool threadplacement_pinned = false;
+
+/**
+ * @brief Pin the threads of the OpenMP parallel regions of the calling thread
+ * to CPUs.
+ *
+ * @param pinning Type of pinning (THREAD_PINNING_NONE, THREAD_PINNING_COMPACT
+ * or THREAD_PINNING_SPREAD).
+ * @return Description of the thread placement, used for output.
+ */
+inline static std::string pin_threads(const int pinning) {
+  if (omp_get_proc_bind() != omp_proc_bind_false) {
+    return "bound by the OpenMP runtime";
+  }
+  if (pinning == THREAD_PINNING_NONE) {
+    return "not pinned";
+  }
+
+  cpu_set_t process_cpus;
+  CPU_ZERO(&process_cpus);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &process_cpus) != 0) {
+    return "not pinned: unable to get the CPU affinity";
+  }
+  std::vector<int> cpus;
+  for (int icpu = 0; icpu < CPU_SETSIZE; ++icpu) {
+    if (CPU_ISSET(icpu, &process_cpus)) {
+      cpus.push_back(icpu);
+    }
+  }
+
+  std::vector<int> thread_cpus(omp_get_max_threads(), -1);
+  bool success = true;
+#pragma omp parallel reduction(&& : success)
+  {
+    const int ithread = omp_get_thread_num();
+    const int nthread = omp_get_num_threads();
+    const size_t ncpu = cpus.size();
+    const size_t index = (pinning == THREAD_PINNING_SPREAD)
+                             ? (ithread * ncpu / nthread) % ncpu
+                             : ithread % ncpu;
+    cpu_set_t thread_cpu;
+    CPU_ZERO(&thread_cpu);
+    CPU_SET(cpus[index], &thread_cpu);
+    success = (sched_setaffinity(0, sizeof(cpu_set_t), &thread_cpu) == 0);
+    thread_cpus[ithread] = cpus[index];
+  }
+  if (!success) {
+    return "not pinned: unable to set the CPU affinity";
+  }
+
+  threadplacement_process_cpus = process_cpus;
+  threadplacement_pinned = true;
+  std::stringstream description;
+  description << "pinned to CPU(s)";
+  for (size_t ithread = 0; ithread < thread_cpus.size(); ++ithread) {
+    if (thread_cpus[ithread] >= 0) {
+      description << " " << thread_cpus[ithread];
+    }
+  }
+  return description.str();
+}
+
+/**
+ * @brief Allow the calling thread to run on all CPUs the process was allowed
+ * to run on before the threads were pinned.
+ *
+ * Threads inherit the pinning of the thread that creates them, so this is
+ * called by background threads.
+ */
+inline static void release_thread_pinning() {
+  if (threadplacement_pinned) {
+    sched_setaffinity(0, sizeof(cpu_set_t), &threadplacement_process_cpus);
+  }
+}
+
+#endif // THREADPLACEMENT_HPP
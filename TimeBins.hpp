@@ -0,0 +1,253 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file TimeBins.hpp
+ *
+ * @brief Power of two time step bins used for individual time stepping.
+ *
+ * Every cell has an integer time step that is a power of 2, and a cell with
+ * time step 2^b is stored in bin b. Cell time steps are always aligned on the
+ * integer time line: a cell with time step 2^b starts and ends its steps at
+ * integer times that are multiples of 2^b. The cells that are active at
+ * integer time t (i.e. that start a new step at time t) are hence exactly the
+ * cells in all bins b for which t is a multiple of 2^b. A cell can only change
+ * its time step when it is active, and the new time step is required to keep
+ * the cell aligned. This means that all cells that change bin move from one
+ * active bin to another, so that the active bins can simply be rebuilt from
+ * the list of active cells.
+ *
+ * As a consequence of the alignment, a cell that is not active at time t
+ * always has a larger time step than any active neighbour.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#ifndef TIMEBINS_HPP
+#define TIMEBINS_HPP
+
+#include "Cell.hpp"       // Cell class
+#include "Checkpoint.hpp" // checkpoint writer and reader
+
+#include <cstdint>
+#include <vector>
+
+/*! @brief Number of time step bins: one for every power of 2 on the 64-bit
+ *  integer time line. */
+#define TIMEBINS_NUMBER_OF_BINS 64
+
+/**
+ * @brief Power of two time step bins.
+ */
+class TimeBins {
+private:
+  /*! @brief Indices of the cells in every bin. */
+  std::vector<uint_fast32_t> _bins[TIMEBINS_NUMBER_OF_BINS];
+
+  /**
+   * @brief Get the bin that corresponds to the given integer time step.
+   *
+   * @param integer_dt Integer time step (needs to be a power of 2).
+   * @return Bin index.
+   */
+  inline static uint_fast32_t get_bin(const uint_fast64_t integer_dt) {
+    return __builtin_ctzll(integer_dt);
+  }
+
+  /**
+   * @brief Get the highest bin that is active at the given integer time.
+   *
+   * @param integer_time Integer time.
+   * @return Highest active bin index.
+   */
+  inline static uint_fast32_t get_max_active_bin(
+      const uint_fast64_t integer_time) {
+    return (integer_time == 0) ? TIMEBINS_NUMBER_OF_BINS - 1
+                               : __builtin_ctzll(integer_time);
+  }
+
+public:
+  /**
+   * @brief Check if a cell with the given integer time step is active at the
+   * given integer time.
+   *
+   * @param integer_time Integer time.
+   * @param integer_dt Integer time step of the cell (a power of 2).
+   * @return True if the cell starts a new time step at the given time.
+   */
+  inline static bool is_active(const uint_fast64_t integer_time,
+                               const uint_fast64_t integer_dt) {
+    return (integer_time & (integer_dt - 1)) == 0;
+  }
+
+  /**
+   * @brief Get the integer time that has passed since the given cell started
+   * its current time step.
+   *
+   * @param integer_time Current integer time.
+   * @param integer_dt Integer time step of the cell (a power of 2).
+   * @return Elapsed integer time since the start of the cell time step.
+   */
+  inline static uint_fast64_t get_elapsed_time(const uint_fast64_t integer_time,
+                                               const uint_fast64_t integer_dt) {
+    return integer_time & (integer_dt - 1);
+  }
+
+  /**
+   * @brief Add the given cell to the bin that corresponds to its time step.
+   *
+   * @param index Index of the cell.
+   * @param integer_dt Integer time step of the cell (a power of 2).
+   */
+  inline void add_cell(const uint_fast32_t index,
+                       const uint_fast64_t integer_dt) {
+    _bins[get_bin(integer_dt)].push_back(index);
+  }
+
+  /**
+   * @brief Get the cells that are active at the given integer time.
+   *
+   * @param integer_time Integer time.
+   * @param active_cells List to store the indices of the active cells in.
+   */
+  inline void get_active_cells(const uint_fast64_t integer_time,
+                               std::vector<uint_fast32_t> &active_cells) const {
+    active_cells.clear();
+    const uint_fast32_t max_bin = get_max_active_bin(integer_time);
+    for (uint_fast32_t ibin = 0; ibin <= max_bin; ++ibin) {
+      active_cells.insert(active_cells.end(), _bins[ibin].begin(),
+                          _bins[ibin].end());
+    }
+  }
+
+  /**
+   * @brief Move the active cells to the bins that correspond to their new time
+   * step.
+   *
+   * @param integer_time Integer time.
+   * @param active_cells Indices of all cells that are active at this time.
+   * @param cells Cells, containing the new time steps.
+   */
+  inline void rebin_active_cells(const uint_fast64_t integer_time,
+                                 const std::vector<uint_fast32_t> &active_cells,
+                                 const Cell *cells) {
+    const uint_fast32_t max_bin = get_max_active_bin(integer_time);
+    for (uint_fast32_t ibin = 0; ibin <= max_bin; ++ibin) {
+      _bins[ibin].clear();
+    }
+    for (size_t k = 0; k < active_cells.size(); ++k) {
+      const uint_fast32_t i = active_cells[k];
+      add_cell(i, cells[i]._integer_dt);
+    }
+  }
+
+  /**
+   * @brief Get the next integer time at which some cells become active.
+   *
+   * @param integer_time Current integer time.
+   * @return Next integer time at which a time step ends.
+   */
+  inline uint_fast64_t get_next_time(const uint_fast64_t integer_time) const {
+    uint_fast64_t next_time = 0;
+    for (uint_fast32_t ibin = 0; ibin < TIMEBINS_NUMBER_OF_BINS; ++ibin) {
+      if (!_bins[ibin].empty()) {
+        // end of the current step of the cells in this bin
+        const uint_fast64_t bin_time = ((integer_time >> ibin) + 1) << ibin;
+        if (next_time == 0 || bin_time < next_time) {
+          next_time = bin_time;
+        }
+      }
+    }
+    return next_time;
+  }
+
+  /**
+   * @brief Add the contents of the bins to the given checkpoint.
+   *
+   * The order of the cells within the bins is preserved, so that a restart
+   * continues bit-for-bit.
+   *
+   * @param checkpoint CheckpointWriter.
+   */
+  inline void write_checkpoint(CheckpointWriter &checkpoint) const {
+    for (uint_fast32_t ibin = 0; ibin < TIMEBINS_NUMBER_OF_BINS; ++ibin) {
+      checkpoint.write(_bins[ibin]);
+    }
+  }
+
+  /**
+   * @brief Restore the contents of the bins from the given checkpoint.
+   *
+   * @param checkpoint CheckpointReader.
+   */
+  inline void read_checkpoint(CheckpointReader &checkpoint) {
+    for (uint_fast32_t ibin = 0; ibin < TIMEBINS_NUMBER_OF_BINS; ++ibin) {
+      checkpoint.read(_bins[ibin]);
+    }
+  }
+
+  /**
+   * @brief Get the interfaces that need a flux computation and the cells that
+   * need a flux update.
+   *
+   * Interface i is the interface between cell i and cell i + 1. An interface is
+   * active if one of its neighbouring cells is active. The ghost cells 0 and
+   * ncell + 1 are assumed to have the same time step as cells 1 and ncell. The
+   * cells that need a flux update are the active cells and their inactive
+   * neighbours, every cell is listed only once.
+   *
+   * @param integer_time Integer time.
+   * @param active_cells Indices of all cells that are active at this time.
+   * @param cells Cells.
+   * @param ncell Number of cells (excluding ghost cells).
+   * @param active_interfaces List to store the active interface indices in.
+   * @param updated_cells List to store the indices of the cells that need a
+   * flux update in.
+   */
+  inline static void
+  get_active_interfaces(const uint_fast64_t integer_time,
+                        const std::vector<uint_fast32_t> &active_cells,
+                        const Cell *cells, const uint_fast32_t ncell,
+                        std::vector<uint_fast32_t> &active_interfaces,
+                        std::vector<uint_fast32_t> &updated_cells) {
+    active_interfaces.clear();
+    updated_cells.clear();
+    for (size_t k = 0; k < active_cells.size(); ++k) {
+      const uint_fast32_t i = active_cells[k];
+      const bool left_active =
+          (i > 1) && is_active(integer_time, cells[i - 1]._integer_dt);
+      // the left interface is handled by the left neighbour if it is active
+      if (!left_active) {
+        active_interfaces.push_back(i - 1);
+      }
+      active_interfaces.push_back(i);
+
+      updated_cells.push_back(i);
+      // an inactive left neighbour is added by its own left neighbour if that
+      // neighbour is active
+      if (i > 1 && !left_active &&
+          !(i > 2 && is_active(integer_time, cells[i - 2]._integer_dt))) {
+        updated_cells.push_back(i - 1);
+      }
+      if (i < ncell && !is_active(integer_time, cells[i + 1]._integer_dt)) {
+        updated_cells.push_back(i + 1);
+      }
+    }
+  }
+};
+
+#endif // TIMEBINS_HPP
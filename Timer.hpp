@@ -23,14 +23,16 @@
  *
  * This file was originally part of the public moving mesh code Shadowfax
  * (https://github.com/AstroUGent/shadowfax). We removed the restart routines,
- * everything else is unchanged.
+ * and replaced gettimeofday by the monotonic high-resolution clock_gettime
+ * clock.
  *
  * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
  */
 #ifndef TIMER_HPP
 #define TIMER_HPP
 
-#include <sys/time.h> // for timeval
+#include <cstdint> // for int_least64_t
+#include <ctime>   // for timespec, clock_gettime
 
 /**
   * @brief A simplified interface to the Unix system timer.
@@ -42,80 +44,82 @@
   * functions Timer::start and Timer::stop. The function Timer::stop always
   * returns the total registered time, which is the sum of all individual
   * intervals measured.
+  *
+  * The Timer uses the monotonic system clock, so that its intervals are not
+  * affected by changes to the system time.
   */
 class Timer {
 private:
-  /*! @brief Starting time of the timer */
-  timeval _start;
+  /*! @brief Starting time of the timer (in ns) */
+  int_least64_t _start;
 
-  /*! @brief Stop time of the timer */
-  timeval _stop;
+  /*! @brief Total time interval registered so far (in ns) */
+  int_least64_t _diff;
 
-  /*! @brief Total time interval registered so far */
-  timeval _diff;
+  /**
+   * @brief Get the current value of the monotonic system clock.
+   *
+   * @return Current value of the clock (in ns).
+   */
+  inline static int_least64_t get_clock() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<int_least64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+  }
 
 public:
   /**
-   * @brief Clear the internal timeval difference.
+   * @brief Clear the internal time difference.
    */
-  inline void reset() { timerclear(&_diff); }
+  inline void reset() { _diff = 0; }
 
   /**
    * @brief Constructor.
    *
-   * Intialize the internal timeval difference and register the current system
+   * Intialize the internal time difference and register the current system
    * time.
    */
   inline Timer() {
     reset();
-    gettimeofday(&_start, NULL);
+    _start = get_clock();
   }
 
   /**
    * @brief Record the current system time as starting time.
    */
-  inline void start() { gettimeofday(&_start, NULL); }
+  inline void start() { _start = get_clock(); }
 
   /**
    * @brief Record the current system time as stopping time and add the
-   * difference between start and stop to the internal timeval difference.
+   * difference between start and stop to the internal time difference.
    *
-   * @return The current contents of the internal timeval difference in seconds
-   * (with microsecond precision).
+   * @return The current contents of the internal time difference in seconds
+   * (with nanosecond precision).
    */
   inline double stop() {
-    gettimeofday(&_stop, NULL);
-    timeval interval_diff;
-    timersub(&_stop, &_start, &interval_diff);
-    timeradd(&_diff, &interval_diff, &_diff);
-    return _diff.tv_sec + 1.e-6 * _diff.tv_usec;
+    _diff += get_clock() - _start;
+    return value();
   }
 
   /**
-   * @brief Get the current internal timeval difference.
+   * @brief Get the current internal time difference.
    *
-   * @return The current contents of the internal timeval difference in seconds
-   * (with microsecond precision).
+   * @return The current contents of the internal time difference in seconds
+   * (with nanosecond precision).
    */
-  inline double value() const { return _diff.tv_sec + 1.e-6 * _diff.tv_usec; }
+  inline double value() const { return 1.e-9 * _diff; }
 
   /**
    * @brief Get the current value of the timer without affecting it.
    *
    * @return The time in seconds since the timer was last started.
    */
-  inline double interval() {
-    timeval tempstop;
-    gettimeofday(&tempstop, NULL);
-    timeval time_interval;
-    timersub(&tempstop, &_start, &time_interval);
-    return time_interval.tv_sec + 1.e-6 * time_interval.tv_usec;
-  }
+  inline double interval() { return 1.e-9 * (get_clock() - _start); }
 
   /**
    * @brief Restart the timer by overwriting the start time.
    */
-  inline void restart() { gettimeofday(&_start, NULL); }
+  inline void restart() { _start = get_clock(); }
 };
 
 #endif // TIMER_HPP
@@ -24,11 +24,18 @@
 # @brief Script that adds a density perturbation to the given binary output file
 # and stores the result in a new binary output file with the given name.
 #
+# Both files use the binary snapshot format (see SnapshotWriter.hpp and
+# read_snapshot.py).
+#
 # @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
 ##
 
 import numpy as np
 import sys
+from read_snapshot import read_binary_snapshot, write_binary_snapshot
+
+# conversion factor from m to AU
+au_in_si = 1.495978707e11
 
 ##
 # @brief Cubic spline kernel like bump filter.
@@ -53,7 +60,7 @@ def cubic_spline(x, center, h, factor):
 
 # Make sure we have 2 command line arguments: the input and output file name
 if len(sys.argv) < 4:
-  print "Usage: python add_density_perturbation input_file output_file rho_p"
+  print("Usage: python add_density_perturbation input_file output_file rho_p")
   exit()
 
 
@@ -61,25 +68,19 @@ name = sys.argv[1]
 outname = sys.argv[2]
 fac = float(sys.argv[3])
 
-print fac
-
-# memory-map the input file to a read-only numpy array
-fp = np.memmap(name, dtype = 'd', mode = 'r')
-# we know the array has 4 columns
-data = fp.reshape((-1, 4))
+print(fac)
 
-# set up the spatial grid with the right resolution
-r = np.linspace(10., 100., len(data) + 1)
-r = 0.5 * (r[1:] + r[:-1])
+# read the input file; we get a copy of the data, which we will modify below
+time, data, names, units = read_binary_snapshot(name)
 
-# make a copy of the original data, which we will modify below
-copy = data.copy()
+# the file contains the cell midpoints (in m)
+r = data[:,names.index("radius")] / au_in_si
 
 # apply the density bump filter
-copy[:,0] *= np.where(r > 60., np.where(r < 70., cubic_spline(r, 65., 5., fac),
-                                                 np.ones(len(r))),
-                               np.ones(len(r)))
+data[:,names.index("density")] *= \
+  np.where(r > 60., np.where(r < 70., cubic_spline(r, 65., 5., fac),
+                             np.ones(len(r))),
+           np.ones(len(r)))
 
-# store the result in a new memory-mapped file
-ofp = np.memmap(outname, dtype = 'd', mode = 'w+', shape = copy.shape)
-ofp[:] = copy[:]
+# store the result in a new binary snapshot file
+write_binary_snapshot(outname, time, data, names, units)
@@ -0,0 +1,346 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file benchmarks.cpp
+ *
+ * @brief Microbenchmarks for the performance critical building blocks of the
+ * code.
+ *
+ * Every benchmark calls a single function a fixed number of times, with
+ * inputs taken from a small, precomputed table of realistic values. Every
+ * benchmark is repeated a few times, and the fastest repeat is reported, which
+ * is the least sensitive to noise from other processes.
+ *
+ * The results are written in the benchmark JSON format that is also used by
+ * run_benchmarks.py for the end-to-end benchmarks:
+ *   {
+ *     "format": "HydroCodeSpherical1D benchmarks",
+ *     "version": 1,
+ *     "type": "micro",
+ *     "benchmarks": [
+ *       {
+ *         "name": ...,
+ *         "calls": ...,
+ *         "repeats": ...,
+ *         "time": ...,
+ *         "time_per_call": ...,
+ *         "calls_per_second": ...
+ *       },
+ *       ...
+ *     ]
+ *   }
+ * All times are in s.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "Bondi.hpp"             // get_neutral_fraction
+#include "BondiProfile.hpp"      // neutral Bondi profile
+#include "HLLCRiemannSolver.hpp" // fast HLLC Riemann solver
+#include "LambertW.hpp"          // Lambert W function implementation
+#include "LogFile.hpp"           // memory-mapped log file
+#include "RandomGenerator.hpp"   // Counter-based random number generator
+#include "RiemannSolver.hpp"     // exact Riemann solver
+#include "SafeParameters.hpp"    // safe way to include Parameters.hpp
+#include "Timer.hpp"             // program timers
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*! @brief Number of precomputed input values for every benchmark (should be a
+ *  power of 2). */
+#define BENCHMARK_TABLE_SIZE 1024
+
+/*! @brief Number of times every benchmark is repeated. */
+#define BENCHMARK_NUMBER_OF_REPEATS 5
+
+/**
+ * @brief Result of a single benchmark.
+ */
+class BenchmarkResult {
+public:
+  /*! @brief Name of the benchmark. */
+  std::string _name;
+
+  /*! @brief Number of function calls per repeat. */
+  uint_fast64_t _number_of_calls;
+
+  /*! @brief Time of the fastest repeat (in s). */
+  double _time;
+};
+
+/**
+ * @brief Run the given benchmark.
+ *
+ * @param name Name of the benchmark.
+ * @param number_of_calls Number of function calls per repeat.
+ * @param benchmark Function that performs the given number of calls, and
+ * returns a value that depends on all calls, so that the compiler cannot
+ * optimise them away.
+ * @param results List of results to add the result to.
+ */
+template <typename _benchmark_>
+inline void run_benchmark(const std::string name,
+                          const uint_fast64_t number_of_calls,
+                          _benchmark_ benchmark,
+                          std::vector<BenchmarkResult> &results) {
+  double best_time = 0.;
+  double check = 0.;
+  for (uint_fast32_t irepeat = 0; irepeat < BENCHMARK_NUMBER_OF_REPEATS;
+       ++irepeat) {
+    Timer timer;
+    timer.start();
+    check += benchmark(number_of_calls);
+    const double time = timer.stop();
+    if (irepeat == 0 || time < best_time) {
+      best_time = time;
+    }
+  }
+
+  BenchmarkResult result;
+  result._name = name;
+  result._number_of_calls = number_of_calls;
+  result._time = best_time;
+  results.push_back(result);
+
+  std::cout << name << ": " << (best_time / number_of_calls) << " s per call"
+            << " (check value: " << check << ")" << std::endl;
+}
+
+/**
+ * @brief Write the given benchmark results to the given stream in the
+ * benchmark JSON format.
+ *
+ * @param results Benchmark results.
+ * @param stream std::ostream to write to.
+ */
+inline void write_json(const std::vector<BenchmarkResult> &results,
+                       std::ostream &stream) {
+  stream.precision(10);
+  stream << "{\n";
+  stream << "  \"format\": \"HydroCodeSpherical1D benchmarks\",\n";
+  stream << "  \"version\": 1,\n";
+  stream << "  \"type\": \"micro\",\n";
+  stream << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult &result = results[i];
+    stream << "    {\n";
+    stream << "      \"name\": \"" << result._name << "\",\n";
+    stream << "      \"calls\": " << result._number_of_calls << ",\n";
+    stream << "      \"repeats\": " << BENCHMARK_NUMBER_OF_REPEATS << ",\n";
+    stream << "      \"time\": " << result._time << ",\n";
+    stream << "      \"time_per_call\": "
+           << (result._time / result._number_of_calls) << ",\n";
+    stream << "      \"calls_per_second\": "
+           << (result._number_of_calls / result._time) << "\n";
+    stream << "    }";
+    if (i + 1 < results.size()) {
+      stream << ",";
+    }
+    stream << "\n";
+  }
+  stream << "  ]\n";
+  stream << "}\n";
+}
+
+/**
+ * @brief Run the microbenchmarks.
+ *
+ * Usage: ./benchmarks [output_file]
+ * The results are written to the given file (default: benchmarks.json).
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
+
+  std::string output_name = "benchmarks.json";
+  if (argc > 1) {
+    output_name = argv[1];
+  }
+
+  // set up the tables with input values
+  // Riemann problems: density, velocity and pressure of the left and right
+  // state, without vacuum
+  std::vector<double> rhoL(BENCHMARK_TABLE_SIZE), uL(BENCHMARK_TABLE_SIZE),
+      PL(BENCHMARK_TABLE_SIZE), rhoR(BENCHMARK_TABLE_SIZE),
+      uR(BENCHMARK_TABLE_SIZE), PR(BENCHMARK_TABLE_SIZE);
+  // Lambert W arguments, in the range [-1/e, 0[
+  std::vector<double> lambertarg(BENCHMARK_TABLE_SIZE);
+  // Bondi profile inverse radii (in units of the Bondi radius), on both sides
+  // of the sonic point
+  std::vector<double> bondirinv(BENCHMARK_TABLE_SIZE);
+  // cell walls for the neutral fraction, distributed around a unit ionisation
+  // radius
+  std::vector<double> rmin(BENCHMARK_TABLE_SIZE), rmax(BENCHMARK_TABLE_SIZE);
+  RandomGenerator random_generator(MC_RANDOM_SEED, 0, 0);
+  for (uint_fast32_t i = 0; i < BENCHMARK_TABLE_SIZE; ++i) {
+    rhoL[i] = 0.5 + 1.5 * random_generator.get_uniform_random_double();
+    uL[i] = -1. + 2. * random_generator.get_uniform_random_double();
+    PL[i] = 0.5 + 1.5 * random_generator.get_uniform_random_double();
+    rhoR[i] = 0.5 + 1.5 * random_generator.get_uniform_random_double();
+    uR[i] = -1. + 2. * random_generator.get_uniform_random_double();
+    PR[i] = 0.5 + 1.5 * random_generator.get_uniform_random_double();
+    lambertarg[i] = -random_generator.get_uniform_random_double() / M_E;
+    bondirinv[i] = 0.1 + 9.9 * random_generator.get_uniform_random_double();
+    rmin[i] = 0.8 + 0.4 * random_generator.get_uniform_random_double();
+    rmax[i] = rmin[i] + 0.001;
+  }
+
+  std::vector<BenchmarkResult> results;
+
+  HLLCRiemannSolver hllc_solver(GAMMA);
+  run_benchmark("HLLCRiemannSolver::solve_for_flux", 2000000,
+                [&](const uint_fast64_t ncall) {
+                  double sum = 0.;
+                  for (uint_fast64_t i = 0; i < ncall; ++i) {
+                    const uint_fast32_t j = i & (BENCHMARK_TABLE_SIZE - 1);
+                    double mflux, pflux, Eflux;
+                    hllc_solver.solve_for_flux(rhoL[j], uL[j], PL[j], rhoR[j],
+                                               uR[j], PR[j], mflux, pflux,
+                                               Eflux);
+                    sum += mflux + pflux + Eflux;
+                  }
+                  return sum;
+                },
+                results);
+
+  RiemannSolver exact_solver(GAMMA);
+  run_benchmark("RiemannSolver::solve_for_flux", 200000,
+                [&](const uint_fast64_t ncall) {
+                  double sum = 0.;
+                  for (uint_fast64_t i = 0; i < ncall; ++i) {
+                    const uint_fast32_t j = i & (BENCHMARK_TABLE_SIZE - 1);
+                    double mflux, pflux, Eflux;
+                    exact_solver.solve_for_flux(rhoL[j], uL[j], PL[j], rhoR[j],
+                                                uR[j], PR[j], mflux, pflux,
+                                                Eflux);
+                    sum += mflux + pflux + Eflux;
+                  }
+                  return sum;
+                },
+                results);
+
+  // the batched solver is called for batches of 256 interfaces, like in the
+  // main program; the number of calls is the number of interfaces
+  std::vector<double> mfluxes(BENCHMARK_TABLE_SIZE),
+      pfluxes(BENCHMARK_TABLE_SIZE), Efluxes(BENCHMARK_TABLE_SIZE);
+  run_benchmark("RiemannSolver::solve_for_flux_batch", 200000,
+                [&](const uint_fast64_t ncall) {
+                  double sum = 0.;
+                  for (uint_fast64_t i = 0; i < ncall; i += 256) {
+                    const uint_fast32_t j = i & (BENCHMARK_TABLE_SIZE - 1);
+                    const uint_fast32_t nbatch =
+                        std::min<uint_fast64_t>(256, ncall - i);
+                    exact_solver.solve_for_flux_batch(
+                        nbatch, &rhoL[j], &uL[j], &PL[j], &rhoR[j], &uR[j],
+                        &PR[j], &mfluxes[j], &pfluxes[j], &Efluxes[j]);
+                    for (uint_fast32_t k = 0; k < nbatch; ++k) {
+                      sum += mfluxes[j + k] + pfluxes[j + k] + Efluxes[j + k];
+                    }
+                  }
+                  return sum;
+                },
+                results);
+
+  run_benchmark("LambertW::lambert_w", 1000000,
+                [&](const uint_fast64_t ncall) {
+                  double sum = 0.;
+                  for (uint_fast64_t i = 0; i < ncall; ++i) {
+                    const uint_fast32_t j = i & (BENCHMARK_TABLE_SIZE - 1);
+                    // alternate between both branches
+                    sum += LambertW::lambert_w(lambertarg[j], -(j & 1));
+                  }
+                  return sum;
+                },
+                results);
+
+  const BondiProfile exact_profile(1., 1.);
+  run_benchmark("BondiProfile::get_primitive_variables (exact)", 1000000,
+                [&](const uint_fast64_t ncall) {
+                  double sum = 0.;
+                  for (uint_fast64_t i = 0; i < ncall; ++i) {
+                    const uint_fast32_t j = i & (BENCHMARK_TABLE_SIZE - 1);
+                    double rho, u, P;
+                    exact_profile.get_primitive_variables(bondirinv[j], rho, u,
+                                                          P);
+                    sum += rho + u + P;
+                  }
+                  return sum;
+                },
+                results);
+
+  const BondiProfile tabulated_profile(1., 1., 0.1, 10.);
+  std::cout << "Tabulated Bondi profile maximum relative error: "
+            << tabulated_profile.get_maximum_relative_error() << std::endl;
+  run_benchmark("BondiProfile::get_primitive_variables (tabulated)", 10000000,
+                [&](const uint_fast64_t ncall) {
+                  double sum = 0.;
+                  for (uint_fast64_t i = 0; i < ncall; ++i) {
+                    const uint_fast32_t j = i & (BENCHMARK_TABLE_SIZE - 1);
+                    double rho, u, P;
+                    tabulated_profile.get_primitive_variables(bondirinv[j], rho,
+                                                              u, P);
+                    sum += rho + u + P;
+                  }
+                  return sum;
+                },
+                results);
+
+  // smooth transition parameters for a transition width of 0.2
+  const double S = 3. / (2. * 0.2);
+  const double A = -16. * S * S * S / 27.;
+  run_benchmark("get_neutral_fraction", 10000000,
+                [&](const uint_fast64_t ncall) {
+                  double sum = 0.;
+                  for (uint_fast64_t i = 0; i < ncall; ++i) {
+                    const uint_fast32_t j = i & (BENCHMARK_TABLE_SIZE - 1);
+                    sum += get_neutral_fraction(rmin[j], rmax[j], 1., 0.9, 1.1,
+                                                S, A);
+                  }
+                  return sum;
+                },
+                results);
+
+  run_benchmark("LogFile::write", 2000000,
+                [&](const uint_fast64_t ncall) {
+                  LogFile logfile("benchmark_logfile.dat", 10);
+                  for (uint_fast64_t i = 0; i < ncall; ++i) {
+                    logfile.write(rhoL[i & (BENCHMARK_TABLE_SIZE - 1)]);
+                  }
+                  const double size = logfile.get_current_position();
+                  logfile.close_file();
+                  return size;
+                },
+                results);
+  std::remove("benchmark_logfile.dat");
+
+  std::ofstream ofile(output_name);
+  write_json(results, ofile);
+  std::cout << "Wrote benchmark results to " << output_name << "."
+            << std::endl;
+
+  return 0;
+}
@@ -36,6 +36,7 @@ configuration_options = {
 "gamma": 1.001,
 "maxtime_in_yr": 80.,
 "number_of_snaps": 4000,
+"max_number_of_steps": 0,
 "ic": "IC_FILE",
 "eos": "EOS_BONDI",
 "boundaries": "BOUNDARIES_BONDI",
@@ -56,8 +57,90 @@ configuration_options = {
 "riemannsolver_type": "RIEMANNSOLVER_TYPE_HLLC",
 "dimensionality": "DIMENSIONALITY_3D",
 "hydro_order": 2,
+"grid_type": "GRID_TYPE_UNIFORM",
+"grid_file_name": "grid.txt",
+"hydro_sweep": "HYDRO_SWEEP_PASSES",
+"hydro_sweep_block_size": 256,
+"time_stepping": "TIME_STEPPING_FIXED",
+"refinement": "REFINEMENT_NONE",
+"refinement_interval": 10,
+"refinement_maximum_level": 2,
+"refinement_density_jump": 0.1,
+"snapshot_type": "SNAPSHOT_TYPE_BINARY",
+"snapshot_container_ionisation_radius": 0,
+"snapshot_compression": "SNAPSHOT_COMPRESSION_NONE",
+"snapshot_compression_tolerance": 1.e-4,
+"logfile": "LOGFILE_NONE",
+"logfile_tolerance": 1.e-3,
+"hardware_counters": "HARDWARE_COUNTERS_NONE",
+"offload": "OFFLOAD_NONE",
+"mc_number_of_photons": 1000,
+"mc_random_seed": 42,
+"mc_ionising_luminosity_in_si": 1.e47,
+"mc_estimator": "MC_ESTIMATOR_ANALOG",
+"mc_target_relative_error": 0.,
+"mc_maximum_number_of_photons": 100000,
+"mc_ionisation_solver": "MC_IONISATION_SOLVER_EXACT",
+"checkpoint_interval_in_s": 0.,
+"analysis_interval": 0,
+"analysis_quantities": "ionisation_radius,central_mass,total_mass,inner_mass_flux",
+"analysis_probe_radii_in_au": "",
+"analysis_tolerance": 1.e-4,
+"thread_pinning": "THREAD_PINNING_NONE",
+"huge_pages": "HUGE_PAGES_NONE",
 }
 
+##
+# @brief Configuration options that are run time parameters.
+#
+# The configured value of these options is only a default value, that can be
+# overwritten in the parameter file (see RuntimeParameters.hpp).
+##
+runtime_parameters = [
+"rmin_in_au",
+"rmax_in_au",
+"ncell",
+"gamma",
+"maxtime_in_yr",
+"number_of_snaps",
+"max_number_of_steps",
+"ionisation_transition_width_in_au",
+"isothermal_temperature_in_k",
+"g_internal",
+"mass_point_mass_in_msol",
+"bondi_density_in_si",
+"bondi_pressure_contrast",
+"ic_file_name",
+"initial_ionisation_radius_in_au",
+"unit_mass_in_si",
+"unit_length_in_si",
+"courant_factor",
+"riemannsolver_type",
+"dimensionality",
+"hydro_order",
+"grid_type",
+"grid_file_name",
+"refinement_interval",
+"refinement_maximum_level",
+"refinement_density_jump",
+"snapshot_compression_tolerance",
+"logfile_tolerance",
+"mc_number_of_photons",
+"mc_random_seed",
+"mc_ionising_luminosity_in_si",
+"mc_estimator",
+"mc_target_relative_error",
+"mc_maximum_number_of_photons",
+"mc_ionisation_solver",
+"checkpoint_interval_in_s",
+"analysis_interval",
+"analysis_quantities",
+"analysis_probe_radii_in_au",
+"analysis_tolerance",
+"thread_pinning",
+"huge_pages",
+]
+
 ##
 # @brief Generate the cmake command to configure the code with a specific
 # configuration.
@@ -83,10 +166,41 @@ def get_cmake_command(custom_options = {}, folder = ".."):
   # check that all custom options were actually used
   for option in custom_options:
     if not custom_options[option] == "read":
-      print "Unknown option:", option
+      print("Unknown option: {0}".format(option))
       exit()
 
   return command
 
+##
+# @brief Get the options that can only be set when configuring the code.
+#
+# All runs that only differ in their run time parameters can use the same
+# compiled program, configured with these options.
+#
+# @param custom_options Configuration options.
+# @return Configuration options that are not run time parameters.
+##
+def get_compile_time_options(custom_options = {}):
+  return dict([(option, custom_options[option]) for option in custom_options
+               if not option in runtime_parameters])
+
+##
+# @brief Generate the contents of a parameter file that sets the run time
+# parameters in the given options.
+#
+# @param custom_options Configuration options. Only the run time parameters
+# are written to the parameter file.
+# @return Contents of the parameter file.
+##
+def get_parameter_file(custom_options = {}):
+  contents = ""
+  for option in runtime_parameters:
+    if option in custom_options:
+      value = custom_options[option]
+      if isinstance(value, float):
+        value = repr(value)
+      contents += "{0}: {1}\n".format(option, value)
+  return contents
+
 if __name__ == "__main__":
-  print get_cmake_command()
+  print(get_cmake_command())
@@ -28,7 +28,8 @@ bondi_setup = {
 "ionisation_transition": "IONISATION_TRANSITION_SMOOTH",
 "ionisation_transition_width_in_au": 5.,
 "courant_factor": 0.05,
-"riemannsolver_type": "RIEMANNSOLVER_TYPE_HLLC"
+"riemannsolver_type": "RIEMANNSOLVER_TYPE_HLLC",
+"snapshot_type": "SNAPSHOT_TYPE_TEXT"
 }
 
 bondi_run = {
@@ -55,7 +56,8 @@ bondi_run = {
 "ionisation_transition": "IONISATION_TRANSITION_SMOOTH",
 "ionisation_transition_width_in_au": 5.,
 "courant_factor": 0.05,
-"riemannsolver_type": "RIEMANNSOLVER_TYPE_HLLC"
+"riemannsolver_type": "RIEMANNSOLVER_TYPE_HLLC",
+"snapshot_type": "SNAPSHOT_TYPE_TEXT"
 }
 
 make_command = "make"
@@ -26,8 +26,9 @@
 # @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
 ##
 
-import numpy as np
 import pylab as pl
+import os
+from read_snapshot import SnapshotContainer, read_ionisation_radius
 
 # units: we plot time in years and distance in AU
 au_in_si = 1.496e11
@@ -35,11 +36,13 @@ yr_in_si = (365.25 * 24. * 3600.)
 
 file = "ionisation_radius.dat"
 
-# memory-map the binary file to a read-only numpy array
-fp = np.memmap(file, dtype = 'd', mode = 'r')
-# the file has 3 columns: the time, ionisation radius and ionising luminosity
-# ratio (in SI units)
-data = fp.reshape((-1, 3))
+if os.path.exists(file):
+  # the file has 3 columns: the time, ionisation radius and ionising luminosity
+  # ratio (in SI units)
+  data = read_ionisation_radius(file)
+else:
+  # the ionisation radius log was stored in the snapshot container
+  data = SnapshotContainer("snapshots.dat").get_ionisation_radius()
 
 # create the plot
 fig, ax = pl.subplots(1, 1, sharex = True, sharey = True)
@@ -25,6 +25,10 @@
 # density, velocity, pressure and neutral fraction profile as a function of
 # radius.
 #
+# Both text (snapshot_XXXX.txt) and binary (snapshot_XXXX.dat) snapshot files
+# are supported, as well as the snapshots in a snapshot container file
+# (snapshots.dat).
+#
 # @autor Bert Vandenbroucke (bv7@st-andrews.ac.uk)
 ##
 
@@ -33,6 +37,8 @@ import pylab as pl
 import glob
 import sys
 import multiprocessing as mp
+from read_snapshot import read_snapshot, SnapshotContainer
+import os
 
 # unit conversions: we plot distances in AU and give time in years
 au_in_si = 1.495978707e11 # m
@@ -47,17 +53,19 @@ if len(sys.argv) > 1:
 ##
 # @brief Make the plots for a single snapshot file.
 #
-# @param f Snapshot file to plot.
+# @param f Snapshot file to plot, or name of the snapshot container file.
+# @param isnap Index of the snapshot in the container file (only used if f is a
+# container file).
 # @return Name of the file.
 ##
-def plot(f):
-  # read the time stamp at the start of the snapshot file
-  ifile = open(f, 'r')
-  timeline = ifile.readline()
-  time = float(timeline.split()[2])
-  ifile.close()
-  # now read in the actual data values
-  data = np.loadtxt(f)
+def plot(f, isnap = -1):
+  # read the time stamp and the actual data values
+  if isnap < 0:
+    time, data = read_snapshot(f)
+    name = f[:-4]
+  else:
+    time, data = SnapshotContainer(f).get_snapshot(isnap)
+    name = "snapshot_{0:04d}".format(isnap)
   # unit conversion
   data[:,0] /= au_in_si
 
@@ -75,18 +83,22 @@ def plot(f):
   ax[1][1].set_xlabel("radius (AU)")
   ax[0][1].set_title("t = {t:.2e} yr".format(t = time / yr_in_si))
   pl.tight_layout()
-  pl.savefig("{name}.png".format(name = f[:-4]))
+  pl.savefig("{name}.png".format(name = name))
   pl.close()
 
-  return f
+  return name
 
 # set up a parallel pool to do the plotting
 pool = mp.Pool(nthread)
 results = []
 # scan the working directory for snapshot files
-for f in sorted(glob.glob("snapshot_*.txt")):
+for f in sorted(glob.glob("snapshot_*.txt") + glob.glob("snapshot_*.dat")):
   # add the file to the list of tasks
   results.append(pool.apply_async(plot, (f,)))
+# add the snapshots in the snapshot container (if present)
+if os.path.exists("snapshots.dat"):
+  for isnap in range(len(SnapshotContainer("snapshots.dat"))):
+    results.append(pool.apply_async(plot, ("snapshots.dat", isnap)))
 
 # wait for the threads to finish
 for result in results:
@@ -0,0 +1,396 @@
+#! /usr/bin/python
+
+################################################################################
+# This file is part of HydroCodeSpherical1D
+# Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+#
+# HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# HydroCodeSpherical1D is distributed in the hope that it will be useful,
+# but WITOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+################################################################################
+
+##
+# @file read_snapshot.py
+#
+# @brief Reader for the text and binary snapshot files, the snapshot
+# container file, the ionisation radius log and the in-situ analysis time series
+# file.
+#
+# Compressed files (see SnapshotCompression.hpp) are decompressed using the zlib
+# module of the standard library.
+#
+# When run as a script, converts the binary snapshot files given on the command
+# line into text snapshot files with the same layout as the ones written by the
+# code when it is configured with SNAPSHOT_TYPE_TEXT. A snapshot container file
+# (snapshots.dat) is converted into one text file per snapshot.
+#
+# @autor Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+##
+
+import numpy as np
+import struct
+import sys
+import zlib
+
+##
+# @brief Decompress a block of doubles compressed by SnapshotCompressor.
+#
+# See SnapshotCompression.hpp for the compression algorithm.
+#
+# @param block Compressed block (bytes).
+# @param count Number of values in the block.
+# @return Array with the values.
+##
+def decompress_values(block, count):
+  shuffled = np.frombuffer(zlib.decompress(block), dtype = np.uint8)
+  if shuffled.size != 8 * count:
+    raise RuntimeError("Compressed block does not contain {0} values!".format(
+      count))
+  # undo the byte shuffling: byte i of all values is stored in row i
+  return np.ascontiguousarray(
+    shuffled.reshape((8, count)).transpose()).view(np.float64).reshape(count)
+
+##
+# @brief Read the compressed fields of a snapshot from the given file.
+#
+# The file should be positioned at the start of the table with the compressed
+# sizes.
+#
+# @param ifile File to read from.
+# @param nfield Number of fields.
+# @param ncell Number of cells.
+# @param fields Indices of the fields to read (default: all fields).
+# @return Array with one row per field in fields.
+##
+def read_compressed_fields(ifile, nfield, ncell, fields = None):
+  table = np.frombuffer(ifile.read(16 * nfield),
+                        dtype = [("size", "u8"), ("error", "f8")])
+  if fields is None:
+    fields = range(nfield)
+  start = ifile.tell()
+  offsets = start + np.concatenate(([0], np.cumsum(table["size"])))
+  data = np.zeros((len(fields), ncell))
+  for i, ifield in enumerate(fields):
+    ifile.seek(int(offsets[ifield]))
+    data[i] = decompress_values(ifile.read(int(table["size"][ifield])), ncell)
+  return data
+
+##
+# @brief Read a binary snapshot file.
+#
+# See SnapshotWriter.hpp for the layout of the file.
+#
+# @param filename Name of the file.
+# @return Time (in s), data array with one column per field (in SI units),
+# list of field names, list of field units.
+##
+def read_binary_snapshot(filename):
+  ifile = open(filename, "rb")
+  magic = ifile.read(8)
+  if magic != b"HCS1DSNP":
+    raise RuntimeError("{0} is not a binary snapshot file!".format(filename))
+  version, nfield, ncell, time = struct.unpack("=IIQd", ifile.read(24))
+  if version != 1 and version != 2:
+    raise RuntimeError(
+      "Unknown snapshot version in {0}: {1}!".format(filename, version))
+  names = []
+  units = []
+  for i in range(nfield):
+    names.append(ifile.read(32).rstrip(b"\0").decode("ascii"))
+    units.append(ifile.read(32).rstrip(b"\0").decode("ascii"))
+  if version == 2:
+    data = read_compressed_fields(ifile, nfield, ncell)
+  else:
+    data = np.fromfile(ifile, dtype = np.float64, count = nfield * ncell)
+    data = data.reshape((nfield, ncell))
+  ifile.close()
+  data = data.transpose()
+  return time, data, names, units
+
+##
+# @brief Random access reader for a snapshot container file.
+#
+# See SnapshotWriter.hpp for the layout of the file. Only the index is read when
+# the container is opened; snapshots and fields are read on demand.
+##
+class SnapshotContainer:
+
+  ##
+  # @brief Constructor.
+  #
+  # @param filename Name of the container file (default: snapshots.dat).
+  ##
+  def __init__(self, filename = "snapshots.dat"):
+    self.file = open(filename, "rb")
+    if self.file.read(8) != b"HCS1DCNT":
+      raise RuntimeError("{0} is not a snapshot container!".format(filename))
+    self.version, self.nfield, self.ncell = \
+      struct.unpack("=IIQ", self.file.read(16))
+    if self.version != 1 and self.version != 2:
+      raise RuntimeError(
+        "Unknown container version in {0}: {1}!".format(filename,
+                                                        self.version))
+    self.names = []
+    self.units = []
+    for i in range(self.nfield):
+      self.names.append(self.file.read(32).rstrip(b"\0").decode("ascii"))
+      self.units.append(self.file.read(32).rstrip(b"\0").decode("ascii"))
+
+    # read the footer and the index
+    self.file.seek(-40, 2)
+    nsnap, index_offset, nchunk, chunk_offset = \
+      struct.unpack("=QQQQ", self.file.read(32))
+    if self.file.read(8) != b"HCS1DEND":
+      raise RuntimeError("{0} has no valid index!".format(filename))
+    self.file.seek(index_offset)
+    index = np.fromfile(self.file, dtype = [("time", "f8"), ("offset", "u8")],
+                        count = nsnap)
+    self.times = index["time"]
+    self.offsets = index["offset"]
+    self.file.seek(chunk_offset)
+    self.radius_chunks = np.fromfile(self.file,
+                                     dtype = [("offset", "u8"), ("size", "u8")],
+                                     count = nchunk)
+
+  ##
+  # @brief Get the number of snapshots in the container.
+  #
+  # @return Number of snapshots.
+  ##
+  def __len__(self):
+    return len(self.times)
+
+  ##
+  # @brief Read a single field of a single snapshot.
+  #
+  # @param isnap Index of the snapshot.
+  # @param name Name of the field.
+  # @return Field values (in SI units).
+  ##
+  def get_field(self, isnap, name):
+    ifield = self.names.index(name)
+    if self.version == 2:
+      self.file.seek(int(self.offsets[isnap]))
+      return read_compressed_fields(self.file, self.nfield, self.ncell,
+                                    [ifield])[0]
+    self.file.seek(int(self.offsets[isnap]) + ifield * self.ncell * 8)
+    return np.fromfile(self.file, dtype = np.float64, count = self.ncell)
+
+  ##
+  # @brief Read a single field for all snapshots, without reading the other
+  # fields.
+  #
+  # @param name Name of the field.
+  # @return Array with one row per snapshot (in SI units).
+  ##
+  def get_field_all_snapshots(self, name):
+    data = np.zeros((len(self.times), self.ncell))
+    for isnap in range(len(self.times)):
+      data[isnap] = self.get_field(isnap, name)
+    return data
+
+  ##
+  # @brief Read a single snapshot.
+  #
+  # @param isnap Index of the snapshot.
+  # @return Time (in s), data array with one column per field (in SI units).
+  ##
+  def get_snapshot(self, isnap):
+    self.file.seek(int(self.offsets[isnap]))
+    if self.version == 2:
+      data = read_compressed_fields(self.file, self.nfield, self.ncell)
+    else:
+      data = np.fromfile(self.file, dtype = np.float64,
+                         count = self.nfield * self.ncell)
+      data = data.reshape((self.nfield, self.ncell))
+    return self.times[isnap], data.transpose()
+
+  ##
+  # @brief Read the ionisation radius log stored in the container.
+  #
+  # @return Array with the same 3 columns as ionisation_radius.dat: time,
+  # ionisation radius and ionising luminosity (in SI units).
+  ##
+  def get_ionisation_radius(self):
+    chunks = [np.zeros((0, 3))]
+    for chunk in self.radius_chunks:
+      self.file.seek(int(chunk["offset"]))
+      nrecord = int(chunk["size"])
+      if self.version == 2:
+        size, = struct.unpack("=Q", self.file.read(8))
+        records = decompress_values(self.file.read(size), 3 * nrecord)
+        chunks.append(records.reshape((3, nrecord)).transpose())
+      else:
+        records = np.fromfile(self.file, dtype = np.float64,
+                              count = 3 * nrecord)
+        chunks.append(records.reshape((-1, 3)))
+    return np.concatenate(chunks)
+
+##
+# @brief Read the ionisation radius log file.
+#
+# The file is either a plain binary dump of the records, or a compressed log
+# (see SnapshotWriter.hpp).
+#
+# @param filename Name of the file (default: ionisation_radius.dat).
+# @return Array with 3 columns: time, ionisation radius and ionising luminosity
+# (in SI units).
+##
+def read_ionisation_radius(filename = "ionisation_radius.dat"):
+  ifile = open(filename, "rb")
+  if ifile.read(8) != b"HCS1DRAD":
+    ifile.close()
+    return np.fromfile(filename, dtype = np.float64).reshape((-1, 3))
+  version, nvalue = struct.unpack("=II", ifile.read(8))
+  if version != 1:
+    raise RuntimeError(
+      "Unknown ionisation radius version in {0}: {1}!".format(filename,
+                                                              version))
+  chunks = [np.zeros((0, nvalue))]
+  header = ifile.read(16)
+  while len(header) == 16:
+    nrecord, size = struct.unpack("=QQ", header)
+    records = decompress_values(ifile.read(size), nvalue * nrecord)
+    chunks.append(records.reshape((nvalue, nrecord)).transpose())
+    header = ifile.read(16)
+  ifile.close()
+  return np.concatenate(chunks)
+
+##
+# @brief Read a text snapshot file.
+#
+# @param filename Name of the file.
+# @return Time (in s), data array with one column per field (in SI units).
+##
+def read_text_snapshot(filename):
+  ifile = open(filename, "r")
+  timeline = ifile.readline()
+  time = float(timeline.split()[2])
+  ifile.close()
+  data = np.loadtxt(filename)
+  return time, data
+
+##
+# @brief Read a snapshot file, using the file extension to determine its type.
+#
+# @param filename Name of the file.
+# @return Time (in s), data array with columns radius, density, velocity,
+# pressure and neutral fraction (in SI units).
+##
+def read_snapshot(filename):
+  if filename.endswith(".txt"):
+    return read_text_snapshot(filename)
+  else:
+    time, data, names, units = read_binary_snapshot(filename)
+    return time, data
+
+##
+# @brief Write a text snapshot file.
+#
+# @param textname Name of the text file.
+# @param time Time (in s).
+# @param data Data array with one column per field (in SI units).
+##
+def write_text_snapshot(textname, time, data):
+  ofile = open(textname, "w")
+  ofile.write("# time: {0:g}\n".format(time))
+  for row in data:
+    ofile.write("\t".join(["{0:g}".format(value) for value in row]) + "\n")
+  ofile.close()
+
+##
+# @brief Write a binary snapshot file.
+#
+# See SnapshotWriter.hpp for the layout of the file. The file can be used as
+# initial condition file (see ICFile.hpp).
+#
+# @param filename Name of the file.
+# @param time Time (in s).
+# @param data Data array with one column per field (in SI units).
+# @param names List of field names.
+# @param units List of field units.
+##
+def write_binary_snapshot(filename, time, data, names, units):
+  ncell, nfield = data.shape
+  ofile = open(filename, "wb")
+  ofile.write(b"HCS1DSNP")
+  ofile.write(struct.pack("=IIQd", 1, nfield, ncell, time))
+  for i in range(nfield):
+    ofile.write(struct.pack("32s", names[i].encode("ascii")))
+    ofile.write(struct.pack("32s", units[i].encode("ascii")))
+  np.ascontiguousarray(data.transpose(), dtype = np.float64).tofile(ofile)
+  ofile.close()
+
+##
+# @brief Convert a binary snapshot file into a text snapshot file.
+#
+# @param filename Name of the binary file.
+# @return Name of the text file.
+##
+def convert_to_text(filename):
+  time, data, names, units = read_binary_snapshot(filename)
+  textname = filename[:-4] + ".txt"
+  write_text_snapshot(textname, time, data)
+  return textname
+
+##
+# @brief Check if the given file is a snapshot container file.
+#
+# @param filename Name of the file.
+# @return True if the file starts with the container signature.
+##
+def is_container(filename):
+  ifile = open(filename, "rb")
+  magic = ifile.read(8)
+  ifile.close()
+  return magic == b"HCS1DCNT"
+
+##
+# @brief Read an in-situ analysis time series file.
+#
+# See InSituAnalysis.hpp for the layout of the file.
+#
+# @param filename Name of the file (analysis.dat).
+# @return Data array with one row per record and one column per value (in SI
+# units; the first column is the time), list of column names, list of column
+# units.
+##
+def read_analysis(filename):
+  ifile = open(filename, "rb")
+  magic = ifile.read(8)
+  if magic != b"HCS1DTSR":
+    raise RuntimeError("{0} is not an analysis file!".format(filename))
+  version, ncolumn = struct.unpack("=II", ifile.read(8))
+  if version != 1:
+    raise RuntimeError(
+      "Unknown analysis version in {0}: {1}!".format(filename, version))
+  names = []
+  units = []
+  for i in range(ncolumn):
+    names.append(ifile.read(32).rstrip(b"\0").decode("ascii"))
+    units.append(ifile.read(32).rstrip(b"\0").decode("ascii"))
+  data = np.fromfile(ifile, dtype = np.float64)
+  ifile.close()
+  data = data.reshape((-1, ncolumn))
+  return data, names, units
+
+if __name__ == "__main__":
+  for f in sys.argv[1:]:
+    if is_container(f):
+      container = SnapshotContainer(f)
+      for isnap in range(len(container)):
+        time, data = container.get_snapshot(isnap)
+        textname = "snapshot_{0:04d}.txt".format(isnap)
+        write_text_snapshot(textname, time, data)
+        print("Converted snapshot {0} in {1} to {2}".format(isnap, f, textname))
+    else:
+      print("Converted {0} to {1}".format(f, convert_to_text(f)))
@@ -0,0 +1,231 @@
+#! /usr/bin/python
+
+################################################################################
+# This file is part of HydroCodeSpherical1D
+# Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+#
+# HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# HydroCodeSpherical1D is distributed in the hope that it will be useful,
+# but WITOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+################################################################################
+
+##
+# @file run_benchmarks.py
+#
+# @brief Benchmark suite: microbenchmarks and end-to-end fixed step benchmarks
+# of the Sod, Bondi and Starbench configurations.
+#
+# Every configuration is configured and compiled in its own folder, with a
+# fixed maximum number of steps, and is then run for all requested numbers of
+# cells and threads. The run time of the main loop is obtained from the phase
+# timers (timers.csv). The results are written to a single file in the
+# benchmark JSON format (see benchmarks.cpp), with type "suite", the results of
+# the microbenchmarks under "micro", and the results of the end-to-end
+# benchmarks under "macro".
+#
+# Usage: python run_benchmarks.py [--ncell 1000,4000] [--threads 1,2,4]
+#   [--steps 200] [--folder benchmark_builds] [--output benchmark_results.json]
+#
+# @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+##
+
+import argparse
+import json
+import multiprocessing
+import os
+import platform
+import subprocess
+import sys
+
+# the source folder is the folder that contains this script
+source_folder = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, source_folder)
+import get_cmake_command
+
+##
+# @brief End-to-end benchmark configurations.
+#
+# The physical time step is fixed in the code, so the Sod configuration uses a
+# large time unit (set through g_internal) to keep the time step well below the
+# CFL limit.
+##
+benchmark_configurations = {
+"sod": {
+  "rmin_in_au": 0.,
+  "rmax_in_au": 6.68459e-12,
+  "gamma": 5. / 3.,
+  "maxtime_in_yr": 0.634,
+  "ic": "IC_SOD",
+  "eos": "EOS_IDEAL",
+  "boundaries": "BOUNDARIES_OPEN",
+  "potential": "POTENTIAL_NONE",
+  "unit_mass_in_si": 1.,
+  "unit_length_in_si": 1.,
+  "g_internal": 6.67408e5,
+  "courant_factor": 0.01,
+  "riemannsolver_type": "RIEMANNSOLVER_TYPE_EXACT",
+  "dimensionality": "DIMENSIONALITY_1D",
+  "hydro_order": 1
+},
+"bondi": {
+  "ic": "IC_BONDI",
+  "initial_ionisation_radius_in_au": 30.,
+  "ionisation_mode": "IONISATION_MODE_SELF_CONSISTENT"
+},
+"starbench": {
+  "rmin_in_au": 0.,
+  "rmax_in_au": 3.e5,
+  "gamma": 1.001,
+  "maxtime_in_yr": 1.41e5,
+  "ic": "IC_STARBENCH",
+  "eos": "EOS_BONDI",
+  "boundaries": "BOUNDARIES_REFLECTIVE",
+  "isothermal_temperature_in_k": 100.,
+  "potential": "POTENTIAL_NONE",
+  "bondi_pressure_contrast": 200.,
+  "initial_ionisation_radius_in_au": 6.5e4,
+  "ionisation_mode": "IONISATION_MODE_MONTE_CARLO_TRANSFER",
+  "ionisation_transition_width_in_au": 3.e3,
+  "riemannsolver_type": "RIEMANNSOLVER_TYPE_EXACT"
+}
+}
+
+##
+# @brief Configure and compile the code in the given folder.
+#
+# @param folder Build folder.
+# @param options Configuration options.
+##
+def build(folder, options):
+  if not os.path.exists(folder):
+    os.makedirs(folder)
+  command = get_cmake_command.get_cmake_command(dict(options), source_folder)
+  with open(os.path.join(folder, "cmake.log"), "w") as log:
+    subprocess.check_call(command, shell = True, cwd = folder, stdout = log,
+                          stderr = log)
+    subprocess.check_call(["make", "-j", str(multiprocessing.cpu_count())],
+                          cwd = folder, stdout = log, stderr = log)
+
+##
+# @brief Read the phase timers written by a run.
+#
+# @param filename Name of the timers.csv file.
+# @return Dictionary with the total time and number of calls of every phase.
+##
+def read_timers(filename):
+  phases = {}
+  with open(filename, "r") as ifile:
+    header = ifile.readline().strip().split(",")
+    for line in ifile:
+      values = line.strip().split(",")
+      phases[values[0]] = {"time": float(values[header.index("time")]),
+                           "calls": int(values[header.index("calls")])}
+  return phases
+
+##
+# @brief Run a single end-to-end benchmark.
+#
+# @param folder Build folder.
+# @param name Name of the configuration.
+# @param ncell Number of cells.
+# @param nthread Number of threads.
+# @return Benchmark result.
+##
+def run_macro_benchmark(folder, name, ncell, nthread):
+  run_folder = os.path.join(folder, "run_{0}_{1}".format(ncell, nthread))
+  if not os.path.exists(run_folder):
+    os.makedirs(run_folder)
+  environment = dict(os.environ)
+  environment["OMP_NUM_THREADS"] = str(nthread)
+  environment["OMP_PROC_BIND"] = "true"
+  with open(os.path.join(run_folder, "run.log"), "w") as log:
+    subprocess.check_call([os.path.abspath(os.path.join(folder,
+                                                        "HydroCodeSpherical1D")),
+                           str(ncell)], cwd = run_folder, env = environment,
+                          stdout = log, stderr = log)
+  phases = read_timers(os.path.join(run_folder, "timers.csv"))
+  steps = phases["primitives"]["calls"]
+  # the snapshot, log file, checkpoint and analysis phases are I/O and are not
+  # part of the loop time
+  loop_time = sum([phases[phase]["time"] for phase in phases
+                   if not phase in ["snapshot", "logfile", "checkpoint",
+                                    "analysis"]])
+  result = {"name": name, "ncell": ncell, "threads": nthread, "steps": steps,
+            "loop_time": loop_time,
+            "time_per_step": loop_time / steps,
+            "cells_per_second": ncell * steps / loop_time,
+            "phases": dict([(phase, phases[phase]["time"]) for phase in phases
+                            if phases[phase]["calls"] > 0])}
+  print("{0}: {1} cells, {2} threads: {3:g} cells per second".format(
+    name, ncell, nthread, result["cells_per_second"]))
+  return result
+
+##
+# @brief Get the commit hash of the source folder.
+#
+# @return Commit hash, or "unknown".
+##
+def get_commit():
+  try:
+    return subprocess.check_output(["git", "rev-parse", "HEAD"],
+                                   cwd = source_folder).decode().strip()
+  except (OSError, subprocess.CalledProcessError):
+    return "unknown"
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description = "Run the benchmark suite.")
+  parser.add_argument("--ncell", default = "1000,4000",
+                      help = "Comma separated list of cell numbers.")
+  parser.add_argument("--threads", default = "1,{0}".format(
+                        multiprocessing.cpu_count()),
+                      help = "Comma separated list of thread numbers.")
+  parser.add_argument("--steps", default = 200, type = int,
+                      help = "Number of steps for every end-to-end run.")
+  parser.add_argument("--folder", default = "benchmark_builds",
+                      help = "Folder for the build and run folders.")
+  parser.add_argument("--output", default = "benchmark_results.json",
+                      help = "Name of the output file.")
+  args = parser.parse_args()
+  ncells = sorted(set([int(n) for n in args.ncell.split(",")]))
+  nthreads = sorted(set([int(n) for n in args.threads.split(",")]))
+  folder = os.path.abspath(args.folder)
+
+  # microbenchmarks, using the default configuration
+  micro_folder = os.path.join(folder, "micro")
+  build(micro_folder, {})
+  subprocess.check_call(["./benchmarks", "benchmarks.json"],
+                        cwd = micro_folder)
+  with open(os.path.join(micro_folder, "benchmarks.json"), "r") as ifile:
+    micro = json.load(ifile)["benchmarks"]
+
+  # end-to-end benchmarks
+  macro = []
+  for name in sorted(benchmark_configurations):
+    options = dict(benchmark_configurations[name])
+    options["number_of_snaps"] = 1
+    options["max_number_of_steps"] = args.steps
+    config_folder = os.path.join(folder, name)
+    build(config_folder, options)
+    for ncell in ncells:
+      for nthread in nthreads:
+        macro.append(run_macro_benchmark(config_folder, name, ncell, nthread))
+
+  results = {"format": "HydroCodeSpherical1D benchmarks", "version": 1,
+             "type": "suite", "commit": get_commit(),
+             "machine": {"hostname": platform.node(),
+                         "processor": platform.processor(),
+                         "number_of_cpus": multiprocessing.cpu_count()},
+             "micro": micro, "macro": macro}
+  with open(args.output, "w") as ofile:
+    json.dump(results, ofile, indent = 2, sort_keys = True)
+    ofile.write("\n")
+  print("Wrote benchmark results to {0}.".format(args.output))
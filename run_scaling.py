@@ -0,0 +1,309 @@
+#! /usr/bin/python
+
+################################################################################
+# This file is part of HydroCodeSpherical1D
+# Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+#
+# HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# HydroCodeSpherical1D is distributed in the hope that it will be useful,
+# but WITOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+################################################################################
+
+##
+# @file run_scaling.py
+#
+# @brief Scaling regression harness: strong and weak scaling sweeps of the Sod,
+# Bondi (self-consistent ionisation) and Bondi Monte Carlo configurations.
+#
+# Every configuration is configured and compiled once (using the end-to-end
+# benchmark configurations of run_benchmarks.py), and is then run for a fixed
+# number of steps:
+#  - strong scaling: for every number of cells, with all requested numbers of
+#    threads
+#  - weak scaling: for every number of cells per thread, with all requested
+#    numbers of threads and the corresponding total number of cells
+# The parallel efficiency of the main loop and of every phase of the phase
+# timers (timers.csv) is computed with respect to the single thread run:
+# T_1 / (N T_N) for strong scaling and T_1 / T_N for weak scaling (T is the
+# time per step). The phase efficiencies show which part of the step stops
+# scaling (e.g. the serial parts of the Monte Carlo transport, the ionisation
+# radius search or the fork/join overhead of the parallel regions for small
+# grids).
+#
+# The efficiency tables are printed and written to a text file, and all results
+# are written to a JSON file. If a baseline file (an earlier results file) is
+# present, every main loop efficiency is compared with the baseline efficiency
+# for the same configuration, number of cells and number of threads, and the
+# script fails (exit code 1) if the efficiency dropped by more than the given
+# tolerance. Since efficiencies depend on the machine, the baseline should be
+# created on the same machine, using --update-baseline.
+#
+# Usage: python run_scaling.py [--ncell 300,3000,30000,300000,1000000]
+#   [--weak-ncell 300,30000] [--threads 1,2,4] [--steps 50]
+#   [--configurations sod,bondi,bondi_mc] [--folder scaling_builds]
+#   [--output scaling_results.json] [--tables scaling_tables.txt]
+#   [--baseline scaling_baseline.json] [--tolerance 0.1] [--update-baseline]
+#
+# @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+##
+
+import argparse
+import json
+import multiprocessing
+import os
+import platform
+import sys
+
+# the source folder is the folder that contains this script
+source_folder = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, source_folder)
+import run_benchmarks
+
+##
+# @brief Scaling configurations.
+#
+# The Bondi Monte Carlo configuration is the Starbench test, which uses the
+# Bondi equation of state with Monte Carlo photoionisation. The Sod
+# configuration uses a 1000 times larger time unit than the benchmark
+# configuration, so that the fixed time step stays below the CFL limit for
+# 10^6 cells.
+##
+scaling_configurations = {
+"sod": dict(run_benchmarks.benchmark_configurations["sod"],
+            g_internal = 6.67408e11),
+"bondi": run_benchmarks.benchmark_configurations["bondi"],
+"bondi_mc": run_benchmarks.benchmark_configurations["starbench"]
+}
+
+##
+# @brief Get the default list of thread numbers: all powers of two up to the
+# number of CPUs, and the number of CPUs itself.
+#
+# @return Comma separated list of thread numbers.
+##
+def get_default_threads():
+  ncpu = multiprocessing.cpu_count()
+  threads = [1]
+  while threads[-1] * 2 <= ncpu:
+    threads.append(threads[-1] * 2)
+  if threads[-1] != ncpu:
+    threads.append(ncpu)
+  return ",".join([str(n) for n in threads])
+
+##
+# @brief Compute the parallel efficiencies of a series of runs.
+#
+# @param runs Results of run_benchmarks.run_macro_benchmark() for the same
+# configuration and number of cells (per thread, for weak scaling), sorted on
+# the number of threads. The first run needs to use a single thread.
+# @param weak Is this a weak scaling series?
+# @return Scaling series: the runs, and the efficiencies of the main loop and
+# of every phase for every run.
+##
+def get_efficiencies(runs, weak):
+  reference = runs[0]
+  phases = sorted([phase for phase in reference["phases"]
+                   if reference["phases"][phase] > 0.])
+  series = []
+  for run in runs:
+    nthread = run["threads"]
+    factor = 1. if weak else float(nthread)
+    efficiency = reference["time_per_step"] / (factor * run["time_per_step"])
+    phase_efficiencies = {}
+    for phase in phases:
+      time_per_step = run["phases"].get(phase, 0.) / run["steps"]
+      if time_per_step > 0.:
+        phase_efficiencies[phase] = \
+          reference["phases"][phase] / reference["steps"] / \
+          (factor * time_per_step)
+    series.append({"name": run["name"], "ncell": run["ncell"],
+                   "threads": nthread, "steps": run["steps"],
+                   "time_per_step": run["time_per_step"],
+                   "speedup": reference["time_per_step"] / run["time_per_step"],
+                   "efficiency": efficiency,
+                   "phase_efficiencies": phase_efficiencies})
+  return series
+
+##
+# @brief Format the efficiency table of a scaling series.
+#
+# Only phases that take at least 1% of the single thread loop time are shown.
+#
+# @param title Title of the table.
+# @param series Scaling series (see get_efficiencies()).
+# @param reference Single thread run of the series.
+# @return Table, as a list of lines.
+##
+def format_table(title, series, reference):
+  phases = sorted([phase for phase in series[0]["phase_efficiencies"]
+                   if reference["phases"][phase] >=
+                      0.01 * reference["loop_time"]])
+  lines = [title]
+  header = "{0:>8} {1:>8} {2:>12} {3:>8} {4:>6}".format(
+             "threads", "ncell", "time/step", "speedup", "eff")
+  for phase in phases:
+    header += " {0:>13}".format(phase)
+  lines.append(header)
+  for entry in series:
+    line = "{0:>8} {1:>8} {2:>12.4e} {3:>8.2f} {4:>6.2f}".format(
+             entry["threads"], entry["ncell"], entry["time_per_step"],
+             entry["speedup"], entry["efficiency"])
+    for phase in phases:
+      if phase in entry["phase_efficiencies"]:
+        line += " {0:>13.2f}".format(entry["phase_efficiencies"][phase])
+      else:
+        line += " {0:>13}".format("-")
+    lines.append(line)
+  lines.append("")
+  return lines
+
+##
+# @brief Compare the efficiencies with the baseline efficiencies.
+#
+# @param results Scaling results.
+# @param baseline Baseline scaling results.
+# @param tolerance Maximum allowed drop in efficiency.
+# @return List of regressions, as messages.
+##
+def compare_with_baseline(results, baseline, tolerance):
+  regressions = []
+  for mode in ["strong", "weak"]:
+    reference = {}
+    for series in baseline.get(mode, []):
+      for entry in series:
+        reference[(entry["name"], entry["ncell"], entry["threads"])] = \
+          entry["efficiency"]
+    for series in results[mode]:
+      for entry in series:
+        key = (entry["name"], entry["ncell"], entry["threads"])
+        # the single thread efficiency is always 1
+        if entry["threads"] > 1 and key in reference and \
+           entry["efficiency"] < reference[key] - tolerance:
+          regressions.append(
+            "{0} scaling of {1}, {2} cells, {3} threads: efficiency {4:.2f} "
+            "(baseline {5:.2f})".format(mode, key[0], key[1], key[2],
+                                        entry["efficiency"], reference[key]))
+  return regressions
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description = "Run the scaling sweeps.")
+  parser.add_argument("--ncell", default = "300,3000,30000,300000,1000000",
+                      help = "Comma separated list of cell numbers for the "
+                             "strong scaling sweep.")
+  parser.add_argument("--weak-ncell", default = "300,30000",
+                      help = "Comma separated list of cell numbers per thread "
+                             "for the weak scaling sweep.")
+  parser.add_argument("--threads", default = get_default_threads(),
+                      help = "Comma separated list of thread numbers.")
+  parser.add_argument("--steps", default = 50, type = int,
+                      help = "Number of steps for every run.")
+  parser.add_argument("--configurations",
+                      default = ",".join(sorted(scaling_configurations)),
+                      help = "Comma separated list of configurations.")
+  parser.add_argument("--folder", default = "scaling_builds",
+                      help = "Folder for the build and run folders.")
+  parser.add_argument("--output", default = "scaling_results.json",
+                      help = "Name of the output file.")
+  parser.add_argument("--tables", default = "scaling_tables.txt",
+                      help = "Name of the efficiency table file.")
+  parser.add_argument("--baseline", default = "scaling_baseline.json",
+                      help = "Name of the baseline file.")
+  parser.add_argument("--tolerance", default = 0.1, type = float,
+                      help = "Maximum allowed drop in efficiency with respect "
+                             "to the baseline.")
+  parser.add_argument("--update-baseline", action = "store_true",
+                      help = "Write the results to the baseline file instead "
+                             "of comparing with it.")
+  args = parser.parse_args()
+  ncells = sorted(set([int(n) for n in args.ncell.split(",")]))
+  weak_ncells = sorted(set([int(n) for n in args.weak_ncell.split(",")]))
+  # the efficiencies are computed with respect to the single thread run
+  nthreads = sorted(set([1] + [int(n) for n in args.threads.split(",")]))
+  names = args.configurations.split(",")
+  for name in names:
+    if not name in scaling_configurations:
+      print("Unknown configuration: {0}!".format(name))
+      sys.exit(1)
+  folder = os.path.abspath(args.folder)
+
+  if nthreads[-1] > multiprocessing.cpu_count():
+    print("Warning: more threads than CPUs ({0}), the efficiencies will be "
+          "low!".format(multiprocessing.cpu_count()))
+
+  results = {"format": "HydroCodeSpherical1D scaling", "version": 1,
+             "commit": run_benchmarks.get_commit(),
+             "machine": {"hostname": platform.node(),
+                         "processor": platform.processor(),
+                         "number_of_cpus": multiprocessing.cpu_count()},
+             "steps": args.steps, "strong": [], "weak": []}
+  tables = []
+  for name in names:
+    options = dict(scaling_configurations[name])
+    options["number_of_snaps"] = 1
+    options["max_number_of_steps"] = args.steps
+    config_folder = os.path.join(folder, name)
+    run_benchmarks.build(config_folder, options)
+    # runs are shared by the strong and weak scaling sweeps
+    runs = {}
+    def get_run(ncell, nthread):
+      if not (ncell, nthread) in runs:
+        runs[(ncell, nthread)] = run_benchmarks.run_macro_benchmark(
+                                   config_folder, name, ncell, nthread)
+      return runs[(ncell, nthread)]
+
+    for ncell in ncells:
+      series = get_efficiencies([get_run(ncell, nthread)
+                                 for nthread in nthreads], False)
+      results["strong"].append(series)
+      tables += format_table(
+        "{0}: strong scaling, {1} cells".format(name, ncell), series,
+        get_run(ncell, 1))
+    for ncell in weak_ncells:
+      series = get_efficiencies([get_run(ncell * nthread, nthread)
+                                 for nthread in nthreads], True)
+      results["weak"].append(series)
+      tables += format_table(
+        "{0}: weak scaling, {1} cells per thread".format(name, ncell), series,
+        get_run(ncell, 1))
+
+  print("")
+  print("\n".join(tables))
+  with open(args.tables, "w") as ofile:
+    ofile.write("\n".join(tables))
+  with open(args.output, "w") as ofile:
+    json.dump(results, ofile, indent = 2, sort_keys = True)
+    ofile.write("\n")
+  print("Wrote scaling results to {0} and {1}.".format(args.output,
+                                                       args.tables))
+
+  if args.update_baseline:
+    with open(args.baseline, "w") as ofile:
+      json.dump(results, ofile, indent = 2, sort_keys = True)
+      ofile.write("\n")
+    print("Wrote scaling baseline to {0}.".format(args.baseline))
+  elif os.path.exists(args.baseline):
+    with open(args.baseline, "r") as ifile:
+      baseline = json.load(ifile)
+    if baseline["machine"] != results["machine"]:
+      print("Warning: the baseline was created on a different machine!")
+    regressions = compare_with_baseline(results, baseline, args.tolerance)
+    if len(regressions) > 0:
+      print("Parallel efficiency dropped with respect to {0}:".format(
+              args.baseline))
+      for regression in regressions:
+        print("  " + regression)
+      sys.exit(1)
+    print("No parallel efficiency regressions with respect to {0}.".format(
+            args.baseline))
+  else:
+    print("No baseline file {0}, use --update-baseline to create it.".format(
+            args.baseline))
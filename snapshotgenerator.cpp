@@ -1,123 +1,184 @@
+/*******************************************************************************
+ * This file is part of HydroCodeSpherical1D
+ * Copyright (C) 2017 Bert Vandenbroucke (bert.vandenbroucke@gmail.com)
+ *
+ * HydroCodeSpherical1D is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HydroCodeSpherical1D is distributed in the hope that it will be useful,
+ * but WITOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with HydroCodeSpherical1D. If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+/**
+ * @file snapshotgenerator.cpp
+ *
+ * @brief Reconstruct snapshots at arbitrary times from a cell event log file.
+ *
+ * The log file (see CellLog.hpp) is memory-mapped, and all snapshots are
+ * reconstructed during a single linear pass over the records: for every cell
+ * and variable, we keep track of the last record we encountered, and linearly
+ * interpolate between that record and the next one for all snapshot times in
+ * between.
+ *
+ * @author Bert Vandenbroucke (bv7@st-andrews.ac.uk)
+ */
+#include "CellLog.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
-#include <map>
 #include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
-enum LogEntry {
-  LOGENTRY_DENSITY = 0,
-  LOGENTRY_VELOCITY,
-  LOGENTRY_PRESSURE,
-  LOGENTRY_NFRAC,
-  NUMBER_OF_LOGENTRIES
-};
-
-struct Entry {
-  unsigned long _previous_entry;
-  unsigned short _index;
-  LogEntry _entry;
-  double _time;
-  double _value;
-};
-
-Entry read_entry(unsigned long position, std::ifstream &file) {
-  file.seekg(position);
-  Entry entry;
-  file.read(reinterpret_cast<char *>(&entry._previous_entry),
-            sizeof(unsigned long));
-  file.read(reinterpret_cast<char *>(&entry._index), sizeof(unsigned short));
-  file.read(reinterpret_cast<char *>(&entry._entry), sizeof(int));
-  file.read(reinterpret_cast<char *>(&entry._time), sizeof(double));
-  file.read(reinterpret_cast<char *>(&entry._value), sizeof(double));
-  return entry;
-}
-
-void print_entry(const Entry &entry, std::ostream &out) {
-  out << "Entry:\n";
-  out << entry._previous_entry << "\n";
-  out << entry._index << "\n";
-  out << entry._entry << "\n";
-  out << entry._time << "\n";
-  out << entry._value << "\n";
-}
+/**
+ * @brief Reconstruct snapshots from a log file.
+ *
+ * Usage: ./SnapshotGenerator [logfile [number_of_snapshots]]
+ * The snapshots are evenly spaced in time between the first and last block in
+ * the log file, and are written to logsnap_XXXX.txt.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @return Exit code: 0 on success.
+ */
+int main(int argc, char **argv) {
 
-std::map<double, double> get_quantity(LogEntry type, unsigned short index,
-                                      std::ifstream &ifile) {
-  const unsigned int lastpos = ifile.tellg();
-  // find first entry for particle
-  unsigned long pos = ifile.tellg();
-  pos -= 30;
-  Entry entry = read_entry(pos, ifile);
-  while (entry._index != index) {
-    pos -= 30;
-    entry = read_entry(pos, ifile);
+  std::string filename = "logfile.dat";
+  uint_fast32_t number_of_snaps = 10;
+  if (argc > 1) {
+    filename = argv[1];
   }
-  // bingo: found last entry
-  // now try to find the last entry containing the quantity of interest
-  // (this is guaranteed to exist)
-  long next_pos = pos - entry._previous_entry;
-  while (entry._entry != type) {
-    pos = next_pos;
-    entry = read_entry(pos, ifile);
-    next_pos = pos - entry._previous_entry;
+  if (argc > 2) {
+    number_of_snaps = atoi(argv[2]);
   }
-  // bingo: found last entry of interest
-  std::map<double, double> table;
-  while (next_pos >= 0 && pos != next_pos && entry._index == index) {
-    if (entry._entry == type) {
-      table[entry._time] = entry._value;
-      //      print_entry(entry, std::cout);
-    }
-    pos = next_pos;
-    entry = read_entry(pos, ifile);
-    next_pos = pos - entry._previous_entry;
+  if (number_of_snaps < 1) {
+    std::cerr << "Need at least 1 snapshot!" << std::endl;
+    return 1;
+  }
+
+  // memory-map the entire log file
+  const int file = open(filename.c_str(), O_RDONLY);
+  if (file < 0) {
+    std::cerr << "Error opening log file!" << std::endl;
+    return 1;
+  }
+  struct stat file_stat;
+  if (fstat(file, &file_stat) != 0 ||
+      static_cast<size_t>(file_stat.st_size) < sizeof(CellLogTrailer)) {
+    std::cerr << "Invalid log file!" << std::endl;
+    return 1;
   }
-  if (entry._index == index && entry._entry == type) {
-    table[entry._time] = entry._value;
-    //    print_entry(entry, std::cout);
+  const size_t file_size = file_stat.st_size;
+  const char *memory = reinterpret_cast<const char *>(
+      mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file, 0));
+  if (memory == MAP_FAILED) {
+    std::cerr << "Error memory mapping log file!" << std::endl;
+    return 1;
   }
 
-  // reset file
-  ifile.seekg(lastpos);
-  return table;
-}
+  // read the trailer and the block index
+  CellLogTrailer trailer;
+  std::memcpy(&trailer, memory + file_size - sizeof(CellLogTrailer),
+              sizeof(CellLogTrailer));
+  if (std::strncmp(trailer._signature, "HCS1DLOG", 8) != 0 ||
+      trailer._number_of_entries != NUMBER_OF_LOGENTRIES ||
+      trailer._number_of_blocks == 0) {
+    std::cerr << "Log file has no valid index!" << std::endl;
+    return 1;
+  }
+  const uint_fast32_t ncell = trailer._number_of_cells;
+  const uint_fast64_t number_of_records =
+      trailer._block_index_offset / sizeof(LogRecord);
+  const char *block_index = memory + trailer._block_index_offset;
+  const size_t block_entry_size = sizeof(double) + 2 * sizeof(uint64_t);
+  double start_time, end_time;
+  std::memcpy(&start_time, block_index, sizeof(double));
+  std::memcpy(&end_time,
+              block_index + (trailer._number_of_blocks - 1) * block_entry_size,
+              sizeof(double));
 
-int main(int argc, char **argv) {
+  std::cout << "Log file contains " << number_of_records << " records for "
+            << ncell << " cells between t = " << start_time
+            << " s and t = " << end_time << " s." << std::endl;
 
-  std::ifstream ifile("logfile.dat", std::ios::binary | std::ios::ate);
-  const unsigned long lastpos = ifile.tellg();
-  Entry entry = read_entry(lastpos - 30, ifile);
-  const double endtime = entry._time;
+  std::vector<double> snaptimes(number_of_snaps, start_time);
+  for (uint_fast32_t isnap = 1; isnap < number_of_snaps; ++isnap) {
+    snaptimes[isnap] = start_time + isnap * (end_time - start_time) /
+                                        (number_of_snaps - 1);
+  }
 
-  std::vector<std::vector<double>> snaps(10, std::vector<double>(1000, 0.));
+  // per cell and variable: last record, and index of the next snapshot that
+  // still needs a value
+  const uint_fast64_t nvariable = ncell * NUMBER_OF_LOGENTRIES;
+  std::vector<bool> has_last(nvariable, false);
+  std::vector<double> last_time(nvariable, 0.);
+  std::vector<double> last_value(nvariable, 0.);
+  std::vector<uint_fast32_t> next_snap(nvariable, 0);
+  std::vector<double> snaps(number_of_snaps * nvariable, 0.);
 
-  const double snaptime = 0.1 * endtime;
-  for (unsigned int i = 0; i < 1000; ++i) {
-    std::map<double, double> table = get_quantity(LOGENTRY_DENSITY, i, ifile);
-    for (unsigned int j = 0; j < 10; ++j) {
-      // find the time keys surrounding the snapshot time
-      const double t = j * snaptime;
-      auto upper_bound = table.upper_bound(t);
-      auto lower_bound = upper_bound--;
-      const double t0 = lower_bound->first;
-      const double t1 = upper_bound->first;
-      const double v0 = lower_bound->second;
-      const double v1 = upper_bound->second;
-      const double tfac = (t - t0) / (t1 - t0);
-      snaps[j][i] = (1. - tfac) * v0 + tfac * v1;
+  // single linear pass over all records
+  const LogRecord *records = reinterpret_cast<const LogRecord *>(memory);
+  for (uint_fast64_t irecord = 0; irecord < number_of_records; ++irecord) {
+    const LogRecord &record = records[irecord];
+    if (record._index >= ncell || record._entry >= NUMBER_OF_LOGENTRIES) {
+      std::cerr << "Invalid record in log file!" << std::endl;
+      return 1;
+    }
+    const uint_fast64_t ivar =
+        record._index * NUMBER_OF_LOGENTRIES + record._entry;
+    uint_fast32_t &isnap = next_snap[ivar];
+    while (isnap < number_of_snaps && snaptimes[isnap] < record._time) {
+      double value = record._value;
+      if (has_last[ivar]) {
+        const double tfac = (snaptimes[isnap] - last_time[ivar]) /
+                            (record._time - last_time[ivar]);
+        value = (1. - tfac) * last_value[ivar] + tfac * record._value;
+      }
+      snaps[isnap * nvariable + ivar] = value;
+      ++isnap;
     }
+    has_last[ivar] = true;
+    last_time[ivar] = record._time;
+    last_value[ivar] = record._value;
   }
+  // snapshots after the last record of a variable get the last value
+  for (uint_fast64_t ivar = 0; ivar < nvariable; ++ivar) {
+    for (uint_fast32_t isnap = next_snap[ivar]; isnap < number_of_snaps;
+         ++isnap) {
+      snaps[isnap * nvariable + ivar] = last_value[ivar];
+    }
+  }
+
+  munmap(const_cast<char *>(memory), file_size);
+  close(file);
 
-  for (unsigned int j = 0; j < 10; ++j) {
-    std::stringstream filename;
-    filename << "logsnap_";
-    filename.fill('0');
-    filename.width(4);
-    filename << j;
-    filename << ".txt";
-    std::ofstream ofile(filename.str());
-    for (unsigned int i = 0; i < 1000; ++i) {
-      ofile << i * 0.001 << "\t" << snaps[j][i] << "\n";
+  for (uint_fast32_t isnap = 0; isnap < number_of_snaps; ++isnap) {
+    std::stringstream snapname;
+    snapname << "logsnap_";
+    snapname.fill('0');
+    snapname.width(4);
+    snapname << isnap;
+    snapname << ".txt";
+    std::ofstream ofile(snapname.str());
+    ofile << "# time: " << snaptimes[isnap] << "\n";
+    for (uint_fast32_t i = 0; i < ncell; ++i) {
+      const double *values =
+          &snaps[isnap * nvariable + i * NUMBER_OF_LOGENTRIES];
+      ofile << i << "\t" << values[LOGENTRY_DENSITY] << "\t"
+            << values[LOGENTRY_VELOCITY] << "\t" << values[LOGENTRY_PRESSURE]
+            << "\t" << values[LOGENTRY_NFRAC] << "\n";
     }
   }
 